@@ -10,7 +10,10 @@ CREATE TABLE IF NOT EXISTS agents (
     matches_played INT DEFAULT 0 COMMENT 'Total matches played',
     matches_won INT DEFAULT 0 COMMENT 'Matches won',
     matches_played_white INT DEFAULT 0 COMMENT 'Matches played as white',
-    matches_won_white INT DEFAULT 0 COMMENT 'Matches won as white'
+    matches_won_white INT DEFAULT 0 COMMENT 'Matches won as white',
+
+    change_seq BIGINT NOT NULL DEFAULT 0 COMMENT 'Change sequence of the last insert or update',
+    INDEX idx_agents_change_seq (change_seq)
 
 ) COMMENT='Saves all agents and their stats';
 
@@ -19,6 +22,8 @@ CREATE TABLE IF NOT EXISTS board_states (
     agent_id BIGINT NOT NULL COMMENT 'Reference to Agent',
     
     board_state VARCHAR(255) NOT NULL COMMENT 'Board-State as String (e.g. "222000111")',
+
+    UNIQUE KEY uq_board_states_agent_state (agent_id, board_state),
     
     CONSTRAINT fk_board_states_agent FOREIGN KEY (agent_id) 
         REFERENCES agents(id) ON DELETE CASCADE ON UPDATE CASCADE
@@ -33,7 +38,33 @@ CREATE TABLE IF NOT EXISTS game_moves (
     from_y INT NOT NULL COMMENT 'from Y-Position',
     to_x INT NOT NULL COMMENT 'to X-Position',
     to_y INT NOT NULL COMMENT 'to Y-Position',
+
+    UNIQUE KEY uq_game_moves_state_move (board_state_id, from_x, from_y, to_x, to_y),
     
     CONSTRAINT fk_game_moves_board_state FOREIGN KEY (board_state_id) 
         REFERENCES board_states(id) ON DELETE CASCADE ON UPDATE CASCADE
-) COMMENT='Saves all moves of a Board-State';
\ No newline at end of file
+) COMMENT='Saves all moves of a Board-State';
+
+CREATE TABLE IF NOT EXISTS agent_blobs (
+    agent_id BIGINT PRIMARY KEY COMMENT 'Reference to Agent',
+    format_version INT NOT NULL DEFAULT 1 COMMENT 'Version of the blob layout',
+
+    board_states LONGBLOB NOT NULL COMMENT 'All board states and moves of the agent (AgentBlobCodec)',
+
+    CONSTRAINT fk_agent_blobs_agent FOREIGN KEY (agent_id)
+        REFERENCES agents(id) ON DELETE CASCADE ON UPDATE CASCADE
+) COMMENT='Saves the board states of an agent as one blob (agent_storage blob)';
+
+CREATE TABLE IF NOT EXISTS agent_tombstones (
+    agent_id BIGINT PRIMARY KEY COMMENT 'Server-ID of the deleted Agent',
+    change_seq BIGINT NOT NULL COMMENT 'Change sequence of the delete',
+
+    INDEX idx_agent_tombstones_change_seq (change_seq)
+) COMMENT='Saves deleted agents, so clients that sync changes remove them too';
+
+CREATE TABLE IF NOT EXISTS change_sequence (
+    id TINYINT PRIMARY KEY COMMENT 'Always 1',
+    value BIGINT NOT NULL COMMENT 'Last handed out change sequence'
+) COMMENT='Counter behind agents.change_seq, the row lock orders the changes by commit';
+
+INSERT IGNORE INTO change_sequence (id, value) VALUES (1, 0);
\ No newline at end of file
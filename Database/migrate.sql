@@ -0,0 +1,89 @@
+-- Brings a database created by an older init.sql up to date, can run any number of times.
+-- The columns, keys and tables only exist as CREATE TABLE IF NOT EXISTS in init.sql,
+-- which never changes a table that already exists.
+-- Run: build db-migrate (or pipe this file into the mysql client)
+USE game;
+
+CREATE TABLE IF NOT EXISTS agent_blobs (
+    agent_id BIGINT PRIMARY KEY COMMENT 'Reference to Agent',
+    format_version INT NOT NULL DEFAULT 1 COMMENT 'Version of the blob layout',
+
+    board_states LONGBLOB NOT NULL COMMENT 'All board states and moves of the agent (AgentBlobCodec)',
+
+    CONSTRAINT fk_agent_blobs_agent FOREIGN KEY (agent_id)
+        REFERENCES agents(id) ON DELETE CASCADE ON UPDATE CASCADE
+) COMMENT='Saves the board states of an agent as one blob (agent_storage blob)';
+
+CREATE TABLE IF NOT EXISTS agent_tombstones (
+    agent_id BIGINT PRIMARY KEY COMMENT 'Server-ID of the deleted Agent',
+    change_seq BIGINT NOT NULL COMMENT 'Change sequence of the delete',
+
+    INDEX idx_agent_tombstones_change_seq (change_seq)
+) COMMENT='Saves deleted agents, so clients that sync changes remove them too';
+
+CREATE TABLE IF NOT EXISTS change_sequence (
+    id TINYINT PRIMARY KEY COMMENT 'Always 1',
+    value BIGINT NOT NULL COMMENT 'Last handed out change sequence'
+) COMMENT='Counter behind agents.change_seq, the row lock orders the changes by commit';
+
+INSERT IGNORE INTO change_sequence (id, value) VALUES (1, 0);
+
+DELIMITER //
+
+DROP PROCEDURE IF EXISTS migrate_game //
+CREATE PROCEDURE migrate_game()
+BEGIN
+    -- agents.change_seq, the existing agents start at 0 and are found by the full sync
+    IF NOT EXISTS (SELECT 1 FROM information_schema.COLUMNS
+        WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = 'agents' AND COLUMN_NAME = 'change_seq') THEN
+        ALTER TABLE agents
+            ADD COLUMN change_seq BIGINT NOT NULL DEFAULT 0 COMMENT 'Change sequence of the last insert or update';
+    END IF;
+
+    IF NOT EXISTS (SELECT 1 FROM information_schema.STATISTICS
+        WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = 'agents' AND INDEX_NAME = 'idx_agents_change_seq') THEN
+        ALTER TABLE agents ADD INDEX idx_agents_change_seq (change_seq);
+    END IF;
+
+    -- board states that exist twice keep the lowest id, the moves of the others move over to it
+    IF NOT EXISTS (SELECT 1 FROM information_schema.STATISTICS
+        WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = 'board_states' AND INDEX_NAME = 'uq_board_states_agent_state') THEN
+        DROP TEMPORARY TABLE IF EXISTS duplicate_board_states;
+        CREATE TEMPORARY TABLE duplicate_board_states AS
+            SELECT b.id, k.keep_id
+            FROM board_states b
+            JOIN (
+                SELECT agent_id, board_state, MIN(id) AS keep_id
+                FROM board_states
+                GROUP BY agent_id, board_state
+                HAVING COUNT(*) > 1
+            ) k ON k.agent_id = b.agent_id AND k.board_state = b.board_state AND b.id <> k.keep_id;
+
+        UPDATE game_moves m
+            JOIN duplicate_board_states d ON d.id = m.board_state_id
+            SET m.board_state_id = d.keep_id;
+        DELETE b FROM board_states b
+            JOIN duplicate_board_states d ON d.id = b.id;
+        DROP TEMPORARY TABLE duplicate_board_states;
+
+        ALTER TABLE board_states ADD UNIQUE KEY uq_board_states_agent_state (agent_id, board_state);
+    END IF;
+
+    -- moves that exist twice for one state (also the ones merged above) keep the lowest id
+    IF NOT EXISTS (SELECT 1 FROM information_schema.STATISTICS
+        WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME = 'game_moves' AND INDEX_NAME = 'uq_game_moves_state_move') THEN
+        DELETE m FROM game_moves m
+            JOIN game_moves k
+                ON k.board_state_id = m.board_state_id
+                AND k.from_x = m.from_x AND k.from_y = m.from_y
+                AND k.to_x = m.to_x AND k.to_y = m.to_y
+                AND k.id < m.id;
+
+        ALTER TABLE game_moves ADD UNIQUE KEY uq_game_moves_state_move (board_state_id, from_x, from_y, to_x, to_y);
+    END IF;
+END //
+
+DELIMITER ;
+
+CALL migrate_game();
+DROP PROCEDURE migrate_game;
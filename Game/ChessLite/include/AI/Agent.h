@@ -1,6 +1,8 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <CoreChessLib/ChessGame.h>
 #include <CoreChessLib/ChessContext.h>
@@ -17,6 +19,37 @@ struct AgentPersistentData {
 	int matchesWonAsWhite = 0;
 };
 
+template<>
+struct OTN::OTNBinding<AgentPersistentData> {
+	static constexpr const char* NAME = "AgentPersistentData";
+
+	static auto Fields() {
+		return std::make_tuple(
+			OTN::BindField("matches_played", &AgentPersistentData::matchesPlayed),
+			OTN::BindField("matches_won", &AgentPersistentData::matchesWon),
+			OTN::BindField("matches_played_white", &AgentPersistentData::matchesPlayedAsWhite),
+			OTN::BindField("matches_won_white", &AgentPersistentData::matchesWonAsWhite)
+		);
+	}
+};
+
+/**
+* @brief Training of a registered agent since its last sync, sent to the server as delta (SyncAgentDeltas).
+*
+* The server adds the deltas to what it stores, so training of several clients on the same
+* agent adds up instead of the newest version overwriting the others.
+*/
+struct AgentTrainingDelta {
+	AgentPersistentData matches;/* < matches played since the last sync*/
+	std::unordered_map<std::string, std::vector<GameMove>> states;/* < board state to moves, the evaluation is the summed change*/
+
+	bool IsEmpty() const;
+	/*< adds the state with all its moves, a state unknown to the server is created from them */
+	void AddState(const std::string& state, const std::vector<GameMove>& moves);
+	void AddEvaluation(const std::string& state, const GameMove& move, float eval);
+	void Merge(AgentTrainingDelta&& other);
+};
+
 class Agent {
 friend class AgentSyncService;
 friend class AgentManager;
@@ -49,9 +82,12 @@ public:
 
 	bool IsAgentCurrentlyWhite() const;
 	bool IsAgentDirty() const;
+	/*< true if the evaluations of the state changed since the last version the server confirmed */
+	bool IsBoardStateDirty(const BoardState& state) const;
 	float GetExplorationChance() const;
 	const std::unordered_map<std::string, BoardState>& GetNormilzedBoardStates() const;
 	const std::vector<std::pair<std::string, size_t>>& GetMoveHistory() const;
+	bool HasTrainingDelta() const;
 
 private:
 	bool m_gameFinished = true;
@@ -59,6 +95,7 @@ private:
 	AgentID m_id;
 	AgentID m_serverID{ 0 };
 	size_t m_version = 0;
+	size_t m_syncedVersion = 0;/* < last version the server has, set on load and by MarkClean*/
 	std::string m_name = "UNKOWN";
 	int m_matchesPlayed = 0;
 	int m_matchesWon = 0;
@@ -71,6 +108,12 @@ private:
 	std::unordered_map<std::string, BoardState> m_boardStates;/* < normalized board position to board state*/
 
 	std::vector<std::pair<std::string, size_t>> m_moveHistory;/* < board state, move index*/
+	std::unordered_set<std::string> m_newStates;/* < states created in the current game*/
+	AgentTrainingDelta m_trainingDelta;/* < training not yet sent to the server*/
+	size_t m_deltaRevision = 0;/* < changes with every game added to the delta, to persist it*/
+
+	/*< adds the delta on top of the board states and stats, used to rebase onto a newer server version */
+	void ApplyTrainingDelta(const AgentTrainingDelta& delta);
 	
 	std::string GetNormalizedBoardStr(const CoreChess::ChessBoard& board, bool isWhite);
 
@@ -3,6 +3,7 @@
 #include <unordered_set>
 #include <CoreLib/OTNFile.h>
 #include "AI/Agent.h"
+#include "AI/AgentSaveWorker.h"
 #include "Type.h"
 
 class AgentSyncService;
@@ -15,15 +16,65 @@ public:
 	AgentManager() = default;
 	~AgentManager() = default;
 
+	/**
+	* @brief Persists all agent changes since the last save.
+	*
+	* Changed and removed agents are appended as a new segment to the agent journal.
+	* Once the journal grows too large it is compacted into a new Agents snapshot.
+	* Waits until the saver thread wrote the files.
+	*
+	* @param path Data directory containing the agent files
+	* @return true on success
+	*/
 	bool Save(const OTN::OTNFilePath& path);
+	/**
+	* @brief Like Save, but returns once the documents are built and leaves the writing to the saver thread.
+	*
+	* A queued snapshot replaces the saves still waiting, errors are logged by the next save.
+	*/
+	void SaveAsync(const OTN::OTNFilePath& path);
 	void Load(const OTN::OTNObject& agents);
 
+	/**
+	* @brief Replays the agent journal on top of the loaded Agents snapshot.
+	* 
+	* note: has to be called after Load
+	* 
+	* @param path Data directory containing the agent files
+	*/
+	void LoadJournal(const OTN::OTNFilePath& path);
+
 	void AddAgent(Agent agent);
 	bool RemoveAgent(AgentID id);
+
+	/**
+	* @brief Applies agents received from the server.
+	*
+	* Unknown agents are added, known agents are replaced if the received version is newer.
+	* Agents with unsynced local changes or deleted locally are kept as they are,
+	* the server compares the versions once they are synced.
+	*
+	* @param agents Agents with their server ID and version set
+	*/
+	void UpsertServerAgents(std::vector<Agent>&& agents);
+
+	/**
+	* @brief Removes the agents that were deleted on the server.
+	* @param serverIDs Server IDs of the deleted agents
+	*/
+	void RemoveServerAgents(const std::vector<AgentID>& serverIDs);
 	void MarkAgentAsRegistered(AgentID localId, AgentID serverId);
 	void MarkAgentsClean(AgentID localId, size_t version);
 
-	OTN::OTNObject BuildOTNObjectFromIDs(const std::unordered_set<AgentID>& agents, bool includeLocalID = false);
+	/**
+	* @brief Builds the agent rows sent to the server.
+	* @param dirtyStatesOnly only the board states changed since the last sync (SyncDirtyStates)
+	*/
+	OTN::OTNObject BuildOTNObjectFromIDs(const std::unordered_set<AgentID>& agents, bool includeLocalID = false, bool dirtyStatesOnly = false);
+	/*< same rows as BuildOTNObjectFromIDs with the local id, as v2 body (NetBodyFormat::AGENTS of the server) */
+	std::string BuildBinaryFromIDs(const std::unordered_set<AgentID>& agents, bool dirtyStatesOnly = false) const;
+	/*< the deltas as v2 body of SyncAgentDeltas, the evaluation of a move is its change */
+	static std::string BuildBinaryTrainingDeltas(const std::vector<std::pair<AgentID, AgentTrainingDelta>>& deltas);
 
 	Agent* GetAgent(AgentID id);
 
@@ -49,12 +100,73 @@ public:
 	const std::unordered_set<AgentID>& GetDeletedServerAgents() const;
 	std::unordered_set<AgentID> GetDirtyAgents() const;
 
+	bool HasTrainingDeltas() const;
+	/**
+	* @brief Hands out the training deltas of the registered agents and starts new ones.
+	*
+	* A delta that is handed out is no longer saved, it is lost if the client quits before the server replied.
+	* @return server ID of the agent and its delta
+	*/
+	std::vector<std::pair<AgentID, AgentTrainingDelta>> TakeTrainingDeltas();
+	/*< puts deltas back that could not be sent, deltas of deleted agents are dropped */
+	void RequeueTrainingDeltas(std::vector<std::pair<AgentID, AgentTrainingDelta>>&& deltas);
+	/**
+	* @brief The server added the delta of the agent, version is the server version containing it.
+	*
+	* If no other client changed the agent in between, the local agent equals that version.
+	* Otherwise the newer version comes with the next changes and the local delta is rebased onto it.
+	*/
+	void ConfirmTrainingDelta(AgentID serverID, size_t version);
+
+	/*< last change sequence of the server that was applied, 0 if the agents were never synced */
+	int64_t GetChangeSequence() const;
+	void SetChangeSequence(int64_t sequence);
+
 private:
+	struct PersistedAgentState {
+		size_t version = 0;
+		size_t deltaRevision = 0;
+		AgentID serverID{ 0 };
+	};
+
+	static constexpr size_t MAX_JOURNAL_SEGMENTS = 32;
+
 	CoreAppIDManager m_idManager;
 	std::unordered_map<AgentID, Agent> m_agents;
 	std::unordered_set<AgentID> m_unregisteredAgentIds;
 
 	std::unordered_set<AgentID> m_deletedServerAgents;
+	int64_t m_changeSequence = 0;
+
+	// persistence, storage ids are stable across sessions unlike the local ids
+	int64_t m_nextStorageID = 1;
+	std::unordered_map<AgentID, int64_t> m_storageIDs;
+	std::unordered_map<int64_t, AgentID> m_localIDsByStorageID;
+	std::unordered_map<int64_t, PersistedAgentState> m_persistedStates;/* < state of each agent as it is on disk*/
+	std::vector<int64_t> m_removedStorageIDs;/* < persisted agents removed since the last save*/
+	size_t m_journalSegmentCount = 0;
+	size_t m_journalRowCount = 0;
+	bool m_snapshotOutdated = false;
+	AgentSaveWorker m_saveWorker;// < last, joined before the other members are destroyed
+
+	AgentID AddAgentInternal(Agent agent, int64_t storageID);
+	void EraseAgentInternal(AgentID id);
+	std::unordered_map<AgentID, AgentID> BuildServerIDLookup() const;
+
+	/*< builds the documents of the next save and queues them on the saver thread */
+	bool QueueSave(const OTN::OTNFilePath& path);
+	void LogSaveErrors();
+	bool SaveSnapshot(const OTN::OTNFilePath& path);
+	bool AppendJournal(const OTN::OTNFilePath& path, const std::unordered_set<AgentID>& changedAgents);
+	void MarkPersisted(AgentID id);
+	OTN::OTNObject BuildStorageObject(const std::unordered_set<AgentID>& agents) const;
+	static OTN::OTNObject BuildBoardStateObject(const Agent& agent, bool dirtyStatesOnly = false);
+	/*< the delta states in the BoardState layout, the evaluation of a move is its change */
+	static OTN::OTNObject BuildDeltaStateObject(const AgentTrainingDelta& delta);
+	using PersistentDataSchema = OTN::OTNBindingCodec<AgentPersistentData>::Schema;
+	/*< binds the stat columns one by one and logs the ones that are missing or of another type */
+	static PersistentDataSchema BindPersistentDataSchema(const OTN::OTNObject& obj);
+	static bool LoadAgentRow(const OTN::OTNObject& obj, size_t row, const PersistentDataSchema& dataSchema, Agent& outAgent);
 
 	void SetDeletedServerAgents(const std::unordered_set<AgentID>& ids);
 	void ClearDeletedServerAgents();
@@ -0,0 +1,54 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+/**
+* @brief Writes the agent files on one long-lived thread.
+*
+* The jobs only touch files and documents they own, the AgentManager prepares them on the main thread.
+* Jobs that did not start yet can be replaced by a newer one, e.g. a snapshot makes older journal appends obsolete.
+*/
+class AgentSaveWorker {
+public:
+	/*< writes the files, returns false and sets outError on failure */
+	using Job = std::function<bool(std::string& outError)>;
+
+	AgentSaveWorker() = default;
+	~AgentSaveWorker();
+
+	AgentSaveWorker(const AgentSaveWorker&) = delete;
+	AgentSaveWorker& operator=(const AgentSaveWorker&) = delete;
+
+	/**
+	* @brief Queues a job, the thread is started by the first one.
+	* @param replaceQueued drops the jobs that are still waiting in the queue
+	*/
+	void Push(Job&& job, bool replaceQueued);
+
+	/**
+	* @brief Blocks until every queued job ran.
+	* @return false if a job failed since the last call to Wait or TakeErrors
+	*/
+	bool Wait();
+
+	/*< errors of the failed jobs since the last call, does not block */
+	std::vector<std::string> TakeErrors();
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::condition_variable m_idleCV;
+	std::deque<Job> m_jobs;
+	std::vector<std::string> m_errors;
+	bool m_running = false;// < a job is being written
+	bool m_failed = false;
+	bool m_stop = false;
+	std::thread m_thread;
+
+	void WorkerLoop();
+};
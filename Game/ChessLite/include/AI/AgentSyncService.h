@@ -28,16 +28,22 @@ private:
 
     void RequestServerAgentIDList(AppContext* ctx);
     void RequestMissingAgentsFromServer(AppContext* ctx);
+    void RequestAgentChanges(AppContext* ctx);
 
     void SyncMissingData(AppContext* ctx, const std::unordered_set<AgentID>& ids);
     void SyncDelete(AppContext* ctx, const std::unordered_set<AgentID>& deleteIDs);
     void SyncDirty(AppContext* ctx, const std::unordered_set<AgentID>& dirtyIDs);
-
-    void RegisterAgents(const std::string& serverIDs);
-    void HandleServerIDList(const std::string& agentIDList);
-    void HandleAddAgents(const std::string& agentList);
+    /*< requestChanges asks for the agent changes once the server added the deltas, so they can be rebased */
+    void SyncTrainingDeltas(AppContext* ctx, bool requestChanges);
+
+    /*< the readers hold the reply, read on the network thread of the client */
+    void RegisterAgents(OTN::OTNReader& reader);
+    void HandleServerIDList(const std::string& agentIDList, bool binary);
+    void HandleAddAgents(OTN::OTNReader& reader);
+    void LoadServerAgents(AppContext* ctx, const OTN::OTNObject& obj, const OTN::OTNObject* boardStatesObj, const OTN::OTNObject* gameMovesObj);
     void HandleDeletedAgents();
-    void HandleDirtyAgents(const std::string& dirtyList);
+    void HandleDirtyAgents(OTN::OTNReader& reader);
+    void HandleTrainingDeltas(const std::string& versionList);
 
     void GlobalCallback(const std::string& msg);
 };
\ No newline at end of file
@@ -20,9 +20,14 @@ public:
 	const std::string& GetState() const;
 	const std::vector<GameMove>& GetPossibleMoves() const;
 
+	/*< agent version of the last evaluation change, states newer than the synced version are sent as delta */
+	size_t GetChangedVersion() const;
+	void MarkChanged(size_t agentVersion);
+
 private:
 	std::string m_state;
 	std::vector<GameMove> m_possibleMoves;
+	size_t m_changedVersion = 0;
 
 	std::vector<GameMove> CalculatePossibleMoves(const CoreChess::ChessGame& game);
  };
\ No newline at end of file
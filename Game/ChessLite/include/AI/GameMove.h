@@ -3,6 +3,7 @@
 #include <CoreLib/OTNFile.h>
 
 class GameMove {
+friend struct OTN::OTNBinding<GameMove>;
 public:
 	GameMove() = default;
 	GameMove(const Vector2& from, const Vector2& to);
@@ -23,22 +24,20 @@ private:
 };
 
 template<>
-inline void OTN::ToOTNDataType<GameMove>(OTN::OTNObjectBuilder& obj, GameMove& move) {
-	obj.SetObjectName("GameMove");
-	obj.AddNames("eval", "from_x", "from_y", "to_x", "to_y");
-
-	if (obj.IsBuildingOTNObject()) {
-		Vector2 from = move.GetFrom();
-		Vector2 to = move.GetTo();
-		obj.AddData(move.GetEvaluation(), from.x, from.y, to.x, to.y);
-	}
-	else {
-		Vector2 from, to;
-		float eval;
-
-		obj.AddData(eval, from.x, from.y, to.x, to.y);
-
-		move = GameMove(from, to);
-		move.SetEvaluation(eval);
+struct OTN::OTNBinding<GameMove> {
+	static constexpr const char* NAME = "GameMove";
+
+	static auto Fields() {
+		return std::make_tuple(
+			OTN::BindField("eval", &GameMove::m_evaluation),
+			OTN::BindAccessor<float, GameMove>("from_x",
+				[](const GameMove& m) { return m.m_from.x; }, [](GameMove& m, float v) { m.m_from.x = v; }),
+			OTN::BindAccessor<float, GameMove>("from_y",
+				[](const GameMove& m) { return m.m_from.y; }, [](GameMove& m, float v) { m.m_from.y = v; }),
+			OTN::BindAccessor<float, GameMove>("to_x",
+				[](const GameMove& m) { return m.m_to.x; }, [](GameMove& m, float v) { m.m_to.x = v; }),
+			OTN::BindAccessor<float, GameMove>("to_y",
+				[](const GameMove& m) { return m.m_to.y; }, [](GameMove& m, float v) { m.m_to.y = v; })
+		);
 	}
-}
\ No newline at end of file
+};
\ No newline at end of file
@@ -5,6 +5,7 @@
 namespace FilePaths {
 
 	extern const char* agentsFileName;
+	extern const char* agentsJournalFileName;
 	extern const char* optionsFileName;
 	extern const char* userFileName;
 
@@ -1,32 +1,125 @@
 #pragma once
 #include <string>
-#include <deque>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
 #include <functional>
+#include <condition_variable>
 #include <SDL3_net/SDL_net.h>
 #include <CoreLib/OTNFile.h>
+#include <CoreLib/FrameDecoder.h>
 #include "Type.h"
+#include "NetProtocol.h"
+#include "SPSCQueue.h"
 
 class App;
+class BinaryDeserializer;
+
+/*
+* Client of the game server.
+*
+* The socket, the framing, compression and the parsing of the responses run on a network
+* thread owned by the client. The main thread only queues requests and gets the responses
+* back in ProcessReceiveQueue, every callback runs on the thread that calls it.
+* Both directions are lock-free single producer single consumer queues.
+*/
 class  GameClient {
 friend App;
 public:
 	using Callback = std::function<void(bool, const std::string&)>;
+	/*< the reader holds the response read on the network thread, see ResponseFormat */
+	using ParsedCallback = std::function<void(bool, const std::string&, OTN::OTNReader&)>;
 	using GlobalCallback = std::function<void(const std::string&)>;
+	using ConnectCallback = std::function<void(bool, const std::string&)>;
+	using ConnectionLostCallback = std::function<void()>;
+
+	/*< how the network thread prepares a response before its callback runs */
+	enum class ResponseFormat : uint8_t {
+		RAW,// < payload only, the reader stays empty
+		OTN,// < one OTN document, read with ReadString
+		OTN_SEGMENTS// < a streamed response, read with ReadSegmentsString
+	};
 
 	GameClient();
 	~GameClient();
 
-	bool Connect(const std::string& host, uint16_t port);
+	/**
+	* @brief Starts connecting, the host is resolved on the network thread.
+	*
+	* IsConnecting is true until the result arrived in ProcessReceiveQueue, which calls cb.
+	* @param cb Called with false and the error if the host could not be resolved or reached
+	*/
+	void Connect(const std::string& host, uint16_t port, ConnectCallback&& cb = {});
 	void Disconnect();
 
-	void Send(const std::string& msg, Callback&& callback);
+	void Send(std::string msg, Callback&& callback);
+	/**
+	* @brief Sends a v2 request, only valid once UsesBinaryProtocol is true.
+	* @param opcode NetOpcode::NONE sends body as v1 OTN document like Send(msg, callback)
+	* @param body Binary body of the opcode, see NetProtocol.h
+	*/
+	void Send(NetOpcode opcode, std::string body, Callback&& callback);
+	/**
+	* @brief Like Send, the response is read on the network thread.
+	*
+	* A response that can not be read is delivered as failed with the reader error.
+	*/
+	void Send(NetOpcode opcode, std::string body, ResponseFormat format, ParsedCallback&& callback);
+
+	/**
+	* @brief Groups the requests sent until the matching EndBatch into one batch frame.
+	*
+	* The server dispatches them together and answers every request on its own, the
+	* callbacks stay the same. Calls can be nested, the outermost EndBatch queues the batch.
+	* Before the protocol is negotiated or with an older server the requests are sent one by one.
+	*/
+	void BeginBatch();
+	void EndBatch();
+
+	void UseCompression(bool value);
+	/**
+	* @brief Sets the largest chunked response the client reassembles.
+	* @param size Limit in bytes of the (still compressed) payload
+	*/
+	void SetMaxMessageSize(size_t size);
 
 	NetworkCallbackID AddGlobalCallback(GlobalCallback&& cb);
 	bool RemoveGlobalCallback(NetworkCallbackID id);
+	/*< called when an open connection is closed, e.g. to notify the user */
+	void SetConnectionLostCallback(ConnectionLostCallback&& cb);
+
+	/**
+	* @brief Lets the network thread write the requests queued since the last call, called once per frame by App.
+	*
+	* All of them leave with a single socket write. Headless users like the load generator call it in their own loop.
+	*/
+	bool ProcessSendQueue();
+	/**
+	* @brief Calls the callbacks of the responses and connection changes the network thread delivered.
+	*
+	* Stops once the receive budget is used up, the rest is delivered by the next call.
+	* @return false if the network thread reported an error, see GetError
+	*/
+	bool ProcessReceiveQueue();
+	/**
+	* @brief Blocks until the network thread delivered something or the timeout passed, for headless loops.
+	* @return false if the client is neither connected nor connecting
+	*/
+	bool WaitForInput(int timeoutMS);
+	/*< time ProcessReceiveQueue may spend on callbacks per call before it leaves the rest for the next frame */
+	void SetReceiveBudget(float budgetMS);
 
 	void ClearError();
 
 	bool IsConnected() const;
+	bool IsConnecting() const;
+	/*< true once the server agreed on the binary protocol (v2) */
+	bool UsesBinaryProtocol() const;
+	bool GetUseCompression() const;
+	size_t GetMaxMessageSize() const;
 
 	OTN::OTNObject CreateHeaderBlock(const std::string& action);
 
@@ -35,37 +128,193 @@ public:
 	uint16_t GetPort() const;
 
 private:
-	struct PendingSend {
+	static constexpr size_t COMPRESSION_THRESHOLD = 512;// < smaller payloads are always sent uncompressed
+	// flags byte of every frame, has to match the server
+	static constexpr uint8_t PAYLOAD_FLAG_COMPRESSED = 1 << 0;
+	static constexpr uint8_t PAYLOAD_FLAG_ACCEPT_COMPRESSED = 1 << 1;
+	static constexpr uint8_t PAYLOAD_FLAG_CHUNKED = 1 << 2;
+	static constexpr uint8_t PAYLOAD_FLAG_STREAMED = 1 << 3;
+	static constexpr uint8_t PAYLOAD_FLAG_HELLO = 1 << 4;
+	static constexpr uint8_t PAYLOAD_FLAG_OPCODE = 1 << 5;
+	static constexpr uint8_t PAYLOAD_FLAG_BATCH = 1 << 6;
+	static constexpr size_t CHUNK_PAYLOAD_SIZE = 4096;// < larger payloads are split, the server rejects frames above 5000 bytes
+	static constexpr size_t DEFAULT_MAX_MESSAGE_SIZE = 32 * 1024 * 1024;
+	static constexpr size_t RECEIVE_BUFFER_SIZE = 16 * 1024;
+	static constexpr uint32_t HELLO_ID = 0;// < request ids start at 1
+	static constexpr int NET_POLL_MS = 2;// < longest a queued command waits while the network thread waits for the socket
+	static constexpr int CONNECT_TIMEOUT_MS = 5000;// < for resolving the host and for connecting
+
+	// one request as handed to the network thread
+	struct NetRequest {
+		NetworkMsgID id;
+		uint8_t flags = 0;
+		NetOpcode opcode = NetOpcode::NONE;
+		ResponseFormat format = ResponseFormat::RAW;
+		std::string payload;
+	};
+
+	enum class NetCommandType : uint8_t {
+		CONNECT,
+		DISCONNECT,
+		SEND,// < one request, or the requests of a batch under batchID
+		FLUSH,// < writes the frames of the sends before it
+		STOP
+	};
+
+	struct NetCommand {
+		NetCommandType type = NetCommandType::FLUSH;
+		uint32_t generation = 0;
+		std::string host;
+		uint16_t port = 0;
+		std::vector<NetRequest> requests;
+		NetworkMsgID batchID;
+	};
+
+	enum class NetEventType : uint8_t {
+		CONNECTED,
+		CONNECT_FAILED,
+		CONNECTION_LOST,
+		PROTOCOL,// < the hello was answered
+		RESPONSE,
+		REPORT_ERROR// < payload is added to GetError
+	};
+
+	struct NetEvent {
+		NetEventType type = NetEventType::REPORT_ERROR;
+		uint32_t generation = 0;// < events of an older connection are dropped
 		NetworkMsgID id;
-		std::vector<uint8_t> data;
+		bool result = false;
+		uint16_t protocolVersion = PROTOCOL_VERSION_TEXT;
+		std::string payload;// < response or error message
+		std::shared_ptr<OTN::OTNReader> reader;// < set if the request asked for a parsed response
+	};
+
+	enum class ConnectionState : uint8_t {
+		DISCONNECTED,
+		CONNECTING,
+		CONNECTED
+	};
+
+	// reassembly of one chunked or streamed response, keyed by the request id
+	struct InboundStream {
+		bool response = false;
+		uint8_t flags = 0;
+		uint32_t nextSequence = 0;
+		uint32_t totalSize = 0;
+		std::string data;
+		std::string segment;// < streamed only, pieces of the segment that is still arriving
 	};
 
-	struct PendingReceive {
-		Callback cb;
-		float waitedTimeMS = 0.0f;
+	// a request written by the network thread that waits for its response
+	struct InFlight {
+		ResponseFormat format = ResponseFormat::RAW;
+		std::chrono::steady_clock::time_point deadline;
 	};
 
+	// main thread
 	std::string m_host;
 	uint16_t m_port = 0;
-	float m_pendingSendTimeOutMS = 2500.0f;
 	CoreAppIDManager m_idManager{ 1 };
 	CoreAppIDManager m_callbackIDManager{ 1 };
-	
 	std::string m_error;
+	float m_receiveBudgetMS = 4.0f;
+	ConnectionState m_state = ConnectionState::DISCONNECTED;
+	uint32_t m_generation = 0;// < raised by every Connect and Disconnect
+	uint16_t m_protocolVersion = PROTOCOL_VERSION_TEXT;
+	bool m_unflushed = false;// < sends were queued since the last flush
+	uint32_t m_batchDepth = 0;
+	std::vector<NetRequest> m_batch;
+	std::unordered_map<NetworkMsgID, ParsedCallback> m_pending;
+	std::unordered_map<NetworkCallbackID, GlobalCallback> m_globalCallbacks;
+	ConnectCallback m_connectCallback;
+	ConnectionLostCallback m_connectionLostCallback;
+
+	// shared, read by the network thread
+	std::atomic<bool> m_useCompression = true;
+	std::atomic<size_t> m_maxMessageSize = DEFAULT_MAX_MESSAGE_SIZE;
+	std::chrono::milliseconds m_pendingSendTimeOut{ 2500 };
+
+	SPSCQueue<NetCommand> m_commands;// < main thread to network thread
+	SPSCQueue<NetEvent> m_events;// < network thread to main thread
+	// only for sleeping, the queues themselves need no lock
+	std::mutex m_commandMutex;
+	std::condition_variable m_commandCV;
+	std::mutex m_eventMutex;
+	std::condition_variable m_eventCV;
+	std::thread m_netThread;
+
+	// network thread
+	NET_Address* m_address = nullptr;// < set while the host is resolved
 	NET_StreamSocket* m_socket = nullptr;
+	ConnectionState m_netState = ConnectionState::DISCONNECTED;
+	uint32_t m_netGeneration = 0;
+	uint16_t m_netPort = 0;
+	std::chrono::steady_clock::time_point m_connectDeadline;
+	std::vector<uint8_t> m_sendBuffer;// < frames written at once by the next flush
+	FrameDecoder m_decoder;
+	std::unordered_map<uint32_t, InboundStream> m_inboundStreams;
+	std::unordered_map<uint32_t, InFlight> m_inFlight;
+	bool m_eventsPushed = false;// < waiters are woken once per loop
 
-	std::deque<PendingSend> m_msgQueue;
-	std::unordered_map<NetworkMsgID, PendingReceive> m_pending;
-	std::vector<uint8_t> m_receiveBuffer;
+	/*< starts the network thread on the first connect */
+	void StartNetThread();
+	void PushCommand(NetCommand&& command);
+	NetworkMsgID AddPending(ParsedCallback&& cb);
+	void QueueRequest(NetRequest&& request);
+	void QueueBatch();
+	/*< fails all pending requests and calls the connection lost callback */
+	void HandleConnectionLost();
+	void HandleEvent(NetEvent& event);
 
-	std::unordered_map<NetworkCallbackID, GlobalCallback> m_globalCallbacks;
+#pragma region Network thread
 
-	bool ProcessSendQueue();
-	bool ProcessReceiveQueue();
-	void ProcessPendingSentTimeOut();
+	void NetThreadLoop();
+	/*< returns false on STOP */
+	bool NetProcessCommand(NetCommand& command);
+	void NetStartConnect(const NetCommand& command);
+	void NetUpdateConnect();
+	void NetClose();
+	/*< closes the connection and reports it to the main thread */
+	void NetFail(NetEventType type, const std::string& error);
+	void NetPushEvent(NetEvent&& event);
+	/*< wakes WaitForInput if events were pushed since the last call */
+	void NetWakeWaiters();
+	void NetPushResponse(uint32_t id, bool result, std::string&& payload);
+	void NetReportError(const std::string& msg);
+	/*< asks the server for the binary protocol, an older server answers with an error and v1 is kept */
+	void NetSendHello();
+	void NetQueueRequest(const NetRequest& request);
+	/*< batch: [u32 count] then per request [u32 id][u8 flags][u16 opcode if flagged][str payload] */
+	void NetQueueBatch(NetworkMsgID batchID, const std::vector<NetRequest>& requests);
+	/*< compresses and frames a payload into the send buffer */
+	void NetQueueFrames(uint32_t id, const std::string& payload, uint8_t flags, NetOpcode opcode);
+	void NetFlush();
+	void NetReceive();
+	/*< reads the complete frames of the decoder */
+	void NetProcessFrames();
+	void NetProcessTimeOuts();
+	/**
+	* @brief Adds one chunk frame to its stream.
+	*
+	* response and flags are those of the frame and are replaced by the ones of the
+	* whole response once it is complete. A broken stream completes as a failed response.
+	* @return true once the response is complete and outPayload is set
+	*/
+	bool AppendChunk(uint32_t id, BinaryDeserializer& des, bool& response, uint8_t& flags, std::string& outPayload);
+	/**
+	* @brief Adds one piece of a streamed response.
+	*
+	* Every segment is decompressed on its own once complete, the payload is the
+	* concatenation of all segments (read it with OTN::OTNReader::ReadSegmentsString).
+	* @return true once the stream ended and outPayload is set
+	*/
+	bool AppendStreamSegment(uint32_t id, BinaryDeserializer& des, bool& response, uint8_t& flags, std::string& outPayload);
+	void ResetPendingTimeOut(uint32_t id);
+
+#pragma endregion
 
-	void CallRequestCallback(NetworkMsgID id, bool result, const std::string& msg);
+	void CallRequestCallback(NetworkMsgID id, bool result, const std::string& msg, OTN::OTNReader* reader = nullptr);
 	void AddError(const std::string& msg);
 
 	void CallGlobalCallBacks(const std::string& msg);
-};
\ No newline at end of file
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+
+#include "AI/GameMove.h"
+
+/*
+* Client side of the wire protocol, has to match Server/include/NetProtocol.h.
+*
+* v1 (text): the request payload is an OTN document with a header object holding the action name.
+* v2 (binary): negotiated with a hello after connecting, requests carry an opcode and the id lists
+* and agent uploads have binary bodies. Responses stay OTN, only the agent id list is binary.
+* v3 (batch): v2 plus batch frames, several requests in one frame that are answered one by one.
+*/
+constexpr uint16_t PROTOCOL_VERSION_TEXT = 1;
+constexpr uint16_t PROTOCOL_VERSION_BINARY = 2;
+constexpr uint16_t PROTOCOL_VERSION_BATCH = 3;
+
+enum class NetOpcode : uint16_t {
+	NONE = 0,
+	SYNC_MISSING_DATA = 1,
+	GET_AGENT_ID_LIST = 2,
+	REQUEST_MISSING_AGENTS = 3,
+	REQUEST_AGENT_CHANGES = 4,
+	SYNC_DELETE_DATA = 5,
+	SYNC_DIRTY_DATA = 6,
+	SYNC_DIRTY_STATES = 7,
+	REPORT_GAMES = 8,
+	SYNC_AGENT_DELTAS = 9,
+	COUNT
+};
+
+class BinarySerializer;
+
+namespace NetProtocol {
+
+	/*< [u32 count][i64 id]... */
+	std::string EncodeIDList(const std::vector<int64_t>& ids);
+	bool DecodeIDList(std::string_view payload, std::vector<int64_t>& outIDs);
+	/*< [i64 sequence] */
+	std::string EncodeSequence(int64_t sequence);
+	/*< one state as [str board_state][u32 move count] and per move [f32 eval][u8 from_x][u8 from_y][u8 to_x][u8 to_y] */
+	void AddState(BinarySerializer& ser, const std::string& boardState, const std::vector<GameMove>& moves);
+	std::string ToPayload(const BinarySerializer& ser);
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <optional>
+#include <utility>
+
+/**
+* @brief Unbounded lock-free queue for a single producer and a single consumer thread.
+*
+* Push only from the producer thread, TryPop and IsEmpty only from the consumer thread.
+* Linked list with a stub node, a push is one allocation and one release store.
+*/
+template<typename T>
+class SPSCQueue {
+public:
+	SPSCQueue() {
+		Node* stub = new Node();
+		m_head = stub;
+		m_tail = stub;
+	}
+
+	~SPSCQueue() {
+		Node* node = m_tail;
+		while (node) {
+			Node* next = node->next.load(std::memory_order_relaxed);
+			delete node;
+			node = next;
+		}
+	}
+
+	SPSCQueue(const SPSCQueue&) = delete;
+	SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+	void Push(T&& value) {
+		Node* node = new Node();
+		node->value.emplace(std::move(value));
+
+		// publishes the value, the consumer reads next with acquire
+		m_head->next.store(node, std::memory_order_release);
+		m_head = node;
+	}
+
+	bool TryPop(T& outValue) {
+		Node* tail = m_tail;
+		Node* next = tail->next.load(std::memory_order_acquire);
+		if (!next)
+			return false;
+
+		outValue = std::move(*next->value);
+		next->value.reset();
+		m_tail = next;
+		delete tail;
+		return true;
+	}
+
+	bool IsEmpty() const {
+		return m_tail->next.load(std::memory_order_acquire) == nullptr;
+	}
+
+private:
+	struct Node {
+		std::atomic<Node*> next = nullptr;
+		std::optional<T> value;
+	};
+
+	Node* m_head = nullptr;// < only touched by the producer
+	Node* m_tail = nullptr;// < only touched by the consumer
+};
@@ -1,6 +1,52 @@
 #include <cmath>
+#include <algorithm>
 #include "AI/Agent.h"
 
+namespace {
+
+	GameMove* FindMove(std::vector<GameMove>& moves, const GameMove& move) {
+		auto it = std::find_if(moves.begin(), moves.end(), [&](const GameMove& m) {
+			return m.GetFrom() == move.GetFrom() && m.GetTo() == move.GetTo();
+		});
+		return (it != moves.end()) ? &*it : nullptr;
+	}
+
+}
+
+bool AgentTrainingDelta::IsEmpty() const {
+	return matches.matchesPlayed == 0 && states.empty();
+}
+
+void AgentTrainingDelta::AddState(const std::string& state, const std::vector<GameMove>& moves) {
+	auto [it, inserted] = states.try_emplace(state);
+	for (const auto& move : moves) {
+		if (!FindMove(it->second, move))
+			it->second.emplace_back(move.GetFrom(), move.GetTo());
+	}
+}
+
+void AgentTrainingDelta::AddEvaluation(const std::string& state, const GameMove& move, float eval) {
+	auto& moves = states[state];
+	GameMove* delta = FindMove(moves, move);
+	if (!delta)
+		delta = &moves.emplace_back(move.GetFrom(), move.GetTo());
+	delta->AddEvaluation(eval);
+}
+
+void AgentTrainingDelta::Merge(AgentTrainingDelta&& other) {
+	matches.matchesPlayed += other.matches.matchesPlayed;
+	matches.matchesWon += other.matches.matchesWon;
+	matches.matchesPlayedAsWhite += other.matches.matchesPlayedAsWhite;
+	matches.matchesWonAsWhite += other.matches.matchesWonAsWhite;
+
+	for (auto& [state, moves] : other.states) {
+		AddState(state, moves);
+		for (const auto& move : moves)
+			AddEvaluation(state, move, move.GetEvaluation());
+	}
+	other = AgentTrainingDelta{};
+}
+
 Agent::Agent(const std::string& name, CoreChess::ChessContext& chessContext)
 	: m_name(name), 
 	m_chessConfigString(chessContext.GetConfigString()), 
@@ -20,6 +66,29 @@ void Agent::GameFinished(bool won) {
 	float reductionAmount = 0.2f;
 	float currentReward = reward;
 
+	// registered agents only send what changed, a dirty agent still uploads its states first
+	bool trackDelta = m_serverID != 0 && !m_dirty;
+	if (trackDelta) {
+		for (const auto& stateKey : m_newStates) {
+			auto it = m_boardStates.find(stateKey);
+			if (it != m_boardStates.end())
+				m_trainingDelta.AddState(stateKey, it->second.GetPossibleMoves());
+		}
+
+		m_trainingDelta.matches.matchesPlayed++;
+		if (won)
+			m_trainingDelta.matches.matchesWon++;
+		if (m_isWhite)
+			m_trainingDelta.matches.matchesPlayedAsWhite++;
+		if (won && m_isWhite)
+			m_trainingDelta.matches.matchesWonAsWhite++;
+		m_deltaRevision++;
+	}
+	else {
+		m_dirty = true;
+		m_version++;
+	}
+
 	for (auto itHistory = m_moveHistory.rbegin(); itHistory != m_moveHistory.rend(); ++itHistory) {
 		auto& [stateKey, moveIndex] = *itHistory;
 
@@ -27,6 +96,10 @@ void Agent::GameFinished(bool won) {
 		if (it != m_boardStates.end()) {
 			auto& move = it->second.GetMove(moveIndex);
 			move.AddEvaluation(currentReward);
+			if (trackDelta)
+				m_trainingDelta.AddEvaluation(stateKey, move, currentReward);
+			else
+				it->second.MarkChanged(m_version);
 		}
 
 		currentReward *= reductionAmount;
@@ -34,8 +107,6 @@ void Agent::GameFinished(bool won) {
 
 	m_gameFinished = true;
 
-	m_dirty = true;
-	m_version++;
 	m_matchesPlayed++;
 	if (won)
 		m_matchesWon++;
@@ -59,6 +130,7 @@ void Agent::LoadPersistentData(const AgentPersistentData& data) {
 const GameMove& Agent::GetBestMove(const CoreChess::ChessGame& game) {
 	if (m_gameFinished) {
 		m_moveHistory.clear();
+		m_newStates.clear();
 		m_gameFinished = false;
 
 		m_isWhite = game.IsWhiteTurn();
@@ -80,6 +152,7 @@ const GameMove& Agent::GetBestMove(const CoreChess::ChessGame& game) {
 	else {
 		BoardState newState{ state, game };
 		boardStatePtr = &m_boardStates.emplace(state, std::move(newState)).first->second;
+		m_newStates.insert(state);
 	}
 
 	float explorationChance = GetExplorationChance();
@@ -153,6 +226,10 @@ bool Agent::IsAgentDirty() const {
 	return m_dirty;
 }
 
+bool Agent::IsBoardStateDirty(const BoardState& state) const {
+	return state.GetChangedVersion() > m_syncedVersion;
+}
+
 float Agent::GetExplorationChance() const {
 	// hits 0 at ca 25 games played with size 3x3
 	double boardArea = static_cast<double>(m_boardWidth) * static_cast<double>(m_boardHeight);
@@ -172,6 +249,38 @@ const std::vector<std::pair<std::string, size_t>>& Agent::GetMoveHistory() const
 	return m_moveHistory;
 }
 
+bool Agent::HasTrainingDelta() const {
+	return !m_trainingDelta.IsEmpty();
+}
+
+void Agent::ApplyTrainingDelta(const AgentTrainingDelta& delta) {
+	m_matchesPlayed += delta.matches.matchesPlayed;
+	m_matchesWon += delta.matches.matchesWon;
+	m_matchesPlayedAsWhite += delta.matches.matchesPlayedAsWhite;
+	m_matchesWonAsWhite += delta.matches.matchesWonAsWhite;
+
+	for (const auto& [stateKey, moves] : delta.states) {
+		auto it = m_boardStates.find(stateKey);
+		if (it == m_boardStates.end()) {
+			// the delta of a new state holds all of its moves
+			BoardState state;
+			state.LoadGameMoves(moves);
+			m_boardStates.emplace(stateKey, std::move(state));
+			continue;
+		}
+
+		for (const auto& move : moves) {
+			const auto& possibleMoves = it->second.GetPossibleMoves();
+			for (size_t i = 0; i < possibleMoves.size(); ++i) {
+				if (possibleMoves[i].GetFrom() == move.GetFrom() && possibleMoves[i].GetTo() == move.GetTo()) {
+					it->second.GetMove(i).AddEvaluation(move.GetEvaluation());
+					break;
+				}
+			}
+		}
+	}
+}
+
 std::string Agent::GetNormalizedBoardStr(const CoreChess::ChessBoard& board, bool isWhite) {
 	size_t fieldCount = board.GetNumberOfFields();
 	std::string result;
@@ -208,9 +317,12 @@ void Agent::SetServerID(AgentID id) {
 
 void Agent::SetVersion(size_t version) {
 	m_version = version;
+	m_syncedVersion = version;
 }
 
 void Agent::MarkClean(size_t syncedVersion) {
+	// states changed after syncedVersion stay dirty
+	m_syncedVersion = std::max(m_syncedVersion, syncedVersion);
 	if (m_version == syncedVersion)
 		m_dirty = false;
 }
\ No newline at end of file
@@ -1,93 +1,349 @@
+#include <filesystem>
+#include <CoreLib/File.h>
+#include <CoreLib/BinarySerializer.h>
 #include "AI/AgentManager.h"
+#include "NetProtocol.h"
 #include "App.h"
+#include "FilePaths.h"
 
 bool AgentManager::Save(const OTN::OTNFilePath& path) {
+    if (!QueueSave(path))
+        return false;
+
+    bool result = m_saveWorker.Wait();
+    LogSaveErrors();
+    return result;
+}
+
+void AgentManager::SaveAsync(const OTN::OTNFilePath& path) {
+    QueueSave(path);
+}
+
+void AgentManager::LogSaveErrors() {
+    std::vector<std::string> errors = m_saveWorker.TakeErrors();
+    for (const auto& error : errors)
+        Log::Error(error);
+
+    // the failed save was already marked as persisted, the next one rewrites everything
+    if (!errors.empty())
+        m_snapshotOutdated = true;
+}
+
+bool AgentManager::QueueSave(const OTN::OTNFilePath& path) {
+    LogSaveErrors();
+
+    std::unordered_set<AgentID> changedAgents;
+    for (const auto& [id, agent] : m_agents) {
+        auto itStorage = m_storageIDs.find(id);
+        if (itStorage == m_storageIDs.end())
+            continue;
+
+        auto it = m_persistedStates.find(itStorage->second);
+        if (it == m_persistedStates.end() || 
+            it->second.version != agent.GetVersion() || 
+            it->second.deltaRevision != agent.m_deltaRevision ||
+            it->second.serverID != agent.GetServerID()) {
+            changedAgents.emplace(id);
+        }
+    }
+
+    if (changedAgents.empty() && m_removedStorageIDs.empty() && !m_snapshotOutdated)
+        return true;
+
+    // compact once the journal would be as large as a full snapshot
+    size_t journalRows = m_journalRowCount + changedAgents.size() + m_removedStorageIDs.size();
+    if (m_snapshotOutdated || 
+        m_journalSegmentCount >= MAX_JOURNAL_SEGMENTS || 
+        journalRows >= m_agents.size()) {
+        return SaveSnapshot(path);
+    }
+
+    return AppendJournal(path, changedAgents);
+}
+
+bool AgentManager::SaveSnapshot(const OTN::OTNFilePath& path) {
     using namespace OTN;
 
     std::unordered_set<AgentID> allAgents;
     for (const auto& [id, _] : m_agents)
         allAgents.emplace(id);
 
-    OTNObject agentObj = BuildOTNObjectFromIDs(allAgents);
+    OTNObject agentObj = BuildStorageObject(allAgents);
 
     if (!agentObj.IsValid()) {
         Log::Error("Failed to save agent data: {}", agentObj.GetError());
         return false;
     }
 
-    OTNWriter writer;
-    writer.AppendObject(agentObj);
-    writer.UseDeduplicateRows(false);
+    auto writer = std::make_shared<OTNWriter>();
+    writer->AppendObject(agentObj);
+    writer->UseDeduplicateRows(false);
+    writer->UseParallelWrite(true);
+    // the journal stays plain text, AppendToFile ignores this
+    writer->UseCompression(true);
+
+    // the snapshot contains everything, saves still waiting in the queue are obsolete
+    m_saveWorker.Push([writer, path](std::string& outError) {
+        // write next to the old snapshot first, so a failed write never loses the old data
+        OTNFilePath tmpPath = path / "Agents.tmp.otn";
+        if (!writer->Save(tmpPath)) {
+            outError = "Failed to save agent data: " + writer->GetError();
+            return false;
+        }
 
-    if (!writer.Save(path / "Agents")) {
-        Log::Error("Failed to save agent data: {}", writer.GetError());
-        return false;
+        std::error_code ec;
+        std::filesystem::rename(tmpPath, path / FilePaths::agentsFileName, ec);
+        if (ec) {
+            outError = "Failed to save agent data: " + ec.message();
+            return false;
+        }
+
+        // the journal is obsolete
+        std::filesystem::remove(path / FilePaths::agentsJournalFileName, ec);
+        return true;
+    }, true);
+
+    m_journalSegmentCount = 0;
+    m_journalRowCount = 0;
+    m_snapshotOutdated = false;
+    m_removedStorageIDs.clear();
+
+    m_persistedStates.clear();
+    for (const auto& [id, _] : m_agents)
+        MarkPersisted(id);
+
+    return true;
+}
+
+bool AgentManager::AppendJournal(const OTN::OTNFilePath& path, const std::unordered_set<AgentID>& changedAgents) {
+    using namespace OTN;
+
+    auto writer = std::make_shared<OTNWriter>();
+    writer->UseDeduplicateRows(false);
+
+    if (!changedAgents.empty()) {
+        OTNObject agentObj = BuildStorageObject(changedAgents);
+        if (!agentObj.IsValid()) {
+            Log::Error("Failed to save agent journal: {}", agentObj.GetError());
+            return false;
+        }
+        writer->AppendObject(agentObj);
+    }
+
+    if (!m_removedStorageIDs.empty()) {
+        OTNObject removedObj{ "RemovedAgent" };
+        removedObj.SetNames("storage_id");
+        removedObj.SetTypes("int64");
+        removedObj.ReserveDataRows(m_removedStorageIDs.size());
+        for (int64_t storageID : m_removedStorageIDs)
+            removedObj.AddDataRow(storageID);
+
+        writer->AppendObject(removedObj);
     }
+
+    m_saveWorker.Push([writer, path](std::string& outError) {
+        if (!writer->AppendToFile(path / FilePaths::agentsJournalFileName)) {
+            outError = "Failed to save agent journal: " + writer->GetError();
+            return false;
+        }
+        return true;
+    }, false);
+
+    m_journalSegmentCount++;
+    m_journalRowCount += changedAgents.size() + m_removedStorageIDs.size();
+
+    for (int64_t storageID : m_removedStorageIDs)
+        m_persistedStates.erase(storageID);
+    m_removedStorageIDs.clear();
+
+    for (AgentID id : changedAgents)
+        MarkPersisted(id);
+
     return true;
 }
 
+void AgentManager::MarkPersisted(AgentID id) {
+    auto itAgent = m_agents.find(id);
+    auto itStorage = m_storageIDs.find(id);
+    if (itAgent == m_agents.end() || itStorage == m_storageIDs.end())
+        return;
+
+    PersistedAgentState& state = m_persistedStates[itStorage->second];
+    state.version = itAgent->second.GetVersion();
+    state.deltaRevision = itAgent->second.m_deltaRevision;
+    state.serverID = itAgent->second.GetServerID();
+}
+
 void AgentManager::Load(const OTN::OTNObject& agents) {
     const auto& obj = agents;
 
     if (obj.GetObjectName() != "Agent")
         return;
 
-    for (size_t i = 0; i < obj.GetColumnCount(); i++) {
-        auto serverID = obj.TryGetValue<int64_t>(i, "server_id");
-        auto version = obj.TryGetValue<int64_t>(i, "version");
-        auto name = obj.TryGetValue<std::string>(i, "name");
-        auto boardStates = obj.TryGetValue<std::vector<OTN::OTNObject>>(i, "board_states");
-        auto config = obj.TryGetValue<std::string>(i, "config");
-
-        auto matchesPlayed = obj.TryGetValue<int>(i, "matches_played");
-        auto matchesWon = obj.TryGetValue<int>(i, "matches_won");
-
-        auto matchesPlayedWhite = obj.TryGetValue<int>(i, "matches_played_white");
-        auto matchesWonWhite = obj.TryGetValue<int>(i, "matches_won_white");
+    auto dataSchema = BindPersistentDataSchema(obj);
+    for (size_t i = 0; i < obj.GetRowCount(); i++) {
+        Agent agent;
+        if (!LoadAgentRow(obj, i, dataSchema, agent))
+            continue;
 
-        if (!serverID || !version || !name || !config)
+        auto storageID = obj.TryGetValue<int64_t>(i, "storage_id");
+        if (!storageID || m_localIDsByStorageID.count(*storageID) > 0) {
+            // old snapshot without storage ids, rewrite it on the next save
+            m_snapshotOutdated = true;
+            AddAgent(agent);
             continue;
+        }
 
-        Agent agent{ *name, *config };
-        AgentPersistentData data;
+        AgentID id = AddAgentInternal(agent, *storageID);
+        MarkPersisted(id);
+    }
+}
 
-        if (matchesPlayed)
-            data.matchesPlayed = *matchesPlayed;
+void AgentManager::LoadJournal(const OTN::OTNFilePath& path) {
+    OTN::OTNFilePath journalPath = path / FilePaths::agentsJournalFileName;
+    File file{ journalPath };
+    if (!file.Exists())
+        return;
 
-        if (matchesWon)
-            data.matchesWon = *matchesWon;
+    OTN::OTNReader reader;
+    if (!reader.ReadSegments(journalPath)) {
+        Log::Error("Failed to load agent journal: {}", reader.GetError());
+        // the snapshot can not be trusted to be complete, rewrite it with what was loaded
+        m_snapshotOutdated = true;
+        return;
+    }
 
-        if (matchesPlayedWhite)
-            data.matchesPlayedAsWhite = *matchesPlayedWhite;
+    // a torn last segment is cut off, the next append would land behind it and be unreadable
+    std::error_code ec;
+    uintmax_t fileSize = std::filesystem::file_size(journalPath, ec);
+    size_t validSize = reader.GetSegmentsValidSize();
+    if (!ec && validSize < fileSize) {
+        Log::Warn("Agent journal has a torn last segment, truncating it from {} to {} bytes", fileSize, validSize);
+        std::filesystem::resize_file(journalPath, validSize, ec);
+        if (ec) {
+            Log::Error("Failed to truncate agent journal: {}", ec.message());
+            // the snapshot rewrite deletes the journal
+            m_snapshotOutdated = true;
+        }
+    }
 
-        if (matchesWonWhite)
-            data.matchesWonAsWhite = *matchesWonWhite;
+    for (const auto& segment : reader.GetSegments()) {
+        auto itAgents = segment.find("Agent");
+        if (itAgents != segment.end()) {
+            const auto& obj = itAgents->second;
+            auto dataSchema = BindPersistentDataSchema(obj);
+            for (size_t i = 0; i < obj.GetRowCount(); i++) {
+                auto storageID = obj.TryGetValue<int64_t>(i, "storage_id");
+                Agent agent;
+                if (!storageID || !LoadAgentRow(obj, i, dataSchema, agent))
+                    continue;
 
-        if (boardStates) {
-            std::unordered_map<std::string, BoardState> states;
-            for (const auto& bState : *boardStates) {
-                auto stateStr = bState.TryGetValue<std::string>(0, "board_state");
-                auto moves = bState.TryGetValue<std::vector<GameMove>>(0, "moves");
+                auto itLocal = m_localIDsByStorageID.find(*storageID);
+                if (itLocal != m_localIDsByStorageID.end())
+                    EraseAgentInternal(itLocal->second);
 
-                if (!stateStr || !moves)
+                AgentID id = AddAgentInternal(agent, *storageID);
+                MarkPersisted(id);
+            }
+            m_journalRowCount += obj.GetRowCount();
+        }
+
+        auto itRemoved = segment.find("RemovedAgent");
+        if (itRemoved != segment.end()) {
+            const auto& obj = itRemoved->second;
+            for (size_t i = 0; i < obj.GetRowCount(); i++) {
+                auto storageID = obj.TryGetValue<int64_t>(i, "storage_id");
+                if (!storageID)
                     continue;
 
-                BoardState b;
-                b.LoadGameMoves(*moves);
-                states[*stateStr] = b;
+                auto itLocal = m_localIDsByStorageID.find(*storageID);
+                if (itLocal != m_localIDsByStorageID.end())
+                    EraseAgentInternal(itLocal->second);
+                m_persistedStates.erase(*storageID);
             }
+            m_journalRowCount += obj.GetRowCount();
+        }
 
-            agent.LoadBoardState(states);
+        m_journalSegmentCount++;
+    }
+}
+
+AgentManager::PersistentDataSchema AgentManager::BindPersistentDataSchema(const OTN::OTNObject& obj) {
+    std::vector<std::string> unbound;
+    auto schema = OTN::OTNBindingCodec<AgentPersistentData>::BindSchemaPerField(obj, &unbound);
+
+    // e.g. older files without the stats, only these start at 0
+    if (!unbound.empty()) {
+        std::string fields;
+        for (const auto& name : unbound)
+            fields += (fields.empty() ? "" : ", ") + name;
+        Log::Warn("Agent stats missing or of another type in '{}', they start at 0: {}", obj.GetObjectName(), fields);
+    }
+    return schema;
+}
+
+bool AgentManager::LoadAgentRow(const OTN::OTNObject& obj, size_t row, const PersistentDataSchema& dataSchema, Agent& outAgent) {
+    size_t i = row;
+    auto serverID = obj.TryGetValue<int64_t>(i, "server_id");
+    auto version = obj.TryGetValue<int64_t>(i, "version");
+    auto name = obj.TryGetValue<std::string>(i, "name");
+    auto boardStates = obj.TryGetValue<std::vector<OTN::OTNObject>>(i, "board_states");
+    auto config = obj.TryGetValue<std::string>(i, "config");
+
+    if (!serverID || !version || !name || !config)
+        return false;
+
+    Agent agent{ *name, *config };
+    AgentPersistentData data;
+
+    // a stat that can not be read keeps its default, the others are still loaded
+    if (!OTN::OTNBindingCodec<AgentPersistentData>::DecodeRowPerField(obj.GetRow(i), dataSchema, data))
+        Log::Warn("Agent '{}' has invalid stats, the invalid ones start at 0", *name);
+
+    if (boardStates) {
+        std::unordered_map<std::string, BoardState> states;
+        for (const auto& bState : *boardStates) {
+            auto stateStr = bState.TryGetValue<std::string>(0, "board_state");
+            auto moves = bState.TryGetValue<std::vector<GameMove>>(0, "moves");
+
+            if (!stateStr || !moves)
+                continue;
+
+            BoardState b;
+            b.LoadGameMoves(*moves);
+            states[*stateStr] = b;
         }
 
-        agent.LoadPersistentData(data);
-        agent.SetServerID(AgentID(static_cast<uint32_t>(*serverID)));
-        agent.SetVersion(static_cast<size_t>(*version));
-        AddAgent(agent);
+        agent.LoadBoardState(states);
+    }
+
+    // training not yet sent to the server, older files have none
+    AgentTrainingDelta& delta = agent.m_trainingDelta;
+    delta.matches.matchesPlayed = obj.TryGetValue<int>(i, "delta_played").value_or(0);
+    delta.matches.matchesWon = obj.TryGetValue<int>(i, "delta_won").value_or(0);
+    delta.matches.matchesPlayedAsWhite = obj.TryGetValue<int>(i, "delta_played_white").value_or(0);
+    delta.matches.matchesWonAsWhite = obj.TryGetValue<int>(i, "delta_won_white").value_or(0);
+    if (auto deltaStates = obj.TryGetValue<std::vector<OTN::OTNObject>>(i, "delta_states")) {
+        for (const auto& bState : *deltaStates) {
+            auto stateStr = bState.TryGetValue<std::string>(0, "board_state");
+            auto moves = bState.TryGetValue<std::vector<GameMove>>(0, "moves");
+            if (stateStr && moves)
+                delta.states[*stateStr] = std::move(*moves);
+        }
     }
+
+    agent.LoadPersistentData(data);
+    agent.SetServerID(AgentID(static_cast<uint32_t>(*serverID)));
+    agent.SetVersion(static_cast<size_t>(*version));
+    outAgent = std::move(agent);
+    return true;
 }
 
 void AgentManager::AddAgent(Agent agent) {
+    AddAgentInternal(std::move(agent), m_nextStorageID);
+}
+
+AgentID AgentManager::AddAgentInternal(Agent agent, int64_t storageID) {
     AgentID id{ m_idManager.GetNewUniqueIdentifier() };
     agent.SetID(id);
     // if id is invalid
@@ -95,7 +351,24 @@ void AgentManager::AddAgent(Agent agent) {
         m_unregisteredAgentIds.emplace(id);
     }
 
+    m_storageIDs[id] = storageID;
+    m_localIDsByStorageID[storageID] = id;
+    if (storageID >= m_nextStorageID)
+        m_nextStorageID = storageID + 1;
+
     m_agents[id] = std::move(agent);
+    return id;
+}
+
+void AgentManager::EraseAgentInternal(AgentID id) {
+    m_unregisteredAgentIds.erase(id);
+    m_agents.erase(id);
+
+    auto itStorage = m_storageIDs.find(id);
+    if (itStorage != m_storageIDs.end()) {
+        m_localIDsByStorageID.erase(itStorage->second);
+        m_storageIDs.erase(itStorage);
+    }
 }
 
 bool AgentManager::RemoveAgent(AgentID id) {
@@ -107,15 +380,66 @@ bool AgentManager::RemoveAgent(AgentID id) {
     if(serverID != 0)// if agent is on server
         m_deletedServerAgents.insert(serverID);
 
-    auto itUnre = m_unregisteredAgentIds.find(id);
-    if (itUnre != m_unregisteredAgentIds.end()) {
-        m_unregisteredAgentIds.erase(itUnre);
+    auto itStorage = m_storageIDs.find(id);
+    if (itStorage != m_storageIDs.end() && 
+        m_persistedStates.find(itStorage->second) != m_persistedStates.end()) {
+        m_removedStorageIDs.push_back(itStorage->second);
     }
 
-    m_agents.erase(it);
+    EraseAgentInternal(id);
     return true;
 }
 
+void AgentManager::UpsertServerAgents(std::vector<Agent>&& agents) {
+    std::unordered_map<AgentID, AgentID> localIDs = BuildServerIDLookup();
+
+    for (auto& agent : agents) {
+        AgentID serverID = agent.GetServerID();
+        auto itLocal = localIDs.find(serverID);
+        if (itLocal == localIDs.end()) {
+            if (m_deletedServerAgents.find(serverID) == m_deletedServerAgents.end())
+                AddAgent(std::move(agent));
+            continue;
+        }
+
+        // also skips the changes this client sent itself
+        Agent& local = m_agents[itLocal->second];
+        if (local.IsAgentDirty() || local.GetVersion() >= agent.GetVersion())
+            continue;
+
+        // keeps the local id, the storage id belongs to it
+        // rebases the unsent training onto the server version, it does not contain it yet
+        agent.SetID(itLocal->second);
+        agent.m_trainingDelta = std::move(local.m_trainingDelta);
+        agent.m_deltaRevision = local.m_deltaRevision;
+        agent.ApplyTrainingDelta(agent.m_trainingDelta);
+        local = std::move(agent);
+    }
+}
+
+void AgentManager::RemoveServerAgents(const std::vector<AgentID>& serverIDs) {
+    std::unordered_map<AgentID, AgentID> localIDs = BuildServerIDLookup();
+
+    for (AgentID serverID : serverIDs) {
+        auto itLocal = localIDs.find(serverID);
+        if (itLocal != localIDs.end())
+            RemoveAgent(itLocal->second);
+
+        // already gone on the server, nothing left to sync
+        m_deletedServerAgents.erase(serverID);
+    }
+}
+
+std::unordered_map<AgentID, AgentID> AgentManager::BuildServerIDLookup() const {
+    std::unordered_map<AgentID, AgentID> localIDs;
+    localIDs.reserve(m_agents.size());
+    for (const auto& [id, agent] : m_agents) {
+        if (agent.GetServerID() != 0)
+            localIDs.emplace(agent.GetServerID(), id);
+    }
+    return localIDs;
+}
+
 void AgentManager::MarkAgentAsRegistered(AgentID localId, AgentID serverId) {
     auto* agent = GetAgent(localId);
     if (!agent)
@@ -135,7 +459,7 @@ void AgentManager::MarkAgentsClean(AgentID localId, size_t version) {
 }
 
 OTN::OTNObject AgentManager::BuildOTNObjectFromIDs(
-    const std::unordered_set<AgentID>& agents, bool includeLocalID)
+    const std::unordered_set<AgentID>& agents, bool includeLocalID, bool dirtyStatesOnly)
 {
     using namespace OTN;
     
@@ -159,16 +483,7 @@ OTN::OTNObject AgentManager::BuildOTNObjectFromIDs(
         if (it == agents.end())
             continue;
 
-        OTNObject boardStateObj{ "BoardState" };
-        boardStateObj.SetNames("board_state", "moves");
-        boardStateObj.SetTypes("String", "GameMove[]");
-        const auto& states = agent.GetNormilzedBoardStates();
-        boardStateObj.ReserveDataRows(states.size());
-
-        for (const auto& [stateStr, boardState] : states) {
-            const auto& moves = boardState.GetPossibleMoves();
-            boardStateObj.AddDataRow(stateStr, moves);
-        }
+        OTNObject boardStateObj = BuildBoardStateObject(agent, dirtyStatesOnly);
 
         if (includeLocalID) {
             agentObj.AddDataRow(
@@ -201,6 +516,139 @@ OTN::OTNObject AgentManager::BuildOTNObjectFromIDs(
     return agentObj;
 }
 
+std::string AgentManager::BuildBinaryFromIDs(const std::unordered_set<AgentID>& agents, bool dirtyStatesOnly) const {
+    std::vector<const Agent*> rows;
+    rows.reserve(agents.size());
+    for (AgentID id : agents) {
+        auto it = m_agents.find(id);
+        if (it != m_agents.end())
+            rows.push_back(&it->second);
+    }
+
+    BinarySerializer ser;
+    ser.AddField(static_cast<uint32_t>(rows.size()));
+
+    for (const Agent* agent : rows) {
+        const Agent& row = *agent;
+        ser.AddFields(
+            static_cast<int64_t>(row.GetServerID().value),
+            static_cast<int64_t>(row.GetVersion()),
+            static_cast<int64_t>(row.GetID().value));
+        ser.AddField(row.GetName());
+        ser.AddField(row.GetChessConfig());
+        ser.AddFields(
+            static_cast<int32_t>(row.GetMatchesPlayed()),
+            static_cast<int32_t>(row.GetWonMatches()),
+            static_cast<int32_t>(row.GetMatchesPlayedAsWhite()),
+            static_cast<int32_t>(row.GetMatchesWonAsWhite()));
+
+        const auto& states = row.GetNormilzedBoardStates();
+        uint32_t stateCount = 0;
+        for (const auto& [stateStr, boardState] : states) {
+            if (!dirtyStatesOnly || row.IsBoardStateDirty(boardState))
+                stateCount++;
+        }
+
+        ser.AddField(stateCount);
+        for (const auto& [stateStr, boardState] : states) {
+            if (dirtyStatesOnly && !row.IsBoardStateDirty(boardState))
+                continue;
+            NetProtocol::AddState(ser, stateStr, boardState.GetPossibleMoves());
+        }
+    }
+    return NetProtocol::ToPayload(ser);
+}
+
+std::string AgentManager::BuildBinaryTrainingDeltas(const std::vector<std::pair<AgentID, AgentTrainingDelta>>& deltas) {
+    BinarySerializer ser;
+    ser.AddField(static_cast<uint32_t>(deltas.size()));
+
+    for (const auto& [serverID, delta] : deltas) {
+        ser.AddField(static_cast<int64_t>(serverID.value));
+        ser.AddFields(
+            static_cast<int32_t>(delta.matches.matchesPlayed),
+            static_cast<int32_t>(delta.matches.matchesWon),
+            static_cast<int32_t>(delta.matches.matchesPlayedAsWhite),
+            static_cast<int32_t>(delta.matches.matchesWonAsWhite));
+
+        ser.AddField(static_cast<uint32_t>(delta.states.size()));
+        for (const auto& [stateStr, moves] : delta.states)
+            NetProtocol::AddState(ser, stateStr, moves);
+    }
+    return NetProtocol::ToPayload(ser);
+}
+
+OTN::OTNObject AgentManager::BuildStorageObject(const std::unordered_set<AgentID>& agents) const {
+    using namespace OTN;
+
+    OTNObject agentObj{ "Agent" };
+    agentObj.SetNames("storage_id", "server_id", "version", "name", "board_states", "config",
+        "matches_played", "matches_won", "matches_played_white", "matches_won_white",
+        "delta_played", "delta_won", "delta_played_white", "delta_won_white", "delta_states");
+    agentObj.SetTypes("int64", "int64", "int64", "String", "-", "String", "int", "int", "int", "int",
+        "int", "int", "int", "int", "-");
+    agentObj.ReserveDataRows(agents.size());
+
+    for (AgentID id : agents) {
+        auto itAgent = m_agents.find(id);
+        auto itStorage = m_storageIDs.find(id);
+        if (itAgent == m_agents.end() || itStorage == m_storageIDs.end())
+            continue;
+
+        const Agent& agent = itAgent->second;
+        agentObj.AddDataRow(
+            itStorage->second,
+            static_cast<int64_t>(agent.GetServerID().value),
+            static_cast<int64_t>(agent.GetVersion()),
+            agent.GetName(),
+            BuildBoardStateObject(agent),
+            agent.GetChessConfig(),
+            agent.GetMatchesPlayed(),
+            agent.GetWonMatches(),
+            agent.GetMatchesPlayedAsWhite(),
+            agent.GetMatchesWonAsWhite(),
+            agent.m_trainingDelta.matches.matchesPlayed,
+            agent.m_trainingDelta.matches.matchesWon,
+            agent.m_trainingDelta.matches.matchesPlayedAsWhite,
+            agent.m_trainingDelta.matches.matchesWonAsWhite,
+            BuildDeltaStateObject(agent.m_trainingDelta)
+        );
+    }
+    return agentObj;
+}
+
+OTN::OTNObject AgentManager::BuildDeltaStateObject(const AgentTrainingDelta& delta) {
+    using namespace OTN;
+
+    OTNObject boardStateObj{ "BoardState" };
+    boardStateObj.SetNames("board_state", "moves");
+    boardStateObj.SetTypes("String", "GameMove[]");
+    boardStateObj.ReserveDataRows(delta.states.size());
+
+    for (const auto& [stateStr, moves] : delta.states)
+        boardStateObj.AddDataRow(stateStr, moves);
+    return boardStateObj;
+}
+
+OTN::OTNObject AgentManager::BuildBoardStateObject(const Agent& agent, bool dirtyStatesOnly) {
+    using namespace OTN;
+
+    OTNObject boardStateObj{ "BoardState" };
+    boardStateObj.SetNames("board_state", "moves");
+    boardStateObj.SetTypes("String", "GameMove[]");
+    const auto& states = agent.GetNormilzedBoardStates();
+    boardStateObj.ReserveDataRows(states.size());
+
+    for (const auto& [stateStr, boardState] : states) {
+        if (dirtyStatesOnly && !agent.IsBoardStateDirty(boardState))
+            continue;
+
+        const auto& moves = boardState.GetPossibleMoves();
+        boardStateObj.AddDataRow(stateStr, moves);
+    }
+    return boardStateObj;
+}
+
 Agent* AgentManager::GetAgent(AgentID id) {
     if (id.IsInvalid())
         return nullptr;
@@ -254,6 +702,61 @@ const std::unordered_set<AgentID>& AgentManager::GetDeletedServerAgents() const
     return m_deletedServerAgents;
 }
 
+bool AgentManager::HasTrainingDeltas() const {
+    for (const auto& [id, agent] : m_agents) {
+        if (agent.HasTrainingDelta() && agent.GetServerID() != 0)
+            return true;
+    }
+    return false;
+}
+
+std::vector<std::pair<AgentID, AgentTrainingDelta>> AgentManager::TakeTrainingDeltas() {
+    std::vector<std::pair<AgentID, AgentTrainingDelta>> deltas;
+
+    for (auto& [id, agent] : m_agents) {
+        AgentID serverID = agent.GetServerID();
+        if (!agent.HasTrainingDelta() || serverID == 0)
+            continue;
+
+        // saved without the delta from now on, a resent delta would be added twice
+        agent.m_deltaRevision++;
+        if (m_deletedServerAgents.find(serverID) != m_deletedServerAgents.end()) {
+            agent.m_trainingDelta = AgentTrainingDelta{};
+            continue;
+        }
+
+        deltas.emplace_back(serverID, std::move(agent.m_trainingDelta));
+        agent.m_trainingDelta = AgentTrainingDelta{};
+    }
+    return deltas;
+}
+
+void AgentManager::RequeueTrainingDeltas(std::vector<std::pair<AgentID, AgentTrainingDelta>>&& deltas) {
+    std::unordered_map<AgentID, AgentID> localIDs = BuildServerIDLookup();
+
+    // deltas add up, the order they are merged in does not matter
+    for (auto& [serverID, delta] : deltas) {
+        auto itLocal = localIDs.find(serverID);
+        if (itLocal == localIDs.end())
+            continue;
+
+        Agent& agent = m_agents[itLocal->second];
+        agent.m_trainingDelta.Merge(std::move(delta));
+        agent.m_deltaRevision++;
+    }
+}
+
+void AgentManager::ConfirmTrainingDelta(AgentID serverID, size_t version) {
+    for (auto& [id, agent] : m_agents) {
+        if (agent.GetServerID() != serverID)
+            continue;
+
+        if (!agent.IsAgentDirty() && agent.GetVersion() + 1 == version)
+            agent.SetVersion(version);
+        return;
+    }
+}
+
 std::unordered_set<AgentID> AgentManager::GetDirtyAgents() const {
     std::unordered_set<AgentID> dirtyAgents;
 
@@ -271,6 +774,14 @@ std::unordered_set<AgentID> AgentManager::GetDirtyAgents() const {
     return dirtyAgents;
 }
 
+int64_t AgentManager::GetChangeSequence() const {
+    return m_changeSequence;
+}
+
+void AgentManager::SetChangeSequence(int64_t sequence) {
+    m_changeSequence = sequence;
+}
+
 void AgentManager::SetDeletedServerAgents(const std::unordered_set<AgentID>& ids) {
     m_deletedServerAgents = ids;
 }
@@ -0,0 +1,67 @@
+#include "AI/AgentSaveWorker.h"
+
+AgentSaveWorker::~AgentSaveWorker() {
+	if (!m_thread.joinable())
+		return;
+
+	// queued jobs are still written, the last save on quit must not be lost
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+	m_cv.notify_all();
+	m_thread.join();
+}
+
+void AgentSaveWorker::Push(Job&& job, bool replaceQueued) {
+	{
+		std::lock_guard lock(m_mutex);
+		if (replaceQueued)
+			m_jobs.clear();
+		m_jobs.push_back(std::move(job));
+
+		if (!m_thread.joinable())
+			m_thread = std::thread(&AgentSaveWorker::WorkerLoop, this);
+	}
+	m_cv.notify_one();
+}
+
+bool AgentSaveWorker::Wait() {
+	std::unique_lock lock(m_mutex);
+	m_idleCV.wait(lock, [this]() { return m_jobs.empty() && !m_running; });
+
+	bool ok = !m_failed;
+	m_failed = false;
+	return ok;
+}
+
+std::vector<std::string> AgentSaveWorker::TakeErrors() {
+	std::lock_guard lock(m_mutex);
+	m_failed = false;
+	return std::move(m_errors);
+}
+
+void AgentSaveWorker::WorkerLoop() {
+	std::unique_lock lock(m_mutex);
+	while (true) {
+		m_cv.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+		if (m_jobs.empty())
+			return;
+
+		Job job = std::move(m_jobs.front());
+		m_jobs.pop_front();
+		m_running = true;
+
+		lock.unlock();
+		std::string error;
+		bool ok = job(error);
+		lock.lock();
+
+		m_running = false;
+		if (!ok) {
+			m_failed = true;
+			m_errors.push_back(std::move(error));
+		}
+		m_idleCV.notify_all();
+	}
+}
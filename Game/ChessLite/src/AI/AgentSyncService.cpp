@@ -1,5 +1,6 @@
 #include <CoreLib/OTNFile.h>
 #include "AI/AgentSyncService.h"
+#include "NetProtocol.h"
 #include "App.h"
 #include "FilePaths.h"
 
@@ -38,20 +39,30 @@ void AgentSyncService::Init(AppContext& ctx) {
 *	- send insert request to server
 *
 * Agent exists locally but no longer on server
-*	- fetch all server_ids from server
+*	- first sync: fetch all server_ids from server
 *	- if a local agents server_id is missing from the server, remove it locally
+*	- later syncs: the server sends the agents deleted since the last change sequence
 *
-* Agent exists on server but not locally
-*	- retrieve missing agents from server
-*	- create them locally
+* Agent exists on server but not locally, or newer on server
+*	- first sync: retrieve missing agents from server
+*	- later syncs: retrieve the agents changed since the last change sequence
+*	- create them locally or replace the older local version
+*
+* Every server change has a change sequence, a full sync replies the current one
+* and later syncs only ask for what changed since then
 *
 * Local agent deleted
 *	- send list of deleted agents (server_ids) to server to delete them
 *
 * Local agent modified
-*	- send agents marked as dirty
-*	- server compares versions and updates if newer
+*	- send agents marked as dirty, with only the board states changed since the last sync
+*	- server compares versions and upserts the sent states if newer
 *	- server sends back the modified ids with ther version to mark them locally as clean
+*
+* Registered agent trained
+*	- send only the evaluation and match count changes since the last sync
+*	- server adds them to the stored agent, training of several clients adds up
+*	- changes are requested after the reply, the local delta is rebased onto newer server versions
 */
 
 void AgentSyncService::FullSync(AppContext* ctx) {
@@ -61,24 +72,37 @@ void AgentSyncService::FullSync(AppContext* ctx) {
 	if (!ctx->gameClient.IsConnected())
 		return;
 
+	// all requests of the sync travel in one frame and are answered in about one round trip
+	ctx->gameClient.BeginBatch();
+
 	auto dirtyIDs = ctx->agentManager.GetDirtyAgents();
 	if (!dirtyIDs.empty())
 		SyncDirty(ctx, dirtyIDs);
 
-	// sync agnet on db but not on local
-	RequestMissingAgentsFromServer(ctx);
-
 	const auto& missingIDs = ctx->agentManager.GetUnregisteredAgentIDs();
-	if (!missingIDs.empty())
-		SyncMissingData(ctx, missingIDs);
+	if (ctx->agentManager.GetChangeSequence() == 0) {
+		// sync agnet on db but not on local
+		RequestMissingAgentsFromServer(ctx);
+
+		if (!missingIDs.empty())
+			SyncMissingData(ctx, missingIDs);
 
-	// sync agent not on db but local with db ID
-	RequestServerAgentIDList(ctx);
+		// sync agent not on db but local with db ID
+		RequestServerAgentIDList(ctx);
+	}
+	else {
+		// the changes would echo the new agents before they are registered
+		if (missingIDs.empty())
+			RequestAgentChanges(ctx);
+		else
+			SyncMissingData(ctx, missingIDs);
+	}
 
 	const auto& deletedIDs = ctx->agentManager.GetDeletedServerAgents();
 	if (!deletedIDs.empty())
 		SyncDelete(ctx, deletedIDs);
 
+	ctx->gameClient.EndBatch();
 	m_fullSyncCalled = true;
 }
 
@@ -94,10 +118,18 @@ void AgentSyncService::Sync(AppContext* ctx) {
 		return;
 	}
 
+	ctx->gameClient.BeginBatch();
+
 	const auto& missingIDs = ctx->agentManager.GetUnregisteredAgentIDs();
+	bool requestChanges = missingIDs.empty() && ctx->agentManager.GetChangeSequence() > 0;
 	if (!missingIDs.empty())
 		SyncMissingData(ctx, missingIDs);
 
+	if (ctx->agentManager.HasTrainingDeltas())
+		SyncTrainingDeltas(ctx, requestChanges);
+	else if (requestChanges)
+		RequestAgentChanges(ctx);
+
 	const auto& deletedIDs = ctx->agentManager.GetDeletedServerAgents();
 	if (!deletedIDs.empty())
 		SyncDelete(ctx, deletedIDs);
@@ -105,6 +137,8 @@ void AgentSyncService::Sync(AppContext* ctx) {
 	auto dirtyIDs = ctx->agentManager.GetDirtyAgents();
 	if (!dirtyIDs.empty())
 		SyncDirty(ctx, dirtyIDs);
+
+	ctx->gameClient.EndBatch();
 }
 
 bool AgentSyncService::IsSyncInProgress() const {
@@ -134,7 +168,8 @@ void AgentSyncService::RemoveSyncAction() {
 		if (!ctx)
 			return;
 
-		ctx->agentManager.Save(FilePaths::GetDataPath());
+		// after every sync, the frame is not blocked by the write
+		ctx->agentManager.SaveAsync(FilePaths::GetDataPath());
 		ctx->app->SaveUserData();
 	}
 }
@@ -148,23 +183,27 @@ void AgentSyncService::SendErrorNotification(const std::string& msg) {
 }
 
 void AgentSyncService::RequestServerAgentIDList(AppContext* ctx) {
-	OTN::OTNObject headerObj = ctx->gameClient.CreateHeaderBlock("GetAgentIDList");
-	OTN::OTNObject bodyObj{ "body" };
-
+	// v2 has no body and gets the list as binary ids
+	bool binary = ctx->gameClient.UsesBinaryProtocol();
 	std::string msg;
-	OTN::OTNWriter writer;
-	writer.AppendObject(headerObj);
-	writer.AppendObject(bodyObj);
-	if (!writer.SaveToString(msg)) {
-		Log::Error("Failed to sync agents: {}", writer.GetError());
-		return;
+	if (!binary) {
+		OTN::OTNObject headerObj = ctx->gameClient.CreateHeaderBlock("GetAgentIDList");
+		OTN::OTNObject bodyObj{ "body" };
+
+		OTN::OTNWriter writer;
+		writer.AppendObject(headerObj);
+		writer.AppendObject(bodyObj);
+		if (!writer.SaveToString(msg)) {
+			Log::Error("Failed to sync agents: {}", writer.GetError());
+			return;
+		}
 	}
 
 	AddSyncAction();
 	auto self = shared_from_this();
 
-	ctx->gameClient.Send(msg,
-		[self](bool result, const std::string& payload) {
+	ctx->gameClient.Send(binary ? NetOpcode::GET_AGENT_ID_LIST : NetOpcode::NONE, std::move(msg),
+		[self, binary](bool result, const std::string& payload) {
 			if (!result) {
 				self->RemoveSyncAction();
 				Log::Error("Failed to sync agents: {}", payload);
@@ -172,7 +211,7 @@ void AgentSyncService::RequestServerAgentIDList(AppContext* ctx) {
 				return;
 			}
 
-			self->HandleServerIDList(payload);
+			self->HandleServerIDList(payload, binary);
 			self->RemoveSyncAction();
 		});
 }
@@ -180,29 +219,80 @@ void AgentSyncService::RequestServerAgentIDList(AppContext* ctx) {
 void AgentSyncService::RequestMissingAgentsFromServer(AppContext* ctx) {
 	auto serverAgents = ctx->agentManager.GetAgentServerIDs();
 
-	OTN::OTNObject headerObj = ctx->gameClient.CreateHeaderBlock("RequestMissingAgents");
-	OTN::OTNObject bodyObj{ "body" };
-	bodyObj.SetNames("id");
-	bodyObj.SetTypes("int64");
-	bodyObj.ReserveDataRows(serverAgents.size());
-	for (auto& id : serverAgents) {
-		bodyObj.AddDataRow(static_cast<int64_t>(id.value));
+	bool binary = ctx->gameClient.UsesBinaryProtocol();
+	std::string msg;
+	if (binary) {
+		std::vector<int64_t> ids;
+		ids.reserve(serverAgents.size());
+		for (auto& id : serverAgents)
+			ids.push_back(static_cast<int64_t>(id.value));
+		msg = NetProtocol::EncodeIDList(ids);
+	}
+	else {
+		OTN::OTNObject headerObj = ctx->gameClient.CreateHeaderBlock("RequestMissingAgents");
+		OTN::OTNObject bodyObj{ "body" };
+		bodyObj.SetNames("id");
+		bodyObj.SetTypes("int64");
+		bodyObj.ReserveDataRows(serverAgents.size());
+		for (auto& id : serverAgents) {
+			bodyObj.AddDataRow(static_cast<int64_t>(id.value));
+		}
+
+		OTN::OTNWriter writer;
+		writer.AppendObject(headerObj);
+		writer.AppendObject(bodyObj);
+		if (!writer.SaveToString(msg)) {
+			Log::Error("Failed to sync agents: {}", writer.GetError());
+			return;
+		}
 	}
 
+	AddSyncAction();
+	auto self = shared_from_this();
+
+	// the reply is the largest of the sync, it is read on the network thread
+	ctx->gameClient.Send(binary ? NetOpcode::REQUEST_MISSING_AGENTS : NetOpcode::NONE, std::move(msg), GameClient::ResponseFormat::OTN_SEGMENTS,
+		[self](bool result, const std::string& payload, OTN::OTNReader& reader) {
+			if (!result) {
+				self->RemoveSyncAction();
+				Log::Error("Failed to sync agents: {}", payload);
+				self->SendErrorNotification("Failed to sync agents: " + payload);
+				return;
+			}
+
+			self->HandleAddAgents(reader);
+			self->RemoveSyncAction();
+		});
+}
+
+void AgentSyncService::RequestAgentChanges(AppContext* ctx) {
+	bool binary = ctx->gameClient.UsesBinaryProtocol();
 	std::string msg;
-	OTN::OTNWriter writer;
-	writer.AppendObject(headerObj);
-	writer.AppendObject(bodyObj);
-	if (!writer.SaveToString(msg)) {
-		Log::Error("Failed to sync agents: {}", writer.GetError());
-		return;
+	if (binary) {
+		msg = NetProtocol::EncodeSequence(ctx->agentManager.GetChangeSequence());
+	}
+	else {
+		OTN::OTNObject headerObj = ctx->gameClient.CreateHeaderBlock("RequestAgentChanges");
+		OTN::OTNObject bodyObj{ "body" };
+		bodyObj.SetNames("since");
+		bodyObj.SetTypes("int64");
+		bodyObj.AddDataRow(ctx->agentManager.GetChangeSequence());
+
+		OTN::OTNWriter writer;
+		writer.AppendObject(headerObj);
+		writer.AppendObject(bodyObj);
+		if (!writer.SaveToString(msg)) {
+			Log::Error("Failed to sync agents: {}", writer.GetError());
+			return;
+		}
 	}
 
 	AddSyncAction();
 	auto self = shared_from_this();
 
-	ctx->gameClient.Send(msg,
-		[self](bool result, const std::string& payload) {
+	// same reply as the missing agents, only the changed agents and the deleted ids
+	ctx->gameClient.Send(binary ? NetOpcode::REQUEST_AGENT_CHANGES : NetOpcode::NONE, std::move(msg), GameClient::ResponseFormat::OTN_SEGMENTS,
+		[self](bool result, const std::string& payload, OTN::OTNReader& reader) {
 			if (!result) {
 				self->RemoveSyncAction();
 				Log::Error("Failed to sync agents: {}", payload);
@@ -210,30 +300,37 @@ void AgentSyncService::RequestMissingAgentsFromServer(AppContext* ctx) {
 				return;
 			}
 
-			self->HandleAddAgents(payload);
+			self->HandleAddAgents(reader);
 			self->RemoveSyncAction();
 		});
 }
 
 void AgentSyncService::SyncMissingData(AppContext* ctx, const std::unordered_set<AgentID>& ids) {
-	OTN::OTNObject headerObj = ctx->gameClient.CreateHeaderBlock("SyncMissingData");
-	OTN::OTNObject bodyObj = ctx->agentManager.BuildOTNObjectFromIDs(ids, true);
-	bodyObj.SetObjectName("body");
-
+	bool binary = ctx->gameClient.UsesBinaryProtocol();
 	std::string msg;
-	OTN::OTNWriter writer;
-	writer.AppendObject(headerObj);
-	writer.AppendObject(bodyObj);
-	if (!writer.SaveToString(msg)) {
-		Log::Error("Failed to sync agents: {}", writer.GetError());
-		return;
+	if (binary) {
+		msg = ctx->agentManager.BuildBinaryFromIDs(ids);
+	}
+	else {
+		OTN::OTNObject headerObj = ctx->gameClient.CreateHeaderBlock("SyncMissingData");
+		OTN::OTNObject bodyObj = ctx->agentManager.BuildOTNObjectFromIDs(ids, true);
+		bodyObj.SetObjectName("body");
+
+		OTN::OTNWriter writer;
+		writer.AppendObject(headerObj);
+		writer.AppendObject(bodyObj);
+		writer.UseParallelWrite(true);
+		if (!writer.SaveToString(msg)) {
+			Log::Error("Failed to sync agents: {}", writer.GetError());
+			return;
+		}
 	}
 
 	AddSyncAction();
 	auto self = shared_from_this();
 
-	ctx->gameClient.Send(msg,
-		[self](bool result, const std::string& payload) {
+	ctx->gameClient.Send(binary ? NetOpcode::SYNC_MISSING_DATA : NetOpcode::NONE, std::move(msg), GameClient::ResponseFormat::OTN,
+		[self](bool result, const std::string& payload, OTN::OTNReader& reader) {
 			if (!result) {
 				self->RemoveSyncAction();
 				Log::Error("Failed to sync agents: {}", payload);
@@ -241,32 +338,42 @@ void AgentSyncService::SyncMissingData(AppContext* ctx, const std::unordered_set
 				return;
 			}
 
-			self->RegisterAgents(payload);
+			self->RegisterAgents(reader);
 			self->RemoveSyncAction();
 		});
 }
 
 void AgentSyncService::SyncDelete(AppContext* ctx, const std::unordered_set<AgentID>& deleteIDs) {
-	OTN::OTNObject headerObj = ctx->gameClient.CreateHeaderBlock("SyncDeleteData");
-	OTN::OTNObject bodyObj{ "body" };
-	bodyObj.SetNames("ids");
-	bodyObj.SetTypes("int64");
-	for (auto id : deleteIDs)
-		bodyObj.AddDataRow(static_cast<int64_t>(id.value));
-
+	bool binary = ctx->gameClient.UsesBinaryProtocol();
 	std::string msg;
-	OTN::OTNWriter writer;
-	writer.AppendObject(headerObj);
-	writer.AppendObject(bodyObj);
-	if (!writer.SaveToString(msg)) {
-		Log::Error("Failed to sync agents: {}", writer.GetError());
-		return;
+	if (binary) {
+		std::vector<int64_t> ids;
+		ids.reserve(deleteIDs.size());
+		for (auto id : deleteIDs)
+			ids.push_back(static_cast<int64_t>(id.value));
+		msg = NetProtocol::EncodeIDList(ids);
+	}
+	else {
+		OTN::OTNObject headerObj = ctx->gameClient.CreateHeaderBlock("SyncDeleteData");
+		OTN::OTNObject bodyObj{ "body" };
+		bodyObj.SetNames("ids");
+		bodyObj.SetTypes("int64");
+		for (auto id : deleteIDs)
+			bodyObj.AddDataRow(static_cast<int64_t>(id.value));
+
+		OTN::OTNWriter writer;
+		writer.AppendObject(headerObj);
+		writer.AppendObject(bodyObj);
+		if (!writer.SaveToString(msg)) {
+			Log::Error("Failed to sync agents: {}", writer.GetError());
+			return;
+		}
 	}
 
 	AddSyncAction();
 	auto self = shared_from_this();
 
-	ctx->gameClient.Send(msg,
+	ctx->gameClient.Send(binary ? NetOpcode::SYNC_DELETE_DATA : NetOpcode::NONE, std::move(msg),
 		[self](bool result, const std::string& payload) {
 			if (!result) {
 				self->RemoveSyncAction();
@@ -280,36 +387,112 @@ void AgentSyncService::SyncDelete(AppContext* ctx, const std::unordered_set<Agen
 }
 
 void AgentSyncService::SyncDirty(AppContext* ctx, const std::unordered_set<AgentID>& dirtyIDs) {
-	OTN::OTNObject headerObj = ctx->gameClient.CreateHeaderBlock("SyncDirtyData");
-	OTN::OTNObject bodyObj = ctx->agentManager.BuildOTNObjectFromIDs(dirtyIDs, true);
-	bodyObj.SetObjectName("body");
-
+	// only the board states changed since the last sync, the server keeps the others
+	bool binary = ctx->gameClient.UsesBinaryProtocol();
 	std::string msg;
-	OTN::OTNWriter writer;
-	writer.AppendObject(headerObj);
-	writer.AppendObject(bodyObj);
-	if (!writer.SaveToString(msg)) {
-		Log::Error("Failed to sync agents: {}", writer.GetError());
-		return;
+	if (binary) {
+		msg = ctx->agentManager.BuildBinaryFromIDs(dirtyIDs, true);
+	}
+	else {
+		OTN::OTNObject headerObj = ctx->gameClient.CreateHeaderBlock("SyncDirtyStates");
+		OTN::OTNObject bodyObj = ctx->agentManager.BuildOTNObjectFromIDs(dirtyIDs, true, true);
+		bodyObj.SetObjectName("body");
+
+		OTN::OTNWriter writer;
+		writer.AppendObject(headerObj);
+		writer.AppendObject(bodyObj);
+		writer.UseParallelWrite(true);
+		if (!writer.SaveToString(msg)) {
+			Log::Error("Failed to sync agents: {}", writer.GetError());
+			return;
+		}
 	}
 
 	AddSyncAction();
 	auto self = shared_from_this();
 
-	ctx->gameClient.Send(msg,
-		[self](bool result, const std::string& payload) {
+	ctx->gameClient.Send(binary ? NetOpcode::SYNC_DIRTY_STATES : NetOpcode::NONE, std::move(msg), GameClient::ResponseFormat::OTN,
+		[self](bool result, const std::string& payload, OTN::OTNReader& reader) {
 			if (!result) {
 				self->RemoveSyncAction();
 				Log::Error("Failed to sync agents: {}", payload);
 				self->SendErrorNotification("Failed to sync agents: " + payload);
 				return;
 			}
-			self->HandleDirtyAgents(payload);
+			self->HandleDirtyAgents(reader);
 			self->RemoveSyncAction();
 		});
 }
 
-void AgentSyncService::RegisterAgents(const std::string& serverIDs) {
+void AgentSyncService::SyncTrainingDeltas(AppContext* ctx, bool requestChanges) {
+	auto deltas = std::make_shared<std::vector<std::pair<AgentID, AgentTrainingDelta>>>(ctx->agentManager.TakeTrainingDeltas());
+	if (deltas->empty()) {
+		if (requestChanges)
+			RequestAgentChanges(ctx);
+		return;
+	}
+
+	bool binary = ctx->gameClient.UsesBinaryProtocol();
+	std::string msg;
+	if (binary) {
+		msg = AgentManager::BuildBinaryTrainingDeltas(*deltas);
+	}
+	else {
+		OTN::OTNObject headerObj = ctx->gameClient.CreateHeaderBlock("SyncAgentDeltas");
+		OTN::OTNObject bodyObj{ "body" };
+		bodyObj.SetNames("server_id", "matches_played", "matches_won", "matches_played_white", "matches_won_white", "states");
+		bodyObj.SetTypes("int64", "int", "int", "int", "int", "-");
+		bodyObj.ReserveDataRows(deltas->size());
+
+		for (const auto& [serverID, delta] : *deltas) {
+			bodyObj.AddDataRow(
+				static_cast<int64_t>(serverID.value),
+				delta.matches.matchesPlayed,
+				delta.matches.matchesWon,
+				delta.matches.matchesPlayedAsWhite,
+				delta.matches.matchesWonAsWhite,
+				AgentManager::BuildDeltaStateObject(delta)
+			);
+		}
+
+		OTN::OTNWriter writer;
+		writer.AppendObject(headerObj);
+		writer.AppendObject(bodyObj);
+		if (!writer.SaveToString(msg)) {
+			ctx->agentManager.RequeueTrainingDeltas(std::move(*deltas));
+			Log::Error("Failed to sync training: {}", writer.GetError());
+			return;
+		}
+	}
+
+	AddSyncAction();
+	auto self = shared_from_this();
+
+	// the changes are requested after the reply, a change echoing a delta still in flight could not be rebased
+	// read here and not on the network thread, a reply that fails to read must not requeue deltas the server already added
+	ctx->gameClient.Send(binary ? NetOpcode::SYNC_AGENT_DELTAS : NetOpcode::NONE, std::move(msg),
+		[self, deltas, requestChanges](bool result, const std::string& payload) {
+			auto* app = App::GetInstance();
+			AppContext* ctx = app ? app->GetContext() : nullptr;
+
+			if (!result) {
+				if (ctx)
+					ctx->agentManager.RequeueTrainingDeltas(std::move(*deltas));
+
+				self->RemoveSyncAction();
+				Log::Error("Failed to sync training: {}", payload);
+				self->SendErrorNotification("Failed to sync training: " + payload);
+				return;
+			}
+
+			self->HandleTrainingDeltas(payload);
+			if (ctx && requestChanges)
+				self->RequestAgentChanges(ctx);
+			self->RemoveSyncAction();
+		});
+}
+
+void AgentSyncService::RegisterAgents(OTN::OTNReader& reader) {
 	auto* app = App::GetInstance();
 	if (!app)
 		return;
@@ -317,12 +500,6 @@ void AgentSyncService::RegisterAgents(const std::string& serverIDs) {
 	if (!ctx)
 		return;
 
-	OTN::OTNReader reader;
-	if (!reader.ReadString(serverIDs)) {
-		Log::Error("Failed to sync agents: {}", reader.GetError());
-		return;
-	}
-
 	auto obj = reader.TryGetObject("ids");
 	if (!obj || obj->GetRowCount() <= 0)
 		return;
@@ -342,29 +519,39 @@ void AgentSyncService::RegisterAgents(const std::string& serverIDs) {
 	}
 }
 
-void AgentSyncService::HandleServerIDList(const std::string& agentIDList) {
-	OTN::OTNReader reader;
-	if (!reader.ReadString(agentIDList)) {
-		Log::Error("Failed to parse server agent ID list: {}", reader.GetError());
-		return;
-	}
-
-	auto listObj = reader.TryGetObject("List");
-	if (!listObj) {
-		Log::Error("Failed to retrieve 'List' object from server data: {}", reader.GetError());
-		return;
-	}
-
+void AgentSyncService::HandleServerIDList(const std::string& agentIDList, bool binary) {
 	// Build a set of server agent IDs for fast lookup
 	std::unordered_set<int64_t> serverIDs;
-	serverIDs.reserve(listObj->GetRowCount());
-	for (size_t i = 0; i < listObj->GetRowCount(); i++) {
-		auto idOpt = listObj->TryGetValue<int64_t>(i, "id");
-		if (!idOpt) {
-			Log::Error("Invalid server ID at row {}: {}", i, reader.GetError());
+	if (binary) {
+		std::vector<int64_t> ids;
+		if (!NetProtocol::DecodeIDList(agentIDList, ids)) {
+			Log::Error("Failed to parse server agent ID list: truncated binary list");
+			return;
+		}
+		serverIDs.insert(ids.begin(), ids.end());
+	}
+	else {
+		OTN::OTNReader reader;
+		if (!reader.ReadString(agentIDList)) {
+			Log::Error("Failed to parse server agent ID list: {}", reader.GetError());
+			return;
+		}
+
+		auto listObj = reader.TryGetObject("List");
+		if (!listObj) {
+			Log::Error("Failed to retrieve 'List' object from server data: {}", reader.GetError());
 			return;
 		}
-		serverIDs.emplace(*idOpt);
+
+		serverIDs.reserve(listObj->GetRowCount());
+		for (size_t i = 0; i < listObj->GetRowCount(); i++) {
+			auto idOpt = listObj->TryGetValue<int64_t>(i, "id");
+			if (!idOpt) {
+				Log::Error("Invalid server ID at row {}: {}", i, reader.GetError());
+				return;
+			}
+			serverIDs.emplace(*idOpt);
+		}
 	}
 
 	auto* app = App::GetInstance();
@@ -387,19 +574,21 @@ void AgentSyncService::HandleServerIDList(const std::string& agentIDList) {
 	}
 }
 
-void AgentSyncService::HandleAddAgents(const std::string& agentList) {
-	OTN::OTNReader reader;
-	if (!reader.ReadString(agentList)) {
-		Log::Error("Failed to parse server agent list: {}", reader.GetError());
-		return;
+void AgentSyncService::HandleAddAgents(OTN::OTNReader& reader) {
+	// the server streams the tables in row batches, one segment per batch
+	std::unordered_map<std::string, OTN::OTNObject> tables;
+	for (auto& segment : reader.GetSegments()) {
+		for (auto& [name, batch] : segment) {
+			auto [it, inserted] = tables.try_emplace(name, std::move(batch));
+			if (!inserted)
+				it->second.AppendRows(std::move(batch));
+		}
 	}
 
-	auto agentObj = reader.TryGetObject("agents");
-	if (!agentObj)
-		return;
-
-	auto boardStatesObj = reader.TryGetObject("board_states");
-	auto gameMovesObj = reader.TryGetObject("game_moves");
+	auto findTable = [&](const std::string& name) -> const OTN::OTNObject* {
+		auto it = tables.find(name);
+		return (it != tables.end()) ? &it->second : nullptr;
+	};
 
 	auto* app = App::GetInstance();
 	if (!app)
@@ -408,33 +597,51 @@ void AgentSyncService::HandleAddAgents(const std::string& agentList) {
 	if (!ctx)
 		return;
 
-	const auto& obj = *agentObj;
+	if (const OTN::OTNObject* agentObj = findTable("agents"))
+		LoadServerAgents(ctx, *agentObj, findTable("board_states"), findTable("game_moves"));
+
+	if (const OTN::OTNObject* deletedObj = findTable("deleted_agents")) {
+		std::vector<AgentID> deleted;
+		deleted.reserve(deletedObj->GetRowCount());
+		for (size_t i = 0; i < deletedObj->GetRowCount(); i++) {
+			if (auto id = deletedObj->TryGetValue<int64_t>(i, "id"))
+				deleted.emplace_back(static_cast<uint32_t>(*id));
+		}
+		ctx->agentManager.RemoveServerAgents(deleted);
+	}
+
+	// only set once the whole reply is applied, a cancelled stream has no changes object
+	if (const OTN::OTNObject* changesObj = findTable("changes")) {
+		if (auto sequence = changesObj->TryGetValue<int64_t>(0, "sequence"))
+			ctx->agentManager.SetChangeSequence(*sequence);
+	}
+}
+
+void AgentSyncService::LoadServerAgents(
+	AppContext* ctx,
+	const OTN::OTNObject& obj,
+	const OTN::OTNObject* boardStatesObj,
+	const OTN::OTNObject* gameMovesObj)
+{
+	std::vector<Agent> agents;
+	agents.reserve(obj.GetRowCount());
+
+	auto dataSchema = AgentManager::BindPersistentDataSchema(obj);
 
 	for (size_t i = 0; i < obj.GetRowCount(); i++) {
 		auto serverID = obj.TryGetValue<int64_t>(i, "id");
+		auto version = obj.TryGetValue<int>(i, "version");
 		auto name = obj.TryGetValue<std::string>(i, "name");
 		auto config = obj.TryGetValue<std::string>(i, "config");
 
-		auto matchesPlayed = obj.TryGetValue<int>(i, "matches_played");
-		auto matchesWon = obj.TryGetValue<int>(i, "matches_won");
-
-		auto matchesPlayedWhite = obj.TryGetValue<int>(i, "matches_played_white");
-		auto matchesWonWhite = obj.TryGetValue<int>(i, "matches_won_white");
-
 		if (!serverID || !name || !config)
 			continue;
 
 		Agent agent{ *name, *config };
 		AgentPersistentData data;
 
-		if (matchesPlayed) 
-			data.matchesPlayed = *matchesPlayed;
-		if (matchesWon) 
-			data.matchesWon = *matchesWon;
-		if (matchesPlayedWhite) 
-			data.matchesPlayedAsWhite = *matchesPlayedWhite;
-		if (matchesWonWhite) 
-			data.matchesWonAsWhite = *matchesWonWhite;
+		if (!OTN::OTNBindingCodec<AgentPersistentData>::DecodeRowPerField(obj.GetRow(i), dataSchema, data))
+			Log::Warn("Server agent '{}' has invalid stats, the invalid ones start at 0", *name);
 
 		if (boardStatesObj) {
 			std::unordered_map<std::string, BoardState> states;
@@ -481,8 +688,11 @@ void AgentSyncService::HandleAddAgents(const std::string& agentList) {
 
 		agent.LoadPersistentData(data);
 		agent.SetServerID(AgentID(static_cast<uint32_t>(*serverID)));
-		ctx->agentManager.AddAgent(agent);
+		agent.SetVersion(static_cast<size_t>(version.value_or(0)));
+		agents.push_back(std::move(agent));
 	}
+
+	ctx->agentManager.UpsertServerAgents(std::move(agents));
 }
 
 void AgentSyncService::HandleDeletedAgents() {
@@ -496,19 +706,13 @@ void AgentSyncService::HandleDeletedAgents() {
 	ctx->agentManager.ClearDeletedServerAgents();
 }
 
-void AgentSyncService::HandleDirtyAgents(const std::string& dirtyList) {
+void AgentSyncService::HandleDirtyAgents(OTN::OTNReader& reader) {
 	auto* app = App::GetInstance();
 	if (!app)
 		return;
 	auto* ctx = app->GetContext();
 	if (!ctx)
 		return;
-	
-	OTN::OTNReader reader;
-	if (!reader.ReadString(dirtyList)) {
-		Log::Error("Failed to parse server dirty list: {}", reader.GetError());
-		return;
-	}
 
 	auto idObj = reader.TryGetObject("ids");
 	if (!idObj)
@@ -524,6 +728,34 @@ void AgentSyncService::HandleDirtyAgents(const std::string& dirtyList) {
 	}
 }
 
+void AgentSyncService::HandleTrainingDeltas(const std::string& versionList) {
+	auto* app = App::GetInstance();
+	if (!app)
+		return;
+	auto* ctx = app->GetContext();
+	if (!ctx)
+		return;
+
+	OTN::OTNReader reader;
+	if (!reader.ReadString(versionList)) {
+		Log::Error("Failed to parse trained agent list: {}", reader.GetError());
+		return;
+	}
+
+	auto resultObj = reader.TryGetObject("Result");
+	if (!resultObj)
+		return;
+
+	for (size_t i = 0; i < resultObj->GetRowCount(); i++) {
+		auto serverID = resultObj->TryGetValue<int64_t>(i, "server_id");
+		auto version = resultObj->TryGetValue<int64_t>(i, "version");
+		if (!serverID || !version)
+			continue;
+
+		ctx->agentManager.ConfirmTrainingDelta(AgentID(static_cast<uint32_t>(*serverID)), static_cast<size_t>(*version));
+	}
+}
+
 void AgentSyncService::GlobalCallback(const std::string& msg) {
 	OTN::OTNReader reader;
 	if (!reader.ReadString(msg)) {
@@ -56,6 +56,14 @@ const std::vector<GameMove>& BoardState::GetPossibleMoves() const {
 	return m_possibleMoves;
 }
 
+size_t BoardState::GetChangedVersion() const {
+	return m_changedVersion;
+}
+
+void BoardState::MarkChanged(size_t agentVersion) {
+	m_changedVersion = agentVersion;
+}
+
 std::vector<GameMove> BoardState::CalculatePossibleMoves(
 	const CoreChess::ChessGame& game)
 {
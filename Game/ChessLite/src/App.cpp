@@ -14,6 +14,12 @@ App::App()
     : Application("ChessLite", SDLCore::Version(1, 0)) {
     g_appInstance = this;
     m_agentSync->Init(m_context);
+
+    m_context.gameClient.SetConnectionLostCallback([]() {
+        // the client disconnects once more while the app is destroyed
+        if (auto* app = App::GetInstance())
+            app->NotifyError("Connection lost to server");
+    });
 }
 
 App::~App() {
@@ -166,8 +172,8 @@ void App::ClearLayers() {
 
 bool App::SaveUserData() {
     OTN::OTNObject obj{ "userData" };
-    obj.SetNames("deleted_server_agents");
-    obj.SetTypes("int64[]");
+    obj.SetNames("deleted_server_agents", "change_sequence");
+    obj.SetTypes("int64[]", "int64");
 
     const auto& deletedServerAgents = m_context.agentManager.GetDeletedServerAgents();
     std::vector<int64_t> deletedServerAgents64;
@@ -175,7 +181,7 @@ bool App::SaveUserData() {
     for (auto id : deletedServerAgents)
         deletedServerAgents64.push_back(static_cast<int64_t>(id.value));
 
-    obj.AddDataRow(deletedServerAgents64);
+    obj.AddDataRow(deletedServerAgents64, m_context.agentManager.GetChangeSequence());
 
     OTN::OTNWriter writer;
     writer.AppendObject(obj);
@@ -195,6 +201,10 @@ void App::LoadUserData(const OTN::OTNObject& object) {
 
         m_context.agentManager.SetDeletedServerAgents(ids);
     }
+
+    // missing in older user data, the next sync is a full one
+    if (auto changeSequence = object.TryGetValue<int64_t>(0, "change_sequence"))
+        m_context.agentManager.SetChangeSequence(*changeSequence);
 }
 
 bool App::LoadAppData(const std::string name, const OTN::OTNObject& obj) {
@@ -315,7 +325,7 @@ void App::InstantiateWindow() {
 
 void App::ConnectClient() {
     auto& client = m_context.gameClient;
-    if (client.IsConnected())
+    if (client.IsConnected() || client.IsConnecting())
         return;
 
     if (m_currentClientTimeOut > 0) {
@@ -323,20 +333,20 @@ void App::ConnectClient() {
         return;
     }
 
-    if (!client.Connect(m_host, m_port)) {
+    // the result arrives in ProcessGameClient, the frame is not blocked while the host is resolved
+    client.Connect(m_host, m_port, [this](bool result, const std::string& error) {
+        if (result) {
+            m_connectionLostMsgSent = false;
+            NotifyDefault("Connected to server");
+            return;
+        }
+
         if (!m_connectionLostMsgSent) {
-            NotifyError(client.GetError());
+            NotifyError(error);
             m_connectionLostMsgSent = true;
         }
-
-        Log::Error(client.GetError());
-        client.ClearError();
-    }
-
-    if (client.IsConnected()) {
-        m_connectionLostMsgSent = false;
-        NotifyDefault("Connected to server");
-    }
+        Log::Error(error);
+    });
 
     m_currentClientTimeOut = m_clientTimeOut;
 }
@@ -409,10 +419,8 @@ void App::ProcessLayerCommands() {
 void App::ProcessGameClient() {
     auto& client = m_context.gameClient;
 
-    if (!client.IsConnected())
-        return;
-
-    if (!client.ProcessSendQueue()) {
+    // also delivers the connect result and a lost connection
+    if (client.IsConnected() && !client.ProcessSendQueue()) {
         Log::Error(client.GetError());
         client.ClearError();
     }
@@ -4,6 +4,7 @@
 namespace FilePaths {
 
 	const char* agentsFileName = "Agents.otn";
+	const char* agentsJournalFileName = "AgentsJournal.otn";
 	const char* optionsFileName = "Settings.otn";
 	const char* userFileName = "User.otn";
 
@@ -1,96 +1,200 @@
 ﻿#include "GameClient.h"
 #include <CoreLib/BinarySerializer.h>
 #include <CoreLib/BinaryDeserializer.h>
-#include <SDLCoreLib/SDLCoreTime.h>
-#include "App.h"
+#include <algorithm>
 
 GameClient::GameClient() {
 }
 
 GameClient::~GameClient() {
 	Disconnect();
-}
-
-bool GameClient::Connect(const std::string& host, uint16_t port) {
-	if (IsConnected()  && 
-		m_host == host && 
-		m_port == port)
-		return true;
 
-	m_host = host;
-	m_port = port;
-	NET_Address* addr = NET_ResolveHostname(host.c_str());
-	if (!addr) {
-		AddError("Connect: Failed to resolve host!\n");
-		return false;
+	if (m_netThread.joinable()) {
+		NetCommand command;
+		command.type = NetCommandType::STOP;
+		PushCommand(std::move(command));
+		m_netThread.join();
 	}
+}
 
-	if (NET_WaitUntilResolved(addr, 5000) != NET_Status::NET_SUCCESS) {
-		AddError("Connect: DNS resolution failed!\n");
-		NET_UnrefAddress(addr);
-		return false;
+void GameClient::Connect(const std::string& host, uint16_t port, ConnectCallback&& cb) {
+	if (m_state != ConnectionState::DISCONNECTED) {
+		if (m_host == host && m_port == port) {
+			if (m_state == ConnectionState::CONNECTED) {
+				if (cb)
+					cb(true, "");
+			}
+			else {
+				m_connectCallback = std::move(cb);
+			}
+			return;
+		}
+		Disconnect();
 	}
 
-	m_socket = NET_CreateClient(addr, port);
-	NET_UnrefAddress(addr);
+	StartNetThread();
 
-	if (!m_socket) {
-		AddError("Connect: Failed to connect to server\n");
-		return false;
-	}
-
-	return true;
+	m_host = host;
+	m_port = port;
+	m_generation++;
+	m_state = ConnectionState::CONNECTING;
+	m_protocolVersion = PROTOCOL_VERSION_TEXT;
+	m_connectCallback = std::move(cb);
+
+	// resolving the host can take seconds, the network thread does it
+	NetCommand command;
+	command.type = NetCommandType::CONNECT;
+	command.generation = m_generation;
+	command.host = host;
+	command.port = port;
+	PushCommand(std::move(command));
 }
 
 void GameClient::Disconnect() {
-	if (!IsConnected())
+	if (m_state == ConnectionState::DISCONNECTED)
 		return;
 
-	auto* app = App::GetInstance();
-	if (app) {
-		app->NotifyError("Connection lost to server");
-	}
+	bool wasConnected = (m_state == ConnectionState::CONNECTED);
+
+	// events of the closed connection that are still queued are dropped
+	m_generation++;
+	NetCommand command;
+	command.type = NetCommandType::DISCONNECT;
+	command.generation = m_generation;
+	PushCommand(std::move(command));
+
+	m_connectCallback = nullptr;
+	if (wasConnected)
+		HandleConnectionLost();
+	else
+		m_state = ConnectionState::DISCONNECTED;
+}
+
+void GameClient::HandleConnectionLost() {
+	m_state = ConnectionState::DISCONNECTED;
+	m_batch.clear();
+	m_batchDepth = 0;
+	m_unflushed = false;
+	// a reconnect negotiates again, the server may have changed
+	m_protocolVersion = PROTOCOL_VERSION_TEXT;
 
-	NET_DestroyStreamSocket(m_socket);
-	m_socket = nullptr;
-	m_msgQueue.clear();
+	if (m_connectionLostCallback)
+		m_connectionLostCallback();
 
-	for (auto& p : m_pending)
-		if(p.second.cb)
-			p.second.cb(false, "");
+	// the callbacks may send again, which fails now that the connection is gone
+	auto pending = std::move(m_pending);
 	m_pending.clear();
-	m_receiveBuffer.clear();
+	OTN::OTNReader reader;
+	for (auto& [id, cb] : pending)
+		if (cb)
+			cb(false, "", reader);
+}
+
+void GameClient::Send(std::string payload, Callback&& cb) {
+	Send(NetOpcode::NONE, std::move(payload), std::move(cb));
 }
 
-void GameClient::Send(const std::string& payload, Callback&& cb) {
+void GameClient::Send(NetOpcode opcode, std::string body, Callback&& cb) {
+	Send(opcode, std::move(body), ResponseFormat::RAW,
+		[cb = std::move(cb)](bool result, const std::string& payload, OTN::OTNReader&) {
+			if (cb)
+				cb(result, payload);
+		});
+}
+
+void GameClient::Send(NetOpcode opcode, std::string body, ResponseFormat format, ParsedCallback&& cb) {
 	if (!IsConnected()) {
-		cb(false, "no Connection with server");
+		OTN::OTNReader reader;
+		if (cb)
+			cb(false, "no Connection with server", reader);
 		return;
 	}
 
-	PendingReceive receive;
-	receive.cb = std::move(cb);
-	NetworkMsgID id = NetworkMsgID(m_idManager.GetNewUniqueIdentifier());
-	m_pending[id] = std::move(receive);
+	NetRequest request;
+	request.id = AddPending(std::move(cb));
+	request.flags = (opcode != NetOpcode::NONE) ? PAYLOAD_FLAG_OPCODE : 0;
+	request.opcode = opcode;
+	request.format = format;
+	request.payload = std::move(body);
 
-	// serialize packet: [id][payload length][payload bytes]
-	BinarySerializer ser;
-	ser.AddField(id.value);
-	std::vector<uint8_t> payloadData(payload.begin(), payload.end());
-	ser.AddField(payloadData);// size + data
+	if (m_batchDepth > 0 && m_protocolVersion >= PROTOCOL_VERSION_BATCH) {
+		m_batch.push_back(std::move(request));
+		return;
+	}
 
-	std::vector<uint8_t> buf = ser.ToBuffer();
+	QueueRequest(std::move(request));
+}
 
-	PendingSend ps;
-	uint32_t len = static_cast<uint32_t>(buf.size());
+void GameClient::BeginBatch() {
+	m_batchDepth++;
+}
 
-	ps.data.resize(sizeof(uint32_t) + buf.size());
-	std::memcpy(ps.data.data(), &len, sizeof(uint32_t));
-	std::memcpy(ps.data.data() + sizeof(uint32_t), buf.data(), buf.size());
+void GameClient::EndBatch() {
+	if (m_batchDepth == 0 || --m_batchDepth > 0)
+		return;
 
-	ps.id = id;
+	QueueBatch();
+}
 
-	m_msgQueue.push_back(std::move(ps));
+void GameClient::QueueRequest(NetRequest&& request) {
+	NetCommand command;
+	command.type = NetCommandType::SEND;
+	command.generation = m_generation;
+	command.requests.push_back(std::move(request));
+	PushCommand(std::move(command));
+	m_unflushed = true;
+}
+
+void GameClient::QueueBatch() {
+	if (m_batch.empty())
+		return;
+
+	NetCommand command;
+	command.type = NetCommandType::SEND;
+	command.generation = m_generation;
+	command.requests = std::move(m_batch);
+	m_batch.clear();
+
+	// a single request needs no batch frame
+	if (command.requests.size() > 1) {
+		std::vector<NetworkMsgID> ids;
+		ids.reserve(command.requests.size());
+		for (const auto& request : command.requests)
+			ids.push_back(request.id);
+
+		// the server acknowledges the batch once it dispatched the requests, a rejected batch fails all of them
+		command.batchID = AddPending([this, ids](bool result, const std::string& payload, OTN::OTNReader&) {
+			if (result)
+				return;
+
+			for (NetworkMsgID id : ids)
+				CallRequestCallback(id, false, payload);
+		});
+	}
+
+	PushCommand(std::move(command));
+	m_unflushed = true;
+}
+
+NetworkMsgID GameClient::AddPending(ParsedCallback&& cb) {
+	NetworkMsgID id = NetworkMsgID(m_idManager.GetNewUniqueIdentifier());
+	m_pending[id] = std::move(cb);
+	return id;
+}
+
+void GameClient::StartNetThread() {
+	if (!m_netThread.joinable())
+		m_netThread = std::thread(&GameClient::NetThreadLoop, this);
+}
+
+void GameClient::PushCommand(NetCommand&& command) {
+	m_commands.Push(std::move(command));
+
+	// wakes the network thread if it sleeps without a connection
+	{
+		std::lock_guard guard(m_commandMutex);
+	}
+	m_commandCV.notify_one();
 }
 
 NetworkCallbackID GameClient::AddGlobalCallback(GlobalCallback&& cb) {
@@ -107,19 +211,44 @@ bool GameClient::RemoveGlobalCallback(NetworkCallbackID id) {
 	return found;
 }
 
+void GameClient::SetConnectionLostCallback(ConnectionLostCallback&& cb) {
+	m_connectionLostCallback = std::move(cb);
+}
+
+void GameClient::SetReceiveBudget(float budgetMS) {
+	m_receiveBudgetMS = budgetMS;
+}
+
 void GameClient::ClearError() {
 	m_error.clear();
 }
 
-bool GameClient::IsConnected() const {
-	if (!m_socket)
-		return false;
+void GameClient::UseCompression(bool value) {
+	m_useCompression = value;
+}
 
-	NET_Status status = NET_GetConnectionStatus(m_socket);
-	if (status == NET_Status::NET_SUCCESS)
-		return true;
+bool GameClient::GetUseCompression() const {
+	return m_useCompression;
+}
+
+void GameClient::SetMaxMessageSize(size_t size) {
+	m_maxMessageSize = size;
+}
+
+size_t GameClient::GetMaxMessageSize() const {
+	return m_maxMessageSize;
+}
 
-	return false;
+bool GameClient::UsesBinaryProtocol() const {
+	return m_protocolVersion >= PROTOCOL_VERSION_BINARY;
+}
+
+bool GameClient::IsConnected() const {
+	return m_state == ConnectionState::CONNECTED;
+}
+
+bool GameClient::IsConnecting() const {
+	return m_state == ConnectionState::CONNECTING;
 }
 
 OTN::OTNObject GameClient::CreateHeaderBlock(const std::string& action) {
@@ -148,105 +277,632 @@ bool GameClient::ProcessSendQueue() {
 		return false;
 	}
 
-	while (!m_msgQueue.empty()) {
-		PendingSend& ps = m_msgQueue.front();
+	// requests left in an open batch are sent by EndBatch
+	if (!m_unflushed)
+		return true;
 
-		bool ok = NET_WriteToStreamSocket(
-			m_socket,
-			ps.data.data(),
-			static_cast<int>(ps.data.size())
-		);
+	NetCommand command;
+	command.type = NetCommandType::FLUSH;
+	command.generation = m_generation;
+	PushCommand(std::move(command));
+	m_unflushed = false;
+	return true;
+}
 
-		if (!ok) {
-			AddError(SDL_GetError());
-			CallRequestCallback(ps.id, false, "");
-			Disconnect();
-			return false;
-		}
+bool GameClient::ProcessReceiveQueue() {
+	auto start = std::chrono::steady_clock::now();
+	size_t errorSize = m_error.size();
 
-		m_msgQueue.pop_front();
+	NetEvent event;
+	while (m_events.TryPop(event)) {
+		HandleEvent(event);
+
+		if (std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() >= m_receiveBudgetMS)
+			break;
 	}
 
-	return true;
+	return m_error.size() == errorSize;
 }
 
-bool GameClient::ProcessReceiveQueue() {
-	ProcessPendingSentTimeOut();
+void GameClient::HandleEvent(NetEvent& event) {
+	if (event.generation != m_generation)
+		return;
 
-	if (!IsConnected()) {
-		AddError("ProcessReceiveQueue: Not connected");
+	switch (event.type) {
+	case NetEventType::CONNECTED: {
+		m_state = ConnectionState::CONNECTED;
+		ConnectCallback cb = std::move(m_connectCallback);
+		m_connectCallback = nullptr;
+		if (cb)
+			cb(true, "");
+		break;
+	}
+	case NetEventType::CONNECT_FAILED: {
+		m_state = ConnectionState::DISCONNECTED;
+		ConnectCallback cb = std::move(m_connectCallback);
+		m_connectCallback = nullptr;
+		if (cb)
+			cb(false, event.payload);
+		else
+			AddError(event.payload);
+		break;
+	}
+	case NetEventType::CONNECTION_LOST:
+		AddError(event.payload);
+		HandleConnectionLost();
+		break;
+	case NetEventType::PROTOCOL:
+		m_protocolVersion = event.protocolVersion;
+		break;
+	case NetEventType::RESPONSE:
+		CallRequestCallback(event.id, event.result, event.payload, event.reader.get());
+		break;
+	case NetEventType::REPORT_ERROR:
+		AddError(event.payload);
+		break;
+	}
+}
+
+bool GameClient::WaitForInput(int timeoutMS) {
+	if (m_state == ConnectionState::DISCONNECTED)
 		return false;
+
+	std::unique_lock lock(m_eventMutex);
+	m_eventCV.wait_for(lock, std::chrono::milliseconds(timeoutMS), [this]() {
+		return !m_events.IsEmpty();
+	});
+	return true;
+}
+
+#pragma region Network thread
+
+void GameClient::NetThreadLoop() {
+	bool running = true;
+	while (running) {
+		NetCommand command;
+		while (running && m_commands.TryPop(command))
+			running = NetProcessCommand(command);
+		NetWakeWaiters();
+
+		if (!running)
+			break;
+
+		switch (m_netState) {
+		case ConnectionState::CONNECTING:
+			NetUpdateConnect();
+			break;
+		case ConnectionState::CONNECTED:
+			NetReceive();
+			NetProcessTimeOuts();
+			break;
+		case ConnectionState::DISCONNECTED: {
+			std::unique_lock lock(m_commandMutex);
+			m_commandCV.wait_for(lock, std::chrono::milliseconds(100), [this]() {
+				return !m_commands.IsEmpty();
+			});
+			break;
+		}
+		}
+		NetWakeWaiters();
 	}
 
-	uint8_t buffer[4096];
-	int received = NET_ReadFromStreamSocket(m_socket, buffer, sizeof(buffer));
-	
-	if (received == 0)
-		return true;
+	NetClose();
+}
 
-	if (received < 0) {
-		AddError(SDL_GetError());
-		Disconnect();
+bool GameClient::NetProcessCommand(NetCommand& command) {
+	switch (command.type) {
+	case NetCommandType::CONNECT:
+		NetStartConnect(command);
+		break;
+	case NetCommandType::DISCONNECT:
+		NetClose();
+		break;
+	case NetCommandType::SEND:
+		// after a lost connection the main thread fails the requests itself
+		if (command.generation != m_netGeneration || m_netState != ConnectionState::CONNECTED)
+			break;
+
+		if (command.requests.size() == 1)
+			NetQueueRequest(command.requests.front());
+		else
+			NetQueueBatch(command.batchID, command.requests);
+		break;
+	case NetCommandType::FLUSH:
+		if (command.generation == m_netGeneration && m_netState == ConnectionState::CONNECTED)
+			NetFlush();
+		break;
+	case NetCommandType::STOP:
 		return false;
 	}
+	return true;
+}
 
-	m_receiveBuffer.insert(m_receiveBuffer.end(), buffer, buffer + received);
+void GameClient::NetStartConnect(const NetCommand& command) {
+	NetClose();
+	m_netGeneration = command.generation;
+	m_netPort = command.port;
 
-	while (true) {
-		if (m_receiveBuffer.size() < sizeof(uint32_t))
-			break;
+	// resolved in the background by SDL_net, NetUpdateConnect polls it
+	m_address = NET_ResolveHostname(command.host.c_str());
+	if (!m_address) {
+		NetFail(NetEventType::CONNECT_FAILED, "Connect: Failed to resolve host!\n");
+		return;
+	}
 
-		uint32_t length = 0;
-		std::memcpy(&length, m_receiveBuffer.data(), sizeof(uint32_t));
-		if (m_receiveBuffer.size() < sizeof(uint32_t) + length)
-			break;
+	m_netState = ConnectionState::CONNECTING;
+	m_connectDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(CONNECT_TIMEOUT_MS);
+}
 
-		std::vector<uint8_t> packet(m_receiveBuffer.begin() + sizeof(uint32_t),
-			m_receiveBuffer.begin() + sizeof(uint32_t) + length);
-		BinaryDeserializer des(packet);
+void GameClient::NetUpdateConnect() {
+	bool timedOut = std::chrono::steady_clock::now() > m_connectDeadline;
 
-		uint32_t id = des.Read<uint32_t>();
-		bool response = des.Read<bool>();
-		std::vector<uint8_t> payloadData = des.ReadVector<uint8_t>();
-		std::string payload(payloadData.begin(), payloadData.end());
+	if (!m_socket) {
+		// short waits, a disconnect or a new connect is not blocked by a slow DNS server
+		NET_Status status = NET_WaitUntilResolved(m_address, NET_POLL_MS);
+		if (status == NET_Status::NET_WAITING && !timedOut)
+			return;
+		if (status != NET_Status::NET_SUCCESS) {
+			NetFail(NetEventType::CONNECT_FAILED, "Connect: DNS resolution failed!\n");
+			return;
+		}
 
-		m_receiveBuffer.erase(m_receiveBuffer.begin(),
-			m_receiveBuffer.begin() + sizeof(uint32_t) + length);
+		m_socket = NET_CreateClient(m_address, m_netPort);
+		NET_UnrefAddress(m_address);
+		m_address = nullptr;
 
-		CallRequestCallback(NetworkMsgID(id), response, payload);
+		if (!m_socket) {
+			NetFail(NetEventType::CONNECT_FAILED, "Connect: Failed to connect to server\n");
+			return;
+		}
+		m_connectDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(CONNECT_TIMEOUT_MS);
+		timedOut = false;
 	}
 
-	return true;
+	NET_Status status = NET_WaitUntilConnected(m_socket, NET_POLL_MS);
+	if (status == NET_Status::NET_WAITING && !timedOut)
+		return;
+	if (status != NET_Status::NET_SUCCESS) {
+		NetFail(NetEventType::CONNECT_FAILED, "Connect: Failed to connect to server\n");
+		return;
+	}
+
+	m_netState = ConnectionState::CONNECTED;
+	NetEvent event;
+	event.type = NetEventType::CONNECTED;
+	NetPushEvent(std::move(event));
+
+	// negotiates right after connecting, the version is known before the first sync
+	NetSendHello();
+}
+
+void GameClient::NetClose() {
+	if (m_address) {
+		NET_UnrefAddress(m_address);
+		m_address = nullptr;
+	}
+	if (m_socket) {
+		NET_DestroyStreamSocket(m_socket);
+		m_socket = nullptr;
+	}
+
+	m_netState = ConnectionState::DISCONNECTED;
+	m_sendBuffer.clear();
+	m_decoder.Clear();
+	m_inboundStreams.clear();
+	m_inFlight.clear();
+}
+
+void GameClient::NetFail(NetEventType type, const std::string& error) {
+	NetClose();
+
+	NetEvent event;
+	event.type = type;
+	event.payload = error;
+	NetPushEvent(std::move(event));
+}
+
+void GameClient::NetPushEvent(NetEvent&& event) {
+	event.generation = m_netGeneration;
+	m_events.Push(std::move(event));
+	m_eventsPushed = true;
+}
+
+void GameClient::NetWakeWaiters() {
+	if (!m_eventsPushed)
+		return;
+
+	m_eventsPushed = false;
+	{
+		std::lock_guard guard(m_eventMutex);
+	}
+	m_eventCV.notify_all();
+}
+
+void GameClient::NetPushResponse(uint32_t id, bool result, std::string&& payload) {
+	ResponseFormat format = ResponseFormat::RAW;
+	auto it = m_inFlight.find(id);
+	if (it != m_inFlight.end()) {
+		format = it->second.format;
+		m_inFlight.erase(it);
+	}
+
+	NetEvent event;
+	event.type = NetEventType::RESPONSE;
+	event.id = NetworkMsgID(id);
+	event.result = result;
+
+	// parsed here, the callback on the main thread only applies the result
+	if (result && format != ResponseFormat::RAW) {
+		auto reader = std::make_shared<OTN::OTNReader>();
+		bool read = (format == ResponseFormat::OTN_SEGMENTS)
+			? reader->ReadSegmentsString(payload)
+			: reader->ReadString(payload);
+
+		if (read) {
+			event.reader = std::move(reader);
+		}
+		else {
+			event.result = false;
+			payload = "Failed to read response: " + reader->GetError();
+		}
+	}
+
+	event.payload = std::move(payload);
+	NetPushEvent(std::move(event));
+}
+
+void GameClient::NetReportError(const std::string& msg) {
+	NetEvent event;
+	event.type = NetEventType::REPORT_ERROR;
+	event.payload = msg;
+	NetPushEvent(std::move(event));
+}
+
+void GameClient::NetSendHello() {
+	// hello: [u16 highest version of the client], the reply is the version used from now on
+	BinarySerializer ser;
+	ser.AddField(PROTOCOL_VERSION_BATCH);
+
+	NetQueueFrames(HELLO_ID, NetProtocol::ToPayload(ser), PAYLOAD_FLAG_HELLO, NetOpcode::NONE);
+	NetFlush();
+}
+
+void GameClient::NetQueueRequest(const NetRequest& request) {
+	m_inFlight[request.id.value] = { request.format, std::chrono::steady_clock::now() + m_pendingSendTimeOut };
+	NetQueueFrames(request.id.value, request.payload, request.flags, request.opcode);
+}
+
+void GameClient::NetQueueBatch(NetworkMsgID batchID, const std::vector<NetRequest>& requests) {
+	auto deadline = std::chrono::steady_clock::now() + m_pendingSendTimeOut;
+
+	BinarySerializer ser;
+	ser.AddField(static_cast<uint32_t>(requests.size()));
+	for (const auto& request : requests) {
+		ser.AddField(request.id.value);
+		ser.AddField(request.flags);
+		if (request.flags & PAYLOAD_FLAG_OPCODE)
+			ser.AddField(static_cast<uint16_t>(request.opcode));
+		ser.AddField(request.payload);
+
+		m_inFlight[request.id.value] = { request.format, deadline };
+	}
+
+	m_inFlight[batchID.value] = { ResponseFormat::RAW, deadline };
+	NetQueueFrames(batchID.value, NetProtocol::ToPayload(ser), PAYLOAD_FLAG_BATCH, NetOpcode::NONE);
+}
+
+void GameClient::NetQueueFrames(uint32_t id, const std::string& payload, uint8_t flags, NetOpcode opcode) {
+	const std::string* data = &payload;
+	std::string compressed;
+	if (m_useCompression) {
+		flags |= PAYLOAD_FLAG_ACCEPT_COMPRESSED;
+		if (payload.size() >= COMPRESSION_THRESHOLD &&
+			OTN::CompressOTN(payload, compressed) &&
+			compressed.size() < payload.size()) {
+			flags |= PAYLOAD_FLAG_COMPRESSED;
+			data = &compressed;
+		}
+	}
+
+	// frames are appended to the send buffer, NetFlush writes all of them at once
+	auto pushFrame = [&](const BinarySerializer& ser) {
+		std::vector<uint8_t> buf = ser.ToBuffer();
+		uint32_t len = static_cast<uint32_t>(buf.size());
+
+		size_t offset = m_sendBuffer.size();
+		m_sendBuffer.resize(offset + sizeof(uint32_t) + buf.size());
+		std::memcpy(m_sendBuffer.data() + offset, &len, sizeof(uint32_t));
+		std::memcpy(m_sendBuffer.data() + offset + sizeof(uint32_t), buf.data(), buf.size());
+	};
+
+	auto addHeader = [&](BinarySerializer& ser, uint8_t frameFlags) {
+		ser.AddField(id);
+		ser.AddField(frameFlags);
+		if (frameFlags & PAYLOAD_FLAG_OPCODE)
+			ser.AddField(static_cast<uint16_t>(opcode));
+	};
+
+	if (data->size() <= CHUNK_PAYLOAD_SIZE) {
+		// serialize packet: [id][flags][opcode if v2][payload length][payload bytes]
+		BinarySerializer ser;
+		addHeader(ser, flags);
+		ser.AddField(*data);// size + data
+		pushFrame(ser);
+		return;
+	}
+
+	// serialize chunks: [id][flags|chunked][opcode if v2][sequence][total size][chunk length][chunk bytes]
+	// the request id is the stream id, the server reassembles by it
+	uint32_t totalSize = static_cast<uint32_t>(data->size());
+	uint32_t sequence = 0;
+	for (size_t offset = 0; offset < data->size(); offset += CHUNK_PAYLOAD_SIZE) {
+		size_t chunkSize = std::min(CHUNK_PAYLOAD_SIZE, data->size() - offset);
+
+		BinarySerializer ser;
+		addHeader(ser, static_cast<uint8_t>(flags | PAYLOAD_FLAG_CHUNKED));
+		ser.AddField(sequence++);
+		ser.AddField(totalSize);
+		ser.AddField(data->substr(offset, chunkSize));
+		pushFrame(ser);
+	}
+}
+
+void GameClient::NetFlush() {
+	if (m_sendBuffer.empty() || !m_socket)
+		return;
+
+	bool ok = NET_WriteToStreamSocket(
+		m_socket,
+		m_sendBuffer.data(),
+		static_cast<int>(m_sendBuffer.size())
+	);
+
+	// keeps the capacity for the next flush
+	m_sendBuffer.clear();
+
+	if (!ok)
+		NetFail(NetEventType::CONNECTION_LOST, SDL_GetError());
 }
 
-void GameClient::ProcessPendingSentTimeOut() {
-	std::vector<NetworkMsgID> timeOutIDs;
-	for (auto& [id, pending] : m_pending) {
-		pending.waitedTimeMS += SDLCore::Time::GetDeltaTimeMSF();
-		if (pending.waitedTimeMS >= m_pendingSendTimeOutMS)
-			timeOutIDs.push_back(id);
+void GameClient::NetReceive() {
+	// also the poll interval of the command queue while connected
+	void* socket = m_socket;
+	if (NET_WaitUntilInputAvailable(&socket, 1, NET_POLL_MS) == 0)
+		return;
+
+	// drains the socket, a large response is read in one go
+	uint8_t buffer[RECEIVE_BUFFER_SIZE];
+	while (m_netState == ConnectionState::CONNECTED) {
+		int received = NET_ReadFromStreamSocket(m_socket, buffer, sizeof(buffer));
+		if (received == 0)
+			break;
+
+		if (received < 0) {
+			NetFail(NetEventType::CONNECTION_LOST, SDL_GetError());
+			return;
+		}
+
+		m_decoder.Append(buffer, static_cast<size_t>(received));
+		NetProcessFrames();
 	}
+}
+
+void GameClient::NetProcessFrames() {
+	std::string_view frame;
+	while (m_decoder.Next(frame)) {
+		uint32_t id = 0;
+		bool response = false;
+		uint8_t flags = 0;
+		std::string payload;
+		bool complete = true;
+
+		try {
+			BinaryDeserializer des(frame);
+			id = des.Read<uint32_t>();
+			response = des.Read<bool>();
+			flags = des.Read<uint8_t>();
+			if (flags & PAYLOAD_FLAG_CHUNKED) {
+				complete = AppendChunk(id, des, response, flags, payload);
+			}
+			else if (flags & PAYLOAD_FLAG_STREAMED) {
+				complete = AppendStreamSegment(id, des, response, flags, payload);
+			}
+			else {
+				// e.g. an error that ends a streamed response early
+				m_inboundStreams.erase(id);
+				payload = des.ReadString();
+			}
+		}
+		catch (const std::runtime_error& e) {
+			NetReportError(std::string("Receive: Malformed frame: ") + e.what() + "\n");
+			continue;
+		}
 
-	while (!timeOutIDs.empty()) {
-		auto id = timeOutIDs.back();
-		timeOutIDs.pop_back(); 
+		if (!complete)
+			continue;
 
-		auto it = m_pending.find(id);
-		if (it != m_pending.end()) {
-			if (it->second.cb) {
-				it->second.cb(false, "Connection time out");
+		if (flags & PAYLOAD_FLAG_COMPRESSED) {
+			std::string text;
+			std::string error;
+			if (!OTN::DecompressOTN(payload, text, error, m_maxMessageSize)) {
+				NetReportError("Receive: Failed to decompress payload: " + error + "\n");
+				NetPushResponse(id, false, "");
+				continue;
 			}
-			m_pending.erase(it);
+			payload = std::move(text);
 		}
+
+		if (id == HELLO_ID) {
+			// an older server does not know the hello and keeps the text protocol
+			if (!response)
+				continue;
+
+			try {
+				BinaryDeserializer des(payload);
+				NetEvent event;
+				event.type = NetEventType::PROTOCOL;
+				event.protocolVersion = std::min(des.Read<uint16_t>(), PROTOCOL_VERSION_BATCH);
+				NetPushEvent(std::move(event));
+			}
+			catch (const std::runtime_error&) {
+				NetReportError("SendHello: Invalid protocol version in the reply\n");
+			}
+			continue;
+		}
+
+		NetPushResponse(id, response, std::move(payload));
+	}
+}
+
+void GameClient::NetProcessTimeOuts() {
+	if (m_inFlight.empty())
+		return;
+
+	auto now = std::chrono::steady_clock::now();
+	for (auto it = m_inFlight.begin(); it != m_inFlight.end();) {
+		if (now < it->second.deadline) {
+			++it;
+			continue;
+		}
+
+		NetEvent event;
+		event.type = NetEventType::RESPONSE;
+		event.id = NetworkMsgID(it->first);
+		event.payload = "Connection time out";
+		it = m_inFlight.erase(it);
+		NetPushEvent(std::move(event));
 	}
 }
 
-void GameClient::CallRequestCallback(NetworkMsgID id, bool result, const std::string& msg) {
+bool GameClient::AppendChunk(uint32_t id, BinaryDeserializer& des, bool& response, uint8_t& flags, std::string& outPayload) {
+	uint32_t sequence = des.Read<uint32_t>();
+	uint32_t totalSize = des.Read<uint32_t>();
+	std::string_view chunk = des.ReadStringView();
+
+	auto fail = [&](const std::string& error) {
+		NetReportError("Receive: " + error + "\n");
+		m_inboundStreams.erase(id);
+		response = false;
+		flags = 0;
+		outPayload.clear();
+		return true;
+	};
+
+	auto it = m_inboundStreams.find(id);
+	if (it == m_inboundStreams.end()) {
+		if (sequence != 0)
+			return fail("Chunked response started with sequence " + std::to_string(sequence));
+		if (totalSize > m_maxMessageSize)
+			return fail("Chunked response of " + std::to_string(totalSize) + " bytes exceeds the limit");
+
+		it = m_inboundStreams.emplace(id, InboundStream{}).first;
+		it->second.response = response;
+		it->second.flags = flags;
+		it->second.totalSize = totalSize;
+		it->second.data.reserve(totalSize);
+	}
+
+	InboundStream& stream = it->second;
+	if (sequence != stream.nextSequence)
+		return fail("Chunk " + std::to_string(sequence) + " arrived, expected " + std::to_string(stream.nextSequence));
+	if (totalSize != stream.totalSize || chunk.size() > stream.totalSize - stream.data.size())
+		return fail("Chunk does not match the announced response size");
+
+	stream.data.append(chunk);
+	stream.nextSequence++;
+	ResetPendingTimeOut(id);
+
+	if (stream.data.size() < stream.totalSize)
+		return false;
+
+	response = stream.response;
+	flags = stream.flags;
+	outPayload = std::move(stream.data);
+	m_inboundStreams.erase(it);
+	return true;
+}
+
+bool GameClient::AppendStreamSegment(uint32_t id, BinaryDeserializer& des, bool& response, uint8_t& flags, std::string& outPayload) {
+	uint32_t sequence = des.Read<uint32_t>();
+	bool segmentEnd = des.Read<bool>();
+	bool streamEnd = des.Read<bool>();
+	std::string_view piece = des.ReadStringView();
+
+	auto fail = [&](const std::string& error) {
+		NetReportError("Receive: " + error + "\n");
+		m_inboundStreams.erase(id);
+		response = false;
+		flags = 0;
+		outPayload.clear();
+		return true;
+	};
+
+	auto it = m_inboundStreams.find(id);
+	if (it == m_inboundStreams.end()) {
+		if (sequence != 0)
+			return fail("Streamed response started with sequence " + std::to_string(sequence));
+
+		it = m_inboundStreams.emplace(id, InboundStream{}).first;
+		it->second.response = response;
+	}
+
+	InboundStream& stream = it->second;
+	if (sequence != stream.nextSequence)
+		return fail("Stream piece " + std::to_string(sequence) + " arrived, expected " + std::to_string(stream.nextSequence));
+	size_t maxSize = m_maxMessageSize;
+	if (stream.data.size() + stream.segment.size() + piece.size() > maxSize)
+		return fail("Streamed response exceeds the limit");
+
+	stream.segment.append(piece);
+	stream.nextSequence++;
+	ResetPendingTimeOut(id);
+
+	if (segmentEnd) {
+		if (flags & PAYLOAD_FLAG_COMPRESSED) {
+			// the decompressed segments count against the limit as well, the check above only saw compressed bytes
+			std::string text;
+			std::string error;
+			if (!OTN::DecompressOTN(stream.segment, text, error, maxSize - stream.data.size()))
+				return fail("Failed to decompress stream segment: " + error);
+			stream.data += text;
+		}
+		else {
+			stream.data += stream.segment;
+		}
+		stream.segment.clear();
+	}
+
+	if (!streamEnd)
+		return false;
+
+	response = stream.response;
+	// the segments are already decompressed
+	flags = 0;
+	outPayload = std::move(stream.data);
+	m_inboundStreams.erase(it);
+	return true;
+}
+
+
+void GameClient::ResetPendingTimeOut(uint32_t id) {
+	// the response is still arriving
+	auto it = m_inFlight.find(id);
+	if (it != m_inFlight.end())
+		it->second.deadline = std::chrono::steady_clock::now() + m_pendingSendTimeOut;
+}
+
+#pragma endregion
+
+void GameClient::CallRequestCallback(NetworkMsgID id, bool result, const std::string& msg, OTN::OTNReader* reader) {
 	auto it = m_pending.find(id);
 	if (it != m_pending.end()) {
-		if(it->second.cb)
-			it->second.cb(result, msg);
+		// erased first, the callback may send and rehash m_pending
+		ParsedCallback cb = std::move(it->second);
 		m_pending.erase(it);
+		if (cb) {
+			OTN::OTNReader empty;
+			cb(result, msg, reader ? *reader : empty);
+		}
 		return;
 	}
 	if(result)
@@ -263,4 +919,4 @@ void GameClient::CallGlobalCallBacks(const std::string & msg) {
 		if(cb)
 			cb(msg);
 	}
-}
\ No newline at end of file
+}
@@ -340,15 +340,15 @@ namespace Layers {
 
 	void StartLoadLayer::RegisterData(AppContext* ctx, ResourceLoader& loader) {		
 		const auto& assets = loader.GetOTNObjects();
-		if (assets.empty())
-			return;
-
 		for (const auto& assetKey : assets) {
 			for (const auto& [name, obj] : *(assetKey.asset.get())) {
 				if (ctx->app->LoadAppData(name, obj))
 					break;// skip to next object
 			}
 		}
+
+		// changes since the last snapshot
+		ctx->agentManager.LoadJournal(FilePaths::GetDataPath());
 	}
 
 }
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "NetProtocol.h"
+#include <CoreLib/BinarySerializer.h>
+#include <CoreLib/BinaryDeserializer.h>
+#include <algorithm>
+#include <stdexcept>
+
+namespace NetProtocol {
+
+	std::string EncodeIDList(const std::vector<int64_t>& ids) {
+		BinarySerializer ser;
+		ser.AddField(ids);
+		return ToPayload(ser);
+	}
+
+	bool DecodeIDList(std::string_view payload, std::vector<int64_t>& outIDs) {
+		outIDs.clear();
+		try {
+			BinaryDeserializer des(payload);
+			uint32_t count = des.Read<uint32_t>();
+			outIDs.reserve(std::min<size_t>(count, payload.size() / sizeof(int64_t)));
+			for (uint32_t i = 0; i < count; ++i)
+				outIDs.push_back(des.Read<int64_t>());
+		}
+		catch (const std::runtime_error&) {
+			outIDs.clear();
+			return false;
+		}
+		return true;
+	}
+
+	std::string EncodeSequence(int64_t sequence) {
+		BinarySerializer ser;
+		ser.AddField(sequence);
+		return ToPayload(ser);
+	}
+
+	void AddState(BinarySerializer& ser, const std::string& boardState, const std::vector<GameMove>& moves) {
+		ser.AddField(boardState);
+		ser.AddComplexField(moves, [](BinarySerializer& s, const GameMove& move) {
+			s.AddFields(move.GetEvaluation(),
+				static_cast<uint8_t>(move.GetFrom().x), static_cast<uint8_t>(move.GetFrom().y),
+				static_cast<uint8_t>(move.GetTo().x), static_cast<uint8_t>(move.GetTo().y));
+		});
+	}
+
+	std::string ToPayload(const BinarySerializer& ser) {
+		std::vector<uint8_t> buffer = ser.ToBuffer();
+		return std::string(buffer.begin(), buffer.end());
+	}
+
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+/**
+* @brief Splits a byte stream into length-prefixed frames ([uint32_t length][length bytes]).
+*
+* Received bytes are kept in a growable ring buffer, so consuming a frame is just moving the
+* read position instead of erasing from the front of a vector. Complete frames are handed out
+* as views into the buffer, nothing is copied unless a frame wraps around the end of the ring,
+* in that case the buffered bytes are moved to the front once.
+*
+* example:
+* decoder.Append(data, size);
+* std::string_view frame;
+* while (decoder.Next(frame)) {
+*     BinaryDeserializer des(frame);
+*     ...
+* }
+*/
+class FrameDecoder {
+public:
+    /**
+    * @param maxFrameSize Largest accepted frame body, 0 means unlimited.
+    * @param initialCapacity Start size of the ring buffer, grows as needed.
+    */
+    explicit FrameDecoder(size_t maxFrameSize = 0, size_t initialCapacity = 4096);
+
+    /**
+    * @brief Adds received bytes to the end of the stream.
+    *
+    * Invalidates views returned by Next.
+    */
+    void Append(const void* data, size_t size);
+
+    /**
+    * @brief Gets the next complete frame body (without its length prefix).
+    *
+    * The view stays valid until the next call to Append, Next or Clear.
+    * Returns false if no complete frame is buffered or the stream is broken (see HasError).
+    */
+    bool Next(std::string_view& outFrame);
+
+    /**
+    * @brief Drops all buffered bytes and resets the error state.
+    */
+    void Clear();
+
+    /**
+    * @brief Returns true if a frame announced a length above maxFrameSize.
+    *
+    * The stream can not be resynchronized after that, call Clear before reusing the decoder.
+    */
+    bool HasError() const;
+    size_t GetBufferedSize() const;
+    size_t GetCapacity() const;
+    size_t GetMaxFrameSize() const;
+
+private:
+    std::vector<uint8_t> m_buffer;
+    size_t m_head = 0;// < index of the first unread byte
+    size_t m_size = 0;// < number of unread bytes
+    size_t m_maxFrameSize = 0;
+    bool m_error = false;
+
+    void Reserve(size_t required);
+    /*
+    * Moves the unread bytes to the start of a buffer of the given capacity.
+    */
+    void Linearize(size_t capacity);
+    void CopyOut(size_t offset, uint8_t* dst, size_t size) const;
+};
\ No newline at end of file
@@ -8,10 +8,12 @@
 #include <optional>
 #include <filesystem>
 #include <cstdint>
+#include <limits>
 #include <string_view>
 #include <unordered_map>
 #include <sstream>
 #include <iomanip>
+#include <tuple>
 
 /**
 * @file OTNFile.h
@@ -210,6 +212,47 @@ namespace OTN {
 		static_assert(otn_always_false_v<T>, "Unsupported type for ToOTNDataType");
 	}
 
+	/**
+	* @brief Compile-time field list for a type.
+	*
+	* Specializations provide a static NAME (object name) and a static Fields()
+	* returning a std::tuple of BindField/BindAccessor entries. Bound types are
+	* encoded and decoded by OTNBindingCodec directly, without going through
+	* OTNObjectBuilder, and take precedence over ToOTNDataType.
+	*
+	* note:
+	*
+	* - Only base types (int, int64_t, uint64_t, float, double, bool, std::string) can be bound.
+	*
+	* code:
+	*
+	* template<>
+	*
+	* struct OTN::OTNBinding<Foo> {
+	*
+	*     static constexpr const char* NAME = "Foo";
+	*
+	*     static auto Fields() { return std::make_tuple(OTN::BindField("id", &Foo::id)); }
+	*
+	* };
+	*
+	* @tparam T Type to bind.
+	*/
+	template<typename T>
+	struct OTNBinding;
+
+	template<typename T, typename = void>
+	struct has_otn_binding : std::false_type {};
+
+	template<typename T>
+	struct has_otn_binding<T, std::void_t<decltype(OTNBinding<T>::Fields())>> : std::true_type {};
+
+	template<typename T>
+	inline constexpr bool has_otn_binding_v = has_otn_binding<T>::value;
+
+	template<typename T>
+	class OTNBindingCodec;
+
 	/**
 	* @brief Type descriptor with support for nested arrays
 	*
@@ -523,6 +566,7 @@ namespace OTN {
 	*/
 	class OTNObject {
 		friend class OTNObjectBuilder;
+		template<typename> friend class OTNBindingCodec;
 	public:
 		/**
 		* @brief Construct a new OTN object with given name
@@ -780,6 +824,16 @@ namespace OTN {
 		*/
 		OTNObject& AddDataRowList(const OTNRow& values);
 
+		/**
+		* @brief Move all rows of another object with the same columns behind the rows of this object
+		*
+		* Used to merge an object that arrived in row batches, see OTNReader::ReadSegmentsString.
+		*
+		* @param other Object with the same column names, its rows are moved out
+		* @return Reference to this object for method chaining
+		*/
+		OTNObject& AppendRows(OTNObject&& other);
+
 		/**
 		* @brief Pre-allocate storage for data rows
 		* @param amount Number of rows to reserve space for
@@ -1312,10 +1366,13 @@ namespace OTN {
 				std::is_same_v<DT, unsigned int>) {
 				m_value = static_cast<int64_t>(value);
 			}
+			else if constexpr (has_otn_binding_v<DT>) {
+				m_value = std::make_shared<OTNObject>(OTNBindingCodec<DT>::EncodeObject(value));
+			}
 			else {
 				OTNObjectBuilder builder;
 				// cast const, because ToOTNDataType needs a non-const reference
-				ToOTNDataType<DT>(builder, static_cast<U>(value));
+				ToOTNDataType<DT>(builder, const_cast<DT&>(value));
 				if (!builder.IsValid()) {
 					AddError(builder.GetError());
 					return;
@@ -1388,6 +1445,19 @@ namespace OTN {
 				return std::nullopt;
 			}
 		}
+		else if constexpr (has_otn_binding_v<DT>) {
+			if (val.type != OTNBaseType::OBJECT)
+				return std::nullopt;
+
+			const OTNObjectPtr* ptr = std::get_if<OTNObjectPtr>(&val.value);
+			if (!ptr || !*ptr || (*ptr)->GetRowCount() != 1)
+				return std::nullopt;
+
+			DT result{};
+			if (!OTNBindingCodec<DT>::Decode(**ptr, 0, result))
+				return std::nullopt;
+			return result;
+		}
 		else {
 			if (val.type != OTNBaseType::OBJECT) 
 				return std::nullopt;
@@ -1513,6 +1583,16 @@ namespace OTN {
 				}
 			}
 			return true;
+		}
+		else if constexpr (has_otn_binding_v<DT>) {
+			if (val.type != OTNBaseType::OBJECT)
+				return false;
+
+			const OTNObjectPtr* ptr = std::get_if<OTNObjectPtr>(&val.value);
+			if (!ptr || !*ptr || (*ptr)->GetRowCount() != 1)
+				return false;
+
+			return OTNBindingCodec<DT>::Decode(**ptr, 0, data);
 		}// if type ist not specified check if it can be made with the object builder
 		else if (val.type == OTNBaseType::OBJECT) {
 			OTNObjectPtr ptr = std::get<OTNObjectPtr>(val.value);
@@ -1533,6 +1613,464 @@ namespace OTN {
 		return false;
 	}
 
+	/**
+	* @brief Field bound through a pointer to a data member.
+	*/
+	template<typename C, typename V>
+	struct OTNMemberField {
+		using ClassType = C;
+		using ValueType = V;
+
+		const char* name;
+		V C::* member;
+
+		const V& Get(const C& obj) const { return obj.*member; }
+		void Set(C& obj, V&& value) const { obj.*member = std::move(value); }
+	};
+
+	/**
+	* @brief Field bound through a getter/setter pair.
+	* Used for values that are not plain members (e.g. components of a nested vector).
+	*/
+	template<typename C, typename V, typename Getter, typename Setter>
+	struct OTNAccessorField {
+		using ClassType = C;
+		using ValueType = V;
+
+		const char* name;
+		Getter getter;
+		Setter setter;
+
+		V Get(const C& obj) const { return getter(obj); }
+		void Set(C& obj, V&& value) const { setter(obj, std::move(value)); }
+	};
+
+	/**
+	* @brief Binds a data member to a column.
+	* @param name Column name.
+	* @param member Pointer to the data member.
+	*/
+	template<typename C, typename V>
+	constexpr OTNMemberField<C, V> BindField(const char* name, V C::* member) {
+		static_assert(is_otn_base_type_v<V> && !std::is_same_v<V, OTNObjectRef>,
+			"BindField only supports OTN base types");
+		return { name, member };
+	}
+
+	/**
+	* @brief Binds a getter/setter pair to a column.
+	* @tparam V Value type stored in the column.
+	* @tparam C Bound type.
+	* @param name Column name.
+	* @param getter Callable V(const C&).
+	* @param setter Callable void(C&, V).
+	*/
+	template<typename V, typename C, typename Getter, typename Setter>
+	constexpr OTNAccessorField<C, V, Getter, Setter> BindAccessor(const char* name, Getter getter, Setter setter) {
+		static_assert(is_otn_base_type_v<V> && !std::is_same_v<V, OTNObjectRef>,
+			"BindAccessor only supports OTN base types");
+		return { name, getter, setter };
+	}
+
+	/**
+	* @brief Typed encoder/decoder generated from an OTNBinding field list.
+	*
+	* Names and types are known at compile time, so encoding writes the row
+	* directly without type deduction. Decoding validates the header of an
+	* object once (BindSchema) and then reads every row with direct typed
+	* access instead of a name lookup and variant round-trip per value.
+	*
+	* @tparam T Bound type (OTNBinding<T> must be specialized).
+	*/
+	template<typename T>
+	class OTNBindingCodec {
+	public:
+		using FieldTuple = std::decay_t<decltype(OTNBinding<T>::Fields())>;
+		static constexpr size_t FIELD_COUNT = std::tuple_size_v<FieldTuple>;
+
+		/// Column index for every bound field, resolved once per object
+		using Schema = std::array<size_t, FIELD_COUNT>;
+		/// Column of a field that BindSchemaPerField could not bind
+		static constexpr size_t UNBOUND_COLUMN = static_cast<size_t>(-1);
+
+		static const std::string& GetObjectName() {
+			static const std::string name = OTNBinding<T>::NAME;
+			return name;
+		}
+
+		static const std::vector<std::string>& GetNames() {
+			static const std::vector<std::string> names = [] {
+				std::vector<std::string> result;
+				result.reserve(FIELD_COUNT);
+				ForEachField([&](size_t, const auto& field) {
+					result.emplace_back(field.name);
+				});
+				return result;
+			}();
+			return names;
+		}
+
+		static const std::vector<OTNTypeDesc>& GetTypes() {
+			static const std::vector<OTNTypeDesc> types = [] {
+				std::vector<OTNTypeDesc> result;
+				result.reserve(FIELD_COUNT);
+				ForEachField([&](size_t, const auto& field) {
+					using V = typename std::decay_t<decltype(field)>::ValueType;
+					result.emplace_back(GetType<V>());
+				});
+				return result;
+			}();
+			return types;
+		}
+
+		/**
+		* @brief Creates an empty object with the bound name, names and types.
+		* @param reserveRows Number of rows to reserve.
+		*/
+		static OTNObject CreateObject(size_t reserveRows = 0) {
+			OTNObject obj{ GetObjectName() };
+			obj.m_columnNames = GetNames();
+			obj.m_columnTypes = GetTypes();
+			obj.m_dataRows.reserve(reserveRows);
+			return obj;
+		}
+
+		/**
+		* @brief Appends the bound fields of a value to a row.
+		* @param value Source value.
+		* @param outRow Row to append to.
+		*/
+		static void EncodeRow(const T& value, OTNRow& outRow) {
+			outRow.reserve(outRow.size() + FIELD_COUNT);
+			ForEachField([&](size_t, const auto& field) {
+				outRow.emplace_back(OTNValueVariant{ field.Get(value) });
+			});
+		}
+
+		/**
+		* @brief Encodes a single value as a one-row object.
+		*/
+		static OTNObject EncodeObject(const T& value) {
+			OTNObject obj = CreateObject(1);
+			OTNRow row;
+			EncodeRow(value, row);
+			obj.AddRowInternal(std::move(row));
+			return obj;
+		}
+
+		/**
+		* @brief Encodes a list of values as one row per value.
+		*/
+		static OTNObject EncodeList(const std::vector<T>& values) {
+			OTNObject obj = CreateObject(values.size());
+			for (const T& value : values) {
+				OTNRow row;
+				EncodeRow(value, row);
+				obj.AddRowInternal(std::move(row));
+			}
+			return obj;
+		}
+
+		/**
+		* @brief Resolves the column of every bound field and checks its type.
+		*
+		* Columns without a declared type are accepted, their values are checked on read.
+		*
+		* @param obj Object to validate.
+		* @return Schema, or std::nullopt if a field is missing or has a different type.
+		*/
+		static std::optional<Schema> BindSchema(const OTNObject& obj) {
+			const auto& names = obj.GetColumnNames();
+			const auto& types = obj.GetColumnTypesDesc();
+
+			Schema schema{};
+			bool valid = true;
+			ForEachField([&](size_t i, const auto& field) {
+				if (!valid)
+					return;
+
+				using V = typename std::decay_t<decltype(field)>::ValueType;
+				size_t column = 0;
+				while (column < names.size() && names[column] != field.name)
+					column++;
+
+				if (column >= names.size()) {
+					valid = false;
+					return;
+				}
+
+				if (column < types.size()) {
+					const OTNTypeDesc& desc = types[column];
+					if (desc.baseType != OTNBaseType::UNKNOWN &&
+						(desc.listDepth != 0 || desc.baseType != GetType<V>()))
+					{
+						valid = false;
+						return;
+					}
+				}
+
+				schema[i] = column;
+			});
+
+			if (!valid)
+				return std::nullopt;
+			return schema;
+		}
+
+		/**
+		* @brief Like BindSchema, but binds every field on its own.
+		*
+		* A field whose column is missing or has an incompatible type gets UNBOUND_COLUMN and
+		* keeps its value in DecodeRowPerField. Integer columns bind to any integer field and
+		* float columns to any floating point field, e.g. an int64 (BIGINT) column to an int field.
+		*
+		* @param outUnbound Receives the names of the fields that could not be bound.
+		*/
+		static Schema BindSchemaPerField(const OTNObject& obj, std::vector<std::string>* outUnbound = nullptr) {
+			const auto& names = obj.GetColumnNames();
+			const auto& types = obj.GetColumnTypesDesc();
+
+			Schema schema{};
+			ForEachField([&](size_t i, const auto& field) {
+				using V = typename std::decay_t<decltype(field)>::ValueType;
+				size_t column = 0;
+				while (column < names.size() && names[column] != field.name)
+					column++;
+
+				if (column < names.size() && column < types.size()) {
+					const OTNTypeDesc& desc = types[column];
+					if (desc.baseType != OTNBaseType::UNKNOWN &&
+						(desc.listDepth != 0 || !IsConvertibleType(desc.baseType, GetType<V>())))
+					{
+						column = names.size();
+					}
+				}
+
+				if (column >= names.size()) {
+					schema[i] = UNBOUND_COLUMN;
+					if (outUnbound)
+						outUnbound->emplace_back(field.name);
+					return;
+				}
+				schema[i] = column;
+			});
+			return schema;
+		}
+
+		/**
+		* @brief Decodes the bound fields of a row using a schema resolved with BindSchemaPerField.
+		* @return False if a bound value is missing or not convertible, only that field keeps its value.
+		*/
+		static bool DecodeRowPerField(const OTNRow& row, const Schema& schema, T& out) {
+			bool valid = true;
+			ForEachField([&](size_t i, const auto& field) {
+				using V = typename std::decay_t<decltype(field)>::ValueType;
+				if (schema[i] == UNBOUND_COLUMN)
+					return;
+
+				V value{};
+				if (schema[i] >= row.size() || !ConvertValue(row[schema[i]], value)) {
+					valid = false;
+					return;
+				}
+				field.Set(out, std::move(value));
+			});
+			return valid;
+		}
+
+		/**
+		* @brief Decodes a row using a schema resolved with BindSchema.
+		* @return False if a value is missing or has a different type, out is partially written then.
+		*/
+		static bool DecodeRow(const OTNRow& row, const Schema& schema, T& out) {
+			bool valid = true;
+			ForEachField([&](size_t i, const auto& field) {
+				if (!valid)
+					return;
+
+				using V = typename std::decay_t<decltype(field)>::ValueType;
+				if (schema[i] >= row.size()) {
+					valid = false;
+					return;
+				}
+
+				const V* value = std::get_if<V>(&row[schema[i]].value);
+				if (!value) {
+					valid = false;
+					return;
+				}
+				field.Set(out, V{ *value });
+			});
+			return valid;
+		}
+
+		/**
+		* @brief Decodes a single row of an object.
+		*/
+		static bool Decode(const OTNObject& obj, size_t row, T& out) {
+			if (row >= obj.GetRowCount())
+				return false;
+
+			auto schema = BindSchema(obj);
+			if (!schema)
+				return false;
+
+			return DecodeRow(obj.GetDataRows()[row], *schema, out);
+		}
+
+		/**
+		* @brief Decodes all rows of an object, the header is validated once.
+		* @return False if the schema does not match or a row is invalid.
+		*/
+		static bool DecodeList(const OTNObject& obj, std::vector<T>& out) {
+			auto schema = BindSchema(obj);
+			if (!schema)
+				return false;
+
+			const auto& rows = obj.GetDataRows();
+			out.clear();
+			out.reserve(rows.size());
+			for (const OTNRow& row : rows) {
+				T value{};
+				if (!DecodeRow(row, *schema, value))
+					return false;
+				out.push_back(std::move(value));
+			}
+			return true;
+		}
+
+		/**
+		* @brief Writes the bound fields in declaration order to a binary serializer.
+		* @tparam Serializer Type providing AddField (e.g. BinarySerializer).
+		*/
+		template<typename Serializer>
+		static void EncodeBinary(Serializer& serializer, const T& value) {
+			ForEachField([&](size_t, const auto& field) {
+				serializer.AddField(field.Get(value));
+			});
+		}
+
+		/**
+		* @brief Reads the bound fields in declaration order from a binary deserializer.
+		* @tparam Deserializer Type providing Read<V> and ReadString (e.g. BinaryDeserializer).
+		*/
+		template<typename Deserializer>
+		static void DecodeBinary(Deserializer& deserializer, T& out) {
+			ForEachField([&](size_t, const auto& field) {
+				using V = typename std::decay_t<decltype(field)>::ValueType;
+				if constexpr (std::is_same_v<V, std::string>)
+					field.Set(out, deserializer.ReadString());
+				else
+					field.Set(out, deserializer.template Read<V>());
+			});
+		}
+
+	private:
+		static const FieldTuple& GetFields() {
+			static const FieldTuple fields = OTNBinding<T>::Fields();
+			return fields;
+		}
+
+		static constexpr bool IsIntegerType(OTNBaseType type) {
+			return type == OTNBaseType::INT || type == OTNBaseType::INT64 || type == OTNBaseType::UINT64;
+		}
+
+		static constexpr bool IsFloatType(OTNBaseType type) {
+			return type == OTNBaseType::FLOAT || type == OTNBaseType::DOUBLE;
+		}
+
+		static constexpr bool IsConvertibleType(OTNBaseType columnType, OTNBaseType fieldType) {
+			return columnType == fieldType ||
+				(IsIntegerType(columnType) && IsIntegerType(fieldType)) ||
+				(IsFloatType(columnType) && IsFloatType(fieldType));
+		}
+
+		template<typename V>
+		static bool ConvertValue(const OTNValue& cell, V& out) {
+			if (const V* value = std::get_if<V>(&cell.value)) {
+				out = *value;
+				return true;
+			}
+
+			if constexpr (std::is_integral_v<V> && !std::is_same_v<V, bool>) {
+				if (const int* value = std::get_if<int>(&cell.value)) {
+					out = static_cast<V>(*value);
+					return true;
+				}
+				if (const int64_t* value = std::get_if<int64_t>(&cell.value)) {
+					out = static_cast<V>(*value);
+					return true;
+				}
+				if (const uint64_t* value = std::get_if<uint64_t>(&cell.value)) {
+					out = static_cast<V>(*value);
+					return true;
+				}
+			}
+			else if constexpr (std::is_floating_point_v<V>) {
+				if (const float* value = std::get_if<float>(&cell.value)) {
+					out = static_cast<V>(*value);
+					return true;
+				}
+				if (const double* value = std::get_if<double>(&cell.value)) {
+					out = static_cast<V>(*value);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		template<typename Func, size_t... I>
+		static void ForEachFieldImpl(Func&& func, std::index_sequence<I...>) {
+			const FieldTuple& fields = GetFields();
+			(func(I, std::get<I>(fields)), ...);
+		}
+
+		template<typename Func>
+		static void ForEachField(Func&& func) {
+			ForEachFieldImpl(std::forward<Func>(func), std::make_index_sequence<FIELD_COUNT>{});
+		}
+	};
+
+	#pragma endregion
+
+	#pragma region OTNCompression
+
+	/// @brief Magic bytes at the start of a compressed OTN document
+	inline constexpr std::string_view COMPRESSED_MAGIC = "OTNZ";
+	/// @brief Version of the compressed container, bump if the codec or the seed dictionary changes
+	inline constexpr uint8_t COMPRESSED_VERSION = 1;
+
+	/**
+	* @brief Checks if data starts with the compressed OTN magic.
+	* @param data Raw file or payload bytes.
+	*/
+	bool IsCompressedOTN(std::string_view data);
+
+	/**
+	* @brief Compresses an OTN document with the built-in LZ block codec.
+	*
+	* Layout: magic, version, body size, header size, plain header text, compressed body.
+	* The header (everything before @object, including the defName/defType tables) is kept
+	* as plain text and, together with a static dictionary of OTN keywords and type names,
+	* seeds the match window of the body.
+	*
+	* @param otnText OTN text as produced by OTNWriter.
+	* @param outData Receives the compressed document.
+	* @return True on success.
+	*/
+	bool CompressOTN(std::string_view otnText, std::string& outData);
+
+	/**
+	* @brief Restores the OTN text of a document created by CompressOTN.
+	* @param data Compressed document.
+	* @param outText Receives the OTN text.
+	* @param outError Receives a description if the data is invalid.
+	* @param maxTextSize Largest OTN text accepted, e.g. the message limit of a connection.
+	* @return True on success.
+	*/
+	bool DecompressOTN(std::string_view data, std::string& outText, std::string& outError,
+		size_t maxTextSize = std::numeric_limits<size_t>::max());
+
 	#pragma endregion
 	
 	#pragma region OTNWriter
@@ -1581,7 +2119,42 @@ namespace OTN {
 		* @return Reference to self for method chaining.
 		*/
 		OTNWriter& UseDeduplicateRows(bool value);
-	
+
+		/**
+		* @brief Enable or disable parallel serialization of the object rows.
+		*
+		* Rows are split into chunks that are formatted by worker threads and
+		* concatenated in their original order, so the output is identical to a serial write.
+		* Small documents are always written serially.
+		*
+		* @param value True to enable, false to disable.
+		* @return Reference to self for method chaining.
+		*/
+		OTNWriter& UseParallelWrite(bool value);
+
+		/**
+		* @brief Set the number of worker threads used by the parallel write.
+		*
+		* The workers come from a pool shared by all writers that is started on the first parallel write.
+		* @param count Number of workers including the calling thread, 0 uses the whole pool.
+		* @return Reference to self for method chaining.
+		*/
+		OTNWriter& SetWorkerCount(uint32_t count);
+
+		/**
+		* @brief Enable or disable the built-in block compression (see CompressOTN).
+		*
+		* note:
+		*
+		* - Applies to Save and SaveToString, AppendToFile always writes plain text so the segments stay readable.
+		*
+		* - OTNReader detects compressed data automatically.
+		*
+		* @param value True to enable, false to disable.
+		* @return Reference to self for method chaining.
+		*/
+		OTNWriter& UseCompression(bool value);
+
 		/**
 		* @brief Append an OTNObject to the writer.
 		* @param object Object to append.
@@ -1619,6 +2192,17 @@ namespace OTN {
 		* @return True if saving succeeded, false otherwise. Retrieve more information via GetError() or TryGetError() 
 		*/
 		bool Save(const OTNFilePath& path);
+
+		/**
+		* @brief Append all appended objects as a new segment to the end of a file.
+		*
+		* Each call writes a complete OTN document (header and body) behind the existing
+		* content, the file is created if it does not exist. Use OTNReader::ReadSegments to read the file back.
+		*
+		* @param path Absolute file path including file name (e.g., "file.otn" or "file").
+		* @return True if appending succeeded, false otherwise.
+		*/
+		bool AppendToFile(const OTNFilePath& path);
 	
 		/**
 		* @brief Serialize all appended objects into an OTN string.
@@ -1647,7 +2231,22 @@ namespace OTN {
 		* @brief Returns whether row deduplication is enabled.
 		*/
 		bool GetDeduplicateRows() const;
-		
+
+		/**
+		* @brief Returns whether parallel writing is enabled.
+		*/
+		bool GetUseParallelWrite() const;
+
+		/**
+		* @brief Returns the configured worker count (0 = hardware concurrency).
+		*/
+		uint32_t GetWorkerCount() const;
+
+		/**
+		* @brief Returns whether compression is enabled.
+		*/
+		bool GetUseCompression() const;
+
 		/**
 		* @brief Returns true if the writer is valid (no errors occurred).
 		*/
@@ -1707,6 +2306,14 @@ namespace OTN {
 				}
 			}
 
+			// Appends already indented text of another stream and takes over its line state
+			void Append(const BufferedIndentedStream& other) {
+				buffer += other.buffer;
+				newLine = other.newLine;
+				if (buffer.size() >= BUFFER_SIZE)
+					Flush();
+			}
+
 			template<typename T>
 			BufferedIndentedStream& operator<<(const T& value) {
 				if (newLine) {
@@ -1746,6 +2353,11 @@ namespace OTN {
 		bool m_useDefType = false;// < replaces often used type names with numbers
 		bool m_useOptimizations = false;// < (Removes spaces, linebreaks)
 		bool m_useDeduplicateRows = false;
+		bool m_useParallelWrite = false;
+		uint32_t m_workerCount = 0;// < 0 = every worker of the shared pool
+		bool m_useCompression = false;
+
+		static constexpr size_t PARALLEL_ROWS_PER_CHUNK = 2048;
 
 		std::vector<OTNObject> m_objects;
 		std::string m_error;
@@ -1755,7 +2367,7 @@ namespace OTN {
 		
 		bool DebugValidateObjects();
 
-		bool WriteToFile(const OTNFilePath& path);
+		bool WriteToFile(const OTNFilePath& path, bool append = false);
 		bool WriteToString(std::string& outText);
 		bool CreateWriteData(WriterData& data);
 		std::vector<size_t> AddObject(WriterData& data, OTNObject& object);
@@ -1778,11 +2390,16 @@ namespace OTN {
 		void WriteHeaderDefHelper(BufferedIndentedStream& stream, const std::unordered_map<std::string, uint32_t>& map);
 		bool WriteBody();
 		bool WriteObjects(BufferedIndentedStream& stream, const std::unordered_map<std::string, SerializedObject>& objects);
+		bool WriteObjectsParallel(BufferedIndentedStream& stream, const std::unordered_map<std::string, SerializedObject>& objects);
+		bool WriteObjectHeader(BufferedIndentedStream& stream, const std::string& name, const SerializedObject& obj, bool firstObj);
+		void WriteObjectNames(std::string& outStr, const SerializedObject& obj) const;
+		// Thread safe, does not touch the writer error state
+		bool WriteObjectRows(BufferedIndentedStream& stream, const SerializedObject& obj, size_t rowBegin, size_t rowEnd) const;
 
-		void WriteOTNValueData(std::string& outStr, const OTNValue& data);
+		bool WriteOTNValueData(std::string& outStr, const OTNValue& data) const;
 
 		template<typename T>
-		void WriteData(std::string& outStr, const T& data);
+		void WriteData(std::string& outStr, const T& data) const;
 
 		void AddSpace(BufferedIndentedStream& stream) const;
 		void AddIndent(BufferedIndentedStream& stream, uint32_t level = 1) const;
@@ -1842,6 +2459,16 @@ namespace OTN {
 	*/
 	class OTNReader {
 	public:
+		/**
+		* @brief Time spent in each phase of the last read, accumulated over all segments.
+		*/
+		struct ReadStats {
+			double tokenizeMs = 0.0;
+			double parseMs = 0.0;
+			double resolveMs = 0.0;
+			size_t tokenCount = 0;
+		};
+
 		/**
 		* @brief Default constructor.
 		*/
@@ -1856,6 +2483,7 @@ namespace OTN {
 		* @brief Read an OTN file from the specified path.
 		* 
 		* Validates the path, opens the file, and reads its data.
+		* Files written with compression are detected and decompressed automatically.
 		* 
 		* @param path Absolute path including file name (e.g., "file.otn" or "file").
 		* @return True if saving succeeded, false otherwise. Retrieve more information via GetError() or TryGetError()
@@ -1866,11 +2494,35 @@ namespace OTN {
 		* @brief Read OTN data directly from a string buffer.
 		*
 		* Useful for tests, network payloads, or already-loaded text content.
+		* The text is parsed in place, e.g. a payload view of a received frame can be passed without copying it.
+		* Compressed data (see CompressOTN) is detected and decompressed automatically.
 		*
 		* @param fileString OTN text data.
 		* @return True if parsing succeeded, false otherwise.
 		*/
-		bool ReadString(const std::string& fileString);
+		bool ReadString(std::string_view fileString);
+
+		/**
+		* @brief Read a file that consists of multiple appended OTN documents (segments).
+		*
+		* Every segment is parsed on its own and stored in file order, see GetSegments().
+		* A torn last segment (e.g. an append that was interrupted) is discarded instead of failing the read.
+		* GetObjects() stays empty after this call.
+		*
+		* @param path Absolute path including file name (e.g., "file.otn" or "file").
+		* @return True if reading succeeded, false otherwise.
+		*/
+		bool ReadSegments(const OTNFilePath& path);
+
+		/**
+		* @brief Read a string that consists of multiple OTN documents (segments), e.g. a streamed network response.
+		*
+		* Behaves like ReadSegments, the segments are available through GetSegments().
+		*
+		* @param text Concatenated OTN documents, not compressed.
+		* @return True if reading succeeded, false otherwise.
+		*/
+		bool ReadSegmentsString(std::string_view text);
 		
 		/**
 		* @brief Returns the version of the OTN file.
@@ -1903,6 +2555,31 @@ namespace OTN {
 		*/
 		std::unordered_map<std::string, OTNObject>& GetObjects();
 
+		/**
+		* @brief Get all segments read by ReadSegments() in file order.
+		* @return Const reference to the list of segments, each containing its objects by name.
+		*/
+		const std::vector<std::unordered_map<std::string, OTNObject>>& GetSegments() const;
+
+		/**
+		* @brief Get all segments read by ReadSegments() or ReadSegmentsString() (modifiable).
+		* @return Reference to the list of segments, the objects can be moved out.
+		*/
+		std::vector<std::unordered_map<std::string, OTNObject>>& GetSegments();
+
+		/**
+		* @brief Byte length of the segments read by the last ReadSegments() or ReadSegmentsString().
+		*
+		* Smaller than the input if a torn last segment was discarded. Truncate the file to this
+		* size before appending again, otherwise the next segment lands behind the torn one.
+		*/
+		size_t GetSegmentsValidSize() const;
+
+		/**
+		* @brief Returns the phase timings of the last ReadFile, ReadString or ReadSegments call.
+		*/
+		const ReadStats& GetReadStats() const;
+
 		/**
 		* @brief Returns true if the reader is in a valid state (no errors).
 		*/
@@ -1983,6 +2660,7 @@ namespace OTN {
 			std::string text;
 			uint32_t line = 0;
 			uint32_t column = 0;
+			size_t offset = 0;// < bytes read when the token was added, one past its last char
 		};
 
 		class OTNTokenizer {
@@ -1994,6 +2672,8 @@ namespace OTN {
 			bool Tokenize();
 			const std::vector<Token>& GetTokens() const;
 			std::string GetError() const;
+			/*< bytes consumed from the stream */
+			size_t GetReadSize() const;
 
 		private:
 			std::istream& m_stream;
@@ -2003,6 +2683,7 @@ namespace OTN {
 
 			uint32_t m_line = 1;
 			uint32_t m_column = 1;
+			size_t m_offset = 0;
 
 			bool ProcessChar(char c);
 
@@ -2027,6 +2708,8 @@ namespace OTN {
 			}
 
 			bool Read();
+			bool Parse();
+			bool Resolve();
 			std::string GetError() const;
 			bool IsValid() const;
 
@@ -2133,9 +2816,14 @@ namespace OTN {
 		std::string m_error;
 		bool m_valid = true;
 		ReaderData m_readerData;
+		std::vector<std::unordered_map<std::string, OTNObject>> m_segments;
+		size_t m_segmentsValidSize = 0;
+		ReadStats m_readStats;
 
 		bool OpenFileStream(const OTNFilePath& path);
 		bool ReadData(std::istream& input, ReaderData& data);
+		bool ReadSegmentsData(std::istream& input);
+		bool ParseTokens(const std::vector<Token>& tokens, ReaderData& data, std::string& outError);
 		bool SetDataVersion(const std::vector<Token>& tokens, ReaderData& data);
 
 		void AddError(const std::string& error);
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cstring>
+#include "FrameDecoder.h"
+
+FrameDecoder::FrameDecoder(size_t maxFrameSize, size_t initialCapacity)
+    : m_maxFrameSize(maxFrameSize) {
+    m_buffer.resize(std::max<size_t>(initialCapacity, sizeof(uint32_t)));
+}
+
+void FrameDecoder::Append(const void* data, size_t size) {
+    if (size == 0)
+        return;
+
+    Reserve(m_size + size);
+
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    size_t capacity = m_buffer.size();
+    size_t tail = (m_head + m_size) % capacity;
+    size_t first = std::min(size, capacity - tail);
+
+    std::memcpy(m_buffer.data() + tail, src, first);
+    std::memcpy(m_buffer.data(), src + first, size - first);
+    m_size += size;
+}
+
+bool FrameDecoder::Next(std::string_view& outFrame) {
+    if (m_error || m_size < sizeof(uint32_t))
+        return false;
+
+    uint32_t length = 0;
+    CopyOut(0, reinterpret_cast<uint8_t*>(&length), sizeof(uint32_t));
+
+    if (m_maxFrameSize > 0 && length > m_maxFrameSize) {
+        m_error = true;
+        return false;
+    }
+
+    size_t frameSize = sizeof(uint32_t) + static_cast<size_t>(length);
+    if (m_size < frameSize)
+        return false;
+
+    size_t capacity = m_buffer.size();
+    size_t bodyStart = (m_head + sizeof(uint32_t)) % capacity;
+    if (bodyStart + length > capacity) {
+        // body wraps around the end of the ring
+        Linearize(capacity);
+        bodyStart = sizeof(uint32_t);
+    }
+
+    outFrame = std::string_view(reinterpret_cast<const char*>(m_buffer.data() + bodyStart), length);
+
+    m_head = (m_head + frameSize) % m_buffer.size();
+    m_size -= frameSize;
+    if (m_size == 0)
+        m_head = 0;
+    return true;
+}
+
+void FrameDecoder::Clear() {
+    m_head = 0;
+    m_size = 0;
+    m_error = false;
+}
+
+bool FrameDecoder::HasError() const {
+    return m_error;
+}
+
+size_t FrameDecoder::GetBufferedSize() const {
+    return m_size;
+}
+
+size_t FrameDecoder::GetCapacity() const {
+    return m_buffer.size();
+}
+
+size_t FrameDecoder::GetMaxFrameSize() const {
+    return m_maxFrameSize;
+}
+
+void FrameDecoder::Reserve(size_t required) {
+    size_t capacity = m_buffer.size();
+    if (required <= capacity)
+        return;
+
+    while (capacity < required)
+        capacity *= 2;
+    Linearize(capacity);
+}
+
+void FrameDecoder::Linearize(size_t capacity) {
+    if (capacity == m_buffer.size()) {
+        std::rotate(m_buffer.begin(), m_buffer.begin() + m_head, m_buffer.end());
+        m_head = 0;
+        return;
+    }
+
+    std::vector<uint8_t> buffer(capacity);
+    CopyOut(0, buffer.data(), m_size);
+    m_buffer.swap(buffer);
+    m_head = 0;
+}
+
+void FrameDecoder::CopyOut(size_t offset, uint8_t* dst, size_t size) const {
+    size_t capacity = m_buffer.size();
+    size_t start = (m_head + offset) % capacity;
+    size_t first = std::min(size, capacity - start);
+
+    std::memcpy(dst, m_buffer.data() + start, first);
+    std::memcpy(dst + first, m_buffer.data(), size - first);
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+
+/*
+* Move of a stored board state, the coordinates are board fields.
+*/
+struct StoredMove {
+	float eval = 0.0f;
+	uint8_t fromX = 0;
+	uint8_t fromY = 0;
+	uint8_t toX = 0;
+	uint8_t toY = 0;
+};
+
+/*
+* Board state of an agent with all its moves, independent of the storage layout.
+*/
+struct StoredBoardState {
+	std::string boardState;
+	std::vector<StoredMove> moves;
+};
+
+/**
+* @brief Compact binary layout of all board states of one agent (agent_blobs.board_states).
+*
+* Layout (Little-Endian):
+* [u32 magic][u8 version][u32 state count]
+* per state: [u32 length][board state bytes][u32 move count]
+* per move:  [f32 eval][u8 from x][u8 from y][u8 to x][u8 to y]
+*/
+namespace AgentBlobCodec {
+
+	constexpr uint32_t MAGIC = 0x42414C43;// < "CLAB"
+	constexpr uint8_t VERSION = 1;
+
+	std::string Encode(const std::vector<StoredBoardState>& states);
+
+	/**
+	* @brief Decodes a blob written by Encode.
+	* @return false if the blob is truncated or has an unknown version, outError is then set
+	*/
+	bool Decode(std::string_view blob, std::vector<StoredBoardState>& outStates, std::string& outError);
+
+}
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 #include <vector>
 #include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
 #include <stdexcept>
 
 /**
@@ -15,7 +18,20 @@ public:
     * @param buffer Reference to the serialized byte buffer.
     */
     BinaryDeserializer(const std::vector<uint8_t>& buffer)
-        : m_buffer(buffer), m_offset(0){
+        : m_data(buffer.data()), m_size(buffer.size()), m_offset(0){
+    }
+
+    /**
+    * @brief Constructs a BinaryDeserializer over a raw byte range, e.g. a frame handed out by FrameDecoder.
+    * @param data First byte of the range, has to outlive the deserializer.
+    * @param size Number of bytes in the range.
+    */
+    BinaryDeserializer(const uint8_t* data, size_t size)
+        : m_data(data), m_size(size), m_offset(0) {
+    }
+
+    BinaryDeserializer(std::string_view data)
+        : BinaryDeserializer(reinterpret_cast<const uint8_t*>(data.data()), data.size()) {
     }
 
     /**
@@ -32,19 +48,19 @@ public:
         static_assert(std::is_trivially_copyable_v<T>,
             "Read requires trivially copyable type");
 
-        if (sizeof(T) > m_buffer.size() - m_offset)
+        if (sizeof(T) > m_size - m_offset)
             throw std::runtime_error("BinaryDeserializer: buffer overflow, current offset + T size is larger than the buffer");
 
         T value{};
 
 #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
         // Little-endian: copy bytes directly
-        std::memcpy(&value, m_buffer.data() + m_offset, sizeof(T));
+        std::memcpy(&value, m_data + m_offset, sizeof(T));
 #else
         // Big-endian: reverse bytes
         uint8_t* ptr = reinterpret_cast<uint8_t*>(&value);
         for (size_t i = 0; i < sizeof(T); ++i)
-            ptr[i] = m_buffer[m_offset + sizeof(T) - 1 - i];
+            ptr[i] = m_data[m_offset + sizeof(T) - 1 - i];
 #endif
         m_offset += sizeof(T);
         return value;
@@ -85,14 +101,38 @@ public:
     std::string ReadString() {
         uint32_t length = Read<uint32_t>();
 
-        if (length > m_buffer.size() - m_offset) {
+        if (length > m_size - m_offset) {
             throw std::runtime_error(
                 "BinaryDeserializer: buffer overflow while reading string"
             );
         }
 
         std::string value(
-            reinterpret_cast<const char*>(m_buffer.data() + m_offset),
+            reinterpret_cast<const char*>(m_data + m_offset),
+            length
+        );
+
+        m_offset += length;
+        return value;
+    }
+
+    /**
+    * @brief Reads a length-prefixed string like ReadString without copying it.
+    *
+    * @return std::string_view View into the underlying buffer, valid as long as the buffer is.
+    * @throws std::runtime_error If the buffer does not contain enough bytes.
+    */
+    std::string_view ReadStringView() {
+        uint32_t length = Read<uint32_t>();
+
+        if (length > m_size - m_offset) {
+            throw std::runtime_error(
+                "BinaryDeserializer: buffer overflow while reading string"
+            );
+        }
+
+        std::string_view value(
+            reinterpret_cast<const char*>(m_data + m_offset),
             length
         );
 
@@ -133,7 +173,7 @@ public:
     * @return false If there are still unread bytes remaining.
     */
     inline bool IsAtEnd() const noexcept {
-        return m_offset >= m_buffer.size();
+        return m_offset >= m_size;
     }
 
     /**
@@ -146,10 +186,11 @@ public:
     *                to the end of the buffer.
     */
     inline size_t Remaining() const noexcept {
-        return m_buffer.size() - m_offset;
+        return m_size - m_offset;
     }
 
 private:
-    const std::vector<uint8_t>& m_buffer;
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
     size_t m_offset = 0;
 };
\ No newline at end of file
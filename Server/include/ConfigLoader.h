@@ -1,6 +1,11 @@
 #pragma once
 #include "OTNFile.h"
+#include "ServerMetrics.h"
 #include "ServerLogic/SQLServerLogic.h"
 
 DBConfig LoadDBConfigRelative(const OTN::OTNFilePath& relativePath);
-DBConfig LoadDBConfig(const OTN::OTNFilePath& path);
\ No newline at end of file
+DBConfig LoadDBConfig(const OTN::OTNFilePath& path);
+
+/*< the metrics object is optional, without it the dump file is disabled */
+MetricsConfig LoadMetricsConfigRelative(const OTN::OTNFilePath& relativePath);
+MetricsConfig LoadMetricsConfig(const OTN::OTNFilePath& path);
\ No newline at end of file
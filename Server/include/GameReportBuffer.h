@@ -0,0 +1,68 @@
+#pragma once
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include "OTNFile.h"
+#include "AgentBlobCodec.h"
+
+/*
+* Training of one agent collected from reported games, written by the store in one change.
+*/
+struct AgentTraining {
+	int matchesPlayed = 0;
+	int matchesWon = 0;
+	int matchesPlayedWhite = 0;
+	int matchesWonWhite = 0;
+	std::unordered_map<std::string, std::vector<StoredMove>> newStates;// < moves of the states created in the games, added if the agent does not have them
+	std::unordered_map<std::string, std::vector<StoredMove>> rewards;// < played moves, eval is the summed reward
+
+	/*< adds the new states and the rewards to the board states of the agent */
+	void ApplyTo(std::vector<StoredBoardState>& states) const;
+};
+
+/**
+* @brief Adds the training delta of one body row (SyncAgentDeltas) to the training of its agent.
+*
+* A row has the server_id, the match counts played since the last sync and the changed board states,
+* the eval of a sent move is the summed evaluation change, so deltas of several clients add up.
+* @return false if the row is not a valid delta
+*/
+bool ReadTrainingDelta(const OTN::OTNObject& body, size_t row, std::unordered_map<int64_t, AgentTraining>& training);
+
+/**
+* @brief Collects the games reported by the clients (ReportGames) until they are flushed.
+*
+* Every game is turned into the same discounted reward update as Agent::GameFinished of the
+* client, the rewards of all games of an agent are summed up, so games of several clients
+* training the same agent all count. Rewards are added, the order of the games does not matter.
+*/
+class GameReportBuffer {
+public:
+	static constexpr float WIN_REWARD = 1.0f;
+	static constexpr float LOSS_REWARD = -1.0f;
+	static constexpr float REWARD_DECAY = 0.2f;// < factor per move from the end of the game
+
+	static constexpr auto FLUSH_INTERVAL = std::chrono::seconds(5);
+	static constexpr size_t FLUSH_GAMES = 512;// < buffered games that flush before the interval
+
+	/**
+	* @brief Adds the game of one body row (server_id, won, white, history, new_states).
+	* @return false if the row is not a valid report
+	*/
+	bool AddReport(const OTN::OTNObject& body, size_t row);
+
+	/*< true once the interval passed or enough games are buffered */
+	bool IsFlushDue() const;
+	/*< hands out all buffered training and starts a new interval */
+	std::unordered_map<int64_t, AgentTraining> Take();
+
+private:
+	mutable std::mutex m_mutex;
+	std::unordered_map<int64_t, AgentTraining> m_agents;
+	size_t m_gameCount = 0;
+	std::chrono::steady_clock::time_point m_lastFlush = std::chrono::steady_clock::now();
+};
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <functional>
+
+#include "OTNFile.h"
+#include "AgentBlobCodec.h"
+#include "GameReportBuffer.h"
+
+/*
+* Agent with all its board states, independent of the storage backend.
+*/
+struct StoredAgent {
+	int64_t id = 0;
+	int64_t version = 0;
+	std::string name;
+	std::string config;
+	int matchesPlayed = 0;
+	int matchesWon = 0;
+	int matchesPlayedWhite = 0;
+	int matchesWonWhite = 0;
+	int64_t changeSequence = 0;// < set by the store, change of the last insert or update
+	std::vector<StoredBoardState> boardStates;
+};
+
+/**
+* @brief Storage of the agents behind the sync actions (InsertAgents, GetAgentIDs, ...).
+*
+* All methods can be called from several threads at once and return once their
+* changes are durable. Errors are thrown as std::runtime_error.
+*
+* Every insert, update and delete call is one change with the next change sequence,
+* clients sync by asking for the changes after the last sequence they have seen.
+*/
+class IAgentStore {
+public:
+	/*< gets a batch of agents, returns false to stop reading */
+	using AgentBatchCallback = std::function<bool(std::vector<StoredAgent>&& agents)>;
+	/*< selects the agents handed out by ForEachAgent */
+	using AgentFilter = std::function<bool(int64_t id, int64_t changeSequence)>;
+
+	virtual ~IAgentStore() = default;
+
+	/*< loads the stored agents, throws if the store can not be used */
+	virtual void Open() = 0;
+	virtual void Close() = 0;
+
+	/**
+	* @brief Stores new agents, the ids are assigned by the store.
+	* @return ids in agent order
+	*/
+	virtual std::vector<int64_t> InsertAgents(std::vector<StoredAgent>&& agents) = 0;
+	/**
+	* @brief Replaces the agents whose stored version is older than their version.
+	*
+	* Unknown agents and agents that are already up to date are skipped, the version
+	* check and the write are one step.
+	* @return indices of the replaced agents
+	*/
+	virtual std::vector<size_t> UpdateAgents(std::vector<StoredAgent>&& agents) = 0;
+	/**
+	* @brief Like UpdateAgents, but the board states of an agent only hold the changed ones.
+	*
+	* They replace the stored states with the same board state, all other stored states are kept.
+	* @return indices of the updated agents
+	*/
+	virtual std::vector<size_t> UpdateAgentStates(std::vector<StoredAgent>&& agents) = 0;
+	/**
+	* @brief Adds the training of reported games or training deltas to the agents, each trained agent gets the next version.
+	*
+	* Unknown agents are skipped.
+	* @return id and new version of every trained agent
+	*/
+	virtual std::vector<std::pair<int64_t, int64_t>> ApplyTraining(const std::unordered_map<int64_t, AgentTraining>& training) = 0;
+	virtual void DeleteAgents(const std::vector<int64_t>& ids) = 0;
+
+	virtual std::vector<int64_t> GetAgentIDs() = 0;
+	/**
+	* @brief Hands out all agents the filter accepts in batches of up to batchSize agents.
+	*
+	* At least one batch is handed out, also if it is empty. An agent changed while the
+	* batches are read is handed out in its newer state.
+	* @return false if onBatch stopped the read
+	*/
+	virtual bool ForEachAgent(const AgentFilter& filter, size_t batchSize, const AgentBatchCallback& onBatch) = 0;
+
+	/*< last durable change sequence, every change up to it can be read */
+	virtual int64_t GetChangeSequence() = 0;
+	/*< ids of the agents deleted with a change sequence in (since, until] */
+	virtual std::vector<int64_t> GetDeletedAgents(int64_t since, int64_t until) = 0;
+};
+
+/*< reads a board state object sent by the client (board_state, moves) */
+bool ReadStoredBoardState(const OTN::OTNObject& boardState, StoredBoardState& outState);
+/*< replaces the states of stored that are in changed and appends the new ones */
+void MergeBoardStates(std::vector<StoredBoardState>& stored, std::vector<StoredBoardState>&& changed);
\ No newline at end of file
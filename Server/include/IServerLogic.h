@@ -4,6 +4,7 @@
 #include <SDL3_net/SDL_net.h>
 
 class NetServer;
+struct ServerMessage;
 
 class IServerLogic {
 public:
@@ -17,17 +18,25 @@ public:
 
 	void OnClientConnectedExternal(NET_StreamSocket* client);
 	void OnMessageExternal(NET_StreamSocket* client, const std::string& msg);
-	void OnServerMessageExternal(const std::string& serverName, const std::string& msg);
+	void OnServerMessageExternal(ServerMessage& msg);
 	void OnClientDisconnectedExternal(NET_StreamSocket* client);
 
 protected: 
 	std::mutex m_logicMutex;
 	NetServer* m_server = nullptr;
+	/*
+	* if true the callbacks are not serialized behind m_logicMutex,
+	* the logic has to synchronize its shared state itself
+	*/
+	bool m_concurrentCallbacks = false;
+
+	std::unique_lock<std::mutex> LockLogic();
 
 	virtual void OnRun() {};
 
 	virtual void OnClientConnected(NET_StreamSocket* client) {};
 	virtual void OnMessage(NET_StreamSocket* client, const std::string& msg) {};
-	virtual void OnServerMessage(const std::string& serverName, const std::string& msg) {};
+	/*< msg.source is the name of the sending server, the objects can be moved out */
+	virtual void OnServerMessage(ServerMessage& msg) {};
 	virtual void OnClientDisconnected(NET_StreamSocket* client) {};
 };
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+#include <mutex>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <fstream>
+#include <filesystem>
+#include <shared_mutex>
+#include <unordered_map>
+#include <condition_variable>
+
+#include "IAgentStore.h"
+
+/**
+* @brief Embedded agent store, an append-only log file with an in-memory index.
+*
+* Every change is appended as one record (the whole agent or a delete) and the index maps
+* an agent id to its latest record. Writers queue their records for a commit thread that
+* writes everything queued so far with one fsync (group commit), concurrent writes share
+* the cost of the sync. The same thread rewrites the log once most of it are outdated records.
+*
+* Record layout (Little-Endian): [u32 payload size][u32 crc32 of payload][u8 type][payload]
+* A torn record at the end of the log (crash while writing) is cut off on Open,
+* a corrupted record in front of intact ones makes Open fail instead.
+*/
+class LogAgentStore : public IAgentStore {
+public:
+	static constexpr auto COMPACT_CHECK_INTERVAL = std::chrono::seconds(30);
+	static constexpr uint64_t COMPACT_MIN_BYTES = 4 * 1024 * 1024;// < smaller logs are never compacted
+	static constexpr double COMPACT_DEAD_RATIO = 0.5;// < share of outdated records that starts a compaction
+
+	explicit LogAgentStore(std::filesystem::path path);
+	~LogAgentStore() override;
+
+	LogAgentStore(const LogAgentStore&) = delete;
+	LogAgentStore& operator=(const LogAgentStore&) = delete;
+
+	void Open() override;
+	void Close() override;
+
+	std::vector<int64_t> InsertAgents(std::vector<StoredAgent>&& agents) override;
+	std::vector<size_t> UpdateAgents(std::vector<StoredAgent>&& agents) override;
+	std::vector<size_t> UpdateAgentStates(std::vector<StoredAgent>&& agents) override;
+	std::vector<std::pair<int64_t, int64_t>> ApplyTraining(const std::unordered_map<int64_t, AgentTraining>& training) override;
+	void DeleteAgents(const std::vector<int64_t>& ids) override;
+
+	std::vector<int64_t> GetAgentIDs() override;
+	bool ForEachAgent(const AgentFilter& filter, size_t batchSize, const AgentBatchCallback& onBatch) override;
+
+	int64_t GetChangeSequence() override;
+	std::vector<int64_t> GetDeletedAgents(int64_t since, int64_t until) override;
+
+private:
+	enum class RecordType : uint8_t {
+		PUT = 1,// < the whole agent
+		REMOVE = 2,// < agent id and change sequence, kept by compactions as tombstone
+		NEXT_ID = 3// < next id and last change sequence, written first by a compaction
+	};
+
+	static constexpr size_t RECORD_HEADER_SIZE = 9;
+	static constexpr uint32_t MAX_RECORD_PAYLOAD = 256 * 1024 * 1024;// < a larger size field can only be corruption
+
+	struct IndexEntry {
+		uint64_t offset = 0;// < offset of the record header in the log
+		uint32_t size = 0;// < record size including the header
+		int64_t sequence = 0;// < change sequence of the record
+	};
+
+	/*< index change of a queued record, applied once the record is durable */
+	struct PendingEntry {
+		int64_t id = 0;
+		bool removed = false;
+		IndexEntry entry;
+	};
+
+	std::filesystem::path m_path;
+	std::FILE* m_file = nullptr;
+	bool m_open = false;
+
+	// writer side, guarded by m_writeMutex
+	std::mutex m_writeMutex;
+	std::condition_variable m_workCV;// < wakes the commit thread
+	std::condition_variable m_durableCV;// < wakes writers once their records are synced
+	std::string m_pendingData;
+	std::vector<PendingEntry> m_pendingEntries;
+	std::unordered_map<int64_t, int64_t> m_versions;// < latest version of every agent, also of not yet durable writes
+	int64_t m_nextID = 1;
+	int64_t m_lastChange = 0;// < last handed out change sequence
+	uint64_t m_writeOffset = 0;// < log size including the queued records
+	uint64_t m_queuedSequence = 0;
+	uint64_t m_durableSequence = 0;
+	std::string m_commitError;// < set once a commit failed, every later write throws
+	bool m_stop = false;
+
+	// reader side, only durable records, guarded by m_indexMutex
+	std::shared_mutex m_indexMutex;
+	std::unordered_map<int64_t, IndexEntry> m_index;
+	std::unordered_map<int64_t, IndexEntry> m_tombstones;// < REMOVE records of the deleted agents
+	int64_t m_durableChange = 0;
+	uint64_t m_liveBytes = 0;// < bytes of the records the index and the tombstones point to
+	uint64_t m_fileBytes = 0;
+
+	std::thread m_commitThread;
+
+	void CommitLoop();
+	bool WriteAndSync(std::FILE* file, const std::string& data);
+	bool NeedsCompaction() const;
+	/*< rewrites the log with only the live records, m_writeMutex has to be held and nothing queued */
+	void Compact();
+
+	/*< moves an agent between index and tombstones, m_indexMutex has to be held exclusively */
+	void ApplyEntry(const PendingEntry& pending);
+	/*< waits until every queued record is in the index, m_writeMutex has to be held */
+	void WaitForQueued(std::unique_lock<std::mutex>& lock);
+	/*< appends a record to the queue, m_writeMutex has to be held */
+	void QueueRecord(RecordType type, int64_t id, int64_t sequence, const std::string& payload);
+	/*< hands the queued records to the commit thread and waits until they are durable */
+	void CommitQueued(std::unique_lock<std::mutex>& lock);
+	void ThrowIfFailed() const;
+
+	StoredAgent ReadAgent(std::ifstream& log, const IndexEntry& entry) const;
+	static std::string EncodeAgent(const StoredAgent& agent);
+	static StoredAgent DecodeAgent(std::string_view payload);
+};
\ No newline at end of file
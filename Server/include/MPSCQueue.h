@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <optional>
+#include <utility>
+
+/**
+* @brief Unbounded lock-free queue for many producers and a single consumer.
+*
+* Push can be called from any thread, TryPop and IsEmpty only from the consumer thread.
+* Linked list with a stub node (Vyukov), a push is one allocation and one atomic exchange.
+*/
+template<typename T>
+class MPSCQueue {
+public:
+	MPSCQueue() {
+		Node* stub = new Node();
+		m_head.store(stub);
+		m_tail = stub;
+	}
+
+	~MPSCQueue() {
+		Node* node = m_tail;
+		while (node) {
+			Node* next = node->next.load();
+			delete node;
+			node = next;
+		}
+	}
+
+	MPSCQueue(const MPSCQueue&) = delete;
+	MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+	void Push(T&& value) {
+		Node* node = new Node();
+		node->value.emplace(std::move(value));
+
+		// seq_cst, so a consumer that checks IsEmpty before sleeping can not miss the node
+		Node* prev = m_head.exchange(node);
+		prev->next.store(node);
+	}
+
+	bool TryPop(T& outValue) {
+		Node* tail = m_tail;
+		Node* next = tail->next.load();
+		if (!next)
+			return false;
+
+		outValue = std::move(*next->value);
+		next->value.reset();
+		m_tail = next;
+		delete tail;
+		return true;
+	}
+
+	bool IsEmpty() const {
+		return m_tail->next.load() == nullptr;
+	}
+
+private:
+	struct Node {
+		std::atomic<Node*> next = nullptr;
+		std::optional<T> value;
+	};
+
+	std::atomic<Node*> m_head;
+	Node* m_tail = nullptr;// < only touched by the consumer
+};
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <string_view>
+
+#include "OTNFile.h"
+
+/*
+* Wire protocol of the game clients.
+*
+* v1 (text): every request payload is an OTN document with a header object holding the action name.
+* v2 (binary): negotiated per connection with a hello frame, requests carry a numeric opcode in the
+* frame header and the id lists and agent uploads have binary bodies (Little-Endian). A client that
+* never sent a hello, or got an error for it from an older server, keeps using v1.
+* v3 (batch): v2 plus batch frames that carry several v1 or v2 requests, see GameServerLogic::HandleBatch.
+*/
+constexpr uint16_t PROTOCOL_VERSION_TEXT = 1;
+constexpr uint16_t PROTOCOL_VERSION_BINARY = 2;
+constexpr uint16_t PROTOCOL_VERSION_BATCH = 3;
+
+/*< numeric action of a v2 request, the values are part of the protocol and must not change */
+enum class NetOpcode : uint16_t {
+	NONE = 0,
+	SYNC_MISSING_DATA = 1,
+	GET_AGENT_ID_LIST = 2,
+	REQUEST_MISSING_AGENTS = 3,
+	REQUEST_AGENT_CHANGES = 4,
+	SYNC_DELETE_DATA = 5,
+	SYNC_DIRTY_DATA = 6,
+	SYNC_DIRTY_STATES = 7,
+	REPORT_GAMES = 8,
+	SYNC_AGENT_DELTAS = 9,
+	COUNT
+};
+
+/*
+* Layout of the body of a v2 request. Strings are [u32 length][bytes], states are
+* [str board_state][u32 move count] and a move is [f32 eval][u8 from_x][u8 from_y][u8 to_x][u8 to_y].
+*/
+enum class NetBodyFormat : uint8_t {
+	EMPTY,// < no body
+	ID_LIST,// < [u32 count][i64 id]...
+	SEQUENCE,// < [i64 since]
+	AGENTS,// < [u32 count] then per agent [i64 server_id][i64 version][i64 local_id][str name][str config][i32 x4 match counts][u32 state count][states]
+	AGENT_DELTAS,// < [u32 count] then per agent [i64 server_id][i32 x4 match counts][u32 state count][states]
+	OTN// < OTN document with a body object, like v1 without the header
+};
+
+struct NetOpcodeInfo {
+	const char* action;// < action name of the same request in v1
+	NetBodyFormat format;
+	const char* column;// < column of the ids (ID_LIST) or the sequence (SEQUENCE) in the OTN body
+};
+
+namespace NetProtocol {
+
+	/*< info of a known opcode, nullptr for NONE and unknown values */
+	const NetOpcodeInfo* GetOpcodeInfo(NetOpcode opcode);
+	/*< opcode of a v1 action name, NetOpcode::NONE if unknown */
+	NetOpcode FindOpcode(std::string_view action);
+
+	/**
+	* @brief Reads a v2 body into the OTN body object the same request would have in v1.
+	*
+	* The handlers and the sql server only see the OTN body, both protocols share them.
+	* The moves of a board state are one GameMove object with a row per move.
+	* @param outError Set if the body does not match its layout or bytes are left after it
+	*/
+	bool DecodeBody(NetOpcode opcode, std::string_view payload, OTN::OTNObject& outBody, std::string& outError);
+
+	/*< one int64 column as ID_LIST body */
+	std::string EncodeIDList(const OTN::OTNObject& obj, const std::string& column);
+
+}
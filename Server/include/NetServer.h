@@ -1,15 +1,24 @@
 #pragma once
 #include <string>
 #include <atomic>
-#include <queue>
+#include <thread>
+#include <vector>
 
 #include <SDL3/SDL.h>
 #include <SDL3_net/SDL_net.h>
 
 #include "IServerLogic.h"
+#include "ServerMetrics.h"
+#include "NetWorkerPool.h"
+#include "ServerMessage.h"
 
 class NetServerManager;
 
+enum class NetIOMode {
+	THREAD_PER_CLIENT = 0,// < one polling thread per client
+	EVENT_LOOP// < one thread waits on all sockets, messages are handled by a worker pool
+};
+
 class NetServer {
 friend class NetServerManager;
 public:
@@ -20,10 +29,25 @@ public:
 
 	void Run();
 
+	/**
+	* @brief Sets how client sockets are served, has to be called before Run.
+	* Defaults to NetIOMode::EVENT_LOOP.
+	*/
+	void SetIOMode(NetIOMode mode);
+	/**
+	* @brief Sets the worker count of the event loop, 0 uses the hardware concurrency.
+	*/
+	void SetWorkerCount(uint32_t count);
+	/**
+	* @brief Sets how many messages may wait per worker before the event loop stops reading.
+	*/
+	void SetMaxQueuedTasks(size_t count);
+
 	bool IsInitialized() const;
 	bool IsRunning() const;
 	const std::string& GetName() const;
 	uint16_t GetPort() const;
+	NetIOMode GetIOMode() const;
 
 	template<typename T, typename ...Args>
 	void SetLogic(Args&& ...args) {
@@ -38,13 +62,37 @@ private:
 	NET_Server* m_server = nullptr;
 	bool m_isInitialized = false;
 	std::atomic<bool> m_running = false;
-	std::mutex m_serverMsgMutex;
-	std::queue<std::pair<std::string, std::string>> m_serverMsgQueue;
+	ServerMessageQueue m_serverMessages;
+	std::thread m_serverMessageThread;// < delivers the server messages as soon as they arrive
 
 	IServerLogic* m_logic = nullptr;
 
+	static constexpr int EVENT_LOOP_TIMEOUT_MS = 50;// < max wait, OnRun is called at least this often
+	static constexpr size_t MAX_READ_PER_WAKE = 64 * 1024;// < so a single busy client cannot starve the others
+
+	NetIOMode m_ioMode = NetIOMode::EVENT_LOOP;
+	uint32_t m_workerCount = 0;
+	size_t m_maxQueuedTasks = 256;
+	NetWorkerPool m_workerPool;
+	std::vector<NET_StreamSocket*> m_clients;// < only used by the event loop thread
+
+	// resolved once with the server name as label, see ServerMetrics
+	std::atomic<int64_t>& m_connectionsGauge;
+	std::atomic<uint64_t>& m_acceptedCounter;
+	std::atomic<uint64_t>& m_receivedBytesCounter;
+	LatencyHistogram& m_clientQueueWait;// < time a read message waits for its worker
+	LatencyHistogram& m_serverMessageQueueWait;// < time a server message waits in the inbox
+
 	NetServer(const std::string& name);
 
+	void ServerMessageLoop();
+	void RunEventLoop();
+	void RunThreadPerClient();
+	void AcceptClients();
+	void ReadClients();
+	void DisconnectClient(NET_StreamSocket* client);
+	static size_t GetClientKey(const NET_StreamSocket* client);
+
 	void HandleClient(NET_StreamSocket* client) const;
 	NET_StreamSocket* WaitForClient();
 	void FreeServerLogic();
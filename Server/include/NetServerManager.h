@@ -12,8 +12,12 @@ public:
 	static NetServer* CreateServer(const std::string& name);
 	static bool DestroyServer(NetServer* server);
 
-	static void SendMessage(const NetServer* srcServer, const std::string& dstServerName, const std::string& msg);
-	static void SendMessage(const std::string& srcServer, const std::string& dstServerName, const std::string& msg);
+	/**
+	* @brief Hands a message to the inbox of another server, never blocks.
+	*
+	* The objects are moved, the destination receives them in OnServerMessage without any re-encoding.
+	*/
+	static void SendMessage(const NetServer* srcServer, const std::string& dstServerName, ServerMessage&& msg);
 
 	static void StartAll();
 	static void StopAll();
@@ -0,0 +1,78 @@
+#pragma once
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+/**
+* @brief Fixed set of worker threads with bounded task queues.
+*
+* Every task is submitted with a key, tasks with the same key always run on the
+* same worker in submit order. The network loop uses the client socket as key, so
+* the messages of one client are handled in order while different clients are
+* handled in parallel.
+*/
+class NetWorkerPool {
+public:
+	using Task = std::function<void()>;
+
+	NetWorkerPool() = default;
+	~NetWorkerPool();
+
+	NetWorkerPool(const NetWorkerPool&) = delete;
+	NetWorkerPool& operator=(const NetWorkerPool&) = delete;
+
+	/**
+	* @brief Starts the worker threads.
+	* @param workerCount Number of workers, 0 uses the hardware concurrency.
+	* @param maxQueuedTasks Maximum number of queued tasks per worker.
+	*/
+	void Start(uint32_t workerCount, size_t maxQueuedTasks);
+
+	/**
+	* @brief Runs all queued tasks and joins the workers.
+	*/
+	void Stop();
+
+	/**
+	* @brief Queues a task on the worker owning the key.
+	*
+	* Blocks while the queue of that worker is full, this applies backpressure
+	* to the caller instead of buffering without limit. The event loop checks
+	* HasQueueSpace first and must never block here.
+	*
+	* @param key Ordering key (e.g. client socket).
+	* @param task Task to run.
+	* @param bounded False queues the task also on a full queue, e.g. for the one disconnect of a client.
+	* @return False if the pool is not running.
+	*/
+	bool Submit(size_t key, Task&& task, bool bounded = true);
+
+	/**
+	* @brief Checks if the worker owning the key can queue a task without blocking.
+	*
+	* Only reliable for a single submitting thread, other submitters can fill the queue in between.
+	*/
+	bool HasQueueSpace(size_t key);
+
+	bool IsRunning() const;
+	uint32_t GetWorkerCount() const;
+
+private:
+	struct Worker {
+		std::thread thread;
+		std::mutex mutex;
+		std::condition_variable taskCV;
+		std::condition_variable spaceCV;
+		std::deque<Task> tasks;
+		bool stop = false;
+	};
+
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	size_t m_maxQueuedTasks = 0;
+
+	static void WorkerLoop(Worker& worker);
+};
\ No newline at end of file
@@ -0,0 +1,154 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <condition_variable>
+
+namespace sql {
+	class Connection;
+	class PreparedStatement;
+}
+
+enum class AgentStorage {
+	ROWS,// < board_states and game_moves, one row per state and per move
+	BLOB// < agent_blobs, all states of an agent in one AgentBlobCodec blob
+};
+
+enum class StoreBackend {
+	MYSQL,// < SQLServerLogic
+	LOG// < StoreServerLogic on a LogAgentStore, no database server needed
+};
+
+struct DBConfig {
+	std::string host;
+	uint16_t port = 0;
+	std::string user;
+	std::string password;
+	std::string schema;
+	uint32_t poolSize = 4;// < number of connections, also the number of sql worker threads
+	AgentStorage storage = AgentStorage::ROWS;// < layout the board states are written in
+	bool migrateStorage = false;// < moves agents stored in the other layout into storage on startup
+	StoreBackend backend = StoreBackend::MYSQL;
+	std::string dataPath = "agents.log";// < log file of the LOG backend
+};
+
+/**
+* @brief Prepared statements of one connection, keyed by their query text.
+*
+* Only used by the thread that leased the connection, the counters can be read from anywhere.
+*/
+class SQLStatementCache {
+public:
+	static constexpr size_t MAX_STATEMENTS = 128;// < the cache is cleared once it is full
+
+	SQLStatementCache() = default;
+	~SQLStatementCache();
+
+	SQLStatementCache(const SQLStatementCache&) = delete;
+	SQLStatementCache& operator=(const SQLStatementCache&) = delete;
+
+	/**
+	* @brief Returns the cached statement of the query, prepares it on a miss.
+	*
+	* The statement stays owned by the cache, parameters bound by a previous use are overwritten.
+	* @throws sql::SQLException if the statement can not be prepared
+	*/
+	sql::PreparedStatement* Prepare(sql::Connection& conn, const std::string& query);
+	void Clear();
+
+	uint64_t GetHits() const;
+	uint64_t GetMisses() const;
+	size_t GetSize() const;
+
+private:
+	std::unordered_map<std::string, std::unique_ptr<sql::PreparedStatement>> m_statements;
+	std::atomic<uint64_t> m_hits = 0;
+	std::atomic<uint64_t> m_misses = 0;
+};
+
+/*
+* Connection of the pool with its statement cache, the statements are destroyed before the connection.
+*/
+struct SQLPooledConnection {
+	std::unique_ptr<sql::Connection> connection;
+	SQLStatementCache statements;
+};
+
+/**
+* @brief Fixed set of open MySQL connections shared by the sql workers.
+*
+* A connection is handed out as a Lease and returned to the pool when the lease is destroyed.
+*/
+class SQLConnectionPool {
+public:
+	class Lease {
+	public:
+		Lease() = default;
+		~Lease();
+
+		Lease(Lease&& other) noexcept;
+		Lease& operator=(Lease&& other) noexcept;
+		Lease(const Lease&) = delete;
+		Lease& operator=(const Lease&) = delete;
+
+		SQLPooledConnection* Get() const;
+		explicit operator bool() const;
+
+	private:
+		friend class SQLConnectionPool;
+		Lease(SQLConnectionPool* pool, SQLPooledConnection* conn);
+
+		SQLConnectionPool* m_pool = nullptr;
+		SQLPooledConnection* m_conn = nullptr;
+
+		void Release();
+	};
+
+	SQLConnectionPool() = default;
+	~SQLConnectionPool();
+
+	SQLConnectionPool(const SQLConnectionPool&) = delete;
+	SQLConnectionPool& operator=(const SQLConnectionPool&) = delete;
+
+	/**
+	* @brief Opens config.poolSize connections.
+	* @return false if not a single connection could be opened
+	*/
+	bool Open(const DBConfig& config);
+
+	/**
+	* @brief Closes all connections, the workers using the pool have to be stopped first.
+	*/
+	void Close();
+
+	/**
+	* @brief Waits until a connection is free.
+	*
+	* A connection that was closed by the server is reopened before it is handed out,
+	* outside of the lock, so the other callers are not blocked by the reconnect.
+	* @return empty lease if the pool is closed
+	*/
+	Lease Acquire();
+
+	size_t GetSize() const;
+	/**
+	* @brief Sums the statement cache counters of all connections.
+	*/
+	uint64_t GetStatementCacheHits() const;
+	uint64_t GetStatementCacheMisses() const;
+
+private:
+	DBConfig m_config;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_freeCV;
+	std::vector<std::unique_ptr<SQLPooledConnection>> m_connections;
+	std::vector<SQLPooledConnection*> m_free;
+	bool m_open = false;
+
+	/*< called without m_mutex held by Acquire, a connect can block for its whole timeout */
+	static std::unique_ptr<sql::Connection> Connect(const DBConfig& config);
+	void Return(SQLPooledConnection* conn);
+};
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+#include <memory>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "OTNFile.h"
+#include "IServerLogic.h"
+#include "ServerMessage.h"
+#include "ServerMetrics.h"
+#include "SQLConnectionPool.h"
+
+/*
+* Shared base of the db backends (SQLServerLogic, StoreServerLogic, see DBConfig::backend).
+* The replies and streamed results are the same for every backend, so they are built here.
+*/
+class DBServerLogic : public IServerLogic {
+public:
+	DBServerLogic(NetServer* server, const DBConfig& config);
+
+protected:
+	/*
+	* Receiver of a streamed result, the state and move ids only have to be unique within one response.
+	*/
+	struct StreamTarget {
+		std::string dstServer;
+		const char* action = "";
+		uint32_t requestID = 0;
+		std::shared_ptr<ServerStream> stream;
+		int64_t nextStateID = 1;
+		int64_t nextMoveID = 1;
+	};
+
+	DBConfig m_config;
+
+	// resolved once, see ServerMetrics
+	std::atomic<uint64_t>& m_errorCounter;
+	LatencyHistogram& m_workerQueueWait;// < time an action waits for its worker
+	LatencyHistogram& m_encodeTime;// < writing a segment of a streamed result
+
+	/*< sends one segment once the client received the previous ones, false if the stream was cancelled, throws std::runtime_error if the writer fails */
+	bool SendSegment(StreamTarget& target, OTN::OTNWriter& writer, const std::string& what);
+	/*< last segment of a sync, the deleted agents and the change sequence the client continues from */
+	bool SendChangeSequence(StreamTarget& target, int64_t sequence, const std::vector<int64_t>& deletedIDs);
+	void FinishStream(StreamTarget& target, bool complete);
+
+	/*< sends the body as the successful result of the request */
+	void SendReply(const std::string& dstServer, const std::string& action, uint32_t requestID, OTN::OTNObject&& body);
+	OTN::OTNObject CreateRequestHeader(const std::string& action, uint32_t requestID, bool response = true);
+	/*< header of one part of a streamed result, the part with last set carries no rows */
+	OTN::OTNObject CreateStreamHeader(const std::string& action, uint32_t requestID, bool last);
+	void SentError(const std::string& errorMsg, const std::string& dstServer, const std::string& action, uint32_t requestID);
+};
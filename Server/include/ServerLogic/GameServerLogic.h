@@ -1,51 +1,205 @@
 #pragma once
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <shared_mutex>
+#include <unordered_set>
 #include "IServerLogic.h"
+#include "NetProtocol.h"
+#include "FrameDecoder.h"
+#include "ServerMessage.h"
+#include "ServerMetrics.h"
 
-constexpr size_t MAX_PACKET_SIZE = 5000;
+class BinaryDeserializer;
 
+constexpr size_t MAX_PACKET_SIZE = 5000;// < limit of a single frame, larger messages are chunked
+constexpr size_t CHUNK_PAYLOAD_SIZE = 4096;// < payload bytes per chunk frame, fits into MAX_PACKET_SIZE
+constexpr size_t DEFAULT_MAX_MESSAGE_SIZE = 32 * 1024 * 1024;// < limit of a reassembled chunked message
+constexpr size_t MAX_STREAMS_PER_CLIENT = 8;// < chunked messages a client can have in flight
+constexpr size_t COMPRESSION_THRESHOLD = 512;// < smaller payloads are always sent uncompressed
+constexpr size_t STREAM_WINDOW = 4;// < segments of a streamed response buffered between the sql server and the client
+constexpr size_t STREAM_DRAIN_BYTES = 256 * 1024;// < a segment counts as sent once less is pending on the client socket
+constexpr uint32_t MAX_BATCH_REQUESTS = 64;// < requests a single batch frame may carry
+
+// flags byte of every frame, negotiated per message
+constexpr uint8_t PAYLOAD_FLAG_COMPRESSED = 1 << 0;// < payload is a compressed OTN document
+constexpr uint8_t PAYLOAD_FLAG_ACCEPT_COMPRESSED = 1 << 1;// < sender accepts compressed payloads in the response
+constexpr uint8_t PAYLOAD_FLAG_CHUNKED = 1 << 2;// < frame is one chunk of a larger message, see ReadRequest
+constexpr uint8_t PAYLOAD_FLAG_STREAMED = 1 << 3;// < frame is one piece of a streamed response, see SendStreamSegment
+constexpr uint8_t PAYLOAD_FLAG_HELLO = 1 << 4;// < protocol negotiation, payload is the highest version of the client (u16), see HandleHello
+constexpr uint8_t PAYLOAD_FLAG_OPCODE = 1 << 5;// < a u16 opcode follows the flags, the payload is a v2 body (NetProtocol.h)
+constexpr uint8_t PAYLOAD_FLAG_BATCH = 1 << 6;// < payload holds several requests, see HandleBatch
+
+/*
+* Callbacks run concurrently (m_concurrentCallbacks), every client has its own session.
+* Only the session table and the pending SQL table are shared between clients.
+*/
 class GameServerLogic : public IServerLogic {
 public:
 	GameServerLogic(NetServer* server);
 
+	void OnRun() override;
+	void OnClientConnected(NET_StreamSocket* client) override;
 	void OnMessage(NET_StreamSocket* client, const std::string& msg) override;
-	void OnServerMessage(const std::string& serverName, const std::string& msg) override;
+	void OnServerMessage(ServerMessage& msg) override;
+	void OnClientDisconnected(NET_StreamSocket* client) override;
+
+	/**
+	* @brief Sets the largest message a client can send as chunked frames.
+	*
+	* Streams that announce a larger size are rejected before anything is buffered.
+	* @param size Limit in bytes of the (still compressed) payload
+	*/
+	void SetMaxMessageSize(size_t size);
+	size_t GetMaxMessageSize() const;
 
 private:
 	struct Request {
 		uint32_t id = 0;
 		bool response = false;
-		std::string otnPayload;
+		uint8_t flags = 0;
+		NetOpcode opcode = NetOpcode::NONE;// < set for v2 requests, the payload is then a binary body
+		std::string otnPayload;// < owns the payload if it does not live in the received frame
+		std::string_view payload;// < received payload, points into the frame or into otnPayload
+		std::chrono::steady_clock::time_point receivedAt;// < start of the request time metric
 	};
 
-	struct PendingSQLRequest {
+	/*
+	* Reassembly state of one chunked message, the request id is the stream id.
+	*/
+	struct InboundStream {
+		uint8_t flags = 0;
+		uint32_t nextSequence = 0;
+		uint32_t totalSize = 0;
+		std::string data;
+	};
+
+	/*
+	* Streamed response that is forwarded from the sql server, the request id is the stream id.
+	*/
+	struct OutboundStream {
+		std::shared_ptr<ServerStream> flow;
+		uint32_t nextSequence = 0;
+		size_t unreleased = 0;// < segments written while the socket was not yet drained
+	};
+
+	/*
+	* State of one connection. The receive side is only touched by the callbacks of its
+	* client, which are delivered in order, the send side is shared with the SQL responses.
+	*/
+	struct ClientSession {
 		NET_StreamSocket* client = nullptr;
+		FrameDecoder decoder{ MAX_PACKET_SIZE };
+		std::atomic<bool> acceptsCompression = false;
+		uint16_t protocolVersion = PROTOCOL_VERSION_TEXT;// < raised by the hello of the client
+		std::unordered_map<uint32_t, InboundStream> inboundStreams;
+
+		std::mutex pendingMutex;
+		std::unordered_set<int64_t> pendingSQL;// < internal ids of the requests waiting for the sql server
+
+		std::mutex sendMutex;
+		std::deque<std::vector<uint8_t>> outbound;
+		std::unordered_map<uint32_t, OutboundStream> outboundStreams;
+		bool closed = false;
+	};
+	using ClientSessionPtr = std::shared_ptr<ClientSession>;
+
+	struct PendingSQLRequest {
+		std::weak_ptr<ClientSession> session;
 		uint32_t clientRequestID = 0;
+		std::shared_ptr<ServerStream> stream;// < set if the sql server streams the result
+		bool binaryResponse = false;// < the client sent the request as v2
+		LatencyHistogram* requestTime = nullptr;// < of the sql action, recorded once the last part was forwarded
+		std::chrono::steady_clock::time_point receivedAt;
 	};
 
-	std::vector<uint8_t> m_receiveBuffer;
+	using RequestHandler = void (GameServerLogic::*)(const ClientSessionPtr&, const Request&, OTN::OTNObject&&);
+	using SQLResultHandler = void (GameServerLogic::*)(ServerMessage&, const ClientSessionPtr&, const PendingSQLRequest&);
+
+	std::shared_mutex m_sessionMutex;
+	std::unordered_map<NET_StreamSocket*, ClientSessionPtr> m_sessions;
+
+	std::mutex m_pendingMutex;
 	std::unordered_map<int64_t, PendingSQLRequest> m_pendingSQL;
-	int64_t m_nextInternalID = 1;
+	std::atomic<int64_t> m_nextInternalID = 1;
+	std::atomic<size_t> m_maxMessageSize = DEFAULT_MAX_MESSAGE_SIZE;
 
-	int64_t RegisterPendingSQL(NET_StreamSocket* client, uint32_t requestID);
+	// resolved once, see ServerMetrics
+	std::atomic<int64_t>& m_pendingSQLGauge;
+	std::atomic<uint64_t>& m_sentBytesCounter;
+	std::atomic<uint64_t>& m_errorCounter;
+	LatencyHistogram& m_decodeTextTime;// < parsing a v1 request
+	LatencyHistogram& m_decodeBinaryTime;// < decoding a v2 body
+	LatencyHistogram& m_encodeTime;// < writing a response to OTN text
+	LatencyHistogram& m_compressTime;
+
+	ClientSessionPtr GetOrCreateSession(NET_StreamSocket* client);
+
+	int64_t RegisterPendingSQL(const std::string& action, const ClientSessionPtr& session, const Request& req, std::shared_ptr<ServerStream> stream = nullptr);
 	bool RemovePendingSQL(int64_t requstID, PendingSQLRequest& outRequest);
+	/*< like RemovePendingSQL but keeps the request, more parts of a streamed result follow */
+	bool FindPendingSQL(int64_t requstID, PendingSQLRequest& outRequest);
+
+	void HandleSQLServer(ServerMessage& msg);
+	void HandleReceiveSQLSyncMissingData(ServerMessage& msg, const ClientSessionPtr& session, const PendingSQLRequest& pending);
+	void HandleReceiveSQLServerAgentIDList(ServerMessage& msg, const ClientSessionPtr& session, const PendingSQLRequest& pending);
+	void HandleReceiveSQLStreamPart(ServerMessage& msg, const ClientSessionPtr& session, uint32_t requestID, bool last);
+	void HandleReceiveSQLDeleteAgentsResult(ServerMessage& msg, const ClientSessionPtr& session, const PendingSQLRequest& pending);
+	void HandleReceiveSQLUpdateAgentsResult(ServerMessage& msg, const ClientSessionPtr& session, const PendingSQLRequest& pending);
+	void HandleReceiveSQLTrainingResult(ServerMessage& msg, const ClientSessionPtr& session, const PendingSQLRequest& pending);
+
+	/*< answers the hello with the protocol version used from now on, the lower one of client and server */
+	void HandleHello(const ClientSessionPtr& session, const Request& req);
+	/*< reads the body of a v1 or v2 request and dispatches it by its opcode */
+	void HandleRequest(const ClientSessionPtr& session, const Request& req);
+	/**
+	* @brief Dispatches the requests of a batch frame, every one is answered with its own id.
+	*
+	* Payload: [u32 count] then per request [u32 id][u8 flags][u16 opcode if flagged][str payload].
+	* The batch is acknowledged with an empty response once all requests are dispatched,
+	* a batch that can not be read is rejected as a whole before any request runs.
+	*/
+	void HandleBatch(const ClientSessionPtr& session, const Request& req);
+	void HandleSyncMissingData(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& body);
+	void HandleServerAgentIDList(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& body);
+	void HandleGetMissinAgents(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& body);
+	void HandleGetAgentChanges(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& body);
+	void HandleDeleteAgents(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& body);
+	void HandleDirtyAgents(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& body);
+	void HandleDirtyAgentStates(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& body);
+	void HandleReportGames(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& body);
+	void HandleSyncAgentDeltas(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& body);
+
+	OTN::OTNObject CreateSQLRequestHeader(const std::string& action, const ClientSessionPtr& session, const Request& req, std::shared_ptr<ServerStream> stream = nullptr);
+	void SendToSQLServer(OTN::OTNObject&& header, OTN::OTNObject&& body, std::shared_ptr<ServerStream> stream = nullptr);
+	void SendResponse(const ClientSessionPtr& session, uint32_t requestID, OTN::OTNWriter& writer);
+	/*< response with a binary payload, for v2 requests */
+	void SendBinaryResponse(const ClientSessionPtr& session, uint32_t requestID, std::string&& payload);
 
-	void HandleSQLServer(const std::string& msg);
-	void HandleReceiveSQLSyncMissingData(OTN::OTNReader& reader, const PendingSQLRequest& pending);
-	void HandleReceiveSQLServerAgentIDList(OTN::OTNReader& reader, const PendingSQLRequest& pending);
-	void HandleReceiveSQLServerAgentList(OTN::OTNReader& reader, const PendingSQLRequest& pending);
-	void HandleReceiveSQLDeleteAgentsResult(OTN::OTNReader& reader, const PendingSQLRequest& pending);
-	void HandleReceiveSQLUpdateAgentsResult(OTN::OTNReader& reader, const PendingSQLRequest& pending);
-
-	void HandleRequest(NET_StreamSocket* client, const Request& req);
-	void HandleSyncMissingData(NET_StreamSocket* client, uint32_t requestID, const OTN::OTNObject& body);
-	void HandleServerAgentIDList(NET_StreamSocket* client, uint32_t requestID);
-	void HandleGetMissinAgents(NET_StreamSocket* client, uint32_t requestID, const OTN::OTNObject& body);
-	void HandleDeleteAgents(NET_StreamSocket* client, uint32_t requestID, const OTN::OTNObject& body);
-	void HandleDirtyAgents(NET_StreamSocket* client, uint32_t requestID, const OTN::OTNObject& body);
-
-	OTN::OTNObject CreateSQLRequestHeader(const std::string& action, NET_StreamSocket* client, uint32_t requestID);
-
-	std::vector<GameServerLogic::Request> GetRequests(const std::string& msg);
-	bool SentRequest(NET_StreamSocket* client, const Request& request);
-	void SentError(NET_StreamSocket* client, uint32_t requestID, const std::string& errorMsg);
+	/**
+	* @brief Reads one frame handed out by the session's decoder.
+	* @return true if the frame completed a request, outRequest is then set
+	*/
+	bool ReadRequest(ClientSession& session, std::string_view frame, Request& outRequest);
+	/**
+	* @brief Adds one chunk frame to its stream.
+	* @return true once the message is complete or failed, outRequest is then set
+	*/
+	bool AppendChunk(ClientSession& session, uint32_t id, uint8_t flags, BinaryDeserializer& des, Request& outRequest);
+	bool WriteFrame(ClientSession& session, std::vector<uint8_t>&& frame);
+	/**
+	* @brief Sends one segment of a streamed response, last ends the stream and carries no segment.
+	*
+	* A segment is a complete OTN document, compressed on its own and split into frames of
+	* [sequence][segment end][stream end][piece]. The client appends the segments and reads
+	* them with OTNReader::ReadSegmentsString.
+	*/
+	bool SendStreamSegment(const ClientSessionPtr& session, uint32_t requestID, const std::string& segment, bool last);
+	/*< releases the written segments of all streams once the socket drained, sendMutex has to be held */
+	void ReleaseDrainedStreams(ClientSession& session);
+	static void CancelStreams(ClientSession& session);
+	bool SentRequest(const ClientSessionPtr& session, const Request& request);
+	/*< compresses payloads above COMPRESSION_THRESHOLD if the client accepts it and it gets smaller */
+	bool TryCompress(const ClientSession& session, const std::string& payload, std::string& outCompressed);
+	void SentError(const ClientSessionPtr& session, uint32_t requestID, const std::string& errorMsg);
 };
\ No newline at end of file
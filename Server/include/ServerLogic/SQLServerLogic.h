@@ -1,29 +1,29 @@
 #pragma once
+#include <map>
 #include <optional>
 #include <tuple>
+#include <atomic>
 #include <mysql/jdbc.h>
 
 #include "OTNFile.h"
-#include "IServerLogic.h"
-
-namespace sql {
-	class Connection;
-}
-
-struct DBConfig {
-	std::string host;
-	uint16_t port = 0;
-	std::string user;
-	std::string password;
-	std::string schema;
-};
-
-class SQLServerLogic : public IServerLogic {
+#include "NetWorkerPool.h"
+#include "IAgentStore.h"
+#include "GameReportBuffer.h"
+#include "SQLConnectionPool.h"
+#include "ServerLogic/DBServerLogic.h"
+
+/*
+* Actions run on a worker pool with one connection per worker (DBConfig::poolSize).
+* Reads go to any worker, writes are ordered per agent, see OnServerMessage.
+*/
+class SQLServerLogic : public DBServerLogic {
 public:
 	SQLServerLogic(NetServer* server, const DBConfig& config);
+	~SQLServerLogic();
 
 	void OnMessage(NET_StreamSocket* client, const std::string& msg) override;
-    void OnServerMessage(const std::string& serverName, const std::string& msg) override;
+    void OnRun() override;
+    void OnServerMessage(ServerMessage& msg) override;
 
 private:
     struct TransactionGuard {
@@ -47,29 +47,178 @@ private:
         }
     };
 
-	bool m_connected = false;
-	DBConfig m_config;
-	std::unique_ptr<sql::Connection> m_connection;
+    static constexpr size_t MAX_ROWS_PER_STATEMENT = 1000;// < rows of one multi-row insert, ids of one IN list
+    static constexpr size_t STREAM_BATCH_ROWS = 512;// < rows of one segment of a streamed result
+    static constexpr size_t BLOB_BATCH_ROWS = 32;// < agent blobs per statement and per streamed segment
 
-    void HandleInsertAgents(const std::string& dstServer, uint32_t requestID, OTN::OTNReader& reader);
-    void HandleGetAgentIDs(const std::string& dstServer, uint32_t requestID, OTN::OTNReader& reader);
-    void HandleGetMissinAgents(const std::string& dstServer, uint32_t requestID, OTN::OTNReader& reader);
-    void HandleDeleteAgents(const std::string& dstServer, uint32_t requestID, OTN::OTNReader& reader);
-    void HandleUpdateAgents(const std::string& dstServer, uint32_t requestID, OTN::OTNReader& reader);
+    /*
+    * Board state of an incoming agent, points into the request body.
+    */
+    struct BoardStateRow {
+        int64_t agentID = 0;
+        const OTN::OTNObject* boardState = nullptr;
+    };
 
-    OTN::OTNObject CreateRequestHeader(const std::string& action, uint32_t requestID, bool response = true);
-    void SentError(const std::string& errorMsg, const std::string dstServer, const std::string& action, uint32_t requestID);
+    using SQLAction = void (SQLServerLogic::*)(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+
+	bool m_connected = false;
+	SQLConnectionPool m_connections;
+	NetWorkerPool m_workers;
+	std::atomic<size_t> m_nextReadKey = 0;
+	GameReportBuffer m_reports;
+
+    void HandleInsertAgents(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+    void HandleGetAgentIDs(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+    void HandleGetMissinAgents(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+    /*< streams the agents changed and deleted after body.since, ends with the current change sequence */
+    void HandleGetAgentChanges(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+    void HandleDeleteAgents(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+    void HandleUpdateAgents(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+    /*< like HandleUpdateAgents, but the agents only carry the board states changed since their last sync */
+    void HandleUpdateAgentStates(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+    /*< shared by both updates, statesOnly upserts the sent board states instead of replacing all of them */
+    void UpdateAgents(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& msg, bool statesOnly);
+    /*< buffers the reported games, runs on the calling thread, the training is written by FlushTraining */
+    void HandleReportGames(const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+    /*< hands the buffered training to the workers, ordered like an update of the trained agents */
+    void FlushTraining();
+    /*< adds the training deltas of the clients right away, the reply has the versions that contain them */
+    void HandleSyncAgentDeltas(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+    /*< adds the training to the agents in one transaction, each trained agent gets the next version */
+    std::vector<std::pair<int64_t, int64_t>> ApplyTraining(SQLPooledConnection* conn, const std::unordered_map<int64_t, AgentTraining>& training);
+
+    /**
+    * @brief Runs the action on a worker with its own connection.
+    *
+    * Without agent ids the action goes to any worker. Otherwise it runs on the worker that owns
+    * the agents (id % worker count), an action touching agents of several workers waits until
+    * all of them reached it, so it stays ordered with every other write to those agents.
+    */
+    void SubmitAction(SQLAction action, std::shared_ptr<ServerMessage> msg, uint32_t requestID, const char* resultAction, LatencyHistogram& dbTime, const std::vector<int64_t>& agentIDs);
+    /*< queues the task like SubmitAction, on the workers owning the agents or on any worker without agent ids */
+    void SubmitOrdered(NetWorkerPool::Task&& run, const std::vector<int64_t>& agentIDs);
+    static std::vector<int64_t> CollectAgentIDs(const ServerMessage& msg, const std::string& column);
 
 	void Connect();
 
-    std::optional<int64_t> SQLServerLogic::FetchLastInsertID();
+    /**
+    * @brief Hands out the next change sequence for agents.change_seq and agent_tombstones.
+    *
+    * The change_sequence row stays locked until the transaction ends. The sequences are
+    * therefore committed in order and a reader that sees sequence n also sees every change
+    * up to n. The lock serializes the writers, so it is taken as the last step right before
+    * the commit, after all other statements of the change ran.
+    */
+    int64_t NextChangeSequence(SQLPooledConnection* conn);
+    /*< takes the next change sequence and writes it to the agents, the last step before the commit */
+    void StampChangeSequence(SQLPooledConnection* conn, std::vector<int64_t> agentIDs);
+    /*< last committed change sequence */
+    int64_t FetchChangeSequence(SQLPooledConnection* conn);
+
+    /**
+    * @brief Streams the agents matching agentFilter with their board states.
+    *
+    * agentFilter is a condition on the agents table (alias a), args are bound to its placeholders.
+    * Sends the tables agents, board_states and game_moves in segments of their own, in the blob
+    * layout the board states are expanded into the same tables.
+    * @return false if the client stopped reading
+    */
+    template<typename... Args>
+    bool StreamAgentTables(SQLPooledConnection* conn, StreamTarget& target, const std::string& agentFilter, const Args&... args) {
+        auto sendTable = [&](const std::string& table) {
+            return [&, table](OTN::OTNObject&& batch) {
+                return SendTableBatch(target, table, std::move(batch));
+            };
+        };
+
+        if (!StreamStatement(conn, "SELECT a.* FROM agents a WHERE " + agentFilter + ";",
+                STREAM_BATCH_ROWS, sendTable("agents"), args...))
+            return false;
+
+        if (m_config.storage == AgentStorage::BLOB) {
+            return StreamStatement(conn,
+                "SELECT b.agent_id, b.board_states FROM agent_blobs b JOIN agents a ON a.id = b.agent_id WHERE " + agentFilter + ";",
+                BLOB_BATCH_ROWS, [&](OTN::OTNObject&& batch) { return SendBlobBatch(target, std::move(batch)); }, args...);
+        }
+
+        // the moves are joined instead of collecting the board state ids of the previous result first
+        return
+            StreamStatement(conn,
+                "SELECT bs.* FROM board_states bs JOIN agents a ON a.id = bs.agent_id WHERE " + agentFilter + ";",
+                STREAM_BATCH_ROWS, sendTable("board_states"), args...) &&
+            StreamStatement(conn,
+                "SELECT gm.* FROM game_moves gm JOIN board_states bs ON bs.id = gm.board_state_id "
+                "JOIN agents a ON a.id = bs.agent_id WHERE " + agentFilter + ";",
+                STREAM_BATCH_ROWS, sendTable("game_moves"), args...);
+    }
+
+    bool SendTableBatch(StreamTarget& target, const std::string& table, OTN::OTNObject&& batch);
+    /*< expands agent_blobs rows into board_states and game_moves */
+    bool SendBlobBatch(StreamTarget& target, OTN::OTNObject&& batch);
+
+    std::optional<int64_t> FetchLastInsertID(SQLPooledConnection* conn);
+
+    /**
+    * @brief Inserts board states and all their moves in the configured layout (DBConfig::storage).
+    */
+    void InsertBoardStates(SQLPooledConnection* conn, const std::vector<BoardStateRow>& states);
+    /**
+    * @brief Writes the board states in the given layout, rows uses a few multi-row statements,
+    * blob writes one agent_blobs row per agent. The states of an agent have to be consecutive.
+    */
+    void WriteBoardStates(SQLPooledConnection* conn, const std::vector<std::pair<int64_t, StoredBoardState>>& states, AgentStorage layout);
+    /**
+    * @brief Writes changed board states over the stored ones, states not sent are kept.
+    *
+    * Rows upserts the states by (agent_id, board_state) and their moves by (board_state_id, move),
+    * blob reads the blobs of the agents, merges the states and writes them back.
+    */
+    void WriteBoardStateDelta(SQLPooledConnection* conn, std::vector<std::pair<int64_t, StoredBoardState>>&& states);
+    /**
+    * @brief Upserts board states of the rows layout, existing states keep their id.
+    * @param moveUpdate assignment for moves that already exist, the sent move is available as new
+    */
+    void UpsertBoardStateRows(SQLPooledConnection* conn, const std::vector<std::pair<int64_t, StoredBoardState>>& states, const std::string& moveUpdate);
+    /**
+    * @brief Reads the ids of stored board states by their natural key (agent_id, board_state).
+    *
+    * One select per MAX_ROWS_PER_STATEMENT states, the two IN lists can match a few states more.
+    */
+    std::map<std::pair<int64_t, std::string>, int64_t> FetchBoardStateIDs(SQLPooledConnection* conn, const std::vector<std::pair<int64_t, StoredBoardState>>& states);
+    std::vector<std::pair<int64_t, StoredBoardState>> LoadBoardStates(SQLPooledConnection* conn, std::vector<int64_t> agentIDs, AgentStorage layout);
+    void DeleteBoardStates(SQLPooledConnection* conn, const std::vector<int64_t>& agentIDs, AgentStorage layout);
+    /**
+    * @brief Moves all agents that are stored in the other layout into DBConfig::storage.
+    *
+    * Runs in chunks of BLOB_BATCH_ROWS agents with one transaction each, an interrupted
+    * migration continues on the next start.
+    */
+    void MigrateStorage(SQLPooledConnection* conn);
+    static std::string BuildPlaceholders(size_t count);
+    /**
+    * @brief Pads an IN list to the next bucket size (8, 16, 32, ...) by repeating its last value.
+    *
+    * IN lists of similar length then share one statement text and hit the statement cache.
+    * @return the padded size, 0 for an empty list
+    */
+    template<typename T>
+    static size_t PadToBucket(std::vector<T>& values) {
+        if (values.empty())
+            return 0;
+
+        size_t bucket = 8;
+        while (bucket < values.size())
+            bucket *= 2;
+
+        values.resize(bucket, T(values.back()));
+        return bucket;
+    }
 
     /**
     * @brief Executes a parameterized SQL query and fetches results as an OTNObject.
     *
     * This function prepares a statement, binds the provided parameters, executes
-    * the query, and constructs an OTNObject containing the resulting column names.
-    * Note: Rows are not yet added; only the column structure is initialized.
+    * the query, and constructs an OTNObject containing the resulting columns and rows.
     *
     * @tparam Args Variadic template parameter types for binding.
     * @param query The SQL query string containing '?' placeholders for parameters.
@@ -77,20 +226,49 @@ private:
     * @return std::optional<OTN::OTNObject> (OTNObject name Result) containing column names if successful, std::nullopt on error.
     */
     template<typename... Args>
-    std::optional<OTN::OTNObject> FetchStatement(const std::string& query, Args&&... args) {
+    std::optional<OTN::OTNObject> FetchStatement(SQLPooledConnection* conn, const std::string& query, Args&&... args) {
+        try {
+            std::optional<OTN::OTNObject> result;
+            StreamStatement(conn, query, 0, [&](OTN::OTNObject&& batch) {
+                result = std::move(batch);
+                return true;
+            }, std::forward<Args>(args)...);
+            return result;
+        }
+        catch (sql::SQLException&) {
+            return std::nullopt;
+        }
+    }
+
+    /**
+    * @brief Executes a parameterized SQL query and hands its rows out in batches.
+    *
+    * With batchRows set the rows are read through a forward-only cursor and converted batch
+    * by batch, a large result is never held as a whole. onBatch gets an OTNObject (name Result)
+    * with up to batchRows rows and returns false to stop reading. The last batch is always
+    * handed out, also if it is empty, so the receiver always gets the columns.
+    * No other statement may run on the connection inside onBatch.
+    *
+    * @param batchRows Rows per batch, 0 reads the whole result into one batch.
+    * @return false if onBatch stopped the read, throws sql::SQLException on a query error
+    */
+    template<typename OnBatch, typename... Args>
+    bool StreamStatement(SQLPooledConnection* conn, const std::string& query, size_t batchRows, OnBatch&& onBatch, Args&&... args) {
         try {
-            std::unique_ptr<sql::PreparedStatement> stmt(m_connection->prepareStatement(query));
+            sql::PreparedStatement* stmt = conn->statements.Prepare(*conn->connection, query);
+            if (batchRows > 0)
+                stmt->setResultSetType(sql::ResultSet::TYPE_FORWARD_ONLY);
 
-            int index = 1;
-            (void)std::initializer_list<int>{(index = BindParam(stmt.get(), index, args), 0)...};
+            if constexpr (sizeof...(Args) > 0) {
+                int index = 1;
+                (void)std::initializer_list<int>{(index = BindParam(stmt, index, args), 0)...};
+            }
 
             std::unique_ptr<sql::ResultSet> res(stmt->executeQuery());
             sql::ResultSetMetaData* metaData = res->getMetaData();
 
-            if (!metaData) {
-                std::cerr << "Query error: metadata is nullptr for query: " << query << "\n";
-                return std::nullopt;
-            }
+            if (!metaData)
+                throw sql::SQLException("metadata is nullptr for query: " + query);
 
             uint32_t columnCount = metaData->getColumnCount();
 
@@ -107,53 +285,39 @@ private:
                 columnTypes.push_back(metaData->getColumnType(i));
             }
 
-            OTN::OTNObject obj("Result");
-            obj.SetNamesList(columnNames);
-            obj.SetTypesList(GetTypesFromColumns(columnTypes));
-
+            std::vector<std::string> typeNames = GetTypesFromColumns(columnTypes);
+            auto createBatch = [&]() {
+                OTN::OTNObject obj("Result");
+                obj.SetNamesList(columnNames);
+                obj.SetTypesList(typeNames);
+                if (batchRows > 0)
+                    obj.ReserveDataRows(batchRows);
+                return obj;
+            };
+
+            OTN::OTNObject batch = createBatch();
             while (res->next()) {
-                OTN::OTNRow rowValues;
-                rowValues.reserve(columnCount);
-
-                for (uint32_t i = 0; i < columnCount; ++i) {
-                    switch (columnTypes[i]) {
-                    case sql::DataType::INTEGER:
-                        rowValues.emplace_back(static_cast<int>(res->getInt(i + 1)));
-                        break;
-                    case sql::DataType::BIGINT:
-                        rowValues.emplace_back(static_cast<int64_t>(res->getInt64(i + 1)));
-                        break;
-                    case sql::DataType::DOUBLE:
-                        rowValues.emplace_back(static_cast<double>(res->getDouble(i + 1)));
-                        break;
-                    case sql::DataType::DECIMAL:
-                    case sql::DataType::REAL:
-                        rowValues.emplace_back(static_cast<float>(res->getDouble(i + 1)));
-                        break;
-                    case sql::DataType::BIT:
-                        rowValues.emplace_back(res->getBoolean(i + 1));
-                        break;
-                    case sql::DataType::CHAR:
-                    case sql::DataType::LONGVARCHAR:
-                    case sql::DataType::VARCHAR:
-                        rowValues.emplace_back(static_cast<std::string>(res->getString(i + 1)));
-                        break;
-                    default:
-                        std::cerr << "SQL Invalid data type '" << columnTypes[i] << "'\n";
-                        break;
-                    }
-                }
+                batch.AddDataRowList(ReadResultRow(*res, columnTypes));
 
-                obj.AddDataRowList(rowValues);
+                if (batchRows > 0 && batch.GetRowCount() >= batchRows) {
+                    if (!onBatch(std::move(batch)))
+                        return false;
+                    batch = createBatch();
+                }
             }
 
-            return obj;
+            return onBatch(std::move(batch));
         }
         catch (sql::SQLException& e) {
             std::cerr << "Query error: " << e.what() << "\n";
-            return std::nullopt;
+            throw;
         }
     }
+
+    /**
+    * @brief Converts the current row of a result set, columnTypes are the sql::DataType of the columns.
+    */
+    static OTN::OTNRow ReadResultRow(sql::ResultSet& res, const std::vector<int>& columnTypes);
     
     /**
     * @brief Executes a raw SQL query without parameters.
@@ -164,7 +328,7 @@ private:
     * @param query The SQL query string to execute.
     * @return true if the query executed successfully, false otherwise.
     */
-	void ExecuteStatement(const std::string& query);
+	void ExecuteStatement(SQLPooledConnection* conn, const std::string& query);
 
     /**
     * @brief Executes a parameterized SQL query using a prepared statement.
@@ -193,14 +357,12 @@ private:
     * @return true if the query executed successfully, false otherwise.
     */
     template<typename... Args>
-    void ExecuteStatement(const std::string& query, Args&&... args) {
+    void ExecuteStatement(SQLPooledConnection* conn, const std::string& query, Args&&... args) {
         try {
-            std::unique_ptr<sql::PreparedStatement> stmt(
-                m_connection->prepareStatement(query)
-            );
+            sql::PreparedStatement* stmt = conn->statements.Prepare(*conn->connection, query);
 
             int index = 1;
-            (void)std::initializer_list<int>{(index = BindParam(stmt.get(), index, args), 0)...};
+            (void)std::initializer_list<int>{(index = BindParam(stmt, index, args), 0)...};
 
             stmt->execute();
         }
@@ -210,61 +372,112 @@ private:
         }
     }
 
+    /**
+    * @brief Inserts the rows with multi-row statements of up to MAX_ROWS_PER_STATEMENT rows.
+    *
+    * The rows are split into full chunks and the rest into power of two chunks (512, 256, ... 1),
+    * so the few statement shapes repeat between calls and all of them stay in the statement cache.
+    * @param suffix appended after the values, e.g. "AS new ON DUPLICATE KEY UPDATE ..."
+    */
     template<typename... Args>
     void ExecuteBatchInsert(
+        SQLPooledConnection* conn,
         const std::string& tableName, 
         const std::vector<std::tuple<Args...>>& rows,
-        const std::string& columns)
+        const std::string& columns,
+        const std::string& suffix = "")
     {
         if (rows.empty())
             throw sql::SQLException("Failed to ExecuteBatchInsert, the given rows where empty!");
 
-        if (rows.size() > 1000) {
-            size_t half = rows.size() / 2;
-            std::vector<std::tuple<Args...>> row1(rows.begin(), rows.begin() + half);
-            std::vector<std::tuple<Args...>> row2(rows.begin() + half, rows.end());
-
-            ExecuteBatchInsert(tableName, row1, columns);
-            ExecuteBatchInsert(tableName, row2, columns);
-            return;
-        }
-
-        std::string query = "INSERT INTO " + tableName + " (" + columns + ") VALUES ";
         size_t numCols = std::tuple_size<std::tuple<Args...>>::value;
+        std::string values = "(";
+        for (size_t j = 0; j < numCols; ++j)
+            values += (j + 1 < numCols) ? "?, " : "?";
+        values += ")";
+
+        for (size_t start = 0; start < rows.size();) {
+            size_t count = std::min(MAX_ROWS_PER_STATEMENT, rows.size() - start);
+            if (count < MAX_ROWS_PER_STATEMENT) {
+                size_t chunk = 1;
+                while (chunk * 2 <= count)
+                    chunk *= 2;
+                count = chunk;
+            }
 
-        for (size_t i = 0; i < rows.size(); ++i) {
-            query += "(";
-            for (size_t j = 0; j < numCols; ++j) {
-                query += "?";
-                if (j + 1 < numCols) 
+            std::string query = "INSERT INTO " + tableName + " (" + columns + ") VALUES ";
+            for (size_t i = 0; i < count; ++i) {
+                query += values;
+                if (i + 1 < count)
                     query += ", ";
             }
-            query += ")";
-            if (i + 1 < rows.size()) 
-                query += ", ";
-        }
 
-        try {
-            std::unique_ptr<sql::PreparedStatement> stmt(
-                m_connection->prepareStatement(query)
-            );
+            if (!suffix.empty())
+                query += " " + suffix;
 
-            int index = 1;
-            for (const auto& row : rows) {
-                std::apply([&](auto&&... args) {
-                    (void)std::initializer_list<int>{(index = BindParam(stmt.get(), index, args), 0)...};
-                }, row);
+            try {
+                sql::PreparedStatement* stmt = conn->statements.Prepare(*conn->connection, query);
+
+                int index = 1;
+                for (size_t i = start; i < start + count; ++i) {
+                    std::apply([&](auto&&... args) {
+                        (void)std::initializer_list<int>{(index = BindParam(stmt, index, args), 0)...};
+                    }, rows[i]);
+                }
+
+                stmt->execute();
+            }
+            catch (sql::SQLException& e) {
+                std::cerr << "BatchInsert error: " << e.what() << "\n";
+                throw;
             }
 
-            stmt->execute();
+            start += count;
         }
-        catch (sql::SQLException& e) {
-            std::cerr << "BatchInsert error: " << e.what() << "\n";
-            throw;
+    }
+
+    /**
+    * @brief Inserts rows into a table with an auto increment id and returns the ids in row order.
+    *
+    * Every row is its own insert inside the transaction of the caller, followed by LAST_INSERT_ID.
+    * A multi-row insert does not get a consecutive id range under innodb_autoinc_lock_mode 2
+    * (the MySQL 8 default) while other connections insert, so its ids can not be derived.
+    * The single-row statement text is the same for every call and stays in the statement cache.
+    * Only for tables without a natural key (agents), board states are read back by FetchBoardStateIDs.
+    *
+    * @return ids of the inserted rows, throws sql::SQLException on failure
+    */
+    template<typename... Args>
+    std::vector<int64_t> InsertRowsReturningIDs(
+        SQLPooledConnection* conn,
+        const std::string& tableName,
+        const std::vector<std::tuple<Args...>>& rows,
+        const std::string& columns)
+    {
+        std::vector<int64_t> ids;
+        ids.reserve(rows.size());
+
+        std::string query = "INSERT INTO " + tableName + " (" + columns + ") VALUES (";
+        size_t numCols = std::tuple_size<std::tuple<Args...>>::value;
+        for (size_t j = 0; j < numCols; ++j)
+            query += (j + 1 < numCols) ? "?, " : "?";
+        query += ")";
+
+        for (const auto& row : rows) {
+            std::apply([&](const auto&... args) {
+                ExecuteStatement(conn, query, args...);
+            }, row);
+
+            std::optional<int64_t> id = FetchLastInsertID(conn);
+            if (!id || *id <= 0)
+                throw sql::SQLException("InsertRowsReturningIDs: Failed to fetch the inserted id of '" + tableName + "'");
+            ids.push_back(*id);
         }
+
+        return ids;
     }
 
-    std::vector<std::string> GetTypesFromColumns(const std::vector<int>& types) {
+    static std::vector<std::string> GetTypesFromColumns(const std::vector<int>& types) {
         std::vector<std::string> result;
         result.reserve(types.size());
 
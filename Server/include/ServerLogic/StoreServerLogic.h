@@ -0,0 +1,59 @@
+#pragma once
+#include <memory>
+#include <atomic>
+
+#include "OTNFile.h"
+#include "IAgentStore.h"
+#include "GameReportBuffer.h"
+#include "NetWorkerPool.h"
+#include "ServerLogic/DBServerLogic.h"
+
+/*
+* Handles the actions of SQLServerLogic on an IAgentStore instead of MySQL (DBConfig::backend).
+* The replies are the same, the game server does not know which backend runs.
+* The store orders the writes itself, so every action can run on any worker.
+*/
+class StoreServerLogic : public DBServerLogic {
+public:
+	StoreServerLogic(NetServer* server, const DBConfig& config);
+	~StoreServerLogic();
+
+	void OnRun() override;
+	void OnServerMessage(ServerMessage& msg) override;
+
+private:
+	static constexpr size_t STREAM_BATCH_AGENTS = 64;// < agents of one segment of a streamed result
+
+	using StoreAction = void (StoreServerLogic::*)(const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+
+	bool m_opened = false;
+	std::unique_ptr<IAgentStore> m_store;
+	NetWorkerPool m_workers;
+	std::atomic<size_t> m_nextKey = 0;
+	GameReportBuffer m_reports;
+
+	void HandleInsertAgents(const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+	void HandleGetAgentIDs(const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+	void HandleGetMissinAgents(const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+	void HandleGetAgentChanges(const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+	void HandleDeleteAgents(const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+	void HandleUpdateAgents(const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+	void HandleUpdateAgentStates(const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+	/*< shared by both updates, statesOnly merges the sent board states into the stored ones */
+	void UpdateAgents(const std::string& dstServer, uint32_t requestID, ServerMessage& msg, bool statesOnly);
+
+	/*< buffers the reported games, they are trained into the agents by FlushTraining */
+	void HandleReportGames(const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+	void FlushTraining();
+	/*< adds the training deltas of the clients right away, the reply has the versions that contain them */
+	void HandleSyncAgentDeltas(const std::string& dstServer, uint32_t requestID, ServerMessage& msg);
+
+	void Open();
+	void SubmitAction(StoreAction action, std::shared_ptr<ServerMessage> msg, uint32_t requestID, const char* resultAction, LatencyHistogram& dbTime);
+
+	/*< streams the agents accepted by the filter in batches of STREAM_BATCH_AGENTS, false if the stream was cancelled */
+	bool StreamAgents(StreamTarget& target, const IAgentStore::AgentFilter& filter);
+
+	/*< reads the agent columns and board states of one row of a request body */
+	static StoredAgent ReadAgent(const OTN::OTNObject& body, size_t row);
+};
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <condition_variable>
+
+#include "OTNFile.h"
+#include "MPSCQueue.h"
+
+/**
+* @brief Flow control of a result that is streamed from one server through another to a client.
+*
+* The producer reserves a slot before it sends a segment, the forwarding server releases
+* it once the segment left the client socket. At most window segments are buffered on the way.
+*/
+class ServerStream {
+public:
+	static constexpr std::chrono::seconds STALL_TIMEOUT{ 30 };// < a producer waiting longer cancels the stream
+
+	explicit ServerStream(size_t window);
+
+	/**
+	* @brief Waits until less than window segments are unreleased.
+	* @return false if the stream was cancelled or stalled, the producer has to stop
+	*/
+	bool Reserve();
+	void Release(size_t count = 1);
+	/*< receiver is gone, wakes a waiting producer */
+	void Cancel();
+	bool IsCancelled() const;
+
+private:
+	mutable std::mutex m_mutex;
+	std::condition_variable m_cv;
+	size_t m_window = 1;
+	size_t m_inFlight = 0;
+	bool m_cancelled = false;
+};
+
+/**
+* @brief Message between two servers of the same process.
+*
+* Carries the already parsed OTN objects, nothing is written to text on the way.
+* Move-only, the objects are handed over to the receiving server.
+*/
+struct ServerMessage {
+	std::string source;// < name of the sending server, set by NetServerManager::SendMessage
+	std::vector<OTN::OTNObject> objects;
+	std::string payload;// < already written OTN text that is forwarded as is, e.g. one segment of a streamed result
+	std::shared_ptr<ServerStream> stream;// < set if the message belongs to a streamed result
+	std::chrono::steady_clock::time_point sentAt;// < set by NetServerManager::SendMessage, for the queue wait metric
+
+	ServerMessage() = default;
+	ServerMessage(ServerMessage&&) noexcept = default;
+	ServerMessage& operator=(ServerMessage&&) noexcept = default;
+	ServerMessage(const ServerMessage&) = delete;
+	ServerMessage& operator=(const ServerMessage&) = delete;
+
+	void AddObject(OTN::OTNObject&& obj);
+	void AddObject(const OTN::OTNObject& obj);
+
+	/**
+	* @brief Gets an object by name.
+	* @return nullptr if the message has no object with that name
+	*/
+	OTN::OTNObject* TryGetObject(const std::string& objName);
+	const OTN::OTNObject* TryGetObject(const std::string& objName) const;
+};
+
+/**
+* @brief Inbox of one server, producers never block.
+*
+* The consumer thread sleeps on a condition variable while the queue is empty,
+* producers only take the mutex if the consumer is actually sleeping.
+*/
+class ServerMessageQueue {
+public:
+	void Push(ServerMessage&& msg);
+
+	/**
+	* @brief Waits until a message is available or the queue is closed.
+	* @return false if the queue was closed and is empty
+	*/
+	bool WaitPop(ServerMessage& outMsg);
+
+	void Open();
+	void Close();
+
+private:
+	MPSCQueue<ServerMessage> m_queue;
+	std::mutex m_waitMutex;
+	std::condition_variable m_waitCV;
+	std::atomic<bool> m_sleeping = false;
+	std::atomic<bool> m_closed = true;
+
+	void Wake();
+};
\ No newline at end of file
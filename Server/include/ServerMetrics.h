@@ -0,0 +1,135 @@
+#pragma once
+#include <map>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <filesystem>
+#include <shared_mutex>
+#include <condition_variable>
+
+/**
+* @brief Latency histogram with log-linear buckets like HdrHistogram.
+*
+* Every power of two of microseconds is split into SUB_BUCKETS buckets, a recorded value
+* is off by at most 1/SUB_BUCKETS. Recording is one atomic increment, no lock.
+*/
+class LatencyHistogram {
+public:
+	static constexpr uint32_t SUB_BUCKET_BITS = 3;
+	static constexpr uint32_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+	static constexpr uint32_t MAX_EXPONENT = 36;// < 2^36 us (19 hours), larger values land in the last bucket
+	static constexpr size_t BUCKET_COUNT = SUB_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+	void Record(std::chrono::nanoseconds duration);
+
+	uint64_t GetCount() const;
+	double GetSumSeconds() const;
+	/*< count of the values below 2^exponent us */
+	uint64_t CountBelowPowerOfTwo(uint32_t exponent) const;
+	/*< highest value in seconds of the bucket holding the quantile (0..1), 0 if empty */
+	double GetQuantileSeconds(double quantile) const;
+
+	static size_t GetBucketIndex(uint64_t micros);
+	/*< exclusive upper bound of the bucket in us */
+	static uint64_t GetBucketUpperBound(size_t index);
+
+private:
+	std::array<std::atomic<uint64_t>, BUCKET_COUNT> m_buckets{};
+	std::atomic<uint64_t> m_count = 0;
+	std::atomic<uint64_t> m_sumNanos = 0;
+};
+
+struct MetricsConfig {
+	std::string dumpPath = "metrics.prom";
+	std::chrono::seconds dumpInterval{ 0 };// < 0 disables the dump file
+};
+
+/**
+* @brief Process wide counters, gauges and latency histograms of all servers.
+*
+* A metric is identified by its name and a label set like {action="InsertAgents"}.
+* The returned references stay valid for the life of the process, hot paths can keep them.
+* The metrics are written in the Prometheus text format to a dump file that is replaced
+* atomically, so a scraper (e.g. the node exporter textfile collector) never reads half a file.
+*/
+class ServerMetrics {
+public:
+	using Labels = std::string;// < already formatted label pairs without braces, e.g. server="game_server"
+
+	ServerMetrics() = delete;
+	ServerMetrics(const ServerMetrics&) = delete;
+	void operator=(const ServerMetrics&) = delete;
+
+	static std::atomic<uint64_t>& GetCounter(const std::string& name, const Labels& labels = {});
+	static std::atomic<int64_t>& GetGauge(const std::string& name, const Labels& labels = {});
+	static LatencyHistogram& GetHistogram(const std::string& name, const Labels& labels = {});
+
+	static void AddCounter(const std::string& name, const Labels& labels, uint64_t value = 1);
+	static void SetGauge(const std::string& name, const Labels& labels, int64_t value);
+	static void AddGauge(const std::string& name, const Labels& labels, int64_t delta);
+	static void RecordLatency(const std::string& name, const Labels& labels, std::chrono::nanoseconds duration);
+
+	/*< all metrics in the Prometheus text format */
+	static std::string WriteText();
+	/*< writes WriteText to a temporary file and renames it over path */
+	static bool WriteFile(const std::filesystem::path& path);
+
+	/**
+	* @brief Starts a thread that writes the dump file every interval.
+	* Does nothing if the interval of the config is 0.
+	*/
+	static void StartDump(const MetricsConfig& config);
+	static void StopDump();
+
+	/*< label pair with the value escaped, join several with a comma */
+	static std::string Label(const std::string& key, const std::string& value);
+
+private:
+	enum class MetricType : uint8_t {
+		COUNTER,
+		GAUGE,
+		HISTOGRAM
+	};
+
+	struct Family {
+		MetricType type = MetricType::COUNTER;
+		std::map<Labels, std::unique_ptr<std::atomic<uint64_t>>> counters;
+		std::map<Labels, std::unique_ptr<std::atomic<int64_t>>> gauges;
+		std::map<Labels, std::unique_ptr<LatencyHistogram>> histograms;
+	};
+
+	static inline std::shared_mutex m_mutex;
+	static inline std::map<std::string, Family> m_families;// < sorted, the dump is stable between writes
+
+	static inline std::mutex m_dumpMutex;
+	static inline std::condition_variable m_dumpCV;
+	static inline std::thread m_dumpThread;
+	static inline bool m_dumpStop = false;
+
+	static Family& GetFamily(const std::string& name, MetricType type);
+	static void DumpLoop(MetricsConfig config);
+};
+
+/**
+* @brief Records the time from construction to destruction into a histogram.
+*/
+class ScopedLatency {
+public:
+	explicit ScopedLatency(LatencyHistogram& histogram)
+		: m_histogram(histogram), m_start(std::chrono::steady_clock::now()) {
+	}
+	~ScopedLatency() {
+		m_histogram.Record(std::chrono::steady_clock::now() - m_start);
+	}
+
+	ScopedLatency(const ScopedLatency&) = delete;
+	ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+	LatencyHistogram& m_histogram;
+	std::chrono::steady_clock::time_point m_start;
+};
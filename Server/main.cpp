@@ -6,6 +6,7 @@
 #include "NetServerManager.h"
 
 #include "ServerLogic/SQLServerLogic.h"
+#include "ServerLogic/StoreServerLogic.h"
 #include "ServerLogic/GameServerLogic.h"
 
 int main(int argc, char* argv[]) {
@@ -13,16 +14,22 @@ int main(int argc, char* argv[]) {
 		return 1;
 	
 	DBConfig config = LoadDBConfigRelative("config.otn");
+	MetricsConfig metricsConfig = LoadMetricsConfigRelative("config.otn");
 
 	NetServer* gameServer = NetServerManager::CreateServer("game_server");
 	gameServer->SetLogic<GameServerLogic>();
 	gameServer->Start(5000);
 
 	NetServer* sqlServer = NetServerManager::CreateServer("sql_server");
-	sqlServer->SetLogic<SQLServerLogic>(config);
+	// the game server talks to sql_server with either backend
+	if (config.backend == StoreBackend::LOG)
+		sqlServer->SetLogic<StoreServerLogic>(config);
+	else
+		sqlServer->SetLogic<SQLServerLogic>(config);
 	sqlServer->Start(5001);
 
 	NetServerManager::StartAll();
+	ServerMetrics::StartDump(metricsConfig);
 
 	std::cout << "-------------------------------------\n";
 	std::cout << "           Server Startup            \n";
@@ -33,10 +40,15 @@ int main(int argc, char* argv[]) {
 		std::cout << "Running server '" << server->GetName()
 			<< "' on Port '" << server->GetPort() << "'\n";
 	}
+	if (metricsConfig.dumpInterval.count() > 0) {
+		std::cout << "Writing metrics to '" << metricsConfig.dumpPath
+			<< "' every " << metricsConfig.dumpInterval.count() << "s\n";
+	}
 
 	while (true) {
 	}
 
+	ServerMetrics::StopDump();
 	NetServerManager::StopAll();
 	NetworkSystem::Quit();
 	return 0;
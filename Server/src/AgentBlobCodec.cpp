@@ -0,0 +1,76 @@
+#include "AgentBlobCodec.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "BinarySerializer.h"
+#include "BinaryDeserializer.h"
+
+namespace AgentBlobCodec {
+
+	std::string Encode(const std::vector<StoredBoardState>& states) {
+		BinarySerializer ser;
+		ser.AddField(MAGIC);
+		ser.AddField(VERSION);
+		ser.AddField(static_cast<uint32_t>(states.size()));
+
+		for (const auto& state : states) {
+			ser.AddField(state.boardState);
+			ser.AddField(static_cast<uint32_t>(state.moves.size()));
+			for (const auto& move : state.moves)
+				ser.AddFields(move.eval, move.fromX, move.fromY, move.toX, move.toY);
+		}
+
+		std::vector<uint8_t> buffer = ser.ToBuffer();
+		return std::string(buffer.begin(), buffer.end());
+	}
+
+	bool Decode(std::string_view blob, std::vector<StoredBoardState>& outStates, std::string& outError) {
+		outStates.clear();
+
+		try {
+			BinaryDeserializer des(blob);
+			if (des.Read<uint32_t>() != MAGIC) {
+				outError = "Agent blob has an invalid magic";
+				return false;
+			}
+
+			uint8_t version = des.Read<uint8_t>();
+			if (version != VERSION) {
+				outError = "Agent blob version " + std::to_string(version) + " is not supported";
+				return false;
+			}
+
+			uint32_t stateCount = des.Read<uint32_t>();
+			// a state takes at least 8 bytes, a broken count can not reserve more than the blob holds
+			outStates.reserve(std::min<size_t>(stateCount, blob.size() / 8));
+
+			for (uint32_t i = 0; i < stateCount; ++i) {
+				StoredBoardState state;
+				state.boardState = des.ReadString();
+
+				uint32_t moveCount = des.Read<uint32_t>();
+				state.moves.reserve(std::min<size_t>(moveCount, blob.size() / 8));
+				for (uint32_t j = 0; j < moveCount; ++j) {
+					StoredMove move;
+					move.eval = des.Read<float>();
+					move.fromX = des.Read<uint8_t>();
+					move.fromY = des.Read<uint8_t>();
+					move.toX = des.Read<uint8_t>();
+					move.toY = des.Read<uint8_t>();
+					state.moves.push_back(move);
+				}
+
+				outStates.push_back(std::move(state));
+			}
+		}
+		catch (const std::runtime_error& e) {
+			outStates.clear();
+			outError = std::string("Agent blob is truncated: ") + e.what();
+			return false;
+		}
+
+		return true;
+	}
+
+}
\ No newline at end of file
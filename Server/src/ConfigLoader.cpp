@@ -1,25 +1,34 @@
+#include <algorithm>
 #include <whereami/whereami.h>
 
 #include "ConfigLoader.h"
 
-DBConfig LoadDBConfigRelative(const OTN::OTNFilePath& relativePath) {
-    int length = wai_getExecutablePath(nullptr, 0, nullptr);
-    if (length <= 0)
-        throw std::runtime_error("LoadDBConfigRelative: Cannot determine executable path");
+namespace {
+
+    std::filesystem::path ResolveNextToExecutable(const OTN::OTNFilePath& relativePath, const std::string& caller) {
+        int length = wai_getExecutablePath(nullptr, 0, nullptr);
+        if (length <= 0)
+            throw std::runtime_error(caller + ": Cannot determine executable path");
+
+        std::vector<char> exePath(length + 1);
+        int result = wai_getExecutablePath(exePath.data(), static_cast<int>(exePath.size()), nullptr);
+        if (result <= 0)
+            throw std::runtime_error(caller + ": Failed to retrieve executable path");
 
-    std::vector<char> exePath(length + 1);
-    int result = wai_getExecutablePath(exePath.data(), static_cast<int>(exePath.size()), nullptr);
-    if (result <= 0)
-        throw std::runtime_error("LoadDBConfigRelative: Failed to retrieve executable path");
+        std::filesystem::path exeDir(exePath.data());
+        exeDir = exeDir.parent_path();
+        std::filesystem::path configPath = exeDir / relativePath;
 
-    std::filesystem::path exeDir(exePath.data());
-    exeDir = exeDir.parent_path();
-    std::filesystem::path configPath = exeDir / relativePath;
+        if (!std::filesystem::exists(configPath))
+            throw std::runtime_error(caller + ": Config file does not exist: " + configPath.string());
+
+        return configPath;
+    }
 
-    if (!std::filesystem::exists(configPath))
-        throw std::runtime_error("LoadDBConfigRelative: Config file does not exist: " + configPath.string());
+}
 
-    return LoadDBConfig(configPath.string());
+DBConfig LoadDBConfigRelative(const OTN::OTNFilePath& relativePath) {
+    return LoadDBConfig(ResolveNextToExecutable(relativePath, "LoadDBConfigRelative").string());
 }
 
 DBConfig LoadDBConfig(const OTN::OTNFilePath& path) {
@@ -42,10 +51,55 @@ DBConfig LoadDBConfig(const OTN::OTNFilePath& path) {
             cfg.password = *passOpt;
         if (auto schemaOpt = objOpt->TryGetValue<std::string>(0, "schema")) 
             cfg.schema = *schemaOpt;
+        if (auto poolOpt = objOpt->TryGetValue<int>(0, "pool_size"))
+            cfg.poolSize = static_cast<uint32_t>(std::max(1, *poolOpt));
+        if (auto storageOpt = objOpt->TryGetValue<std::string>(0, "agent_storage")) {
+            if (*storageOpt == "blob")
+                cfg.storage = AgentStorage::BLOB;
+            else if (*storageOpt == "rows")
+                cfg.storage = AgentStorage::ROWS;
+            else
+                throw std::runtime_error("LoadDBConfig: Unknown agent_storage '" + *storageOpt + "', expected rows or blob");
+        }
+        if (auto migrateOpt = objOpt->TryGetValue<bool>(0, "migrate_storage"))
+            cfg.migrateStorage = *migrateOpt;
+        if (auto backendOpt = objOpt->TryGetValue<std::string>(0, "backend")) {
+            if (*backendOpt == "mysql")
+                cfg.backend = StoreBackend::MYSQL;
+            else if (*backendOpt == "log")
+                cfg.backend = StoreBackend::LOG;
+            else
+                throw std::runtime_error("LoadDBConfig: Unknown backend '" + *backendOpt + "', expected mysql or log");
+        }
+        if (auto dataPathOpt = objOpt->TryGetValue<std::string>(0, "data_path"))
+            cfg.dataPath = *dataPathOpt;
     }
     else {
         throw std::runtime_error("LoadDBConfig: Database object not found in config file: " + path.string());
     }
 
+    return cfg;
+}
+
+MetricsConfig LoadMetricsConfigRelative(const OTN::OTNFilePath& relativePath) {
+    return LoadMetricsConfig(ResolveNextToExecutable(relativePath, "LoadMetricsConfigRelative").string());
+}
+
+MetricsConfig LoadMetricsConfig(const OTN::OTNFilePath& path) {
+    MetricsConfig cfg;
+
+    OTN::OTNReader reader;
+    if (!reader.ReadFile(path)) {
+        std::string errMsg = "LoadMetricsConfig: Failed to read config file: " + path.string() + "\n Reader error:" + reader.GetError();
+        throw std::runtime_error(errMsg);
+    }
+
+    if (auto objOpt = reader.TryGetObject("metrics")) {
+        if (auto pathOpt = objOpt->TryGetValue<std::string>(0, "dump_path"))
+            cfg.dumpPath = *pathOpt;
+        if (auto intervalOpt = objOpt->TryGetValue<int>(0, "dump_interval_s"))
+            cfg.dumpInterval = std::chrono::seconds(std::max(0, *intervalOpt));
+    }
+
     return cfg;
 }
\ No newline at end of file
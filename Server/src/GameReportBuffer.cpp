@@ -0,0 +1,159 @@
+#include "GameReportBuffer.h"
+
+#include <algorithm>
+
+#include "IAgentStore.h"
+
+namespace {
+
+	bool SameMove(const StoredMove& a, const StoredMove& b) {
+		return a.fromX == b.fromX && a.fromY == b.fromY && a.toX == b.toX && a.toY == b.toY;
+	}
+
+	StoredMove* FindMove(std::vector<StoredMove>& moves, const StoredMove& move) {
+		auto it = std::find_if(moves.begin(), moves.end(), [&](const StoredMove& m) { return SameMove(m, move); });
+		return (it != moves.end()) ? &*it : nullptr;
+	}
+
+}
+
+void AgentTraining::ApplyTo(std::vector<StoredBoardState>& states) const {
+	std::unordered_map<std::string, size_t> indices;
+	indices.reserve(states.size() + newStates.size());
+	for (size_t i = 0; i < states.size(); ++i)
+		indices.emplace(states[i].boardState, i);
+
+	// a state another client already created keeps its evaluations
+	for (const auto& [boardState, moves] : newStates) {
+		auto [it, inserted] = indices.try_emplace(boardState, states.size());
+		if (!inserted)
+			continue;
+
+		StoredBoardState state{ boardState, moves };
+		for (auto& move : state.moves)
+			move.eval = 0.0f;
+		states.push_back(std::move(state));
+	}
+
+	for (const auto& [boardState, moves] : rewards) {
+		auto [it, inserted] = indices.try_emplace(boardState, states.size());
+		if (inserted)
+			states.push_back({ boardState, {} });
+
+		auto& stateMoves = states[it->second].moves;
+		for (const auto& reward : moves) {
+			if (StoredMove* move = FindMove(stateMoves, reward))
+				move->eval += reward.eval;
+			else
+				stateMoves.push_back(reward);
+		}
+	}
+}
+
+bool ReadTrainingDelta(const OTN::OTNObject& body, size_t row, std::unordered_map<int64_t, AgentTraining>& training) {
+	auto agentID = body.TryGetValue<int64_t>(row, "server_id");
+	auto states = body.TryGetValue<std::vector<OTN::OTNObject>>(row, "states");
+	if (!agentID || *agentID <= 0 || !states)
+		return false;
+
+	AgentTraining& agentTraining = training[*agentID];
+	agentTraining.matchesPlayed += body.TryGetValue<int>(row, "matches_played").value_or(0);
+	agentTraining.matchesWon += body.TryGetValue<int>(row, "matches_won").value_or(0);
+	agentTraining.matchesPlayedWhite += body.TryGetValue<int>(row, "matches_played_white").value_or(0);
+	agentTraining.matchesWonWhite += body.TryGetValue<int>(row, "matches_won_white").value_or(0);
+
+	for (const auto& state : *states) {
+		StoredBoardState delta;
+		if (!ReadStoredBoardState(state, delta))
+			continue;
+
+		// a state missing on the server is created with the delta as evaluation
+		auto& moves = agentTraining.rewards[delta.boardState];
+		for (const auto& move : delta.moves) {
+			if (StoredMove* summed = FindMove(moves, move))
+				summed->eval += move.eval;
+			else
+				moves.push_back(move);
+		}
+	}
+	return true;
+}
+
+bool GameReportBuffer::AddReport(const OTN::OTNObject& body, size_t row) {
+	auto agentID = body.TryGetValue<int64_t>(row, "server_id");
+	auto won = body.TryGetValue<bool>(row, "won");
+	auto white = body.TryGetValue<bool>(row, "white");
+	auto history = body.TryGetValue<std::vector<OTN::OTNObject>>(row, "history");
+	if (!agentID || *agentID <= 0 || !won || !white || !history)
+		return false;
+
+	std::vector<StoredBoardState> newStates;
+	if (auto states = body.TryGetValue<std::vector<OTN::OTNObject>>(row, "new_states")) {
+		newStates.reserve(states->size());
+		for (const auto& state : *states) {
+			StoredBoardState stored;
+			if (ReadStoredBoardState(state, stored))
+				newStates.push_back(std::move(stored));
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	AgentTraining& training = m_agents[*agentID];
+
+	training.matchesPlayed++;
+	if (*won)
+		training.matchesWon++;
+	if (*white)
+		training.matchesPlayedWhite++;
+	if (*won && *white)
+		training.matchesWonWhite++;
+
+	for (auto& state : newStates)
+		training.newStates.try_emplace(std::move(state.boardState), std::move(state.moves));
+
+	// same update as Agent::GameFinished, the last move gets the full reward
+	float reward = *won ? WIN_REWARD : LOSS_REWARD;
+	for (auto it = history->rbegin(); it != history->rend(); ++it) {
+		auto boardState = it->TryGetValue<std::string>(0, "board_state");
+		auto fromX = it->TryGetValue<int>(0, "from_x");
+		auto fromY = it->TryGetValue<int>(0, "from_y");
+		auto toX = it->TryGetValue<int>(0, "to_x");
+		auto toY = it->TryGetValue<int>(0, "to_y");
+
+		if (boardState && fromX && fromY && toX && toY) {
+			StoredMove move{ reward,
+				static_cast<uint8_t>(*fromX), static_cast<uint8_t>(*fromY),
+				static_cast<uint8_t>(*toX), static_cast<uint8_t>(*toY) };
+
+			auto& moves = training.rewards[*boardState];
+			if (StoredMove* summed = FindMove(moves, move))
+				summed->eval += reward;
+			else
+				moves.push_back(move);
+		}
+
+		reward *= REWARD_DECAY;
+	}
+
+	m_gameCount++;
+	return true;
+}
+
+bool GameReportBuffer::IsFlushDue() const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_agents.empty())
+		return false;
+
+	return m_gameCount >= FLUSH_GAMES ||
+		std::chrono::steady_clock::now() - m_lastFlush >= FLUSH_INTERVAL;
+}
+
+std::unordered_map<int64_t, AgentTraining> GameReportBuffer::Take() {
+	std::unordered_map<int64_t, AgentTraining> agents;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	agents.swap(m_agents);
+	m_gameCount = 0;
+	m_lastFlush = std::chrono::steady_clock::now();
+	return agents;
+}
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include <unordered_map>
+
+#include "IAgentStore.h"
+
+bool ReadStoredBoardState(const OTN::OTNObject& boardState, StoredBoardState& outState) {
+	auto stateStr = boardState.TryGetValue<std::string>(0, "board_state");
+	auto moves = boardState.TryGetValue<std::vector<OTN::OTNObject>>(0, "moves");
+	if (!stateStr || !moves)
+		return false;
+
+	outState.boardState = std::move(*stateStr);
+	outState.moves.clear();
+	outState.moves.reserve(moves->size());
+
+	// v1 sends an object per move, a decoded v2 body one object with a row per move
+	for (auto& move : *moves) {
+		for (size_t row = 0; row < move.GetRowCount(); ++row) {
+			auto eval = move.TryGetValue<float>(row, "eval");
+			auto fromX = move.TryGetValue<float>(row, "from_x");
+			auto fromY = move.TryGetValue<float>(row, "from_y");
+			auto toX = move.TryGetValue<float>(row, "to_x");
+			auto toY = move.TryGetValue<float>(row, "to_y");
+
+			if (!eval || !fromX || !fromY || !toX || !toY)
+				continue;
+
+			outState.moves.push_back({
+				*eval,
+				static_cast<uint8_t>(*fromX), static_cast<uint8_t>(*fromY),
+				static_cast<uint8_t>(*toX), static_cast<uint8_t>(*toY)
+			});
+		}
+	}
+	return true;
+}
+
+void MergeBoardStates(std::vector<StoredBoardState>& stored, std::vector<StoredBoardState>&& changed) {
+	std::unordered_map<std::string, size_t> indices;
+	indices.reserve(stored.size() + changed.size());
+	for (size_t i = 0; i < stored.size(); ++i)
+		indices.emplace(stored[i].boardState, i);
+
+	// a state sent twice keeps the last one
+	for (auto& state : changed) {
+		auto [it, inserted] = indices.try_emplace(state.boardState, stored.size());
+		if (inserted)
+			stored.push_back(std::move(state));
+		else
+			stored[it->second].moves = std::move(state.moves);
+	}
+}
\ No newline at end of file
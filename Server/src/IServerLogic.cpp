@@ -3,26 +3,33 @@
 #include "NetServer.h"
 
 void IServerLogic::OnRunExternal() {
-	std::lock_guard guard(m_logicMutex);
+	auto lock = LockLogic();
 	OnRun();
 }
 
 void IServerLogic::OnClientConnectedExternal(NET_StreamSocket* client) {
-	std::lock_guard guard(m_logicMutex);
+	auto lock = LockLogic();
 	OnClientConnected(client);
 }
 
 void IServerLogic::OnMessageExternal(NET_StreamSocket* client, const std::string& msg) {
-	std::lock_guard guard(m_logicMutex);
+	auto lock = LockLogic();
 	OnMessage(client, msg);
 }
 
-void IServerLogic::OnServerMessageExternal(const std::string& serverName, const std::string& msg) {
-	std::lock_guard guard(m_logicMutex);
-	OnServerMessage(serverName, msg);
+void IServerLogic::OnServerMessageExternal(ServerMessage& msg) {
+	auto lock = LockLogic();
+	OnServerMessage(msg);
 }
 
 void IServerLogic::OnClientDisconnectedExternal(NET_StreamSocket* client) {
-	std::lock_guard guard(m_logicMutex);
+	auto lock = LockLogic();
 	OnClientDisconnected(client);
+}
+
+std::unique_lock<std::mutex> IServerLogic::LockLogic() {
+	std::unique_lock<std::mutex> lock(m_logicMutex, std::defer_lock);
+	if (!m_concurrentCallbacks)
+		lock.lock();
+	return lock;
 }
\ No newline at end of file
@@ -0,0 +1,697 @@
+#include "LogAgentStore.h"
+
+#include <array>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "BinarySerializer.h"
+#include "BinaryDeserializer.h"
+
+namespace {
+
+	uint32_t Crc32(std::string_view data) {
+		static const std::array<uint32_t, 256> table = []() {
+			std::array<uint32_t, 256> t{};
+			for (uint32_t i = 0; i < 256; ++i) {
+				uint32_t c = i;
+				for (int k = 0; k < 8; ++k)
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				t[i] = c;
+			}
+			return t;
+		}();
+
+		uint32_t crc = 0xFFFFFFFFu;
+		for (char ch : data)
+			crc = table[(crc ^ static_cast<uint8_t>(ch)) & 0xFF] ^ (crc >> 8);
+		return crc ^ 0xFFFFFFFFu;
+	}
+
+	std::string ToString(const std::vector<uint8_t>& buffer) {
+		return std::string(buffer.begin(), buffer.end());
+	}
+
+	/*< true if the stream holds only zero bytes from its position on, what a crash can leave behind a torn write */
+	bool OnlyZerosFollow(std::ifstream& log) {
+		std::array<char, 4096> buffer;
+		while (log.read(buffer.data(), buffer.size()) || log.gcount() > 0) {
+			auto end = buffer.begin() + log.gcount();
+			if (std::any_of(buffer.begin(), end, [](char c) { return c != 0; }))
+				return false;
+		}
+		return true;
+	}
+
+	bool SyncFile(std::FILE* file) {
+		if (std::fflush(file) != 0)
+			return false;
+#ifdef _WIN32
+		return _commit(_fileno(file)) == 0;
+#else
+		return fsync(fileno(file)) == 0;
+#endif
+	}
+
+}
+
+LogAgentStore::LogAgentStore(std::filesystem::path path)
+	: m_path(std::move(path)) {
+}
+
+LogAgentStore::~LogAgentStore() {
+	Close();
+}
+
+void LogAgentStore::Open() {
+	if (m_open)
+		return;
+
+	if (m_path.has_parent_path())
+		std::filesystem::create_directories(m_path.parent_path());
+
+	m_index.clear();
+	m_tombstones.clear();
+	m_versions.clear();
+	m_nextID = 1;
+	m_lastChange = 0;
+	m_liveBytes = 0;
+	m_commitError.clear();
+
+	std::error_code sizeError;
+	uint64_t fileBytes = std::filesystem::exists(m_path) ? std::filesystem::file_size(m_path, sizeError) : 0;
+	if (sizeError)
+		throw std::runtime_error("LogAgentStore: Failed to read the size of '" + m_path.string() + "': " + sizeError.message());
+
+	uint64_t validBytes = 0;
+	{
+		std::ifstream log(m_path, std::ios::binary);
+		std::string header(RECORD_HEADER_SIZE, '\0');
+		std::string payload;
+
+		while (validBytes + RECORD_HEADER_SIZE <= fileBytes && log.read(header.data(), RECORD_HEADER_SIZE)) {
+			BinaryDeserializer des(header);
+			uint32_t payloadSize = des.Read<uint32_t>();
+			uint32_t crc = des.Read<uint32_t>();
+			auto type = static_cast<RecordType>(des.Read<uint8_t>());
+
+			if (payloadSize > MAX_RECORD_PAYLOAD) {
+				throw std::runtime_error("LogAgentStore: Record at " + std::to_string(validBytes) + " of '" + m_path.string()
+					+ "' has a size of " + std::to_string(payloadSize) + " bytes, the log is corrupted");
+			}
+
+			// a record that runs past the end of the file is the torn tail
+			uint64_t recordEnd = validBytes + RECORD_HEADER_SIZE + payloadSize;
+			if (recordEnd > fileBytes)
+				break;
+
+			payload.resize(payloadSize);
+			bool intact = log.read(payload.data(), payloadSize) && Crc32(payload) == crc;
+
+			if (intact) {
+				try {
+					BinaryDeserializer body(payload);
+					int64_t id = body.Read<int64_t>();
+					IndexEntry entry{ validBytes, static_cast<uint32_t>(RECORD_HEADER_SIZE + payloadSize) };
+
+					switch (type) {
+					case RecordType::PUT: {
+						int64_t version = body.Read<int64_t>();
+						entry.sequence = body.Read<int64_t>();
+						ApplyEntry({ id, false, entry });
+						m_versions[id] = version;
+						m_nextID = std::max(m_nextID, id + 1);
+						break;
+					}
+					case RecordType::REMOVE:
+						entry.sequence = body.Read<int64_t>();
+						ApplyEntry({ id, true, entry });
+						m_versions.erase(id);
+						m_nextID = std::max(m_nextID, id + 1);
+						break;
+					case RecordType::NEXT_ID:
+						m_nextID = std::max(m_nextID, id);
+						m_lastChange = std::max(m_lastChange, body.Read<int64_t>());
+						break;
+					default:
+						throw std::runtime_error("unknown record type");
+					}
+					m_lastChange = std::max(m_lastChange, entry.sequence);
+				}
+				catch (const std::runtime_error&) {
+					intact = false;
+				}
+			}
+
+			if (!intact) {
+				// only the last write can be torn, cutting off a bad record in the middle would drop the intact ones behind it
+				if (recordEnd == fileBytes || OnlyZerosFollow(log))
+					break;
+				throw std::runtime_error("LogAgentStore: Record at " + std::to_string(validBytes) + " of '" + m_path.string()
+					+ "' is corrupted and followed by " + std::to_string(fileBytes - recordEnd) + " more bytes");
+			}
+
+			validBytes = recordEnd;
+		}
+	}
+
+	// everything behind the last complete record was a write that never finished
+	if (fileBytes > validBytes) {
+		std::cerr << "LogAgentStore: Cut off " << (fileBytes - validBytes)
+			<< " bytes of a torn record in '" << m_path.string() << "'\n";
+		std::filesystem::resize_file(m_path, validBytes);
+	}
+
+	m_file = std::fopen(m_path.string().c_str(), "ab");
+	if (!m_file)
+		throw std::runtime_error("LogAgentStore: Failed to open '" + m_path.string() + "'");
+
+	m_durableChange = m_lastChange;
+	m_fileBytes = validBytes;
+	m_writeOffset = validBytes;
+	m_stop = false;
+	m_open = true;
+	m_commitThread = std::thread(&LogAgentStore::CommitLoop, this);
+
+	std::cout << "LogAgentStore: Loaded " << m_index.size() << " agents from '" << m_path.string() << "'\n";
+}
+
+void LogAgentStore::Close() {
+	if (!m_open)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_writeMutex);
+		m_stop = true;
+	}
+	m_workCV.notify_one();
+
+	// the commit thread writes the queued records before it ends
+	if (m_commitThread.joinable())
+		m_commitThread.join();
+
+	std::fclose(m_file);
+	m_file = nullptr;
+	m_open = false;
+}
+
+std::vector<int64_t> LogAgentStore::InsertAgents(std::vector<StoredAgent>&& agents) {
+	std::vector<int64_t> ids;
+	ids.reserve(agents.size());
+	if (agents.empty())
+		return ids;
+
+	std::unique_lock<std::mutex> lock(m_writeMutex);
+	ThrowIfFailed();
+
+	int64_t sequence = ++m_lastChange;
+	for (auto& agent : agents) {
+		agent.id = m_nextID++;
+		agent.changeSequence = sequence;
+		QueueRecord(RecordType::PUT, agent.id, sequence, EncodeAgent(agent));
+		m_versions[agent.id] = agent.version;
+		ids.push_back(agent.id);
+	}
+
+	CommitQueued(lock);
+	return ids;
+}
+
+std::vector<size_t> LogAgentStore::UpdateAgents(std::vector<StoredAgent>&& agents) {
+	std::vector<size_t> updated;
+
+	std::unique_lock<std::mutex> lock(m_writeMutex);
+	ThrowIfFailed();
+
+	// taken with the first real update, a request without one is no change
+	int64_t sequence = 0;
+
+	for (size_t i = 0; i < agents.size(); ++i) {
+		// the version of an earlier agent of the same request is already set, a duplicate is skipped
+		auto stored = m_versions.find(agents[i].id);
+		if (stored == m_versions.end() || stored->second >= agents[i].version)
+			continue;
+
+		if (sequence == 0)
+			sequence = ++m_lastChange;
+
+		stored->second = agents[i].version;
+		agents[i].changeSequence = sequence;
+		QueueRecord(RecordType::PUT, agents[i].id, sequence, EncodeAgent(agents[i]));
+		updated.push_back(i);
+	}
+
+	if (!updated.empty())
+		CommitQueued(lock);
+	return updated;
+}
+
+std::vector<size_t> LogAgentStore::UpdateAgentStates(std::vector<StoredAgent>&& agents) {
+	std::vector<size_t> updated;
+
+	std::unique_lock<std::mutex> lock(m_writeMutex);
+	ThrowIfFailed();
+
+	// the stored states are read from the index
+	WaitForQueued(lock);
+
+	int64_t sequence = 0;
+	std::ifstream log;
+	std::unordered_set<int64_t> merged;
+
+	for (size_t i = 0; i < agents.size(); ++i) {
+		// the index does not hold the record of an agent merged earlier in this request
+		auto stored = m_versions.find(agents[i].id);
+		if (stored == m_versions.end() || stored->second >= agents[i].version || !merged.insert(agents[i].id).second)
+			continue;
+
+		IndexEntry entry;
+		{
+			std::shared_lock<std::shared_mutex> indexLock(m_indexMutex);
+			auto it = m_index.find(agents[i].id);
+			if (it == m_index.end())
+				continue;
+			entry = it->second;
+		}
+
+		// nothing is written while m_writeMutex is held, the record stays where it is
+		if (!log.is_open())
+			log.open(m_path, std::ios::binary);
+		StoredAgent current = ReadAgent(log, entry);
+
+		if (sequence == 0)
+			sequence = ++m_lastChange;
+
+		MergeBoardStates(current.boardStates, std::move(agents[i].boardStates));
+		agents[i].boardStates = std::move(current.boardStates);
+
+		stored->second = agents[i].version;
+		agents[i].changeSequence = sequence;
+		QueueRecord(RecordType::PUT, agents[i].id, sequence, EncodeAgent(agents[i]));
+		updated.push_back(i);
+	}
+
+	if (!updated.empty())
+		CommitQueued(lock);
+	return updated;
+}
+
+std::vector<std::pair<int64_t, int64_t>> LogAgentStore::ApplyTraining(const std::unordered_map<int64_t, AgentTraining>& training) {
+	std::unique_lock<std::mutex> lock(m_writeMutex);
+	ThrowIfFailed();
+	WaitForQueued(lock);
+
+	int64_t sequence = 0;
+	std::vector<std::pair<int64_t, int64_t>> trained;
+	std::ifstream log;
+
+	for (const auto& [id, agentTraining] : training) {
+		auto stored = m_versions.find(id);
+		if (stored == m_versions.end())
+			continue;
+
+		IndexEntry entry;
+		{
+			std::shared_lock<std::shared_mutex> indexLock(m_indexMutex);
+			auto it = m_index.find(id);
+			if (it == m_index.end())
+				continue;
+			entry = it->second;
+		}
+
+		if (!log.is_open())
+			log.open(m_path, std::ios::binary);
+		StoredAgent agent = ReadAgent(log, entry);
+
+		if (sequence == 0)
+			sequence = ++m_lastChange;
+
+		agent.matchesPlayed += agentTraining.matchesPlayed;
+		agent.matchesWon += agentTraining.matchesWon;
+		agent.matchesPlayedWhite += agentTraining.matchesPlayedWhite;
+		agent.matchesWonWhite += agentTraining.matchesWonWhite;
+		agentTraining.ApplyTo(agent.boardStates);
+
+		agent.version = ++stored->second;
+		agent.changeSequence = sequence;
+		QueueRecord(RecordType::PUT, id, sequence, EncodeAgent(agent));
+		trained.emplace_back(id, agent.version);
+	}
+
+	if (!trained.empty())
+		CommitQueued(lock);
+	return trained;
+}
+
+void LogAgentStore::DeleteAgents(const std::vector<int64_t>& ids) {
+	std::unique_lock<std::mutex> lock(m_writeMutex);
+	ThrowIfFailed();
+
+	int64_t sequence = 0;
+	for (int64_t id : ids) {
+		if (m_versions.erase(id) == 0)
+			continue;
+
+		if (sequence == 0)
+			sequence = ++m_lastChange;
+
+		BinarySerializer ser;
+		ser.AddFields(id, sequence);
+		QueueRecord(RecordType::REMOVE, id, sequence, ToString(ser.ToBuffer()));
+	}
+
+	if (sequence != 0)
+		CommitQueued(lock);
+}
+
+std::vector<int64_t> LogAgentStore::GetAgentIDs() {
+	std::vector<int64_t> ids;
+	{
+		std::shared_lock<std::shared_mutex> lock(m_indexMutex);
+		ids.reserve(m_index.size());
+		for (const auto& [id, entry] : m_index)
+			ids.push_back(id);
+	}
+
+	std::sort(ids.begin(), ids.end());
+	return ids;
+}
+
+bool LogAgentStore::ForEachAgent(const AgentFilter& filter, size_t batchSize, const AgentBatchCallback& onBatch) {
+	std::vector<int64_t> ids;
+	{
+		std::shared_lock<std::shared_mutex> lock(m_indexMutex);
+		for (const auto& [id, entry] : m_index) {
+			if (filter(id, entry.sequence))
+				ids.push_back(id);
+		}
+	}
+	std::sort(ids.begin(), ids.end());
+
+	batchSize = std::max<size_t>(batchSize, 1);
+	size_t start = 0;
+	do {
+		size_t end = std::min(start + batchSize, ids.size());
+		std::vector<StoredAgent> agents;
+		agents.reserve(end - start);
+
+		{
+			// the lock is only held per batch, a slow receiver does not block commits or compactions
+			std::shared_lock<std::shared_mutex> lock(m_indexMutex);
+			std::ifstream log(m_path, std::ios::binary);
+			if (!log)
+				throw std::runtime_error("LogAgentStore: Failed to read '" + m_path.string() + "'");
+
+			for (size_t i = start; i < end; ++i) {
+				// deleted since the ids were collected
+				auto entry = m_index.find(ids[i]);
+				if (entry != m_index.end())
+					agents.push_back(ReadAgent(log, entry->second));
+			}
+		}
+
+		if (!onBatch(std::move(agents)))
+			return false;
+		start = end;
+	} while (start < ids.size());
+
+	return true;
+}
+
+int64_t LogAgentStore::GetChangeSequence() {
+	std::shared_lock<std::shared_mutex> lock(m_indexMutex);
+	return m_durableChange;
+}
+
+std::vector<int64_t> LogAgentStore::GetDeletedAgents(int64_t since, int64_t until) {
+	std::vector<int64_t> ids;
+	std::shared_lock<std::shared_mutex> lock(m_indexMutex);
+	for (const auto& [id, entry] : m_tombstones) {
+		if (entry.sequence > since && entry.sequence <= until)
+			ids.push_back(id);
+	}
+	return ids;
+}
+
+void LogAgentStore::CommitLoop() {
+	auto nextCompactCheck = std::chrono::steady_clock::now() + COMPACT_CHECK_INTERVAL;
+
+	std::unique_lock<std::mutex> lock(m_writeMutex);
+	while (true) {
+		m_workCV.wait_until(lock, nextCompactCheck, [this]() {
+			return m_stop || !m_pendingData.empty();
+		});
+
+		if (m_pendingData.empty()) {
+			if (m_stop)
+				break;
+
+			if (std::chrono::steady_clock::now() >= nextCompactCheck) {
+				nextCompactCheck = std::chrono::steady_clock::now() + COMPACT_CHECK_INTERVAL;
+				if (m_commitError.empty() && NeedsCompaction())
+					Compact();
+			}
+			continue;
+		}
+
+		// every record queued while the previous sync ran goes into this one
+		std::string data;
+		std::vector<PendingEntry> entries;
+		data.swap(m_pendingData);
+		entries.swap(m_pendingEntries);
+		uint64_t sequence = m_queuedSequence;
+
+		lock.unlock();
+		bool written = WriteAndSync(m_file, data);
+		if (written) {
+			std::unique_lock<std::shared_mutex> indexLock(m_indexMutex);
+			for (const auto& pending : entries) {
+				ApplyEntry(pending);
+				m_durableChange = std::max(m_durableChange, pending.entry.sequence);
+			}
+			m_fileBytes += data.size();
+		}
+		lock.lock();
+
+		if (!written) {
+			m_commitError = "LogAgentStore: Failed to write '" + m_path.string() + "'";
+			std::cerr << m_commitError << '\n';
+		}
+		m_durableSequence = sequence;
+		m_durableCV.notify_all();
+
+		if (!written)
+			break;
+	}
+}
+
+bool LogAgentStore::WriteAndSync(std::FILE* file, const std::string& data) {
+	if (std::fwrite(data.data(), 1, data.size(), file) != data.size())
+		return false;
+	return SyncFile(file);
+}
+
+bool LogAgentStore::NeedsCompaction() const {
+	if (m_fileBytes < COMPACT_MIN_BYTES)
+		return false;
+	return static_cast<double>(m_fileBytes - m_liveBytes) >= static_cast<double>(m_fileBytes) * COMPACT_DEAD_RATIO;
+}
+
+void LogAgentStore::Compact() {
+	std::unique_lock<std::shared_mutex> indexLock(m_indexMutex);
+
+	std::filesystem::path compactPath = m_path;
+	compactPath += ".compact";
+
+	// runs on the commit thread, nothing in here may throw
+	std::error_code ignored;
+	std::FILE* out = std::fopen(compactPath.string().c_str(), "wb");
+	if (!out) {
+		std::cerr << "LogAgentStore: Failed to create '" << compactPath.string() << "'\n";
+		return;
+	}
+
+	BinarySerializer nextID;
+	nextID.AddFields(m_nextID, m_lastChange);
+	std::string nextIDPayload = ToString(nextID.ToBuffer());
+
+	BinarySerializer header;
+	header.AddFields(static_cast<uint32_t>(nextIDPayload.size()), Crc32(nextIDPayload), static_cast<uint8_t>(RecordType::NEXT_ID));
+	std::string data = ToString(header.ToBuffer()) + nextIDPayload;
+
+	// the live records and tombstones are copied as they are, only their offsets change
+	std::unordered_map<int64_t, IndexEntry> index;
+	std::unordered_map<int64_t, IndexEntry> tombstones;
+	index.reserve(m_index.size());
+	tombstones.reserve(m_tombstones.size());
+	{
+		std::ifstream log(m_path, std::ios::binary);
+		std::string record;
+		auto copyRecords = [&](const std::unordered_map<int64_t, IndexEntry>& from, std::unordered_map<int64_t, IndexEntry>& to) {
+			for (const auto& [id, entry] : from) {
+				record.resize(entry.size);
+				log.seekg(static_cast<std::streamoff>(entry.offset));
+				if (!log.read(record.data(), entry.size)) {
+					std::cerr << "LogAgentStore: Compaction failed to read agent " << id << '\n';
+					return false;
+				}
+
+				to[id] = { data.size(), entry.size, entry.sequence };
+				data += record;
+			}
+			return true;
+		};
+
+		if (!copyRecords(m_index, index) || !copyRecords(m_tombstones, tombstones)) {
+			std::fclose(out);
+			std::filesystem::remove(compactPath, ignored);
+			return;
+		}
+	}
+
+	if (!WriteAndSync(out, data)) {
+		std::fclose(out);
+		std::filesystem::remove(compactPath, ignored);
+		std::cerr << "LogAgentStore: Compaction failed to write '" << compactPath.string() << "'\n";
+		return;
+	}
+	std::fclose(out);
+
+	uint64_t oldBytes = m_fileBytes;
+	std::fclose(m_file);
+
+	// on failure the original log is still in place and is reopened with the old index
+	std::error_code renameError;
+	std::filesystem::rename(compactPath, m_path, renameError);
+	if (renameError) {
+		std::cerr << "LogAgentStore: Compaction failed to replace '" << m_path.string() << "': " << renameError.message() << '\n';
+		std::filesystem::remove(compactPath, ignored);
+	}
+
+	m_file = std::fopen(m_path.string().c_str(), "ab");
+	if (!m_file) {
+		m_commitError = "LogAgentStore: Failed to reopen '" + m_path.string() + "' after compaction";
+		std::cerr << m_commitError << '\n';
+		return;
+	}
+	if (renameError)
+		return;
+
+	m_index = std::move(index);
+	m_tombstones = std::move(tombstones);
+	m_fileBytes = data.size();
+	m_writeOffset = data.size();
+
+	std::cout << "LogAgentStore: Compacted '" << m_path.string() << "' from " << oldBytes
+		<< " to " << m_fileBytes << " bytes\n";
+}
+
+void LogAgentStore::ApplyEntry(const PendingEntry& pending) {
+	auto& from = pending.removed ? m_index : m_tombstones;
+	auto& to = pending.removed ? m_tombstones : m_index;
+
+	auto old = from.find(pending.id);
+	if (old != from.end()) {
+		m_liveBytes -= old->second.size;
+		from.erase(old);
+	}
+
+	auto replaced = to.find(pending.id);
+	if (replaced != to.end())
+		m_liveBytes -= replaced->second.size;
+
+	to[pending.id] = pending.entry;
+	m_liveBytes += pending.entry.size;
+}
+
+void LogAgentStore::QueueRecord(RecordType type, int64_t id, int64_t sequence, const std::string& payload) {
+	BinarySerializer header;
+	header.AddFields(static_cast<uint32_t>(payload.size()), Crc32(payload), static_cast<uint8_t>(type));
+	std::vector<uint8_t> headerBytes = header.ToBuffer();
+
+	uint32_t size = static_cast<uint32_t>(headerBytes.size() + payload.size());
+	m_pendingEntries.push_back({ id, type == RecordType::REMOVE, { m_writeOffset, size, sequence } });
+	m_pendingData.append(headerBytes.begin(), headerBytes.end());
+	m_pendingData += payload;
+	m_writeOffset += size;
+}
+
+void LogAgentStore::CommitQueued(std::unique_lock<std::mutex>& lock) {
+	uint64_t sequence = ++m_queuedSequence;
+	m_workCV.notify_one();
+
+	m_durableCV.wait(lock, [&]() {
+		return m_durableSequence >= sequence || !m_commitError.empty();
+	});
+	ThrowIfFailed();
+}
+
+void LogAgentStore::WaitForQueued(std::unique_lock<std::mutex>& lock) {
+	// nothing is queued while m_writeMutex is held, the index then holds every record after this
+	m_durableCV.wait(lock, [&]() {
+		return m_durableSequence >= m_queuedSequence || !m_commitError.empty();
+	});
+	ThrowIfFailed();
+}
+
+void LogAgentStore::ThrowIfFailed() const {
+	if (!m_open)
+		throw std::runtime_error("LogAgentStore: Store is not open");
+	if (!m_commitError.empty())
+		throw std::runtime_error(m_commitError);
+}
+
+StoredAgent LogAgentStore::ReadAgent(std::ifstream& log, const IndexEntry& entry) const {
+	std::string record(entry.size, '\0');
+	log.seekg(static_cast<std::streamoff>(entry.offset));
+	if (!log.read(record.data(), entry.size))
+		throw std::runtime_error("LogAgentStore: Failed to read record at " + std::to_string(entry.offset));
+
+	BinaryDeserializer des(std::string_view(record).substr(0, RECORD_HEADER_SIZE));
+	des.Read<uint32_t>();
+	uint32_t crc = des.Read<uint32_t>();
+
+	std::string_view payload = std::string_view(record).substr(RECORD_HEADER_SIZE);
+	if (Crc32(payload) != crc)
+		throw std::runtime_error("LogAgentStore: Record at " + std::to_string(entry.offset) + " is corrupted");
+
+	return DecodeAgent(payload);
+}
+
+std::string LogAgentStore::EncodeAgent(const StoredAgent& agent) {
+	BinarySerializer ser;
+	ser.AddFields(agent.id, agent.version, agent.changeSequence);
+	ser.AddField(agent.name);
+	ser.AddField(agent.config);
+	ser.AddFields(agent.matchesPlayed, agent.matchesWon, agent.matchesPlayedWhite, agent.matchesWonWhite);
+	ser.AddField(AgentBlobCodec::Encode(agent.boardStates));
+	return ToString(ser.ToBuffer());
+}
+
+StoredAgent LogAgentStore::DecodeAgent(std::string_view payload) {
+	BinaryDeserializer des(payload);
+
+	StoredAgent agent;
+	agent.id = des.Read<int64_t>();
+	agent.version = des.Read<int64_t>();
+	agent.changeSequence = des.Read<int64_t>();
+	agent.name = des.ReadString();
+	agent.config = des.ReadString();
+	agent.matchesPlayed = des.Read<int>();
+	agent.matchesWon = des.Read<int>();
+	agent.matchesPlayedWhite = des.Read<int>();
+	agent.matchesWonWhite = des.Read<int>();
+
+	std::string error;
+	if (!AgentBlobCodec::Decode(des.ReadStringView(), agent.boardStates, error))
+		throw std::runtime_error("LogAgentStore: Agent " + std::to_string(agent.id) + ": " + error);
+
+	return agent;
+}
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include "NetProtocol.h"
+
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+
+#include "BinarySerializer.h"
+#include "BinaryDeserializer.h"
+
+namespace {
+
+	// indexed by the opcode, the column names are the ones of the v1 bodies
+	const std::array<NetOpcodeInfo, static_cast<size_t>(NetOpcode::COUNT)> OPCODE_INFOS = { {
+		{ "", NetBodyFormat::EMPTY, "" },
+		{ "SyncMissingData", NetBodyFormat::AGENTS, "" },
+		{ "GetAgentIDList", NetBodyFormat::EMPTY, "" },
+		{ "RequestMissingAgents", NetBodyFormat::ID_LIST, "id" },
+		{ "RequestAgentChanges", NetBodyFormat::SEQUENCE, "since" },
+		{ "SyncDeleteData", NetBodyFormat::ID_LIST, "ids" },
+		{ "SyncDirtyData", NetBodyFormat::AGENTS, "" },
+		{ "SyncDirtyStates", NetBodyFormat::AGENTS, "" },
+		{ "ReportGames", NetBodyFormat::OTN, "" },
+		{ "SyncAgentDeltas", NetBodyFormat::AGENT_DELTAS, "" },
+	} };
+
+	// smallest encoded size of an entry, a count can not promise more entries than the bytes left can hold
+	constexpr size_t MIN_MOVE_SIZE = 4 + 4 * 1;// < eval, from and to
+	constexpr size_t MIN_STATE_SIZE = 4 + 4;// < empty board state, move count
+	constexpr size_t MIN_ID_SIZE = 8;
+	constexpr size_t MIN_AGENT_SIZE = 3 * 8 + 4 + 4 + 4 * 4 + 4;// < ids, empty name and config, match counts, state count
+	constexpr size_t MIN_AGENT_DELTA_SIZE = 8 + 4 * 4 + 4;// < server id, match counts, state count
+
+	// a broken count can not reserve more than the rest of the body can fill
+	size_t ClampCount(uint32_t count, const BinaryDeserializer& des, size_t minEntrySize) {
+		return std::min<size_t>(count, des.Remaining() / minEntrySize);
+	}
+
+	std::vector<OTN::OTNObject> ReadStates(BinaryDeserializer& des) {
+		uint32_t stateCount = des.Read<uint32_t>();
+		std::vector<OTN::OTNObject> states;
+		states.reserve(ClampCount(stateCount, des, MIN_STATE_SIZE));
+
+		for (uint32_t i = 0; i < stateCount; ++i) {
+			std::string boardState = des.ReadString();
+			uint32_t moveCount = des.Read<uint32_t>();
+
+			// one object with a row per move, ReadStoredBoardState reads every row of the moves
+			OTN::OTNObject moves{ "GameMove" };
+			moves.SetNames("eval", "from_x", "from_y", "to_x", "to_y");
+			moves.SetTypes("float", "float", "float", "float", "float");
+			moves.ReserveDataRows(ClampCount(moveCount, des, MIN_MOVE_SIZE));
+			for (uint32_t j = 0; j < moveCount; ++j) {
+				float eval = des.Read<float>();
+				float fromX = des.Read<uint8_t>();
+				float fromY = des.Read<uint8_t>();
+				float toX = des.Read<uint8_t>();
+				float toY = des.Read<uint8_t>();
+				moves.AddDataRow(eval, fromX, fromY, toX, toY);
+			}
+
+			OTN::OTNObject state{ "BoardState" };
+			state.SetNames("board_state", "moves");
+			state.SetTypes("String", "-");
+			state.AddDataRow(std::move(boardState), std::vector<OTN::OTNObject>{ std::move(moves) });
+			states.push_back(std::move(state));
+		}
+		return states;
+	}
+
+	void ReadIDList(BinaryDeserializer& des, const char* column, OTN::OTNObject& outBody) {
+		uint32_t count = des.Read<uint32_t>();
+		outBody.SetNames(column);
+		outBody.SetTypes("int64");
+		outBody.ReserveDataRows(ClampCount(count, des, MIN_ID_SIZE));
+		for (uint32_t i = 0; i < count; ++i)
+			outBody.AddDataRow(des.Read<int64_t>());
+	}
+
+	void ReadAgents(BinaryDeserializer& des, OTN::OTNObject& outBody) {
+		uint32_t count = des.Read<uint32_t>();
+		outBody.SetNames("server_id", "version", "local_id", "name", "board_states", "config",
+			"matches_played", "matches_won", "matches_played_white", "matches_won_white");
+		outBody.SetTypes("int64", "int64", "int64", "String", "-", "String", "int", "int", "int", "int");
+		outBody.ReserveDataRows(ClampCount(count, des, MIN_AGENT_SIZE));
+
+		for (uint32_t i = 0; i < count; ++i) {
+			int64_t serverID = des.Read<int64_t>();
+			int64_t version = des.Read<int64_t>();
+			int64_t localID = des.Read<int64_t>();
+			std::string name = des.ReadString();
+			std::string config = des.ReadString();
+			int32_t played = des.Read<int32_t>();
+			int32_t won = des.Read<int32_t>();
+			int32_t playedWhite = des.Read<int32_t>();
+			int32_t wonWhite = des.Read<int32_t>();
+			std::vector<OTN::OTNObject> states = ReadStates(des);
+
+			outBody.AddDataRow(serverID, version, localID, std::move(name), std::move(states), std::move(config),
+				static_cast<int>(played), static_cast<int>(won), static_cast<int>(playedWhite), static_cast<int>(wonWhite));
+		}
+	}
+
+	void ReadAgentDeltas(BinaryDeserializer& des, OTN::OTNObject& outBody) {
+		uint32_t count = des.Read<uint32_t>();
+		outBody.SetNames("server_id", "matches_played", "matches_won", "matches_played_white", "matches_won_white", "states");
+		outBody.SetTypes("int64", "int", "int", "int", "int", "-");
+		outBody.ReserveDataRows(ClampCount(count, des, MIN_AGENT_DELTA_SIZE));
+
+		for (uint32_t i = 0; i < count; ++i) {
+			int64_t serverID = des.Read<int64_t>();
+			int32_t played = des.Read<int32_t>();
+			int32_t won = des.Read<int32_t>();
+			int32_t playedWhite = des.Read<int32_t>();
+			int32_t wonWhite = des.Read<int32_t>();
+			std::vector<OTN::OTNObject> states = ReadStates(des);
+
+			outBody.AddDataRow(serverID, static_cast<int>(played), static_cast<int>(won),
+				static_cast<int>(playedWhite), static_cast<int>(wonWhite), std::move(states));
+		}
+	}
+
+}
+
+namespace NetProtocol {
+
+	const NetOpcodeInfo* GetOpcodeInfo(NetOpcode opcode) {
+		size_t index = static_cast<size_t>(opcode);
+		if (opcode == NetOpcode::NONE || index >= OPCODE_INFOS.size())
+			return nullptr;
+		return &OPCODE_INFOS[index];
+	}
+
+	NetOpcode FindOpcode(std::string_view action) {
+		for (size_t i = 1; i < OPCODE_INFOS.size(); ++i) {
+			if (action == OPCODE_INFOS[i].action)
+				return static_cast<NetOpcode>(i);
+		}
+		return NetOpcode::NONE;
+	}
+
+	bool DecodeBody(NetOpcode opcode, std::string_view payload, OTN::OTNObject& outBody, std::string& outError) {
+		const NetOpcodeInfo* info = GetOpcodeInfo(opcode);
+		if (!info) {
+			outError = "Unknown opcode " + std::to_string(static_cast<uint16_t>(opcode));
+			return false;
+		}
+
+		outBody = OTN::OTNObject{ "body" };
+		if (info->format == NetBodyFormat::OTN) {
+			OTN::OTNReader reader;
+			if (!reader.ReadString(payload)) {
+				outError = "Failed to parse OTN: " + reader.GetError();
+				return false;
+			}
+
+			auto& objects = reader.GetObjects();
+			auto bodyIt = objects.find("body");
+			if (bodyIt == objects.end()) {
+				outError = "Failed to extract body of the request";
+				return false;
+			}
+			outBody = std::move(bodyIt->second);
+			return true;
+		}
+
+		try {
+			BinaryDeserializer des(payload);
+			switch (info->format) {
+			case NetBodyFormat::ID_LIST:
+				ReadIDList(des, info->column, outBody);
+				break;
+			case NetBodyFormat::SEQUENCE:
+				outBody.SetNames(info->column);
+				outBody.SetTypes("int64");
+				outBody.AddDataRow(des.Read<int64_t>());
+				break;
+			case NetBodyFormat::AGENTS:
+				ReadAgents(des, outBody);
+				break;
+			case NetBodyFormat::AGENT_DELTAS:
+				ReadAgentDeltas(des, outBody);
+				break;
+			default:
+				break;
+			}
+
+			if (!des.IsAtEnd()) {
+				outError = std::string("Body of ") + info->action + " has " + std::to_string(des.Remaining()) + " bytes after the last field";
+				return false;
+			}
+		}
+		catch (const std::runtime_error& e) {
+			outError = std::string("Body of ") + info->action + " is truncated: " + e.what();
+			return false;
+		}
+
+		return true;
+	}
+
+	std::string EncodeIDList(const OTN::OTNObject& obj, const std::string& column) {
+		BinarySerializer ser;
+		size_t rowCount = obj.GetRowCount();
+		ser.AddField(static_cast<uint32_t>(rowCount));
+		for (size_t row = 0; row < rowCount; ++row)
+			ser.AddField(obj.TryGetValue<int64_t>(row, column).value_or(0));
+
+		std::vector<uint8_t> buffer = ser.ToBuffer();
+		return std::string(buffer.begin(), buffer.end());
+	}
+
+}
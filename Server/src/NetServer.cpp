@@ -40,18 +40,23 @@ void NetServer::Run() {
 
 	m_running = true;
 
-	while (m_running) {
-		{
-			std::lock_guard<std::mutex> guard(m_serverMsgMutex);
-			while (!m_serverMsgQueue.empty()) {
-				auto& [serverName, msg] = m_serverMsgQueue.front();
+	m_serverMessages.Open();
+	m_serverMessageThread = std::thread(&NetServer::ServerMessageLoop, this);
 
-				if (m_logic)
-					m_logic->OnServerMessageExternal(serverName, msg);
-				m_serverMsgQueue.pop();
-			}
-		}
+	if (m_ioMode == NetIOMode::EVENT_LOOP) {
+		RunEventLoop();
+	}
+	else {
+		RunThreadPerClient();
+	}
 
+	m_serverMessages.Close();
+	if (m_serverMessageThread.joinable())
+		m_serverMessageThread.join();
+}
+
+void NetServer::RunThreadPerClient() {
+	while (m_running) {
 		if (m_logic)
 			m_logic->OnRunExternal();
 
@@ -65,6 +70,22 @@ void NetServer::Run() {
 	}
 }
 
+void NetServer::SetIOMode(NetIOMode mode) {
+	if (m_running) {
+		std::cerr << "Failed to change io mode of running server '" << m_name << "'!\n";
+		return;
+	}
+	m_ioMode = mode;
+}
+
+void NetServer::SetWorkerCount(uint32_t count) {
+	m_workerCount = count;
+}
+
+void NetServer::SetMaxQueuedTasks(size_t count) {
+	m_maxQueuedTasks = count;
+}
+
 bool NetServer::IsInitialized() const {
 	return m_isInitialized;
 }
@@ -81,11 +102,156 @@ uint16_t NetServer::GetPort() const {
 	return m_port;
 }
 
+NetIOMode NetServer::GetIOMode() const {
+	return m_ioMode;
+}
+
 NetServer::NetServer(const std::string& name) 
-	: m_name(name) {
+	: m_name(name),
+	m_connectionsGauge(ServerMetrics::GetGauge("chesslite_connections", ServerMetrics::Label("server", name))),
+	m_acceptedCounter(ServerMetrics::GetCounter("chesslite_connections_accepted_total", ServerMetrics::Label("server", name))),
+	m_receivedBytesCounter(ServerMetrics::GetCounter("chesslite_received_bytes_total", ServerMetrics::Label("server", name))),
+	m_clientQueueWait(ServerMetrics::GetHistogram("chesslite_queue_wait_seconds",
+		ServerMetrics::Label("server", name) + "," + ServerMetrics::Label("queue", "client"))),
+	m_serverMessageQueueWait(ServerMetrics::GetHistogram("chesslite_queue_wait_seconds",
+		ServerMetrics::Label("server", name) + "," + ServerMetrics::Label("queue", "server_message"))) {
+}
+
+void NetServer::ServerMessageLoop() {
+	ServerMessage msg;
+	while (m_serverMessages.WaitPop(msg)) {
+		m_serverMessageQueueWait.Record(std::chrono::steady_clock::now() - msg.sentAt);
+		if (m_logic)
+			m_logic->OnServerMessageExternal(msg);
+		msg = ServerMessage{};
+	}
+}
+
+void NetServer::RunEventLoop() {
+	m_workerPool.Start(m_workerCount, m_maxQueuedTasks);
+
+	std::vector<void*> waitables;
+	while (m_running) {
+		if (m_logic)
+			m_logic->OnRunExternal();
+
+		// a client whose worker is full is not waited on, the loop checks it again after the timeout
+		waitables.clear();
+		waitables.reserve(m_clients.size() + 1);
+		waitables.push_back(m_server);
+		for (auto* client : m_clients) {
+			if (m_workerPool.HasQueueSpace(GetClientKey(client)))
+				waitables.push_back(client);
+		}
+
+		// sleeps until a client connects, sends data or the timeout is reached
+		int ready = NET_WaitUntilInputAvailable(waitables.data(), static_cast<int>(waitables.size()), EVENT_LOOP_TIMEOUT_MS);
+		if (ready < 0) {
+			std::cerr << "Server '" << m_name << "' failed to wait for input: " << SDL_GetError() << "\n";
+			SDL_Delay(EVENT_LOOP_TIMEOUT_MS);
+			continue;
+		}
+
+		if (ready == 0)
+			continue;
+
+		AcceptClients();
+		ReadClients();
+	}
+
+	for (auto* client : m_clients)
+		DisconnectClient(client);
+	m_clients.clear();
+
+	// runs the remaining messages and disconnects
+	m_workerPool.Stop();
+}
+
+void NetServer::AcceptClients() {
+	NET_StreamSocket* client = nullptr;
+	while ((client = WaitForClient()) != nullptr) {
+		m_clients.push_back(client);
+		m_connectionsGauge.fetch_add(1, std::memory_order_relaxed);
+		m_acceptedCounter.fetch_add(1, std::memory_order_relaxed);
+
+		// one task per connection, it does not wait for a full worker
+		m_workerPool.Submit(GetClientKey(client), [this, client]() {
+			if (m_logic)
+				m_logic->OnClientConnectedExternal(client);
+		}, false);
+	}
+}
+
+void NetServer::ReadClients() {
+	char buffer[4096];
+
+	for (size_t i = 0; i < m_clients.size();) {
+		NET_StreamSocket* client = m_clients[i];
+
+		// the loop never blocks on a slow worker, the unread bytes stay in the socket
+		// and tcp flow control slows down the clients of that worker only
+		if (!m_workerPool.HasQueueSpace(GetClientKey(client))) {
+			++i;
+			continue;
+		}
+
+		std::string msg;
+		int received = 0;
+		while (msg.size() < MAX_READ_PER_WAKE) {
+			received = NET_ReadFromStreamSocket(client, buffer, sizeof(buffer));
+			if (received <= 0)
+				break;
+			msg.append(buffer, received);
+		}
+
+		if (!msg.empty()) {
+			m_receivedBytesCounter.fetch_add(msg.size(), std::memory_order_relaxed);
+			auto queuedAt = std::chrono::steady_clock::now();
+			m_workerPool.Submit(GetClientKey(client), [this, client, queuedAt, msg = std::move(msg)]() {
+				m_clientQueueWait.Record(std::chrono::steady_clock::now() - queuedAt);
+				if (m_logic)
+					m_logic->OnMessageExternal(client, msg);
+			});
+		}
+
+		if (received < 0) {
+			DisconnectClient(client);
+			m_clients[i] = m_clients.back();
+			m_clients.pop_back();
+			continue;
+		}
+
+		++i;
+	}
+}
+
+void NetServer::DisconnectClient(NET_StreamSocket* client) {
+	m_connectionsGauge.fetch_sub(1, std::memory_order_relaxed);
+
+	// queued behind the messages of the client, the socket is destroyed after the last one was handled
+	auto disconnect = [this, client]() {
+		if (m_logic)
+			m_logic->OnClientDisconnectedExternal(client);
+		NET_DestroyStreamSocket(client);
+	};
+
+	if (!m_workerPool.Submit(GetClientKey(client), disconnect, false))
+		disconnect();
+}
+
+size_t NetServer::GetClientKey(const NET_StreamSocket* client) {
+	// pointers are aligned, mix the bits so the clients spread over all workers
+	uint64_t value = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(client));
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdULL;
+	value ^= value >> 33;
+	return static_cast<size_t>(value);
 }
 
 void NetServer::HandleClient(NET_StreamSocket* client) const {
+	m_connectionsGauge.fetch_add(1, std::memory_order_relaxed);
+	m_acceptedCounter.fetch_add(1, std::memory_order_relaxed);
+
 	if (m_logic)
 		m_logic->OnClientConnectedExternal(client);
 
@@ -94,6 +260,7 @@ void NetServer::HandleClient(NET_StreamSocket* client) const {
 		int received = NET_ReadFromStreamSocket(client, buffer, sizeof(buffer));
 
 		if (received > 0) {
+			m_receivedBytesCounter.fetch_add(static_cast<uint64_t>(received), std::memory_order_relaxed);
 			std::string msg(buffer, received);
 			// std::cout << "[" << m_name << "] Received: " << msg << "\n";
 
@@ -113,6 +280,7 @@ void NetServer::HandleClient(NET_StreamSocket* client) const {
 		m_logic->OnClientDisconnectedExternal(client);
 
 	NET_DestroyStreamSocket(client);
+	m_connectionsGauge.fetch_sub(1, std::memory_order_relaxed);
 }
 
 NET_StreamSocket* NetServer::WaitForClient() {
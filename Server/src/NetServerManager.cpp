@@ -25,7 +25,7 @@ bool NetServerManager::DestroyServer(NetServer* server) {
 	return true;
 }
 
-void NetServerManager::SendMessage(const NetServer* srcServer, const std::string& dstServerName, const std::string& msg) {
+void NetServerManager::SendMessage(const NetServer* srcServer, const std::string& dstServerName, ServerMessage&& msg) {
 	if (!srcServer) {
 		std::cerr << "NetServerManager: Failed to Send server message, src server was nullptr!";
 		return;
@@ -34,19 +34,9 @@ void NetServerManager::SendMessage(const NetServer* srcServer, const std::string
 	for (auto* s : m_serverList) {
 		if (s->GetName() == dstServerName) {
 			if (s->IsInitialized()) {
-				std::lock_guard<std::mutex> guard(s->m_serverMsgMutex);
-				s->m_serverMsgQueue.emplace(srcServer->GetName(), msg);
-			}
-			break;
-		}
-	}
-}
-
-void NetServerManager::SendMessage(const std::string& srcServer, const std::string& dstServerName, const std::string& msg) {
-	for (auto* s : m_serverList) {
-		if (s->GetName() == dstServerName) {
-			if (s->IsInitialized()) {
-				s->m_logic->OnServerMessageExternal(srcServer, msg);
+				msg.source = srcServer->GetName();
+				msg.sentAt = std::chrono::steady_clock::now();
+				s->m_serverMessages.Push(std::move(msg));
 			}
 			break;
 		}
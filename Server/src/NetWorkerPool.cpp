@@ -0,0 +1,103 @@
+#include "NetWorkerPool.h"
+
+#include <algorithm>
+
+NetWorkerPool::~NetWorkerPool() {
+	Stop();
+}
+
+void NetWorkerPool::Start(uint32_t workerCount, size_t maxQueuedTasks) {
+	Stop();
+
+	if (workerCount == 0)
+		workerCount = std::max(1u, std::thread::hardware_concurrency());
+
+	m_maxQueuedTasks = std::max<size_t>(1, maxQueuedTasks);
+	m_workers.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; ++i) {
+		auto worker = std::make_unique<Worker>();
+		Worker* ptr = worker.get();
+		worker->thread = std::thread([ptr]() {
+			WorkerLoop(*ptr);
+		});
+		m_workers.push_back(std::move(worker));
+	}
+}
+
+void NetWorkerPool::Stop() {
+	for (auto& worker : m_workers) {
+		{
+			std::lock_guard<std::mutex> guard(worker->mutex);
+			worker->stop = true;
+		}
+		worker->taskCV.notify_all();
+		worker->spaceCV.notify_all();
+	}
+
+	for (auto& worker : m_workers) {
+		if (worker->thread.joinable())
+			worker->thread.join();
+	}
+
+	m_workers.clear();
+}
+
+bool NetWorkerPool::Submit(size_t key, Task&& task, bool bounded) {
+	if (m_workers.empty())
+		return false;
+
+	Worker& worker = *m_workers[key % m_workers.size()];
+	{
+		std::unique_lock<std::mutex> lock(worker.mutex);
+		worker.spaceCV.wait(lock, [&]() {
+			return worker.stop || !bounded || worker.tasks.size() < m_maxQueuedTasks;
+		});
+
+		if (worker.stop)
+			return false;
+
+		worker.tasks.push_back(std::move(task));
+	}
+	worker.taskCV.notify_one();
+	return true;
+}
+
+bool NetWorkerPool::HasQueueSpace(size_t key) {
+	if (m_workers.empty())
+		return false;
+
+	Worker& worker = *m_workers[key % m_workers.size()];
+	std::lock_guard<std::mutex> guard(worker.mutex);
+	return worker.tasks.size() < m_maxQueuedTasks;
+}
+
+bool NetWorkerPool::IsRunning() const {
+	return !m_workers.empty();
+}
+
+uint32_t NetWorkerPool::GetWorkerCount() const {
+	return static_cast<uint32_t>(m_workers.size());
+}
+
+void NetWorkerPool::WorkerLoop(Worker& worker) {
+	while (true) {
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(worker.mutex);
+			worker.taskCV.wait(lock, [&]() {
+				return worker.stop || !worker.tasks.empty();
+			});
+
+			// queued tasks are still run on stop, they may release sockets
+			if (worker.tasks.empty())
+				return;
+
+			task = std::move(worker.tasks.front());
+			worker.tasks.pop_front();
+		}
+		worker.spaceCV.notify_one();
+
+		if (task)
+			task();
+	}
+}
\ No newline at end of file
@@ -2,6 +2,14 @@
 #include <functional>
 #include <unordered_map>
 #include <cassert>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <condition_variable>
+#include <cstring>
+#include <streambuf>
 #include "OTNFile.h"
 
 namespace OTN {
@@ -10,6 +18,100 @@ namespace OTN {
 		seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
 	}
 
+	/*
+	* Workers of the parallel write, started once and shared by every writer.
+	* A write hands its chunk loop to the pool and helps with it on the calling thread.
+	*/
+	class ParallelWritePool {
+	public:
+		static ParallelWritePool& Get() {
+			static ParallelWritePool pool;
+			return pool;
+		}
+
+		~ParallelWritePool() {
+			{
+				std::lock_guard lock(m_mutex);
+				m_stop = true;
+			}
+			m_cv.notify_all();
+			for (auto& t : m_threads)
+				t.join();
+		}
+
+		ParallelWritePool(const ParallelWritePool&) = delete;
+		ParallelWritePool& operator=(const ParallelWritePool&) = delete;
+
+		uint32_t GetThreadCount() const {
+			return static_cast<uint32_t>(m_threads.size());
+		}
+
+		/*< calls task on helpers pool workers and on the calling thread, returns once every call returned */
+		void Run(uint32_t helpers, const std::function<void()>& task) {
+			helpers = std::min(helpers, GetThreadCount());
+			if (helpers == 0) {
+				task();
+				return;
+			}
+
+			Job job;
+			job.task = &task;
+			job.remaining = helpers;
+			{
+				std::lock_guard lock(m_mutex);
+				for (uint32_t i = 0; i < helpers; ++i)
+					m_jobs.push_back(&job);
+			}
+			m_cv.notify_all();
+
+			task();
+
+			std::unique_lock lock(m_mutex);
+			job.done.wait(lock, [&]() { return job.remaining == 0; });
+		}
+
+	private:
+		struct Job {
+			const std::function<void()>* task = nullptr;
+			uint32_t remaining = 0;
+			std::condition_variable done;
+		};
+
+		std::mutex m_mutex;
+		std::condition_variable m_cv;
+		std::deque<Job*> m_jobs;
+		std::vector<std::thread> m_threads;
+		bool m_stop = false;
+
+		ParallelWritePool() {
+			// the calling thread is the last worker
+			uint32_t count = std::thread::hardware_concurrency();
+			count = (count > 1) ? count - 1 : 1;
+			m_threads.reserve(count);
+			for (uint32_t i = 0; i < count; ++i)
+				m_threads.emplace_back(&ParallelWritePool::WorkerLoop, this);
+		}
+
+		void WorkerLoop() {
+			std::unique_lock lock(m_mutex);
+			while (true) {
+				m_cv.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+				if (m_stop)
+					return;
+
+				Job* job = m_jobs.front();
+				m_jobs.pop_front();
+
+				lock.unlock();
+				(*job->task)();
+				lock.lock();
+
+				if (--job->remaining == 0)
+					job->done.notify_all();
+			}
+		}
+	};
+
 	// returns OTNBasType or UNKNOWN
 	OTNBaseType StringToOTNBaseType(const std::string& type) {
 		namespace SynTypes = Syntax::Types;
@@ -329,6 +431,19 @@ namespace OTN {
 		return *this;
 	}
 
+	OTNObject& OTNObject::AppendRows(OTNObject&& other) {
+		if (other.m_columnNames != m_columnNames) {
+			AddError("AppendRows called with object '" + other.m_name + "' that has different columns than '" + m_name + "'!");
+			return *this;
+		}
+
+		m_dataRows.reserve(m_dataRows.size() + other.m_dataRows.size());
+		for (auto& row : other.m_dataRows)
+			m_dataRows.emplace_back(std::move(row));
+		other.m_dataRows.clear();
+		return *this;
+	}
+
 	OTNObject& OTNObject::ReserveDataRows(size_t amount) {
 		m_dataRows.reserve(amount);
 		return *this;
@@ -760,6 +875,301 @@ namespace OTN {
 
 	#pragma endregion
 
+	#pragma region OTNCompression
+
+	// Seed for the match window of every compressed body, changing it requires a new COMPRESSED_VERSION
+	static constexpr std::string_view COMPRESSION_DICTIONARY =
+		"@version: 1;\n@defType: \n@defName: \n@object: {\n\t"
+		"int/, int64/, uint64/, float/, double/, bool/, String/, Ref<>[], [], "
+		"true, false, 0.0, 1.0, -1, \"\";\n\t};\n";
+
+	static constexpr size_t LZ_MIN_MATCH = 4;
+	static constexpr size_t LZ_MAX_OFFSET = 65535;
+	static constexpr uint32_t LZ_HASH_BITS = 16;
+	static constexpr uint32_t LZ_MAX_CHAIN = 32;
+	static constexpr size_t LZ_GOOD_MATCH = 64;// < stop searching the chain once a match is this long
+	static constexpr uint64_t LZ_MAX_EXPANSION = 255;// < most bytes one compressed byte can produce (a 255 length byte)
+	static constexpr size_t COMPRESSED_PREFIX_SIZE = 4 + 1 + 4 + 4; // magic, version, body size, header size
+
+	static inline uint32_t LZHash(const char* p) {
+		uint32_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+	}
+
+	static inline void WriteU32LE(std::string& out, uint32_t value) {
+		for (int i = 0; i < 4; ++i)
+			out.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+	}
+
+	static inline uint32_t ReadU32LE(std::string_view data, size_t pos) {
+		uint32_t value = 0;
+		for (int i = 0; i < 4; ++i)
+			value |= static_cast<uint32_t>(static_cast<uint8_t>(data[pos + i])) << (i * 8);
+		return value;
+	}
+
+	static inline void WriteLZLength(std::string& out, size_t length) {
+		while (length >= 255) {
+			out.push_back(static_cast<char>(255));
+			length -= 255;
+		}
+		out.push_back(static_cast<char>(length));
+	}
+
+	static inline bool ReadLZLength(std::string_view in, size_t& pos, size_t& length) {
+		uint8_t b = 0;
+		do {
+			if (pos >= in.size())
+				return false;
+			b = static_cast<uint8_t>(in[pos++]);
+			length += b;
+		} while (b == 255);
+		return true;
+	}
+
+	// token: high nibble literal count, low nibble match length - LZ_MIN_MATCH (15 = extended),
+	// followed by the literals and a 16 bit offset. The last sequence only carries literals.
+	static void LZWriteSequence(std::string& out, const char* literals, size_t literalCount, size_t offset, size_t matchLength) {
+		size_t matchCode = matchLength > 0 ? matchLength - LZ_MIN_MATCH : 0;
+		uint8_t token = static_cast<uint8_t>((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(matchCode, 15));
+		out.push_back(static_cast<char>(token));
+
+		if (literalCount >= 15)
+			WriteLZLength(out, literalCount - 15);
+		out.append(literals, literalCount);
+
+		if (matchLength == 0)
+			return;
+
+		out.push_back(static_cast<char>(offset & 0xFF));
+		out.push_back(static_cast<char>((offset >> 8) & 0xFF));
+		if (matchCode >= 15)
+			WriteLZLength(out, matchCode - 15);
+	}
+
+	static void LZCompress(std::string_view dictionary, std::string_view input, std::string& out) {
+		std::string window;
+		window.reserve(dictionary.size() + input.size());
+		window.append(dictionary);
+		window.append(input);
+
+		const char* data = window.data();
+		const size_t begin = dictionary.size();
+		const size_t end = window.size();
+
+		std::vector<int32_t> head(size_t(1) << LZ_HASH_BITS, -1);
+		std::vector<int32_t> prev(end, -1);
+
+		auto insert = [&](size_t pos) {
+			uint32_t h = LZHash(data + pos);
+			prev[pos] = head[h];
+			head[h] = static_cast<int32_t>(pos);
+		};
+
+		for (size_t i = 0; i + LZ_MIN_MATCH <= begin; ++i)
+			insert(i);
+
+		size_t pos = begin;
+		size_t anchor = begin;
+		while (pos + LZ_MIN_MATCH <= end) {
+			size_t bestLength = 0;
+			size_t bestOffset = 0;
+
+			int32_t candidate = head[LZHash(data + pos)];
+			for (uint32_t chain = 0; candidate >= 0 && chain < LZ_MAX_CHAIN; ++chain) {
+				size_t offset = pos - static_cast<size_t>(candidate);
+				if (offset > LZ_MAX_OFFSET)
+					break;
+
+				size_t length = 0;
+				while (pos + length < end && data[candidate + length] == data[pos + length])
+					++length;
+
+				if (length > bestLength) {
+					bestLength = length;
+					bestOffset = offset;
+					if (length >= LZ_GOOD_MATCH)
+						break;
+				}
+				candidate = prev[candidate];
+			}
+
+			if (bestLength < LZ_MIN_MATCH) {
+				insert(pos);
+				++pos;
+				continue;
+			}
+
+			LZWriteSequence(out, data + anchor, pos - anchor, bestOffset, bestLength);
+
+			size_t matchEnd = pos + bestLength;
+			for (; pos < matchEnd; ++pos) {
+				if (pos + LZ_MIN_MATCH <= end)
+					insert(pos);
+			}
+			anchor = pos;
+		}
+
+		LZWriteSequence(out, data + anchor, end - anchor, 0, 0);
+	}
+
+	static bool LZDecompress(std::string_view dictionary, std::string_view in, size_t rawSize, std::string& out) {
+		std::string window;
+		window.reserve(dictionary.size() + rawSize);
+		window.append(dictionary);
+
+		const size_t limit = dictionary.size() + rawSize;
+		size_t pos = 0;
+		while (pos < in.size()) {
+			uint8_t token = static_cast<uint8_t>(in[pos++]);
+
+			size_t literalCount = token >> 4;
+			if (literalCount == 15 && !ReadLZLength(in, pos, literalCount))
+				return false;
+			if (literalCount > in.size() - pos || window.size() + literalCount > limit)
+				return false;
+
+			window.append(in.data() + pos, literalCount);
+			pos += literalCount;
+
+			// last sequence has no match
+			if (pos == in.size())
+				break;
+
+			if (in.size() - pos < 2)
+				return false;
+			size_t offset = static_cast<uint8_t>(in[pos]) | (static_cast<size_t>(static_cast<uint8_t>(in[pos + 1])) << 8);
+			pos += 2;
+
+			size_t matchLength = token & 0x0F;
+			if (matchLength == 15 && !ReadLZLength(in, pos, matchLength))
+				return false;
+			matchLength += LZ_MIN_MATCH;
+
+			if (offset == 0 || offset > window.size() || window.size() + matchLength > limit)
+				return false;
+
+			// byte wise, the match may overlap with the bytes it produces
+			size_t from = window.size() - offset;
+			for (size_t i = 0; i < matchLength; ++i)
+				window.push_back(window[from + i]);
+		}
+
+		if (window.size() != limit)
+			return false;
+
+		out.append(window, dictionary.size(), rawSize);
+		return true;
+	}
+
+	bool IsCompressedOTN(std::string_view data) {
+		return data.size() >= COMPRESSED_MAGIC.size() && 
+			data.substr(0, COMPRESSED_MAGIC.size()) == COMPRESSED_MAGIC;
+	}
+
+	bool CompressOTN(std::string_view otnText, std::string& outData) {
+		std::string objectKeyword = std::string(1, Syntax::KEYWORD_PREFIX_CHAR) + std::string(Keyword::OBJECT_KW);
+		size_t headerSize = otnText.find(objectKeyword);
+		if (headerSize == std::string_view::npos)
+			headerSize = 0;
+
+		std::string_view header = otnText.substr(0, headerSize);
+		std::string_view body = otnText.substr(headerSize);
+		if (body.size() > UINT32_MAX || header.size() > UINT32_MAX)
+			return false;
+
+		std::string dictionary;
+		dictionary.reserve(COMPRESSION_DICTIONARY.size() + header.size());
+		dictionary.append(COMPRESSION_DICTIONARY);
+		dictionary.append(header);
+
+		outData.clear();
+		outData.reserve(COMPRESSED_PREFIX_SIZE + header.size() + body.size() / 2);
+		outData.append(COMPRESSED_MAGIC);
+		outData.push_back(static_cast<char>(COMPRESSED_VERSION));
+		WriteU32LE(outData, static_cast<uint32_t>(body.size()));
+		WriteU32LE(outData, static_cast<uint32_t>(header.size()));
+		outData.append(header);
+
+		LZCompress(dictionary, body, outData);
+		return true;
+	}
+
+	bool DecompressOTN(std::string_view data, std::string& outText, std::string& outError, size_t maxTextSize) {
+		if (!IsCompressedOTN(data) || data.size() < COMPRESSED_PREFIX_SIZE) {
+			outError = "Data is not a compressed OTN document!";
+			return false;
+		}
+
+		uint8_t version = static_cast<uint8_t>(data[COMPRESSED_MAGIC.size()]);
+		if (version != COMPRESSED_VERSION) {
+			outError = "Unsupported compressed OTN version '" + std::to_string(version) + "'!";
+			return false;
+		}
+
+		uint32_t bodySize = ReadU32LE(data, COMPRESSED_MAGIC.size() + 1);
+		uint32_t headerSize = ReadU32LE(data, COMPRESSED_MAGIC.size() + 5);
+		if (headerSize > data.size() - COMPRESSED_PREFIX_SIZE) {
+			outError = "Compressed OTN header is truncated!";
+			return false;
+		}
+
+		std::string_view header = data.substr(COMPRESSED_PREFIX_SIZE, headerSize);
+		std::string_view block = data.substr(COMPRESSED_PREFIX_SIZE + headerSize);
+
+		// the size comes from the data, nothing is reserved before it is known to be possible and allowed
+		if (static_cast<uint64_t>(bodySize) > static_cast<uint64_t>(block.size()) * LZ_MAX_EXPANSION) {
+			outError = "Compressed OTN body can not expand to " + std::to_string(bodySize) + " bytes!";
+			return false;
+		}
+		if (bodySize > maxTextSize || header.size() > maxTextSize - bodySize) {
+			outError = "Compressed OTN document of " + std::to_string(header.size() + static_cast<size_t>(bodySize)) +
+				" bytes exceeds the limit of " + std::to_string(maxTextSize) + " bytes!";
+			return false;
+		}
+
+		std::string dictionary;
+		dictionary.reserve(COMPRESSION_DICTIONARY.size() + header.size());
+		dictionary.append(COMPRESSION_DICTIONARY);
+		dictionary.append(header);
+
+		outText.clear();
+		outText.reserve(header.size() + bodySize);
+		outText.append(header);
+		if (!LZDecompress(dictionary, block, bodySize, outText)) {
+			outError = "Compressed OTN body is corrupted!";
+			outText.clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	static bool TryLoadCompressedFile(const OTNFilePath& path, std::string& outData) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		char magic[COMPRESSED_MAGIC.size()] = {};
+		file.read(magic, sizeof(magic));
+		if (file.gcount() != static_cast<std::streamsize>(sizeof(magic)) ||
+			!IsCompressedOTN(std::string_view(magic, sizeof(magic))))
+			return false;
+
+		file.seekg(0, std::ios::end);
+		std::streamoff size = file.tellg();
+		file.seekg(0, std::ios::beg);
+		if (size <= 0)
+			return false;
+
+		outData.resize(static_cast<size_t>(size));
+		file.read(outData.data(), size);
+		return file.gcount() == size;
+	}
+
+	#pragma endregion
+
 	#pragma region OTNWriter
 
 	// ======== OTNWriter ========
@@ -783,6 +1193,21 @@ namespace OTN {
 		return *this;
 	}
 
+	OTNWriter& OTNWriter::UseParallelWrite(bool value) {
+		m_useParallelWrite = value;
+		return *this;
+	}
+
+	OTNWriter& OTNWriter::SetWorkerCount(uint32_t count) {
+		m_workerCount = count;
+		return *this;
+	}
+
+	OTNWriter& OTNWriter::UseCompression(bool value) {
+		m_useCompression = value;
+		return *this;
+	}
+
 	OTNWriter& OTNWriter::AppendObject(const OTNObject& object) {
 #ifndef NDEBUG
 		for (const auto& obj : m_objects) {
@@ -839,6 +1264,38 @@ namespace OTN {
 		return true;
 	}
 
+	bool OTNWriter::AppendToFile(const OTNFilePath& path) {
+		if (!IsValid()) {
+			AddError("Writer object is invalid!");
+			return false;
+		}
+
+		OTNFilePath newPath;
+		std::string error;
+		if (!ValidateFilePath(path, CREATE_MISSING_DIR, newPath, error)) {
+			AddError(error);
+			AddError("File path '" + path.string() + "' was invalid!");
+			return false;
+		}
+
+		if (!DebugValidateObjects()) {
+			AddError("[Debug] Validation of objects failed!");
+			return false;
+		}
+
+		if (!WriteToFile(newPath, true)) {
+			AddError("Append to file failed!");
+			return false;
+		}
+
+		if (!IsValid()) {
+			AddError("Writer object is invalid!");
+			return false;
+		}
+
+		return true;
+	}
+
 	bool OTNWriter::SaveToString(std::string& outText) {
 		if (!IsValid()) {
 			AddError("Writer object is invalid!");
@@ -879,6 +1336,18 @@ namespace OTN {
 		return m_useDeduplicateRows;
 	}
 
+	bool OTNWriter::GetUseParallelWrite() const {
+		return m_useParallelWrite;
+	}
+
+	uint32_t OTNWriter::GetWorkerCount() const {
+		return m_workerCount;
+	}
+
+	bool OTNWriter::GetUseCompression() const {
+		return m_useCompression;
+	}
+
 	bool OTNWriter::IsValid() const {
 		return m_valid;
 	}
@@ -1052,16 +1521,36 @@ namespace OTN {
 #endif
 	}
 
-	bool OTNWriter::WriteToFile(const OTNFilePath& path) {
+	bool OTNWriter::WriteToFile(const OTNFilePath& path, bool append) {
+		if (m_useCompression && !append) {
+			std::string data;
+			if (!WriteToString(data))
+				return false;
+
+			std::ofstream file(path, std::ios::binary);
+			if (!file.is_open())
+				return false;
+
+			file.write(data.data(), data.size());
+			return file.good();
+		}
+
 		m_writerData.Reset();
 
+		std::error_code ec;
+		bool hasContent = append && std::filesystem::exists(path, ec) && std::filesystem::file_size(path, ec) > 0;
+
 		auto& stream = m_writerData.stream.stream;
-		stream.open(path, std::ios::binary);
+		stream.open(path, append ? (std::ios::binary | std::ios::app) : std::ios::binary);
 
 		if (!stream.is_open()) {
 			return false;
 		}
 
+		// every appended segment starts on its own line
+		if (hasContent)
+			AddLineBreak(m_writerData.stream);
+
 		if (!CreateWriteData(m_writerData)) {
 			stream.close();
 			return false;
@@ -1098,6 +1587,12 @@ namespace OTN {
 			return false;
 		}
 
+		if (m_useCompression) {
+			bool compressed = CompressOTN(m_writerData.stream.buffer, outText);
+			m_writerData.stream.buffer.clear();
+			return compressed;
+		}
+
 		outText = m_writerData.stream.buffer;
 		m_writerData.stream.buffer.clear();
 		return true;
@@ -1408,127 +1903,227 @@ namespace OTN {
 
 	bool OTNWriter::WriteObjects(BufferedIndentedStream& stream,
 		const std::unordered_map<std::string, SerializedObject>& objects) {
-		const auto& defNameMap = m_writerData.defName;
-		const auto& defTypeMap = m_writerData.defType;
+		if (m_useParallelWrite)
+			return WriteObjectsParallel(stream, objects);
 
-		auto writeNames = [&](const SerializedObject& obj) {
-			std::string out;
-			out.reserve(obj.columnNames.size() * 16);
+		bool firstObj = true;
+		for (const auto& [name, obj] : objects) {
+			if (!WriteObjectHeader(stream, name, obj, firstObj))
+				return false;
+			firstObj = false;
 
-			bool firstName = true;
-			for (size_t i = 0; i < obj.columnNames.size(); ++i) {
-				if (!firstName) {
-					out += Syntax::SEPARATOR_CHAR;
-					AddSpace(out);
-				}
-				firstName = false;
+			if (!WriteObjectRows(stream, obj, 0, obj.rows.size())) {
+				AddError("WriteData: unsupported OTNValueType in object '" + name + "'");
+				return false;
+			}
+		}
 
-				const OTNTypeDesc& colType = obj.columnTypes[i];
+		return true;
+	}
 
-				if (colType.refObjectName.empty()) {
-					const std::string_view baseTypeStr = OTNValueTypeToString(colType.baseType);
+	bool OTNWriter::WriteObjectsParallel(BufferedIndentedStream& stream,
+		const std::unordered_map<std::string, SerializedObject>& objects) {
+		struct RowChunk {
+			const SerializedObject* obj = nullptr;
+			size_t rowBegin = 0;
+			size_t rowEnd = 0;
+			BufferedIndentedStream out;
+			bool valid = true;
+		};
 
-					if (defTypeMap.empty()) {
-						out += baseTypeStr;
-					}
-					else {
-						std::string str(baseTypeStr);
-						auto it = defTypeMap.find(str);
-						if (it != defTypeMap.end()) {
-							out += std::to_string(it->second);
-						}
-						else {
-							out += baseTypeStr;
-						}
-					}
-				}
-				else {
-					AppendRefName(out, colType.refObjectName);
+		// chunks are created in object iteration order, so the output matches the serial write
+		std::vector<std::pair<const std::string*, const SerializedObject*>> orderedObjects;
+		orderedObjects.reserve(objects.size());
+		size_t chunkCount = 0;
+		for (const auto& [name, obj] : objects) {
+			orderedObjects.emplace_back(&name, &obj);
+			chunkCount += (obj.rows.size() + PARALLEL_ROWS_PER_CHUNK - 1) / PARALLEL_ROWS_PER_CHUNK;
+		}
+
+		ParallelWritePool& pool = ParallelWritePool::Get();
+		uint32_t workerCount = (m_workerCount > 0) ? m_workerCount : pool.GetThreadCount() + 1;
+		workerCount = static_cast<uint32_t>(std::min<size_t>(workerCount, chunkCount));
+
+		if (workerCount <= 1) {
+			bool firstObj = true;
+			for (const auto& [name, obj] : orderedObjects) {
+				if (!WriteObjectHeader(stream, *name, *obj, firstObj))
+					return false;
+				firstObj = false;
+
+				if (!WriteObjectRows(stream, *obj, 0, obj->rows.size())) {
+					AddError("WriteData: unsupported OTNValueType in object '" + *name + "'");
+					return false;
 				}
+			}
+			return true;
+		}
+
+		std::vector<RowChunk> chunks(chunkCount);
+		size_t chunkIndex = 0;
+		for (const auto& [name, obj] : orderedObjects) {
+			for (size_t begin = 0; begin < obj->rows.size(); begin += PARALLEL_ROWS_PER_CHUNK) {
+				RowChunk& chunk = chunks[chunkIndex++];
+				chunk.obj = obj;
+				chunk.rowBegin = begin;
+				chunk.rowEnd = std::min(begin + PARALLEL_ROWS_PER_CHUNK, obj->rows.size());
+				chunk.out.indentLevel = stream.indentLevel;
+				chunk.out.indentStr = stream.indentStr;
+			}
+		}
+
+		std::atomic<size_t> nextChunk{ 0 };
+		std::function<void()> worker = [&]() {
+			for (size_t i = nextChunk++; i < chunks.size(); i = nextChunk++) {
+				RowChunk& chunk = chunks[i];
+				chunk.valid = WriteObjectRows(chunk.out, *chunk.obj, chunk.rowBegin, chunk.rowEnd);
+			}
+		};
+		pool.Run(workerCount - 1, worker);
 
-				for (size_t j = 0; j < colType.listDepth; ++j) {
-					out += "[]";
+		chunkIndex = 0;
+		bool firstObj = true;
+		for (const auto& [name, obj] : orderedObjects) {
+			if (!WriteObjectHeader(stream, *name, *obj, firstObj))
+				return false;
+			firstObj = false;
+
+			for (; chunkIndex < chunks.size() && chunks[chunkIndex].obj == obj; ++chunkIndex) {
+				const RowChunk& chunk = chunks[chunkIndex];
+				if (!chunk.valid) {
+					AddError("WriteData: unsupported OTNValueType in object '" + *name + "'");
+					return false;
 				}
+				stream.Append(chunk.out);
+			}
+		}
+
+		return true;
+	}
+
+	bool OTNWriter::WriteObjectHeader(BufferedIndentedStream& stream, 
+		const std::string& name, const SerializedObject& obj, bool firstObj) {
+		if (!firstObj) {
+			AddLineBreak(stream);
+		}
+		stream << name;
+		stream << "[";
+		stream << obj.rows.size();
+		stream << "]";
+		AddSpace(stream);
+		stream << Syntax::BLOCK_BEGIN_CHAR;
+		AddLineBreak(stream);
 
-				out += Syntax::TYPE_SEPARATOR_CHAR;
+		AddIndent(stream);
+		if (obj.columnNames.size() != obj.columnTypes.size()) {
+			AddError("Could not save body Section @Object, size of names(" + 
+				std::to_string(obj.columnNames.size()) 
+				+ ") and types(" + 
+				std::to_string(obj.columnTypes.size()) 
+				+ ") dose not match in object '" + name + "'!");
+			return false;
+		}
 
-				// ---------- NAME ----------
-				const std::string& colName = obj.columnNames[i];
+		std::string names;
+		names.reserve(obj.columnNames.size() * 16);
+		WriteObjectNames(names, obj);
+		stream << names;
 
-				if (defNameMap.empty()) {
-					out += colName;
+		AddLineBreak(stream);
+		stream 
+			<< Syntax::BLOCK_END_CHAR 
+			<< Syntax::STATEMENT_TERMINATOR;
+		AddLineBreak(stream);
+		return true;
+	}
+
+	void OTNWriter::WriteObjectNames(std::string& out, const SerializedObject& obj) const {
+		const auto& defNameMap = m_writerData.defName;
+		const auto& defTypeMap = m_writerData.defType;
+
+		bool firstName = true;
+		for (size_t i = 0; i < obj.columnNames.size(); ++i) {
+			if (!firstName) {
+				out += Syntax::SEPARATOR_CHAR;
+				AddSpace(out);
+			}
+			firstName = false;
+
+			const OTNTypeDesc& colType = obj.columnTypes[i];
+
+			if (colType.refObjectName.empty()) {
+				const std::string_view baseTypeStr = OTNValueTypeToString(colType.baseType);
+
+				if (defTypeMap.empty()) {
+					out += baseTypeStr;
 				}
 				else {
-					auto it = defNameMap.find(colName);
-					if (it != defNameMap.end()) {
+					std::string str(baseTypeStr);
+					auto it = defTypeMap.find(str);
+					if (it != defTypeMap.end()) {
 						out += std::to_string(it->second);
 					}
 					else {
-						out += colName;
+						out += baseTypeStr;
 					}
 				}
 			}
+			else {
+				AppendRefName(out, colType.refObjectName);
+			}
 
-			stream << out;
-		};
-
-		bool firstObj = true;
-		for (const auto& [name, obj] : objects) {
-			if (!firstObj) {
-				AddLineBreak(stream);
+			for (size_t j = 0; j < colType.listDepth; ++j) {
+				out += "[]";
 			}
-			firstObj = false;
-			stream << name;
-			stream << "[";
-			stream << obj.rows.size();
-			stream << "]";
-			AddSpace(stream);
-			stream << Syntax::BLOCK_BEGIN_CHAR;
-			AddLineBreak(stream);
 
-			AddIndent(stream);
-			if (obj.columnNames.size() != obj.columnTypes.size()) {
-				AddError("Could not save body Section @Object, size of names(" + 
-					std::to_string(obj.columnNames.size()) 
-					+ ") and types(" + 
-					std::to_string(obj.columnTypes.size()) 
-					+ ") dose not match in object '" + name + "'!");
-				return false;
+			out += Syntax::TYPE_SEPARATOR_CHAR;
+
+			// ---------- NAME ----------
+			const std::string& colName = obj.columnNames[i];
+
+			if (defNameMap.empty()) {
+				out += colName;
+			}
+			else {
+				auto it = defNameMap.find(colName);
+				if (it != defNameMap.end()) {
+					out += std::to_string(it->second);
+				}
+				else {
+					out += colName;
+				}
 			}
+		}
+	}
 
-			writeNames(obj);
-			AddLineBreak(stream);
-			stream 
-				<< Syntax::BLOCK_END_CHAR 
-				<< Syntax::STATEMENT_TERMINATOR;
-			AddLineBreak(stream);
-			
-			size_t rowLength = (obj.rows.size() > 0) ? obj.rows[0].size() : 0;
-			std::string rowOutStr;
-			rowOutStr.reserve(rowLength * 8);
-			
-			for (const auto& row : obj.rows) {
-				bool first = true;
-				for (const auto& serValue : row) {
-					if (!first) {
-						rowOutStr += Syntax::SEPARATOR_CHAR;
-						AddSpace(rowOutStr);
-					}
-					first = false;
+	bool OTNWriter::WriteObjectRows(BufferedIndentedStream& stream, 
+		const SerializedObject& obj, size_t rowBegin, size_t rowEnd) const {
+		size_t rowLength = (obj.rows.size() > 0) ? obj.rows[0].size() : 0;
+		std::string rowOutStr;
+		rowOutStr.reserve(rowLength * 8);
 
-					WriteOTNValueData(rowOutStr, serValue);
+		for (size_t r = rowBegin; r < rowEnd; ++r) {
+			bool first = true;
+			for (const auto& serValue : obj.rows[r]) {
+				if (!first) {
+					rowOutStr += Syntax::SEPARATOR_CHAR;
+					AddSpace(rowOutStr);
 				}
-				rowOutStr += Syntax::STATEMENT_TERMINATOR;
-				stream << rowOutStr;
-				AddLineBreak(stream);
-				rowOutStr.clear();
+				first = false;
+
+				if (!WriteOTNValueData(rowOutStr, serValue))
+					return false;
 			}
+			rowOutStr += Syntax::STATEMENT_TERMINATOR;
+			stream << rowOutStr;
+			AddLineBreak(stream);
+			rowOutStr.clear();
 		}
 
 		return true;
 	}
 
-	void OTNWriter::WriteOTNValueData(std::string& outStr, const OTNValue& data) {
+	bool OTNWriter::WriteOTNValueData(std::string& outStr, const OTNValue& data) const {
 		switch (data.type) {
 		case OTNBaseType::INT:
 			WriteData(outStr, std::get<int>(data.value));
@@ -1562,7 +2157,8 @@ namespace OTN {
 						AddSpace(outStr);
 					}
 					first = false;
-					WriteOTNValueData(outStr, val);
+					if (!WriteOTNValueData(outStr, val))
+						return false;
 				}
 			}
 			outStr += Syntax::LIST_END_CHAR;
@@ -1571,16 +2167,17 @@ namespace OTN {
 		case OTNBaseType::OBJECT:
 		case OTNBaseType::UNKNOWN:
 		default:
-			AddError("WriteData: unsupported OTNValueType");
 #ifndef NDEBUG
 			assert(false && "WriteData: unsupported OTNValueType");
 #endif
-			break;
+			return false;
 		}
+
+		return true;
 	}
 
 	template<typename T>
-	void OTNWriter::WriteData(std::string& outStr, const T& data) {
+	void OTNWriter::WriteData(std::string& outStr, const T& data) const {
 		using DT = std::decay_t<T>;
 
 		if constexpr (std::is_same_v<DT, int>) {
@@ -1649,6 +2246,18 @@ namespace OTN {
 
 	#pragma region OTNReader
 
+	/*
+	* Read-only stream buffer over existing memory, lets the tokenizer read a string_view
+	* without copying it into a std::istringstream first.
+	*/
+	class OTNViewStreamBuf : public std::streambuf {
+	public:
+		explicit OTNViewStreamBuf(std::string_view data) {
+			char* begin = const_cast<char*>(data.data());
+			setg(begin, begin, begin + data.size());
+		}
+	};
+
 	// ======== OTNReader ========
 	bool OTNReader::ReadFile(const OTNFilePath& path) {
 		if (!IsValid()) {
@@ -1664,7 +2273,12 @@ namespace OTN {
 			return false;
 		}
 
+		std::string compressed;
+		if (TryLoadCompressedFile(newPath, compressed))
+			return ReadString(compressed);
+
 		m_readerData.Reset();
+		m_readStats = ReadStats{};
 		if (!OpenFileStream(newPath)) {
 			AddError("Could not open file stream!");
 			return false;
@@ -1678,14 +2292,141 @@ namespace OTN {
 		return true;
 	}
 
-	bool OTNReader::ReadString(const std::string& fileString) {
+	bool OTNReader::ReadSegments(const OTNFilePath& path) {
+		if (!IsValid()) {
+			AddError("Reader object is invalid!");
+			return false;
+		}
+
+		OTNFilePath newPath;
+		std::string error;
+		if (!ValidateFilePath(path, !CREATE_MISSING_DIR, newPath, error)) {
+			AddError(error);
+			AddError("File path was invalid!");
+			return false;
+		}
+
+		m_readerData.Reset();
+		m_segments.clear();
+		m_segmentsValidSize = 0;
+		m_readStats = ReadStats{};
+		if (!OpenFileStream(newPath)) {
+			AddError("Could not open file stream!");
+			return false;
+		}
+
+		return ReadSegmentsData(m_readerData.stream);
+	}
+
+	bool OTNReader::ReadSegmentsString(std::string_view text) {
+		if (!IsValid()) {
+			AddError("Reader object is invalid!");
+			return false;
+		}
+
+		m_readerData.Reset();
+		m_segments.clear();
+		m_segmentsValidSize = 0;
+		m_readStats = ReadStats{};
+
+		OTNViewStreamBuf buffer(text);
+		std::istream stream(&buffer);
+		return ReadSegmentsData(stream);
+	}
+
+	bool OTNReader::ReadSegmentsData(std::istream& input) {
+		OTNTokenizer tokenizer{ input };
+		auto start = std::chrono::steady_clock::now();
+		// a failed tokenize can only be a torn last segment, everything before it is still usable
+		bool complete = tokenizer.Tokenize();
+		const auto& tokens = tokenizer.GetTokens();
+		m_readStats.tokenizeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		m_readStats.tokenCount += tokens.size();
+
+		std::vector<size_t> segmentStarts;
+		for (size_t i = 0; i + 1 < tokens.size(); ++i) {
+			if (tokens[i].type == TokenType::KEYWORD_PREFIX &&
+				tokens[i + 1].type == TokenType::IDENTIFIER &&
+				tokens[i + 1].text == Keyword::VERSION_KW) {
+				segmentStarts.push_back(i);
+			}
+		}
+
+		if (segmentStarts.empty() || segmentStarts.front() != 0) {
+			if (!complete)
+				AddError(tokenizer.GetError());
+			AddError("Could not determine file version!");
+			return false;
+		}
+
+		// the tokenizer closes a complete stream with an END_OF_FILE token
+		size_t tokenEnd = complete ? tokens.size() - 1 : tokens.size();
+		m_segments.reserve(segmentStarts.size());
+
+		for (size_t s = 0; s < segmentStarts.size(); ++s) {
+			bool isLast = (s + 1 == segmentStarts.size());
+			size_t begin = segmentStarts[s];
+			// a torn segment ends the valid part right before its version keyword prefix
+			size_t segmentOffset = tokens[begin].offset - 1;
+			if (isLast && !complete) {
+				m_segmentsValidSize = segmentOffset;
+				return true;
+			}
+
+			size_t end = isLast ? tokenEnd : segmentStarts[s + 1];
+
+			std::vector<Token> segmentTokens(tokens.begin() + begin, tokens.begin() + end);
+			segmentTokens.emplace_back(TokenType::END_OF_FILE, "", 0, 0);
+
+			ReaderData segmentData;
+			std::string segmentError;
+			if (!ParseTokens(segmentTokens, segmentData, segmentError)) {
+				if (isLast) {
+					m_segmentsValidSize = segmentOffset;
+					return true;
+				}
+
+				AddError(segmentError);
+				AddError("Segment " + std::to_string(s) + " could not be read!");
+				return false;
+			}
+
+			m_segments.push_back(std::move(segmentData.objects));
+		}
+
+		m_segmentsValidSize = tokenizer.GetReadSize();
+		return true;
+	}
+
+	bool OTNReader::ReadString(std::string_view fileString) {
 		if (!IsValid()) {
 			AddError("Reader object is invalid!");
 			return false;
 		}
 
 		m_readerData.Reset();
-		std::istringstream stream(fileString);
+		m_readStats = ReadStats{};
+
+		if (IsCompressedOTN(fileString)) {
+			std::string text;
+			std::string error;
+			if (!DecompressOTN(fileString, text, error)) {
+				AddError(error);
+				AddError("Data could not be read!");
+				return false;
+			}
+
+			OTNViewStreamBuf buffer(text);
+			std::istream stream(&buffer);
+			if (!ReadData(stream, m_readerData)) {
+				AddError("Data could not be read!");
+				return false;
+			}
+			return true;
+		}
+
+		OTNViewStreamBuf buffer(fileString);
+		std::istream stream(&buffer);
 
 		if (!ReadData(stream, m_readerData)) {
 			AddError("Data could not be read!");
@@ -1715,6 +2456,22 @@ namespace OTN {
 		return m_readerData.objects;
 	}
 
+	const std::vector<std::unordered_map<std::string, OTNObject>>& OTNReader::GetSegments() const {
+		return m_segments;
+	}
+
+	size_t OTNReader::GetSegmentsValidSize() const {
+		return m_segmentsValidSize;
+	}
+
+	std::vector<std::unordered_map<std::string, OTNObject>>& OTNReader::GetSegments() {
+		return m_segments;
+	}
+
+	const OTNReader::ReadStats& OTNReader::GetReadStats() const {
+		return m_readStats;
+	}
+
 	bool OTNReader::IsValid() const {
 		return m_valid;
 	}
@@ -1750,6 +2507,10 @@ namespace OTN {
 		return m_error;
 	}
 
+	size_t OTNReader::OTNTokenizer::GetReadSize() const {
+		return m_offset;
+	}
+
 	bool OTNReader::OTNTokenizer::ProcessChar(char c) {
 		Advance(c);
 
@@ -1818,12 +2579,14 @@ namespace OTN {
 			else if (std::isdigit(static_cast<unsigned char>(c))) {
 				m_stream.unget();
 				m_column--;
+				m_offset--;
 				if (!ReadNumber())
 					return false;
 			}
 			else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
 				m_stream.unget();
 				m_column--;
+				m_offset--;
 				if (!ReadIdentifier())
 					return false;
 			}
@@ -1853,6 +2616,7 @@ namespace OTN {
 		uint32_t column) 
 	{
 		m_tokens.emplace_back(type, text, line, column);
+		m_tokens.back().offset = m_offset;
 		return true;
 	}
 
@@ -1979,6 +2743,7 @@ namespace OTN {
 	}
 
 	void OTNReader::OTNTokenizer::Advance(char c) {
+		m_offset++;
 		if (c == '\n') {
 			m_line++;
 			m_column = 1;
@@ -1998,6 +2763,10 @@ namespace OTN {
 	#pragma region ReaderV_Num
 
 	bool OTNReader::OTNReaderV1::Read() {
+		return Parse() && Resolve();
+	}
+
+	bool OTNReader::OTNReaderV1::Parse() {
 		while (!IsAtEnd()) {
 			if (!IsValid())
 				return false;
@@ -2006,12 +2775,13 @@ namespace OTN {
 				return false;
 		}
 
-		if (!ResolveOTNObjectRefs())
-			return false;
-
 		return true;
 	}
 
+	bool OTNReader::OTNReaderV1::Resolve() {
+		return ResolveOTNObjectRefs();
+	}
+
 	std::string OTNReader::OTNReaderV1::GetError() const {
 		return m_error;
 	}
@@ -2723,37 +3493,61 @@ namespace OTN {
 
 	bool OTNReader::OpenFileStream(const OTNFilePath& path) {
 		auto& stream = m_readerData.stream;
-		stream.open(path, std::ios::in);
+		// binary like the writer, GetSegmentsValidSize has to count the bytes of the file
+		stream.open(path, std::ios::in | std::ios::binary);
 		return stream.is_open();
 	}
 
 	bool OTNReader::ReadData(std::istream& input, ReaderData& data) {
 		OTNTokenizer tokenizer{ input };
 
-		if (!tokenizer.Tokenize()) {
+		auto start = std::chrono::steady_clock::now();
+		bool tokenized = tokenizer.Tokenize();
+		m_readStats.tokenizeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		m_readStats.tokenCount += tokenizer.GetTokens().size();
+
+		if (!tokenized) {
 			AddError("Failed to convert data to tokens!");
 			AddError(tokenizer.GetError());
 			return false;
 		}
 
-		auto& tokens = tokenizer.GetTokens();
+		std::string error;
+		if (!ParseTokens(tokenizer.GetTokens(), data, error)) {
+			AddError(error);
+			return false;
+		}
+
+		return true;
+	}
+
+	bool OTNReader::ParseTokens(const std::vector<Token>& tokens, ReaderData& data, std::string& outError) {
 		if (!SetDataVersion(tokens, data)) {
-			AddError("Could not determine file version!");
+			outError = "Could not determine file version!";
 			return false;
 		}
 
 		switch (data.version) {
 		case 1: {
 			OTNReaderV1 reader{ data, tokens };
-			if (!reader.Read()) {
-				AddError("Failed to read Tokens!");
-				AddError(reader.GetError());
+
+			auto start = std::chrono::steady_clock::now();
+			bool parsed = reader.Parse();
+			auto parsedTime = std::chrono::steady_clock::now();
+			bool resolved = parsed && reader.Resolve();
+			auto resolvedTime = std::chrono::steady_clock::now();
+
+			m_readStats.parseMs += std::chrono::duration<double, std::milli>(parsedTime - start).count();
+			m_readStats.resolveMs += std::chrono::duration<double, std::milli>(resolvedTime - parsedTime).count();
+
+			if (!resolved) {
+				outError = "Failed to read Tokens!\n" + reader.GetError();
 				return false;
 			}
 			break;
 		}
 		default:
-			AddError("Unsupported OTN version: " + std::to_string(data.version) +  "!");
+			outError = "Unsupported OTN version: " + std::to_string(data.version) + "!";
 			return false;
 		}
 
@@ -0,0 +1,203 @@
+#include "SQLConnectionPool.h"
+
+#include <iostream>
+#include <algorithm>
+#include <mysql/jdbc.h>
+
+SQLStatementCache::~SQLStatementCache() {
+	Clear();
+}
+
+sql::PreparedStatement* SQLStatementCache::Prepare(sql::Connection& conn, const std::string& query) {
+	auto it = m_statements.find(query);
+	if (it != m_statements.end()) {
+		m_hits++;
+		return it->second.get();
+	}
+
+	m_misses++;
+	if (m_statements.size() >= MAX_STATEMENTS)
+		Clear();
+
+	std::unique_ptr<sql::PreparedStatement> stmt(conn.prepareStatement(query));
+	sql::PreparedStatement* result = stmt.get();
+	m_statements.emplace(query, std::move(stmt));
+	return result;
+}
+
+void SQLStatementCache::Clear() {
+	m_statements.clear();
+}
+
+uint64_t SQLStatementCache::GetHits() const {
+	return m_hits;
+}
+
+uint64_t SQLStatementCache::GetMisses() const {
+	return m_misses;
+}
+
+size_t SQLStatementCache::GetSize() const {
+	return m_statements.size();
+}
+
+SQLConnectionPool::Lease::Lease(SQLConnectionPool* pool, SQLPooledConnection* conn)
+	: m_pool(pool), m_conn(conn) {
+}
+
+SQLConnectionPool::Lease::~Lease() {
+	Release();
+}
+
+SQLConnectionPool::Lease::Lease(Lease&& other) noexcept
+	: m_pool(other.m_pool), m_conn(other.m_conn) {
+	other.m_pool = nullptr;
+	other.m_conn = nullptr;
+}
+
+SQLConnectionPool::Lease& SQLConnectionPool::Lease::operator=(Lease&& other) noexcept {
+	if (this != &other) {
+		Release();
+		m_pool = other.m_pool;
+		m_conn = other.m_conn;
+		other.m_pool = nullptr;
+		other.m_conn = nullptr;
+	}
+	return *this;
+}
+
+SQLPooledConnection* SQLConnectionPool::Lease::Get() const {
+	return m_conn;
+}
+
+SQLConnectionPool::Lease::operator bool() const {
+	return m_conn != nullptr;
+}
+
+void SQLConnectionPool::Lease::Release() {
+	if (m_pool && m_conn)
+		m_pool->Return(m_conn);
+	m_pool = nullptr;
+	m_conn = nullptr;
+}
+
+SQLConnectionPool::~SQLConnectionPool() {
+	Close();
+}
+
+bool SQLConnectionPool::Open(const DBConfig& config) {
+	Close();
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_config = config;
+
+	uint32_t size = std::max(1u, config.poolSize);
+	for (uint32_t i = 0; i < size; ++i) {
+		auto conn = Connect(m_config);
+		if (!conn)
+			break;
+
+		auto pooled = std::make_unique<SQLPooledConnection>();
+		pooled->connection = std::move(conn);
+		m_free.push_back(pooled.get());
+		m_connections.push_back(std::move(pooled));
+	}
+
+	m_open = !m_connections.empty();
+	if (m_open && m_connections.size() < size) {
+		std::cerr << "SQLConnectionPool: Only opened " << m_connections.size()
+			<< " of " << size << " connections\n";
+	}
+	return m_open;
+}
+
+void SQLConnectionPool::Close() {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_open = false;
+	m_free.clear();
+	m_connections.clear();
+	m_freeCV.notify_all();
+}
+
+SQLConnectionPool::Lease SQLConnectionPool::Acquire() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_freeCV.wait(lock, [this]() {
+		return !m_open || !m_free.empty();
+	});
+
+	if (!m_open)
+		return Lease{};
+
+	SQLPooledConnection* conn = m_free.back();
+	m_free.pop_back();
+	DBConfig config = m_config;
+	lock.unlock();
+
+	// the connection is taken from the pool, the other workers do not wait for the connect timeout
+	if (conn->connection->isClosed()) {
+		auto reconnected = Connect(config);
+		if (!reconnected) {
+			Return(conn);
+			return Lease{};
+		}
+
+		// the cached statements belong to the old connection
+		conn->statements.Clear();
+		conn->connection = std::move(reconnected);
+	}
+
+	return Lease{ this, conn };
+}
+
+size_t SQLConnectionPool::GetSize() const {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_connections.size();
+}
+
+uint64_t SQLConnectionPool::GetStatementCacheHits() const {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	uint64_t hits = 0;
+	for (const auto& conn : m_connections)
+		hits += conn->statements.GetHits();
+	return hits;
+}
+
+uint64_t SQLConnectionPool::GetStatementCacheMisses() const {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	uint64_t misses = 0;
+	for (const auto& conn : m_connections)
+		misses += conn->statements.GetMisses();
+	return misses;
+}
+
+std::unique_ptr<sql::Connection> SQLConnectionPool::Connect(const DBConfig& config) {
+	try {
+		std::string hostString = "tcp://" + config.host + ":" + std::to_string(config.port);
+
+		sql::mysql::MySQL_Driver* driver = sql::mysql::get_mysql_driver_instance();
+		std::unique_ptr<sql::Connection> conn(
+			driver->connect(hostString, config.user, config.password)
+		);
+
+		conn->setSchema(config.schema);
+		return conn;
+	}
+	catch (sql::SQLException& e) {
+		std::cerr << "Error connecting to MySQL: "
+			<< e.what() << " (MySQL error code: "
+			<< e.getErrorCode() << ")" << '\n';
+		return nullptr;
+	}
+}
+
+void SQLConnectionPool::Return(SQLPooledConnection* conn) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	// the pool was closed or reopened while the connection was leased
+	bool owned = std::any_of(m_connections.begin(), m_connections.end(),
+		[conn](const auto& c) { return c.get() == conn; });
+	if (!owned)
+		return;
+
+	m_free.push_back(conn);
+	m_freeCV.notify_one();
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include <stdexcept>
+
+#include "NetServerManager.h"
+#include "ServerLogic/DBServerLogic.h"
+
+DBServerLogic::DBServerLogic(NetServer* server, const DBConfig& config)
+    : IServerLogic(server), m_config(config),
+    m_errorCounter(ServerMetrics::GetCounter("chesslite_request_errors_total", ServerMetrics::Label("server", server->GetName()))),
+    m_workerQueueWait(ServerMetrics::GetHistogram("chesslite_queue_wait_seconds",
+        ServerMetrics::Label("server", server->GetName()) + "," + ServerMetrics::Label("queue", "db_worker"))),
+    m_encodeTime(ServerMetrics::GetHistogram("chesslite_serialize_seconds",
+        ServerMetrics::Label("server", server->GetName()) + "," + ServerMetrics::Label("stage", "encode"))) {
+}
+
+bool DBServerLogic::SendSegment(StreamTarget& target, OTN::OTNWriter& writer, const std::string& what) {
+    // waits while the client has not yet received the previous segments
+    if (!target.stream->Reserve())
+        return false;
+
+    ServerMessage part;
+    part.AddObject(CreateStreamHeader(target.action, target.requestID, false));
+    part.stream = target.stream;
+    bool written = false;
+    {
+        ScopedLatency timer(m_encodeTime);
+        written = writer.SaveToString(part.payload);
+    }
+    if (!written)
+        throw std::runtime_error("Failed to write " + what + " segment: " + writer.GetError());
+
+    NetServerManager::SendMessage(m_server, target.dstServer, std::move(part));
+    return true;
+}
+
+bool DBServerLogic::SendChangeSequence(StreamTarget& target, int64_t sequence, const std::vector<int64_t>& deletedIDs) {
+    OTN::OTNObject deleted{ "deleted_agents" };
+    deleted.SetNames("id");
+    deleted.SetTypes("int64");
+    deleted.ReserveDataRows(deletedIDs.size());
+    for (int64_t id : deletedIDs)
+        deleted.AddDataRow(id);
+
+    OTN::OTNObject changes{ "changes" };
+    changes.SetNames("sequence");
+    changes.SetTypes("int64");
+    changes.AddDataRow(sequence);
+
+    OTN::OTNWriter writer;
+    writer.AppendObject(deleted).AppendObject(changes);
+    return SendSegment(target, writer, "changes");
+}
+
+void DBServerLogic::FinishStream(StreamTarget& target, bool complete) {
+    // the client disconnected or stopped reading, the error only clears the pending request
+    if (!complete) {
+        SentError("Streaming the agents was cancelled", target.dstServer, target.action, target.requestID);
+        return;
+    }
+
+    ServerMessage end;
+    end.AddObject(CreateStreamHeader(target.action, target.requestID, true));
+    end.stream = target.stream;
+    NetServerManager::SendMessage(m_server, target.dstServer, std::move(end));
+}
+
+void DBServerLogic::SendReply(const std::string& dstServer, const std::string& action, uint32_t requestID, OTN::OTNObject&& body) {
+    ServerMessage reply;
+    reply.AddObject(CreateRequestHeader(action, requestID));
+    reply.AddObject(std::move(body));
+
+    NetServerManager::SendMessage(m_server, dstServer, std::move(reply));
+}
+
+OTN::OTNObject DBServerLogic::CreateRequestHeader(const std::string& action, uint32_t requestID, bool response) {
+    OTN::OTNObject headerObj{ "header" };
+
+    headerObj.SetNames("action", "request_id", "response");
+    headerObj.SetTypes("String", "int64", "bool");
+    headerObj.AddDataRow(action, requestID, response);
+
+    return headerObj;
+}
+
+OTN::OTNObject DBServerLogic::CreateStreamHeader(const std::string& action, uint32_t requestID, bool last) {
+    OTN::OTNObject headerObj{ "header" };
+
+    headerObj.SetNames("action", "request_id", "response", "last");
+    headerObj.SetTypes("String", "int64", "bool", "bool");
+    headerObj.AddDataRow(action, requestID, true, last);
+
+    return headerObj;
+}
+
+void DBServerLogic::SentError(
+    const std::string& errorMsg,
+    const std::string& dstServer,
+    const std::string& action,
+    uint32_t requestID)
+{
+    m_errorCounter.fetch_add(1, std::memory_order_relaxed);
+
+    OTN::OTNObject body{ "body" };
+    body.SetNames("error");
+    body.SetTypes("String");
+    body.AddDataRow(errorMsg);
+
+    ServerMessage reply;
+    reply.AddObject(CreateRequestHeader(action, requestID, false));
+    reply.AddObject(std::move(body));
+
+    NetServerManager::SendMessage(m_server, dstServer, std::move(reply));
+}
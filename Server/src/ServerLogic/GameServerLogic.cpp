@@ -1,4 +1,7 @@
 #include <iostream>
+#include <array>
+#include <algorithm>
+#include <mutex>
 #include <SDL3_net/SDL_Net.h>
 
 #include "OTNFile.h"
@@ -7,53 +10,212 @@
 #include "NetServerManager.h"
 #include "ServerLogic/GameServerLogic.h"
 
+namespace {
+
+    std::string SerializeLabels(const std::string& server, const char* stage) {
+        return ServerMetrics::Label("server", server) + "," + ServerMetrics::Label("stage", stage);
+    }
+
+}
+
 GameServerLogic::GameServerLogic(NetServer* server) 
-    : IServerLogic(server) {
+    : IServerLogic(server),
+    m_pendingSQLGauge(ServerMetrics::GetGauge("chesslite_pending_sql_requests")),
+    m_sentBytesCounter(ServerMetrics::GetCounter("chesslite_sent_bytes_total", ServerMetrics::Label("server", server->GetName()))),
+    m_errorCounter(ServerMetrics::GetCounter("chesslite_request_errors_total", ServerMetrics::Label("server", server->GetName()))),
+    m_decodeTextTime(ServerMetrics::GetHistogram("chesslite_serialize_seconds", SerializeLabels(server->GetName(), "decode_v1"))),
+    m_decodeBinaryTime(ServerMetrics::GetHistogram("chesslite_serialize_seconds", SerializeLabels(server->GetName(), "decode_v2"))),
+    m_encodeTime(ServerMetrics::GetHistogram("chesslite_serialize_seconds", SerializeLabels(server->GetName(), "encode"))),
+    m_compressTime(ServerMetrics::GetHistogram("chesslite_serialize_seconds", SerializeLabels(server->GetName(), "compress"))) {
+    m_concurrentCallbacks = true;
+}
+
+void GameServerLogic::OnRun() {
+    std::vector<ClientSessionPtr> sessions;
+    {
+        std::shared_lock lock(m_sessionMutex);
+        sessions.reserve(m_sessions.size());
+        for (auto& [client, session] : m_sessions)
+            sessions.push_back(session);
+    }
+
+    // lets the sql server continue streamed results once their segments left the socket
+    for (auto& session : sessions) {
+        std::lock_guard guard(session->sendMutex);
+        ReleaseDrainedStreams(*session);
+    }
+}
+
+void GameServerLogic::OnClientConnected(NET_StreamSocket* client) {
+    if (!client)
+        return;
+
+    GetOrCreateSession(client);
 }
 
 void GameServerLogic::OnMessage(NET_StreamSocket* client, const std::string& msg) {
     if (!client)
         return;
 
-    auto reqs = GetRequests(msg);
-    for (auto& r : reqs) {
-        if (!r.response)
+    ClientSessionPtr session = GetOrCreateSession(client);
+
+    session->decoder.Append(msg.data(), msg.size());
+    auto receivedAt = std::chrono::steady_clock::now();
+
+    std::string_view frame;
+    while (session->decoder.Next(frame)) {
+        Request r;
+        try {
+            if (!ReadRequest(*session, frame, r))
+                continue;
+        }
+        catch (const std::runtime_error&) {
+            // a truncated frame only drops its own request, the id is 0 if not even that could be read
+            std::cerr << "GameServer: Malformed frame for request " << r.id << ", dropping it\n";
+            session->inboundStreams.erase(r.id);
+            SentError(session, r.id, "Malformed frame");
+            continue;
+        }
+        r.receivedAt = receivedAt;
+
+        session->acceptsCompression = (r.flags & PAYLOAD_FLAG_ACCEPT_COMPRESSED) != 0;
+
+        if (!r.response) {
+            SentError(session, r.id, std::string(r.payload));
             continue;
+        }
+
+        if (r.flags & PAYLOAD_FLAG_HELLO)
+            HandleHello(session, r);
+        else if (r.flags & PAYLOAD_FLAG_BATCH)
+            HandleBatch(session, r);
+        else
+            HandleRequest(session, r);
+    }
+
+    if (session->decoder.HasError()) {
+        // the stream can not be resynchronized after a broken frame
+        std::cerr << "GameServer: Frame exceeds MAX_PACKET_SIZE, dropping client data\n";
+        session->decoder.Clear();
+        session->inboundStreams.clear();
+    }
+}
+
+void GameServerLogic::OnClientDisconnected(NET_StreamSocket* client) {
+    ClientSessionPtr session;
+    {
+        std::unique_lock lock(m_sessionMutex);
+        auto it = m_sessions.find(client);
+        if (it == m_sessions.end())
+            return;
+
+        session = std::move(it->second);
+        m_sessions.erase(it);
+    }
+
+    {
+        std::lock_guard sendGuard(session->sendMutex);
+        session->closed = true;
+        session->outbound.clear();
+        CancelStreams(*session);
+    }
+
+    // answers of the sql server for this client are no longer needed
+    std::unordered_set<int64_t> pending;
+    {
+        std::lock_guard guard(session->pendingMutex);
+        pending.swap(session->pendingSQL);
+    }
 
-        HandleRequest(client, r);
+    std::lock_guard guard(m_pendingMutex);
+    for (int64_t id : pending) {
+        auto it = m_pendingSQL.find(id);
+        if (it == m_pendingSQL.end())
+            continue;
+        // a streaming sql worker would otherwise wait for the client
+        if (it->second.stream)
+            it->second.stream->Cancel();
+        m_pendingSQL.erase(it);
     }
+    m_pendingSQLGauge.store(static_cast<int64_t>(m_pendingSQL.size()), std::memory_order_relaxed);
 }
 
-void GameServerLogic::OnServerMessage(
-    const std::string& serverName,
-    const std::string& msg)
-{
-    if (serverName == "sql_server")
+void GameServerLogic::OnServerMessage(ServerMessage& msg) {
+    if (msg.source == "sql_server")
         HandleSQLServer(msg);
 }
 
-int64_t GameServerLogic::RegisterPendingSQL(NET_StreamSocket* client, uint32_t requestID) {
+void GameServerLogic::SetMaxMessageSize(size_t size) {
+    m_maxMessageSize = size;
+}
+
+size_t GameServerLogic::GetMaxMessageSize() const {
+    return m_maxMessageSize;
+}
+
+GameServerLogic::ClientSessionPtr GameServerLogic::GetOrCreateSession(NET_StreamSocket* client) {
+    {
+        std::shared_lock lock(m_sessionMutex);
+        auto it = m_sessions.find(client);
+        if (it != m_sessions.end())
+            return it->second;
+    }
+
+    std::unique_lock lock(m_sessionMutex);
+    ClientSessionPtr& session = m_sessions[client];
+    if (!session) {
+        session = std::make_shared<ClientSession>();
+        session->client = client;
+    }
+    return session;
+}
+
+int64_t GameServerLogic::RegisterPendingSQL(const std::string& action, const ClientSessionPtr& session, const Request& req, std::shared_ptr<ServerStream> stream) {
+    LatencyHistogram& requestTime = ServerMetrics::GetHistogram("chesslite_request_seconds", ServerMetrics::Label("action", action));
+
     int64_t internalID = m_nextInternalID++;
-    m_pendingSQL[internalID] = { client, requestID };
+    {
+        std::lock_guard guard(m_pendingMutex);
+        m_pendingSQL[internalID] = { session, req.id, std::move(stream), req.opcode != NetOpcode::NONE, &requestTime, req.receivedAt };
+        m_pendingSQLGauge.store(static_cast<int64_t>(m_pendingSQL.size()), std::memory_order_relaxed);
+    }
+
+    std::lock_guard guard(session->pendingMutex);
+    session->pendingSQL.insert(internalID);
     return internalID;
 }
 
 bool GameServerLogic::RemovePendingSQL(int64_t requstID, PendingSQLRequest& outRequest) {
+    {
+        std::lock_guard guard(m_pendingMutex);
+        auto it = m_pendingSQL.find(requstID);
+        if (it == m_pendingSQL.end())
+            return false;
+
+        outRequest = it->second;
+        m_pendingSQL.erase(it);
+        m_pendingSQLGauge.store(static_cast<int64_t>(m_pendingSQL.size()), std::memory_order_relaxed);
+    }
+
+    if (auto session = outRequest.session.lock()) {
+        std::lock_guard guard(session->pendingMutex);
+        session->pendingSQL.erase(requstID);
+    }
+    return true;
+}
+
+bool GameServerLogic::FindPendingSQL(int64_t requstID, PendingSQLRequest& outRequest) {
+    std::lock_guard guard(m_pendingMutex);
     auto it = m_pendingSQL.find(requstID);
     if (it == m_pendingSQL.end())
         return false;
 
     outRequest = it->second;
-    m_pendingSQL.erase(it);
     return true;
 }
 
-void GameServerLogic::HandleSQLServer(const std::string& msg) {
-    OTN::OTNReader reader;
-    if (!reader.ReadString(msg))
-        return;
-
-    auto header = reader.TryGetObject("header");
+void GameServerLogic::HandleSQLServer(ServerMessage& msg) {
+    auto header = msg.TryGetObject("header");
     if (!header)
         return;
 
@@ -63,124 +225,149 @@ void GameServerLogic::HandleSQLServer(const std::string& msg) {
     if (!action || !requestID || !response)
         return;
 
+    // every part of a streamed result but the last keeps the request pending
+    bool last = header->TryGetValue<bool>(0, "last").value_or(true);
+    bool streamPart = msg.stream && *response && !last;
+
     PendingSQLRequest pending;
-    if (!RemovePendingSQL(static_cast<uint32_t>(*requestID), pending))
+    bool found = streamPart
+        ? FindPendingSQL(static_cast<uint32_t>(*requestID), pending)
+        : RemovePendingSQL(static_cast<uint32_t>(*requestID), pending);
+    if (!found) {
+        if (msg.stream)
+            msg.stream->Cancel();
+        return;
+    }
+
+    // from reading the request until the answer is handed to the client, errors included
+    if (!streamPart && pending.requestTime)
+        pending.requestTime->Record(std::chrono::steady_clock::now() - pending.receivedAt);
+
+    // client disconnected in the meantime
+    ClientSessionPtr session = pending.session.lock();
+    if (!session) {
+        if (pending.stream)
+            pending.stream->Cancel();
         return;
+    }
     
     if (*response == false) {
-        auto body = reader.TryGetObject("body");
+        if (pending.stream) {
+            std::lock_guard guard(session->sendMutex);
+            session->outboundStreams.erase(pending.clientRequestID);
+            pending.stream->Cancel();
+        }
+
+        auto body = msg.TryGetObject("body");
         if (!body)
             return;
         auto errorMsg = body->TryGetValue<std::string>(0, "error");
         if (!errorMsg)
             return;
-        SentError(pending.client, pending.clientRequestID, *errorMsg);
-    }
-
-    if (action == "InsertAgentsResult")
-        HandleReceiveSQLSyncMissingData(reader, pending);
-    else if (action == "GetAgentIDResult")
-        HandleReceiveSQLServerAgentIDList(reader, pending);
-    else if (action == "HandleGetMissinAgents")
-        HandleReceiveSQLServerAgentList(reader, pending);
-    else if(action == "HandleDeleteAgentsResult")
-        HandleReceiveSQLDeleteAgentsResult(reader, pending);
-    else if(action == "HandleUpdateAgentsResult")
-        HandleReceiveSQLUpdateAgentsResult(reader, pending);
-    else
-        std::cerr << "Unkown action game server '" << *action << "'\n";
+        SentError(session, pending.clientRequestID, *errorMsg);
+        return;
+    }
+
+    if (*action == "HandleGetMissinAgents" || *action == "GetAgentChanges") {
+        HandleReceiveSQLStreamPart(msg, session, pending.clientRequestID, last);
+        return;
+    }
 
+    static const std::unordered_map<std::string_view, SQLResultHandler> handlers = {
+        { "InsertAgentsResult", &GameServerLogic::HandleReceiveSQLSyncMissingData },
+        { "GetAgentIDResult", &GameServerLogic::HandleReceiveSQLServerAgentIDList },
+        { "HandleDeleteAgentsResult", &GameServerLogic::HandleReceiveSQLDeleteAgentsResult },
+        { "HandleUpdateAgentsResult", &GameServerLogic::HandleReceiveSQLUpdateAgentsResult },
+        { "ReportGamesResult", &GameServerLogic::HandleReceiveSQLTrainingResult },
+        { "SyncAgentDeltasResult", &GameServerLogic::HandleReceiveSQLTrainingResult },
+    };
+
+    auto it = handlers.find(*action);
+    if (it == handlers.end()) {
+        std::cerr << "Unkown action game server '" << *action << "'\n";
+        return;
+    }
+    (this->*it->second)(msg, session, pending);
 }
 
-void GameServerLogic::HandleReceiveSQLSyncMissingData(OTN::OTNReader& reader, const PendingSQLRequest& pending) {
-    auto idsObj = reader.TryGetObject("ids");
+void GameServerLogic::HandleReceiveSQLSyncMissingData(ServerMessage& msg, const ClientSessionPtr& session, const PendingSQLRequest& pending) {
+    auto idsObj = msg.TryGetObject("ids");
     if (!idsObj)
         return;
 
     OTN::OTNWriter writer;
     writer.AppendObject(*idsObj);
 
-    std::string payload;
-    if (!writer.SaveToString(payload))
-        return;
-
-    Request response;
-    response.id = pending.clientRequestID;
-    response.response = true;
-    response.otnPayload = payload;
-
-    SentRequest(pending.client, response);
+    SendResponse(session, pending.clientRequestID, writer);
 }
 
-void GameServerLogic::HandleReceiveSQLServerAgentIDList(OTN::OTNReader& reader, const PendingSQLRequest& pending) {
-    auto idsObj = reader.TryGetObject("Result");
+void GameServerLogic::HandleReceiveSQLServerAgentIDList(ServerMessage& msg, const ClientSessionPtr& session, const PendingSQLRequest& pending) {
+    auto idsObj = msg.TryGetObject("Result");
     if (!idsObj)
         return;
+
+    if (pending.binaryResponse) {
+        SendBinaryResponse(session, pending.clientRequestID, NetProtocol::EncodeIDList(*idsObj, "id"));
+        return;
+    }
     idsObj->SetObjectName("List");
 
     OTN::OTNWriter writer;
     writer.AppendObject(*idsObj);
 
-    std::string payload;
-    if (!writer.SaveToString(payload))
-        return;
-
-    Request response;
-    response.id = pending.clientRequestID;
-    response.response = true;
-    response.otnPayload = payload;
-
-    SentRequest(pending.client, response);
+    SendResponse(session, pending.clientRequestID, writer);
 }
 
-void GameServerLogic::HandleReceiveSQLServerAgentList(OTN::OTNReader& reader, const PendingSQLRequest& pending) {
-    auto agentObj = reader.TryGetObject("agents");
-    auto boardStateObj = reader.TryGetObject("board_states");
-    auto gameMoveObj = reader.TryGetObject("game_moves");
-    if (!agentObj)
+void GameServerLogic::HandleReceiveSQLStreamPart(ServerMessage& msg, const ClientSessionPtr& session, uint32_t requestID, bool last) {
+    if (!msg.stream) {
+        SentError(session, requestID, "Expected a streamed result from the sql server");
         return;
+    }
 
-    OTN::OTNWriter writer;
-    writer.AppendObject(*agentObj);
-    if (boardStateObj)
-        writer.AppendObject(*boardStateObj);
-    if (gameMoveObj)
-        writer.AppendObject(*gameMoveObj);
+    {
+        std::lock_guard guard(session->sendMutex);
+        if (session->closed) {
+            msg.stream->Cancel();
+            return;
+        }
+        // the first part opens the stream
+        auto& stream = session->outboundStreams[requestID];
+        stream.flow = msg.stream;
+    }
 
-    std::string payload;
-    if (!writer.SaveToString(payload))
+    // the segment was already written by the sql server, it is forwarded without parsing it
+    if (!SendStreamSegment(session, requestID, msg.payload, last)) {
+        msg.stream->Cancel();
         return;
+    }
 
-    Request response;
-    response.id = pending.clientRequestID;
-    response.response = true;
-    response.otnPayload = payload;
+    std::lock_guard guard(session->sendMutex);
+    auto it = session->outboundStreams.find(requestID);
+    if (it == session->outboundStreams.end())
+        return;
+
+    if (last) {
+        session->outboundStreams.erase(it);
+        return;
+    }
 
-    SentRequest(pending.client, response);
+    it->second.unreleased++;
+    ReleaseDrainedStreams(*session);
 }
 
-void GameServerLogic::HandleReceiveSQLDeleteAgentsResult(OTN::OTNReader& reader, const PendingSQLRequest& pending) {
-    auto idsObj = reader.TryGetObject("Result");
+void GameServerLogic::HandleReceiveSQLDeleteAgentsResult(ServerMessage& msg, const ClientSessionPtr& session, const PendingSQLRequest& pending) {
+    auto idsObj = msg.TryGetObject("Result");
     if (!idsObj)
         return;
 
     OTN::OTNWriter writer;
     writer.AppendObject(*idsObj);
 
-    std::string payload;
-    if (!writer.SaveToString(payload))
-        return;
-
-    Request response;
-    response.id = pending.clientRequestID;
-    response.response = true;
-    response.otnPayload = payload;
-
-    SentRequest(pending.client, response);
+    SendResponse(session, pending.clientRequestID, writer);
 }
 
-void GameServerLogic::HandleReceiveSQLUpdateAgentsResult(OTN::OTNReader& reader, const PendingSQLRequest& pending) {
-    auto idsObj = reader.TryGetObject("Result");
+void GameServerLogic::HandleReceiveSQLUpdateAgentsResult(ServerMessage& msg, const ClientSessionPtr& session, const PendingSQLRequest& pending) {
+    auto idsObj = msg.TryGetObject("Result");
     if (!idsObj)
         return;
 
@@ -188,247 +375,545 @@ void GameServerLogic::HandleReceiveSQLUpdateAgentsResult(OTN::OTNReader& reader,
     idsObj->SetObjectName("ids");
     writer.AppendObject(*idsObj);
 
-    std::string payload;
-    if (!writer.SaveToString(payload))
+    SendResponse(session, pending.clientRequestID, writer);
+}
+
+void GameServerLogic::HandleReceiveSQLTrainingResult(ServerMessage& msg, const ClientSessionPtr& session, const PendingSQLRequest& pending) {
+    auto resultObj = msg.TryGetObject("Result");
+    if (!resultObj)
         return;
 
-    Request response;
-    response.id = pending.clientRequestID;
-    response.response = true;
-    response.otnPayload = payload;
+    OTN::OTNWriter writer;
+    writer.AppendObject(*resultObj);
 
-    SentRequest(pending.client, response);
+    SendResponse(session, pending.clientRequestID, writer);
 }
 
-void GameServerLogic::HandleRequest(NET_StreamSocket* client, const Request& req) {
-    OTN::OTNReader reader;
-    if (!reader.ReadString(req.otnPayload)) {
-        SentError(client, req.id, "Failed to parse OTN: " + reader.GetError());
+void GameServerLogic::HandleHello(const ClientSessionPtr& session, const Request& req) {
+    // hello: [u16 highest version of the client], answered with [u16 version used from now on]
+    uint16_t clientVersion = 0;
+    try {
+        BinaryDeserializer des(req.payload);
+        clientVersion = des.Read<uint16_t>();
+    }
+    catch (const std::runtime_error&) {
+        SentError(session, req.id, "Failed to read the protocol version of the hello");
         return;
     }
 
-    auto header = reader.TryGetObject("header");
-    auto body = reader.TryGetObject("body");
-
-    if (!header || header->GetRowCount() == 0) {
-        SentError(client, req.id, "Failed to extract header of the request");
+    if (clientVersion < PROTOCOL_VERSION_TEXT) {
+        SentError(session, req.id, "Protocol version " + std::to_string(clientVersion) + " is not supported");
         return;
     }
 
-    if (!body) {
-        SentError(client, req.id, "Failed to extract body of the request");
+    session->protocolVersion = std::min(clientVersion, PROTOCOL_VERSION_BATCH);
+
+    BinarySerializer ser;
+    ser.AddField(session->protocolVersion);
+    std::vector<uint8_t> buffer = ser.ToBuffer();
+    SendBinaryResponse(session, req.id, std::string(buffer.begin(), buffer.end()));
+}
+
+void GameServerLogic::HandleBatch(const ClientSessionPtr& session, const Request& req) {
+    if (session->protocolVersion < PROTOCOL_VERSION_BATCH) {
+        SentError(session, req.id, "Batch request before the protocol was negotiated");
         return;
     }
 
-    auto action = header->TryGetValue<std::string>(0, "action");
-    if (!action) {
-        SentError(client, req.id, "Failed to extract action of the request");
+    // read completely first, a broken batch must not run half of its requests
+    std::vector<Request> requests;
+    try {
+        BinaryDeserializer des(req.payload);
+        uint32_t count = des.Read<uint32_t>();
+        if (count > MAX_BATCH_REQUESTS) {
+            SentError(session, req.id, "Batch of " + std::to_string(count) + " requests exceeds the limit of " + std::to_string(MAX_BATCH_REQUESTS));
+            return;
+        }
+
+        requests.resize(count);
+        for (Request& r : requests) {
+            r.response = true;
+            r.id = des.Read<uint32_t>();
+            r.flags = des.Read<uint8_t>();
+            if (r.flags & PAYLOAD_FLAG_OPCODE)
+                r.opcode = static_cast<NetOpcode>(des.Read<uint16_t>());
+            // the views point into the batch payload, which outlives the dispatch below
+            r.payload = des.ReadStringView();
+            r.receivedAt = req.receivedAt;
+
+            // the batch frame is chunked and compressed as a whole
+            constexpr uint8_t FRAME_FLAGS = PAYLOAD_FLAG_COMPRESSED | PAYLOAD_FLAG_CHUNKED | PAYLOAD_FLAG_STREAMED | PAYLOAD_FLAG_HELLO | PAYLOAD_FLAG_BATCH;
+            if (r.flags & FRAME_FLAGS) {
+                SentError(session, req.id, "Batch request " + std::to_string(r.id) + " has frame flags");
+                return;
+            }
+            r.flags |= (req.flags & PAYLOAD_FLAG_ACCEPT_COMPRESSED);
+        }
+    }
+    catch (const std::runtime_error&) {
+        SentError(session, req.id, "Failed to read the batch");
         return;
     }
 
-    if (*action == "SyncMissingData")
-        HandleSyncMissingData(client, req.id, *body);
-    else if (*action == "GetAgentIDList")
-        HandleServerAgentIDList(client, req.id);
-    else if (*action == "RequestMissingAgents")
-        HandleGetMissinAgents(client, req.id, *body);
-    else if (*action == "SyncDeleteData")
-        HandleDeleteAgents(client, req.id, *body);
-    else if (*action == "SyncDirtyData")
-        HandleDirtyAgents(client, req.id, *body);
-    else
-        std::cerr << "Unkown action game server '" << *action << "'\n";
+    for (const Request& r : requests)
+        HandleRequest(session, r);
+
+    SendBinaryResponse(session, req.id, std::string{});
 }
 
-void GameServerLogic::HandleSyncMissingData(NET_StreamSocket* client, uint32_t requestID, const OTN::OTNObject& body) {
-    OTN::OTNObject headerObj = CreateSQLRequestHeader("InsertAgents", client, requestID);
+void GameServerLogic::HandleRequest(const ClientSessionPtr& session, const Request& req) {
+    // indexed by the opcode, v1 requests are mapped to their opcode by the action name
+    static const std::array<RequestHandler, static_cast<size_t>(NetOpcode::COUNT)> handlers = {
+        nullptr,
+        &GameServerLogic::HandleSyncMissingData,
+        &GameServerLogic::HandleServerAgentIDList,
+        &GameServerLogic::HandleGetMissinAgents,
+        &GameServerLogic::HandleGetAgentChanges,
+        &GameServerLogic::HandleDeleteAgents,
+        &GameServerLogic::HandleDirtyAgents,
+        &GameServerLogic::HandleDirtyAgentStates,
+        &GameServerLogic::HandleReportGames,
+        &GameServerLogic::HandleSyncAgentDeltas,
+    };
+
+    NetOpcode opcode = req.opcode;
+    OTN::OTNObject body;
+
+    if (opcode != NetOpcode::NONE) {
+        if (session->protocolVersion < PROTOCOL_VERSION_BINARY) {
+            SentError(session, req.id, "Binary request before the protocol was negotiated");
+            return;
+        }
 
-    OTN::OTNWriter writer;
-    writer.AppendObject(headerObj);
-    writer.AppendObject(body);
+        std::string error;
+        bool decoded = false;
+        {
+            ScopedLatency timer(m_decodeBinaryTime);
+            decoded = NetProtocol::DecodeBody(opcode, req.payload, body, error);
+        }
+        if (!decoded) {
+            SentError(session, req.id, error);
+            return;
+        }
+    }
+    else {
+        OTN::OTNReader reader;
+        bool parsed = false;
+        {
+            ScopedLatency timer(m_decodeTextTime);
+            parsed = reader.ReadString(req.payload);
+        }
+        if (!parsed) {
+            SentError(session, req.id, "Failed to parse OTN: " + reader.GetError());
+            return;
+        }
 
-    std::string msg;
-    writer.SaveToString(msg);
+        // the objects are moved on to the sql server, no copies
+        auto& objects = reader.GetObjects();
+        auto headerIt = objects.find("header");
+        auto bodyIt = objects.find("body");
 
-    NetServerManager::SendMessage(
-        m_server,
-        "sql_server",
-        msg
-    );
-}
+        if (headerIt == objects.end() || headerIt->second.GetRowCount() == 0) {
+            SentError(session, req.id, "Failed to extract header of the request");
+            return;
+        }
 
-void GameServerLogic::HandleServerAgentIDList(NET_StreamSocket* client, uint32_t requestID) {
-    int64_t internalID = RegisterPendingSQL(client, requestID);
+        if (bodyIt == objects.end()) {
+            SentError(session, req.id, "Failed to extract body of the request");
+            return;
+        }
 
-    OTN::OTNObject headerObj = CreateSQLRequestHeader("GetAgentIDs", client, requestID);
-    OTN::OTNObject body{ "body" };
+        auto action = headerIt->second.TryGetValue<std::string>(0, "action");
+        if (!action) {
+            SentError(session, req.id, "Failed to extract action of the request");
+            return;
+        }
 
-    OTN::OTNWriter writer;
-    writer.AppendObject(headerObj);
-    writer.AppendObject(body);
+        opcode = NetProtocol::FindOpcode(*action);
+        if (opcode == NetOpcode::NONE) {
+            std::cerr << "Unkown action game server '" << *action << "'\n";
+            return;
+        }
+        body = std::move(bodyIt->second);
+    }
 
-    std::string msg;
-    writer.SaveToString(msg);
+    // per action and protocol, the counters are resolved on the first request
+    static const auto requestCounters = []() {
+        std::array<std::array<std::atomic<uint64_t>*, 2>, static_cast<size_t>(NetOpcode::COUNT)> counters{};
+        for (size_t i = 1; i < counters.size(); ++i) {
+            std::string action = ServerMetrics::Label("action", NetProtocol::GetOpcodeInfo(static_cast<NetOpcode>(i))->action);
+            counters[i][0] = &ServerMetrics::GetCounter("chesslite_requests_total", action + "," + ServerMetrics::Label("protocol", "v1"));
+            counters[i][1] = &ServerMetrics::GetCounter("chesslite_requests_total", action + "," + ServerMetrics::Label("protocol", "v2"));
+        }
+        return counters;
+    }();
+    requestCounters[static_cast<size_t>(opcode)][req.opcode != NetOpcode::NONE ? 1 : 0]->fetch_add(1, std::memory_order_relaxed);
 
-    NetServerManager::SendMessage(
-        m_server,
-        "sql_server",
-        msg
-    );
+    (this->*handlers[static_cast<size_t>(opcode)])(session, req, std::move(body));
 }
 
-void GameServerLogic::HandleGetMissinAgents(NET_StreamSocket* client, uint32_t requestID, const OTN::OTNObject& body) {
-    int64_t internalID = RegisterPendingSQL(client, requestID);
+void GameServerLogic::HandleSyncMissingData(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& body) {
+    OTN::OTNObject headerObj = CreateSQLRequestHeader("InsertAgents", session, req);
+    SendToSQLServer(std::move(headerObj), std::move(body));
+}
 
-    OTN::OTNObject headerObj = CreateSQLRequestHeader("HandleGetMissinAgents", client, requestID);
-    
-    OTN::OTNWriter writer;
-    writer.AppendObject(headerObj);
-    writer.AppendObject(body);
+void GameServerLogic::HandleServerAgentIDList(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& /*body*/) {
+    OTN::OTNObject headerObj = CreateSQLRequestHeader("GetAgentIDs", session, req);
+    OTN::OTNObject body{ "body" };
+    SendToSQLServer(std::move(headerObj), std::move(body));
+}
 
-    std::string msg;
-    writer.SaveToString(msg);
+void GameServerLogic::HandleGetMissinAgents(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& body) {
+    // can be the whole database, the sql server streams it in segments
+    auto stream = std::make_shared<ServerStream>(STREAM_WINDOW);
+    OTN::OTNObject headerObj = CreateSQLRequestHeader("HandleGetMissinAgents", session, req, stream);
+    SendToSQLServer(std::move(headerObj), std::move(body), std::move(stream));
+}
 
-    NetServerManager::SendMessage(
-        m_server,
-        "sql_server",
-        msg
-    );
+void GameServerLogic::HandleGetAgentChanges(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& body) {
+    // usually a few agents, streamed like the missing agents since a client can be far behind
+    auto stream = std::make_shared<ServerStream>(STREAM_WINDOW);
+    OTN::OTNObject headerObj = CreateSQLRequestHeader("GetAgentChanges", session, req, stream);
+    SendToSQLServer(std::move(headerObj), std::move(body), std::move(stream));
 }
 
-void GameServerLogic::HandleDeleteAgents(NET_StreamSocket* client, uint32_t requestID, const OTN::OTNObject& body) {
-    int64_t internalID = RegisterPendingSQL(client, requestID);
+void GameServerLogic::HandleDeleteAgents(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& body) {
+    OTN::OTNObject headerObj = CreateSQLRequestHeader("HandleDeleteAgents", session, req);
+    SendToSQLServer(std::move(headerObj), std::move(body));
+}
 
-    OTN::OTNObject headerObj = CreateSQLRequestHeader("HandleDeleteAgents", client, requestID);
+void GameServerLogic::HandleDirtyAgents(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& body) {
+    OTN::OTNObject headerObj = CreateSQLRequestHeader("HandleDirtyAgents", session, req);
+    SendToSQLServer(std::move(headerObj), std::move(body));
+}
 
-    OTN::OTNWriter writer;
-    writer.AppendObject(headerObj);
-    writer.AppendObject(body);
+void GameServerLogic::HandleDirtyAgentStates(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& body) {
+    // answered with HandleUpdateAgentsResult like a full update
+    OTN::OTNObject headerObj = CreateSQLRequestHeader("HandleDirtyAgentStates", session, req);
+    SendToSQLServer(std::move(headerObj), std::move(body));
+}
 
-    std::string msg;
-    writer.SaveToString(msg);
+void GameServerLogic::HandleReportGames(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& body) {
+    // the agents are trained by the sql server, the client only sends the games
+    OTN::OTNObject headerObj = CreateSQLRequestHeader("ReportGames", session, req);
+    SendToSQLServer(std::move(headerObj), std::move(body));
+}
 
-    NetServerManager::SendMessage(
-        m_server,
-        "sql_server",
-        msg
-    );
+void GameServerLogic::HandleSyncAgentDeltas(const ClientSessionPtr& session, const Request& req, OTN::OTNObject&& body) {
+    // the deltas are added to what is stored, no version check
+    OTN::OTNObject headerObj = CreateSQLRequestHeader("SyncAgentDeltas", session, req);
+    SendToSQLServer(std::move(headerObj), std::move(body));
 }
 
-void GameServerLogic::HandleDirtyAgents(NET_StreamSocket* client, uint32_t requestID, const OTN::OTNObject& body) {
-    int64_t internalID = RegisterPendingSQL(client, requestID);
+OTN::OTNObject GameServerLogic::CreateSQLRequestHeader(const std::string& action, const ClientSessionPtr& session, const Request& req, std::shared_ptr<ServerStream> stream) {
+    int64_t internalID = RegisterPendingSQL(action, session, req, std::move(stream));
 
-    OTN::OTNObject headerObj = CreateSQLRequestHeader("HandleDirtyAgents", client, requestID);
+    OTN::OTNObject headerObj{ "header" };
+    headerObj.SetNames("action", "request_id");
+    headerObj.SetTypes("String", "int64");
+    headerObj.AddDataRow(action, internalID);
 
-    OTN::OTNWriter writer;
-    writer.AppendObject(headerObj);
-    writer.AppendObject(body);
+    return headerObj;
+}
 
-    std::string msg;
-    writer.SaveToString(msg);
+void GameServerLogic::SendToSQLServer(OTN::OTNObject&& header, OTN::OTNObject&& body, std::shared_ptr<ServerStream> stream) {
+    ServerMessage msg;
+    msg.AddObject(std::move(header));
+    msg.AddObject(std::move(body));
+    msg.stream = std::move(stream);
 
     NetServerManager::SendMessage(
         m_server,
         "sql_server",
-        msg
+        std::move(msg)
     );
 }
 
-OTN::OTNObject GameServerLogic::CreateSQLRequestHeader(const std::string& action, NET_StreamSocket* client, uint32_t requestID) {
-    int64_t internalID = RegisterPendingSQL(client, requestID);
+void GameServerLogic::SendResponse(const ClientSessionPtr& session, uint32_t requestID, OTN::OTNWriter& writer) {
+    std::string payload;
+    bool written = false;
+    {
+        ScopedLatency timer(m_encodeTime);
+        written = writer.SaveToString(payload);
+    }
+    if (!written)
+        return;
 
-    OTN::OTNObject headerObj{ "header" };
-    headerObj.SetNames("action", "request_id");
-    headerObj.SetTypes("String", "int64");
-    headerObj.AddDataRow(action, internalID);
+    Request response;
+    response.id = requestID;
+    response.response = true;
+    response.otnPayload = std::move(payload);
 
-    return headerObj;
+    SentRequest(session, response);
 }
 
-std::vector<GameServerLogic::Request>
-GameServerLogic::GetRequests(const std::string& msg) {
-    std::vector<Request> reqs;
+void GameServerLogic::SendBinaryResponse(const ClientSessionPtr& session, uint32_t requestID, std::string&& payload) {
+    Request response;
+    response.id = requestID;
+    response.response = true;
+    response.otnPayload = std::move(payload);
 
-    m_receiveBuffer.insert(
-        m_receiveBuffer.end(),
-        msg.begin(),
-        msg.end()
-    );
+    SentRequest(session, response);
+}
 
-    while (m_receiveBuffer.size() >= sizeof(uint32_t)) {
-        uint32_t length = 0;
-        std::memcpy(&length, m_receiveBuffer.data(), sizeof(uint32_t));
+bool GameServerLogic::ReadRequest(ClientSession& session, std::string_view frame, Request& outRequest) {
+    BinaryDeserializer des(frame);
+    outRequest.response = true;
+    outRequest.id = des.Read<uint32_t>();
+    outRequest.flags = des.Read<uint8_t>();
+    // every chunk of a v2 request repeats the opcode
+    if (outRequest.flags & PAYLOAD_FLAG_OPCODE)
+        outRequest.opcode = static_cast<NetOpcode>(des.Read<uint16_t>());
+
+    if (outRequest.flags & PAYLOAD_FLAG_CHUNKED) {
+        if (!AppendChunk(session, outRequest.id, outRequest.flags, des, outRequest))
+            return false;
+    }
+    else {
+        outRequest.payload = des.ReadStringView();
+    }
 
-        if (length > MAX_PACKET_SIZE) {
-            m_receiveBuffer.clear();
-            break;
+    if (outRequest.response && (outRequest.flags & PAYLOAD_FLAG_COMPRESSED)) {
+        std::string text;
+        std::string error;
+        if (OTN::DecompressOTN(outRequest.payload, text, error, m_maxMessageSize)) {
+            outRequest.otnPayload = std::move(text);
+        }
+        else {
+            // reported back to the client as an error response
+            outRequest.response = false;
+            outRequest.otnPayload = "Failed to decompress payload: " + error;
         }
+        outRequest.payload = outRequest.otnPayload;
+    }
 
-        if (m_receiveBuffer.size() < sizeof(uint32_t) + length)
-            break;
+    return true;
+}
 
-        std::vector<uint8_t> packet(
-            m_receiveBuffer.begin() + sizeof(uint32_t),
-            m_receiveBuffer.begin() + sizeof(uint32_t) + length
-        );
+bool GameServerLogic::AppendChunk(ClientSession& session, uint32_t id, uint8_t flags, BinaryDeserializer& des, Request& outRequest) {
+    // chunk: [sequence][total size][chunk length][chunk bytes]
+    uint32_t sequence = des.Read<uint32_t>();
+    uint32_t totalSize = des.Read<uint32_t>();
+    std::string_view chunk = des.ReadStringView();
+
+    auto fail = [&](const std::string& error) {
+        session.inboundStreams.erase(id);
+        outRequest.response = false;
+        outRequest.otnPayload = error;
+        outRequest.payload = outRequest.otnPayload;
+        return true;
+    };
+
+    auto it = session.inboundStreams.find(id);
+    if (it == session.inboundStreams.end()) {
+        if (sequence != 0)
+            return fail("Chunked message started with sequence " + std::to_string(sequence));
+        if (totalSize > m_maxMessageSize)
+            return fail("Chunked message of " + std::to_string(totalSize) + " bytes exceeds the limit of " + std::to_string(m_maxMessageSize.load()) + " bytes");
+        if (session.inboundStreams.size() >= MAX_STREAMS_PER_CLIENT)
+            return fail("Too many chunked messages in flight");
+
+        // no reserve, the announced size is not trusted before the data arrived
+        it = session.inboundStreams.emplace(id, InboundStream{}).first;
+        it->second.flags = flags;
+        it->second.totalSize = totalSize;
+    }
 
-        BinaryDeserializer des(packet);
-        Request req;
-        req.response = true;
-        req.id = des.Read<uint32_t>();
-        std::vector<uint8_t> payloadData = des.ReadVector<uint8_t>();
+    InboundStream& stream = it->second;
+    if (sequence != stream.nextSequence)
+        return fail("Chunk " + std::to_string(sequence) + " arrived, expected " + std::to_string(stream.nextSequence));
+    if (totalSize != stream.totalSize || chunk.size() > stream.totalSize - stream.data.size())
+        return fail("Chunk does not match the announced message size");
 
-        req.otnPayload.assign(
-            payloadData.begin(),
-            payloadData.end()
-        );
+    // all streams of a client share one budget, several half sent messages can not add up beyond it
+    size_t bufferedBytes = 0;
+    for (const auto& [streamID, other] : session.inboundStreams)
+        bufferedBytes += other.data.size();
+    if (bufferedBytes + chunk.size() > m_maxMessageSize)
+        return fail("Chunked messages in flight exceed the limit of " + std::to_string(m_maxMessageSize.load()) + " bytes");
 
-        reqs.push_back(std::move(req));
+    stream.data.append(chunk);
+    stream.nextSequence++;
 
-        m_receiveBuffer.erase(
-            m_receiveBuffer.begin(),
-            m_receiveBuffer.begin() + sizeof(uint32_t) + length
-        );
-    }
+    if (stream.data.size() < stream.totalSize)
+        return false;
 
-    return reqs;
+    outRequest.flags = stream.flags;
+    outRequest.otnPayload = std::move(stream.data);
+    outRequest.payload = outRequest.otnPayload;
+    session.inboundStreams.erase(it);
+    return true;
 }
 
-bool GameServerLogic::SentRequest(NET_StreamSocket* client, const Request& request) {
-    if (!client)
+bool GameServerLogic::SentRequest(const ClientSessionPtr& session, const Request& request) {
+    if (!session || !session->client)
         return false;
 
     auto& id = request.id;
     auto& response = request.response;
-    auto& payLoad = request.otnPayload;
+    const std::string* payLoad = &request.otnPayload;
 
-    // send: [size][id][response][payload length][payload bytes]
-    BinarySerializer ser;
-    ser.AddField(id);
-    ser.AddField<bool>(response);
-    ser.AddField(payLoad);
+    uint8_t flags = 0;
+    std::string compressed;
+    if (response && TryCompress(*session, *payLoad, compressed)) {
+        flags |= PAYLOAD_FLAG_COMPRESSED;
+        payLoad = &compressed;
+    }
 
-    std::vector<uint8_t> body = ser.ToBuffer();
-    uint32_t len = static_cast<uint32_t>(body.size());
+    auto toFrame = [](const BinarySerializer& ser) {
+        std::vector<uint8_t> body = ser.ToBuffer();
+        uint32_t len = static_cast<uint32_t>(body.size());
+
+        std::vector<uint8_t> frame(sizeof(uint32_t) + body.size());
+        std::memcpy(frame.data(), &len, sizeof(uint32_t));
+        std::memcpy(frame.data() + sizeof(uint32_t),
+                    body.data(),
+                    body.size());
+        return frame;
+    };
+
+    if (payLoad->size() <= CHUNK_PAYLOAD_SIZE) {
+        // send: [size][id][response][flags][payload length][payload bytes]
+        BinarySerializer ser;
+        ser.AddField(id);
+        ser.AddField<bool>(response);
+        ser.AddField(flags);
+        ser.AddField(*payLoad);
+        return WriteFrame(*session, toFrame(ser));
+    }
 
-    std::vector<uint8_t> packet(sizeof(uint32_t) + body.size());
-    
-    std::memcpy(packet.data(), &len, sizeof(uint32_t));
-    std::memcpy(packet.data() + sizeof(uint32_t), 
-                body.data(), 
-                body.size());
+    // send: [size][id][response][flags|chunked][sequence][total size][chunk length][chunk bytes] per chunk
+    uint32_t totalSize = static_cast<uint32_t>(payLoad->size());
+    uint32_t sequence = 0;
+    for (size_t offset = 0; offset < payLoad->size(); offset += CHUNK_PAYLOAD_SIZE) {
+        size_t chunkSize = std::min(CHUNK_PAYLOAD_SIZE, payLoad->size() - offset);
+
+        BinarySerializer ser;
+        ser.AddField(id);
+        ser.AddField<bool>(response);
+        ser.AddField(static_cast<uint8_t>(flags | PAYLOAD_FLAG_CHUNKED));
+        ser.AddField(sequence++);
+        ser.AddField(totalSize);
+        ser.AddField(payLoad->substr(offset, chunkSize));
+
+        if (!WriteFrame(*session, toFrame(ser)))
+            return false;
+    }
+    return true;
+}
 
-    return NET_WriteToStreamSocket(client, packet.data(), static_cast<int>(packet.size()));
+bool GameServerLogic::TryCompress(const ClientSession& session, const std::string& payload, std::string& outCompressed) {
+    if (payload.size() < COMPRESSION_THRESHOLD || !session.acceptsCompression)
+        return false;
+
+    ScopedLatency timer(m_compressTime);
+    return OTN::CompressOTN(payload, outCompressed) && outCompressed.size() < payload.size();
 }
 
-void GameServerLogic::SentError(NET_StreamSocket* client, uint32_t requestID, const std::string& errorMsg) {
-    if (!client)
+bool GameServerLogic::WriteFrame(ClientSession& session, std::vector<uint8_t>&& frame) {
+    // workers and the sql responses send to the same client, frames must not interleave.
+    // chunks of different messages may, they are told apart by their stream id
+    std::lock_guard guard(session.sendMutex);
+    if (session.closed)
+        return false;
+
+    session.outbound.push_back(std::move(frame));
+    while (!session.outbound.empty()) {
+        const auto& next = session.outbound.front();
+        if (!NET_WriteToStreamSocket(session.client, next.data(), static_cast<int>(next.size())))
+            return false;
+        m_sentBytesCounter.fetch_add(next.size(), std::memory_order_relaxed);
+        session.outbound.pop_front();
+    }
+    return true;
+}
+
+bool GameServerLogic::SendStreamSegment(const ClientSessionPtr& session, uint32_t requestID, const std::string& segment, bool last) {
+    if (!session || !session->client)
+        return false;
+
+    uint8_t flags = PAYLOAD_FLAG_STREAMED;
+    const std::string* data = &segment;
+    std::string compressed;
+    if (TryCompress(*session, *data, compressed)) {
+        flags |= PAYLOAD_FLAG_COMPRESSED;
+        data = &compressed;
+    }
+
+    // the end of the stream is a single empty frame
+    size_t frameCount = last ? 1 : std::max<size_t>(1, (data->size() + CHUNK_PAYLOAD_SIZE - 1) / CHUNK_PAYLOAD_SIZE);
+
+    uint32_t sequence = 0;
+    {
+        std::lock_guard guard(session->sendMutex);
+        auto it = session->outboundStreams.find(requestID);
+        if (it == session->outboundStreams.end())
+            return false;
+        sequence = it->second.nextSequence;
+        it->second.nextSequence += static_cast<uint32_t>(frameCount);
+    }
+
+    for (size_t i = 0; i < frameCount; ++i) {
+        size_t offset = i * CHUNK_PAYLOAD_SIZE;
+        std::string_view piece = last ? std::string_view{} : std::string_view(*data).substr(offset, CHUNK_PAYLOAD_SIZE);
+
+        // send: [size][id][response][flags|streamed][sequence][segment end][stream end][piece length][piece bytes]
+        BinarySerializer ser;
+        ser.AddField(requestID);
+        ser.AddField<bool>(true);
+        ser.AddField(flags);
+        ser.AddField(sequence++);
+        ser.AddField<bool>(!last && i + 1 == frameCount);
+        ser.AddField<bool>(last);
+        ser.AddField(std::string(piece));
+
+        std::vector<uint8_t> body = ser.ToBuffer();
+        uint32_t len = static_cast<uint32_t>(body.size());
+
+        std::vector<uint8_t> frame(sizeof(uint32_t) + body.size());
+        std::memcpy(frame.data(), &len, sizeof(uint32_t));
+        std::memcpy(frame.data() + sizeof(uint32_t), body.data(), body.size());
+
+        if (!WriteFrame(*session, std::move(frame)))
+            return false;
+    }
+    return true;
+}
+
+void GameServerLogic::ReleaseDrainedStreams(ClientSession& session) {
+    if (session.closed || session.outboundStreams.empty())
+        return;
+
+    int pending = NET_GetStreamSocketPendingWrites(session.client);
+    if (pending < 0 || static_cast<size_t>(pending) > STREAM_DRAIN_BYTES)
         return;
 
+    for (auto& [id, stream] : session.outboundStreams) {
+        if (stream.unreleased == 0)
+            continue;
+        stream.flow->Release(stream.unreleased);
+        stream.unreleased = 0;
+    }
+}
+
+void GameServerLogic::CancelStreams(ClientSession& session) {
+    for (auto& [id, stream] : session.outboundStreams) {
+        if (stream.flow)
+            stream.flow->Cancel();
+    }
+    session.outboundStreams.clear();
+}
+
+void GameServerLogic::SentError(const ClientSessionPtr& session, uint32_t requestID, const std::string& errorMsg) {
+    if (!session)
+        return;
+
+    m_errorCounter.fetch_add(1, std::memory_order_relaxed);
+
     Request rq;
     rq.id = requestID;
     rq.response = false;
     rq.otnPayload = errorMsg;
 
-    SentRequest(client, rq);
+    SentRequest(session, rq);
 }
\ No newline at end of file
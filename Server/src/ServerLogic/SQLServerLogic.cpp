@@ -1,26 +1,43 @@
 ﻿#include <memory>
+#include <map>
 #include <iostream>
 #include <stdexcept>
+#include <algorithm>
+#include <unordered_map>
+#include <condition_variable>
 
 #include "NetServerManager.h"
 #include "ServerLogic/SQLServerLogic.h"
 
 SQLServerLogic::SQLServerLogic(NetServer* server, const DBConfig& config)
-    : m_config(config), IServerLogic(server){
+    : DBServerLogic(server, config) {
+}
+
+SQLServerLogic::~SQLServerLogic() {
+    // finishes the queued actions before the connections are closed
+    if (m_connected)
+        FlushTraining();
+    m_workers.Stop();
+    if (m_connected) {
+        std::cout << "SQLServerLogic: Statement cache hits " << m_connections.GetStatementCacheHits()
+            << ", misses " << m_connections.GetStatementCacheMisses() << '\n';
+    }
+    m_connections.Close();
 }
 
 void SQLServerLogic::OnMessage(NET_StreamSocket* client, const std::string& msg) {
 }
 
-void SQLServerLogic::OnServerMessage(const std::string& serverName, const std::string& msg) {    
+void SQLServerLogic::OnRun() {
+    if (m_connected && m_reports.IsFlushDue())
+        FlushTraining();
+}
+
+void SQLServerLogic::OnServerMessage(ServerMessage& msg) {    
     if (!m_connected)
         Connect();
     
-    OTN::OTNReader reader;
-    if (!reader.ReadString(msg))
-        return;
-
-    auto header = reader.TryGetObject("header");
+    auto header = msg.TryGetObject("header");
     if (!header)
         return;
 
@@ -30,28 +47,151 @@ void SQLServerLogic::OnServerMessage(const std::string& serverName, const std::s
     if (!action || !requestID)
         return;
 
-    if (*action == "InsertAgents")
-        HandleInsertAgents(serverName, static_cast<uint32_t>(*requestID), reader);
-    else if (*action == "GetAgentIDs")
-        HandleGetAgentIDs(serverName, static_cast<uint32_t>(*requestID), reader);
-    else if (*action == "HandleGetMissinAgents")
-        HandleGetMissinAgents(serverName, static_cast<uint32_t>(*requestID), reader);
-    else if(*action == "HandleDeleteAgents")
-        HandleDeleteAgents(serverName, static_cast<uint32_t>(*requestID), reader);
-    else if(*action == "HandleDirtyAgents")
-        HandleUpdateAgents(serverName, static_cast<uint32_t>(*requestID), reader);
-    else
+    uint32_t id = static_cast<uint32_t>(*requestID);
+    if (*action == "ReportGames") {
+        if (m_connected)
+            HandleReportGames(msg.source, id, msg);
+        else
+            SentError("Not connected to DB", msg.source, "ReportGamesResult", id);
+        return;
+    }
+
+    struct ActionEntry {
+        SQLAction handler;
+        const char* resultAction;
+        const char* agentIDColumn;// < orders the action per agent, nullptr if it can run anywhere
+    };
+
+    // inserts only create new agents and reads can run anywhere, deletes and updates are ordered per agent
+    static const std::unordered_map<std::string_view, ActionEntry> actions = {
+        { "InsertAgents", { &SQLServerLogic::HandleInsertAgents, "InsertAgentsResult", nullptr } },
+        { "GetAgentIDs", { &SQLServerLogic::HandleGetAgentIDs, "GetAgentIDResult", nullptr } },
+        { "HandleGetMissinAgents", { &SQLServerLogic::HandleGetMissinAgents, "HandleGetMissinAgents", nullptr } },
+        { "HandleDeleteAgents", { &SQLServerLogic::HandleDeleteAgents, "HandleDeleteAgentsResult", "ids" } },
+        { "GetAgentChanges", { &SQLServerLogic::HandleGetAgentChanges, "GetAgentChanges", nullptr } },
+        { "HandleDirtyAgents", { &SQLServerLogic::HandleUpdateAgents, "HandleUpdateAgentsResult", "server_id" } },
+        { "HandleDirtyAgentStates", { &SQLServerLogic::HandleUpdateAgentStates, "HandleUpdateAgentsResult", "server_id" } },
+        { "SyncAgentDeltas", { &SQLServerLogic::HandleSyncAgentDeltas, "SyncAgentDeltasResult", "server_id" } },
+    };
+
+    auto it = actions.find(*action);
+    if (it == actions.end()) {
         std::cerr << "Unkown action sql server '" << *action << "'\n";
+        return;
+    }
+
+    const ActionEntry& entry = it->second;
+    auto shared = std::make_shared<ServerMessage>(std::move(msg));
+    std::vector<int64_t> agentIDs = entry.agentIDColumn ? CollectAgentIDs(*shared, entry.agentIDColumn) : std::vector<int64_t>{};
+    LatencyHistogram& dbTime = ServerMetrics::GetHistogram("chesslite_db_seconds", ServerMetrics::Label("action", *action));
+    SubmitAction(entry.handler, shared, id, entry.resultAction, dbTime, agentIDs);
+}
+
+void SQLServerLogic::SubmitAction(
+    SQLAction action,
+    std::shared_ptr<ServerMessage> msg,
+    uint32_t requestID,
+    const char* resultAction,
+    LatencyHistogram& dbTime,
+    const std::vector<int64_t>& agentIDs)
+{
+    auto queuedAt = std::chrono::steady_clock::now();
+    SubmitOrdered([this, action, msg, requestID, resultAction, &dbTime, queuedAt]() {
+        m_workerQueueWait.Record(std::chrono::steady_clock::now() - queuedAt);
+        ScopedLatency timer(dbTime);
+
+        SQLConnectionPool::Lease lease = m_connections.Acquire();
+        if (!lease) {
+            SentError("Not connected to DB", msg->source, resultAction, requestID);
+            return;
+        }
+
+        // the handlers catch their sql errors, this catches e.g. a failed segment of a stream
+        try {
+            (this->*action)(lease.Get(), msg->source, requestID, *msg);
+        }
+        catch (const std::exception& e) {
+            SentError(std::string("Server Error: ") + e.what(), msg->source, resultAction, requestID);
+        }
+    }, agentIDs);
+}
+
+void SQLServerLogic::SubmitOrdered(NetWorkerPool::Task&& run, const std::vector<int64_t>& agentIDs) {
+    size_t workerCount = m_workers.GetWorkerCount();
+    if (workerCount == 0) {
+        run();
+        return;
+    }
+
+    std::vector<size_t> lanes;
+    for (int64_t id : agentIDs) {
+        size_t lane = static_cast<size_t>(id) % workerCount;
+        if (std::find(lanes.begin(), lanes.end(), lane) == lanes.end())
+            lanes.push_back(lane);
+    }
+
+    if (lanes.empty()) {
+        m_workers.Submit(m_nextReadKey++, std::move(run));
+        return;
+    }
+
+    if (lanes.size() == 1) {
+        m_workers.Submit(lanes.front(), std::move(run));
+        return;
+    }
+
+    // every lane gets a part, the last part to arrive runs the action while the others wait,
+    // the lanes are submitted in message order so the parts can not wait on each other in a cycle
+    struct Barrier {
+        std::mutex mutex;
+        std::condition_variable cv;
+        size_t arrived = 0;
+        bool done = false;
+    };
+    auto barrier = std::make_shared<Barrier>();
+    size_t parts = lanes.size();
+
+    for (size_t lane : lanes) {
+        m_workers.Submit(lane, [barrier, parts, run]() {
+            std::unique_lock<std::mutex> lock(barrier->mutex);
+            if (++barrier->arrived < parts) {
+                barrier->cv.wait(lock, [&]() { return barrier->done; });
+                return;
+            }
+            lock.unlock();
+
+            run();
+
+            lock.lock();
+            barrier->done = true;
+            barrier->cv.notify_all();
+        });
+    }
+}
+
+std::vector<int64_t> SQLServerLogic::CollectAgentIDs(const ServerMessage& msg, const std::string& column) {
+    std::vector<int64_t> ids;
+    auto obj = msg.TryGetObject("body");
+    if (!obj)
+        return ids;
+
+    ids.reserve(obj->GetRowCount());
+    for (size_t i = 0; i < obj->GetRowCount(); i++) {
+        if (auto id = obj->TryGetValue<int64_t>(i, column))
+            ids.push_back(*id);
+    }
+    return ids;
 }
 
 void SQLServerLogic::HandleInsertAgents(
+    SQLPooledConnection* conn,
     const std::string& dstServer,
     uint32_t requestID,
-    OTN::OTNReader& reader)
+    ServerMessage& msg)
 {
     const char* actionName = "InsertAgentsResult";
 
-    if (!m_connection) {
+    if (!conn) {
         std::cerr << "Not connected to DB\n";
         SentError("Not connected to DB", dstServer, actionName, requestID);
         return;
@@ -63,11 +203,20 @@ void SQLServerLogic::HandleInsertAgents(
 
     try {
         // sets auto commit to false
-        TransactionGuard guard(m_connection.get());
+        TransactionGuard guard(conn->connection.get());
 
-        auto obj = reader.TryGetObject("body");
-        if (!obj) 
+        auto obj = msg.TryGetObject("body");
+        if (!obj) {
+            SentError("Failed to read the agents to insert", dstServer, actionName, requestID);
             return;
+        }
+
+        std::vector<int64_t> localIDs;
+        std::vector<std::tuple<std::string, std::string, int, int, int, int, int>> agentRows;
+        std::vector<std::optional<std::vector<OTN::OTNObject>>> agentBoardStates;
+        localIDs.reserve(obj->GetRowCount());
+        agentRows.reserve(obj->GetRowCount());
+        agentBoardStates.reserve(obj->GetRowCount());
 
         for (size_t i = 0; i < obj->GetRowCount(); ++i) {
             auto localID = obj->TryGetValue<int64_t>(i, "local_id");
@@ -81,116 +230,65 @@ void SQLServerLogic::HandleInsertAgents(
             if (!localID || !name || !config)
                 continue;
 
-            ExecuteStatement(R"""(
-                INSERT INTO agents 
-                (name, config, version, matches_played, matches_won, matches_played_white, matches_won_white)
-                VALUES (?, ?, ?, ?, ?, ?, ?);)""",
-                *name, *config, 0, 
+            localIDs.push_back(*localID);
+            agentRows.emplace_back(
+                *name, *config, 0,
                 (matches_played ? *matches_played : 0),
                 (matches_won ? *matches_won : 0),
                 (matches_played_white ? *matches_played_white : 0),
                 (matches_won_white ? *matches_won_white : 0)
-                );
-            auto currentAgentID = FetchLastInsertID();
-
-            if (!currentAgentID)
-                continue;
-
-            result.AddDataRow(*localID, *currentAgentID);
-
-            auto boardStates = obj->TryGetValue<std::vector<OTN::OTNObject>>(i, "board_states");
-            if (!boardStates || boardStates->empty())
-                continue;
+            );
+            agentBoardStates.push_back(obj->TryGetValue<std::vector<OTN::OTNObject>>(i, "board_states"));
+        }
 
-            for (auto& bs : *boardStates) {
-                auto stateStr = bs.TryGetValue<std::string>(0, "board_state");
-                auto moves = bs.TryGetValue<std::vector<OTN::OTNObject>>(0, "moves");
+        if (!agentRows.empty()) {
+            std::vector<int64_t> agentIDs = InsertRowsReturningIDs(conn, "agents", agentRows,
+                "name, config, version, matches_played, matches_won, matches_played_white, matches_won_white");
 
-                if (!stateStr || !moves)
-                    continue;
+            std::vector<BoardStateRow> states;
+            for (size_t i = 0; i < agentIDs.size(); ++i) {
+                result.AddDataRow(localIDs[i], agentIDs[i]);
 
-                ExecuteStatement(R"""(
-                INSERT INTO board_states 
-                (agent_id, board_state)
-                VALUES (?, ?);)""",
-                    *currentAgentID, *stateStr
-                );
-                auto currentBoardStateID = FetchLastInsertID();
-                if (!currentBoardStateID)
+                if (!agentBoardStates[i])
                     continue;
+                for (auto& bs : *agentBoardStates[i])
+                    states.push_back({ agentIDs[i], &bs });
+            }
 
-                std::vector<std::tuple<int64_t, float, float, float, float, float>> gameMoves;
-
-                for (auto& move : *moves) {
-                    auto eval = move.TryGetValue<float>(0, "eval");
-                    auto fromX = move.TryGetValue<float>(0, "from_x");
-                    auto fromY = move.TryGetValue<float>(0, "from_y");
-                    auto toX = move.TryGetValue<float>(0, "to_x");
-                    auto toY = move.TryGetValue<float>(0, "to_y");
-
-                    if (!eval || !fromX || !fromY || !toX || !toY)
-                        continue;
+            InsertBoardStates(conn, states);
 
-                    gameMoves.emplace_back(*currentBoardStateID, *eval, *fromX, *fromY, *toX, *toY);
-                }
-
-                ExecuteBatchInsert("game_moves", gameMoves, 
-                    "board_state_id, evaluation, from_x, from_y, to_x, to_y");
-            }
+            // all agents of the request are one change
+            StampChangeSequence(conn, agentIDs);
         }
         
         guard.commit();
     }
     catch (sql::SQLException& e) {
-        m_connection->rollback();
+        conn->connection->rollback();
         SentError(std::string("SQL Error: ") + e.what(), dstServer, actionName, requestID);
         return;
     }
 
-    OTN::OTNObject header = CreateRequestHeader(actionName, requestID);
-    OTN::OTNWriter writer;
-    writer.AppendObject(header);
-    writer.AppendObject(result);
-
-    std::string output;
-    writer.SaveToString(output);
-
-    NetServerManager::SendMessage(
-        m_server,
-        dstServer,
-        output
-    );
+    SendReply(dstServer, actionName, requestID, std::move(result));
 }
 
-void SQLServerLogic::HandleGetAgentIDs(const std::string& dstServer, uint32_t requestID, OTN::OTNReader& reader) {
+void SQLServerLogic::HandleGetAgentIDs(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& /*msg*/) {
     const char* actionName = "GetAgentIDResult";
 
-    if (!m_connection) {
+    if (!conn) {
         std::cerr << "Not connected to DB\n";
         SentError("Not connected to DB", dstServer, actionName, requestID);
         return;
     }
 
     try {
-        auto body = FetchStatement("SELECT id FROM agents;");
+        auto body = FetchStatement(conn, "SELECT id FROM agents;");
         if (!body) {
             SentError("Query returned no result", dstServer, actionName, requestID);
             return;
         }
 
-        OTN::OTNObject header = CreateRequestHeader(actionName, requestID);
-        OTN::OTNWriter writer;
-        writer.AppendObject(header);
-        writer.AppendObject(*body);
-
-        std::string output;
-        writer.SaveToString(output);
-
-        NetServerManager::SendMessage(
-            m_server,
-            dstServer,
-            output
-        );
+        SendReply(dstServer, actionName, requestID, std::move(*body));
     }
     catch (sql::SQLException& e) {
         SentError(std::string("SQL Error: ") + e.what(), dstServer, actionName, requestID);
@@ -198,17 +296,23 @@ void SQLServerLogic::HandleGetAgentIDs(const std::string& dstServer, uint32_t re
     }
 }
 
-void SQLServerLogic::HandleGetMissinAgents(const std::string& dstServer, uint32_t requestID, OTN::OTNReader& reader) {
+void SQLServerLogic::HandleGetMissinAgents(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& msg) {
     const char* actionName = "HandleGetMissinAgents";
 
-    if (!m_connection) {
+    if (!conn) {
         std::cerr << "Not connected to DB\n";
         SentError("Not connected to DB", dstServer, actionName, requestID);
         return;
     }
 
+    // the result is forwarded to the client segment by segment
+    if (!msg.stream) {
+        SentError("Missing agents can only be requested as a stream", dstServer, actionName, requestID);
+        return;
+    }
+
     try {
-        auto obj = reader.TryGetObject("body");
+        auto obj = msg.TryGetObject("body");
         if (!obj) {
             SentError("Failed to Get missing agents", dstServer, actionName, requestID);
             return;
@@ -221,100 +325,140 @@ void SQLServerLogic::HandleGetMissinAgents(const std::string& dstServer, uint32_
                 list.push_back(*id);
         }
 
-        std::optional<OTN::OTNObject> agentObj;
-        std::optional<OTN::OTNObject> boardStateObj;
-        std::optional<OTN::OTNObject> gameMoveObj;
+        // all tables and the change sequence are read from one snapshot
+        TransactionGuard guard(conn->connection.get());
+        StreamTarget target{ dstServer, actionName, requestID, msg.stream };
+        int64_t sequence = FetchChangeSequence(conn);
 
+        bool complete = false;
         if (list.empty()) {
-            agentObj = FetchStatement("SELECT * FROM agents;");
-            boardStateObj = FetchStatement("SELECT * FROM board_states;");
-            gameMoveObj = FetchStatement("SELECT * FROM game_moves;");
+            complete = StreamAgentTables(conn, target, "TRUE");
         }
         else {
-            std::string agentQuery = "SELECT * FROM agents WHERE id NOT IN (";
-            for (size_t i = 0; i < list.size(); ++i) {
-                agentQuery += "?";
-                if (i + 1 < list.size()) 
-                    agentQuery += ",";
-            }
-            agentQuery += ");";
-
-            agentObj = FetchStatement(agentQuery, list);
+            std::string placeholders = BuildPlaceholders(PadToBucket(list));
+            complete = StreamAgentTables(conn, target, "a.id NOT IN (" + placeholders + ")", list);
+        }
 
-            std::string boardQuery = "SELECT * FROM board_states WHERE agent_id NOT IN (";
-            for (size_t i = 0; i < list.size(); ++i) {
-                boardQuery += "?";
-                if (i + 1 < list.size()) boardQuery += ",";
-            }
-            boardQuery += ");";
+        // the client continues with GetAgentChanges from this sequence
+        complete = complete && SendChangeSequence(target, sequence, {});
+        FinishStream(target, complete);
+    }
+    catch (sql::SQLException& e) {
+        SentError(std::string("SQL Error: ") + e.what(), dstServer, actionName, requestID);
+    }
+}
 
-            boardStateObj = FetchStatement(boardQuery, list);
+void SQLServerLogic::HandleGetAgentChanges(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& msg) {
+    const char* actionName = "GetAgentChanges";
 
-            if (boardStateObj && boardStateObj->GetRowCount() > 0) {
-                std::vector<int64_t> boardIds;
-                boardIds.reserve(boardStateObj->GetRowCount());
-                for (size_t i = 0; i < boardStateObj->GetRowCount(); ++i) {
-                    if (auto id = boardStateObj->TryGetValue<int64_t>(i, "id"))
-                        boardIds.push_back(*id);
-                }
-
-                if (!boardIds.empty()) {
-                    std::string moveQuery = "SELECT * FROM game_moves WHERE board_state_id IN (";
-                    for (size_t i = 0; i < boardIds.size(); ++i) {
-                        moveQuery += "?";
-                        if (i + 1 < boardIds.size()) moveQuery += ",";
-                    }
-                    moveQuery += ");";
+    if (!conn) {
+        std::cerr << "Not connected to DB\n";
+        SentError("Not connected to DB", dstServer, actionName, requestID);
+        return;
+    }
 
-                    gameMoveObj = FetchStatement(moveQuery, boardIds);
-                }
-            }
-        }
+    if (!msg.stream) {
+        SentError("Agent changes can only be requested as a stream", dstServer, actionName, requestID);
+        return;
+    }
 
-        if (!agentObj) {
-            SentError("Failed to Get missing agents", dstServer, actionName, requestID);
+    try {
+        auto obj = msg.TryGetObject("body");
+        auto since = obj ? obj->TryGetValue<int64_t>(0, "since") : std::nullopt;
+        if (!since) {
+            SentError("Failed to read the change sequence of the request", dstServer, actionName, requestID);
             return;
         }
 
-        OTN::OTNObject header = CreateRequestHeader(actionName, requestID);
-        OTN::OTNWriter writer;
-        writer.AppendObject(header);
-        agentObj->SetObjectName("agents");
-        writer.AppendObject(*agentObj);
+        // changes committed after the snapshot have a larger sequence and are sent by the next request
+        TransactionGuard guard(conn->connection.get());
+        StreamTarget target{ dstServer, actionName, requestID, msg.stream };
+        int64_t sequence = FetchChangeSequence(conn);
 
-        if (boardStateObj) {
-            boardStateObj->SetObjectName("board_states");
-            writer.AppendObject(*boardStateObj);
-        }
-        if (gameMoveObj) {
-            gameMoveObj->SetObjectName("game_moves");
-            writer.AppendObject(*gameMoveObj);
-        }
+        bool complete = true;
+        std::vector<int64_t> deleted;
+        if (sequence > *since) {
+            complete = StreamAgentTables(conn, target, "a.change_seq > ? AND a.change_seq <= ?", *since, sequence);
 
-        std::string output;
-        if (!writer.SaveToString(output)) {
-            SentError("Failed to Get missing agents", dstServer, actionName, requestID);
-            return;
+            auto tombstones = FetchStatement(conn,
+                "SELECT agent_id FROM agent_tombstones WHERE change_seq > ? AND change_seq <= ?;",
+                *since, sequence
+            );
+            if (!tombstones)
+                throw sql::SQLException("GetAgentChanges: Failed to read agent_tombstones");
+
+            deleted.reserve(tombstones->GetRowCount());
+            for (size_t i = 0; i < tombstones->GetRowCount(); ++i) {
+                if (auto id = tombstones->TryGetValue<int64_t>(i, "agent_id"))
+                    deleted.push_back(*id);
+            }
         }
 
-        NetServerManager::SendMessage(m_server, dstServer, output);
+        complete = complete && SendChangeSequence(target, sequence, deleted);
+        FinishStream(target, complete);
     }
     catch (sql::SQLException& e) {
         SentError(std::string("SQL Error: ") + e.what(), dstServer, actionName, requestID);
     }
 }
 
-void SQLServerLogic::HandleDeleteAgents(const std::string& dstServer, uint32_t requestID, OTN::OTNReader& reader) {
+bool SQLServerLogic::SendTableBatch(StreamTarget& target, const std::string& table, OTN::OTNObject&& batch) {
+    batch.SetObjectName(table);
+    OTN::OTNWriter writer;
+    writer.AppendObject(batch);
+    return SendSegment(target, writer, table);
+}
+
+bool SQLServerLogic::SendBlobBatch(StreamTarget& target, OTN::OTNObject&& batch) {
+    OTN::OTNObject states{ "board_states" };
+    states.SetNames("id", "agent_id", "board_state");
+    states.SetTypes("int64", "int64", "String");
+
+    OTN::OTNObject moves{ "game_moves" };
+    moves.SetNames("id", "board_state_id", "evaluation", "from_x", "from_y", "to_x", "to_y");
+    moves.SetTypes("int64", "int64", "float", "int", "int", "int", "int");
+
+    for (size_t row = 0; row < batch.GetRowCount(); ++row) {
+        auto agentID = batch.TryGetValue<int64_t>(row, "agent_id");
+        auto blob = batch.TryGetValue<std::string>(row, "board_states");
+        if (!agentID || !blob)
+            continue;
+
+        std::vector<StoredBoardState> decoded;
+        std::string error;
+        if (!AgentBlobCodec::Decode(*blob, decoded, error)) {
+            std::cerr << "SQLServerLogic: Skipped board states of agent " << *agentID << ": " << error << '\n';
+            continue;
+        }
+
+        for (const auto& state : decoded) {
+            int64_t stateID = target.nextStateID++;
+            states.AddDataRow(stateID, *agentID, state.boardState);
+
+            for (const auto& move : state.moves) {
+                moves.AddDataRow(target.nextMoveID++, stateID, move.eval,
+                    static_cast<int>(move.fromX), static_cast<int>(move.fromY),
+                    static_cast<int>(move.toX), static_cast<int>(move.toY));
+            }
+        }
+    }
+
+    OTN::OTNWriter writer;
+    writer.AppendObject(states).AppendObject(moves);
+    return SendSegment(target, writer, "agent_blobs");
+}
+
+void SQLServerLogic::HandleDeleteAgents(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& msg) {
     const char* actionName = "HandleDeleteAgentsResult";
 
-    if (!m_connection) {
+    if (!conn) {
         std::cerr << "Not connected to DB\n";
         SentError("Not connected to DB", dstServer, actionName, requestID);
         return;
     }
 
     try {
-        auto obj = reader.TryGetObject("body");
+        auto obj = msg.TryGetObject("body");
         if (!obj) {
             SentError("Failed to delete agents", dstServer, actionName, requestID);
             return;
@@ -327,33 +471,36 @@ void SQLServerLogic::HandleDeleteAgents(const std::string& dstServer, uint32_t r
                 ids.push_back(*id);
         }
 
-        std::string query = "DELETE FROM agents WHERE id IN (";
-        for (size_t i = 0; i < ids.size(); ++i) {
-            query += "?";
-            if (i + 1 < ids.size()) 
-                query += ",";
-        }
-        query += ");";
+        if (!ids.empty()) {
+            TransactionGuard guard(conn->connection.get());
+            std::string placeholders = BuildPlaceholders(PadToBucket(ids));
+
+            auto existing = FetchStatement(conn, "SELECT id FROM agents WHERE id IN (" + placeholders + ") FOR UPDATE;", ids);
+            if (!existing)
+                throw sql::SQLException("DeleteAgents: Failed to read the deleted agents");
+            ExecuteStatement(conn, "DELETE FROM agents WHERE id IN (" + placeholders + ");", ids);
+
+            // clients that sync by change sequence learn about the delete from the tombstone
+            if (existing->GetRowCount() > 0) {
+                int64_t sequence = NextChangeSequence(conn);
+                std::vector<std::tuple<int64_t, int64_t>> tombstones;
+                tombstones.reserve(existing->GetRowCount());
+                for (size_t row = 0; row < existing->GetRowCount(); ++row) {
+                    if (auto id = existing->TryGetValue<int64_t>(row, "id"))
+                        tombstones.emplace_back(*id, sequence);
+                }
 
-        ExecuteStatement(query, ids);
+                ExecuteBatchInsert(conn, "agent_tombstones", tombstones, "agent_id, change_seq",
+                    "AS new ON DUPLICATE KEY UPDATE change_seq = new.change_seq");
+            }
+            guard.commit();
+        }
 
         OTN::OTNObject body{ "Result" };
         body.SetNames("empty");
         body.SetTypes("int");
 
-        OTN::OTNObject header = CreateRequestHeader(actionName, requestID);
-        OTN::OTNWriter writer;
-        writer.AppendObject(header);
-        writer.AppendObject(body);
-
-        std::string output;
-        writer.SaveToString(output);
-
-        NetServerManager::SendMessage(
-            m_server,
-            dstServer,
-            output
-        );
+        SendReply(dstServer, actionName, requestID, std::move(body));
     }
     catch (sql::SQLException& e) {
         SentError(std::string("SQL Error: ") + e.what(), dstServer, actionName, requestID);
@@ -361,10 +508,18 @@ void SQLServerLogic::HandleDeleteAgents(const std::string& dstServer, uint32_t r
     }
 }
 
-void SQLServerLogic::HandleUpdateAgents(const std::string& dstServer, uint32_t requestID, OTN::OTNReader& reader) {
+void SQLServerLogic::HandleUpdateAgents(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& msg) {
+    UpdateAgents(conn, dstServer, requestID, msg, false);
+}
+
+void SQLServerLogic::HandleUpdateAgentStates(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& msg) {
+    UpdateAgents(conn, dstServer, requestID, msg, true);
+}
+
+void SQLServerLogic::UpdateAgents(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& msg, bool statesOnly) {
     const char* actionName = "HandleUpdateAgentsResult";
 
-    if (!m_connection) {
+    if (!conn) {
         std::cerr << "Not connected to DB\n";
         SentError("Not connected to DB", dstServer, actionName, requestID);
         return;
@@ -375,11 +530,45 @@ void SQLServerLogic::HandleUpdateAgents(const std::string& dstServer, uint32_t r
     result.SetTypes("int64", "int64");
 
     try {
-        TransactionGuard guard(m_connection.get());
+        TransactionGuard guard(conn->connection.get());
 
-        auto obj = reader.TryGetObject("body");
-        if (!obj)
+        auto obj = msg.TryGetObject("body");
+        if (!obj) {
+            SentError("Failed to read the agents to update", dstServer, actionName, requestID);
             return;
+        }
+
+        // one version check for all agents
+        std::vector<int64_t> serverIDs;
+        serverIDs.reserve(obj->GetRowCount());
+        for (size_t i = 0; i < obj->GetRowCount(); ++i) {
+            if (auto serverId = obj->TryGetValue<int64_t>(i, "server_id"))
+                serverIDs.push_back(*serverId);
+        }
+
+        std::unordered_map<int64_t, int64_t> storedVersions;
+        for (size_t start = 0; start < serverIDs.size(); start += MAX_ROWS_PER_STATEMENT) {
+            size_t count = std::min(MAX_ROWS_PER_STATEMENT, serverIDs.size() - start);
+            std::vector<int64_t> chunk(serverIDs.begin() + start, serverIDs.begin() + start + count);
+            count = PadToBucket(chunk);
+
+            auto versions = FetchStatement(conn,
+                "SELECT id, version FROM agents WHERE id IN (" + BuildPlaceholders(count) + ");",
+                chunk
+            );
+            if (!versions)
+                continue;
+
+            for (size_t row = 0; row < versions->GetRowCount(); ++row) {
+                auto id = versions->TryGetValue<int64_t>(row, "id");
+                auto version = versions->TryGetValue<int>(row, "version");
+                if (id && version)
+                    storedVersions[*id] = *version;
+            }
+        }
+
+        std::vector<int64_t> updatedIDs;
+        std::vector<std::optional<std::vector<OTN::OTNObject>>> agentBoardStates;
 
         for (size_t i = 0; i < obj->GetRowCount(); ++i) {
             auto serverId = obj->TryGetValue<int64_t>(i, "server_id");
@@ -391,20 +580,19 @@ void SQLServerLogic::HandleUpdateAgents(const std::string& dstServer, uint32_t r
             if (!serverId || !version || !name || !config)
                 continue;
 
-            auto checkResult = FetchStatement(
-                "SELECT id FROM agents WHERE id = ? AND version < ?",
-                *serverId, *version
-            );
-
-            if (!checkResult || checkResult->GetRowCount() == 0)
+            // unknown agents and agents that are already up to date are skipped
+            auto stored = storedVersions.find(*serverId);
+            if (stored == storedVersions.end() || stored->second >= *version)
                 continue;
+            // the same agent twice in one request only applies the first
+            stored->second = *version;
 
             auto matches_played = obj->TryGetValue<int>(i, "matches_played");
             auto matches_won = obj->TryGetValue<int>(i, "matches_won");
             auto matches_played_white = obj->TryGetValue<int>(i, "matches_played_white");
             auto matches_won_white = obj->TryGetValue<int>(i, "matches_won_white");
 
-            ExecuteStatement(R"""(
+            ExecuteStatement(conn, R"""(
                 UPDATE agents 
                 SET name = ?, config = ?, version = ?, 
                     matches_played = ?, matches_won = ?, 
@@ -417,145 +605,657 @@ void SQLServerLogic::HandleUpdateAgents(const std::string& dstServer, uint32_t r
                 (matches_won_white ? *matches_won_white : 0),
                 *serverId
             );
-            //delete all old board states/game moves
-            ExecuteStatement(
-                "DELETE FROM board_states WHERE agent_id = ?;",
-                *serverId
-            );
 
-            // create ne board states
-            auto boardStates = obj->TryGetValue<std::vector<OTN::OTNObject>>(i, "board_states");
-            if (boardStates && !boardStates->empty()) {
-                for (auto& bs : *boardStates) {
-                    auto stateStr = bs.TryGetValue<std::string>(0, "board_state");
-                    auto moves = bs.TryGetValue<std::vector<OTN::OTNObject>>(0, "moves");
-
-                    if (!stateStr || !moves)
-                        continue;
-
-                    ExecuteStatement(R"""(
-                        INSERT INTO board_states 
-                        (agent_id, board_state)
-                        VALUES (?, ?);)""",
-                        *serverId, *stateStr
-                    );
-
-                    auto currentBoardStateID = FetchLastInsertID();
-                    if (!currentBoardStateID)
-                        continue;
-
-                    std::vector<std::tuple<int64_t, float, float, float, float, float>> gameMoves;
-
-                    for (auto& move : *moves) {
-                        auto eval = move.TryGetValue<float>(0, "eval");
-                        auto fromX = move.TryGetValue<float>(0, "from_x");
-                        auto fromY = move.TryGetValue<float>(0, "from_y");
-                        auto toX = move.TryGetValue<float>(0, "to_x");
-                        auto toY = move.TryGetValue<float>(0, "to_y");
-
-                        if (!eval || !fromX || !fromY || !toX || !toY)
-                            continue;
-
-                        gameMoves.emplace_back(*currentBoardStateID, *eval, *fromX, *fromY, *toX, *toY);
-                    }
-
-                    if (!gameMoves.empty()) {
-                        ExecuteBatchInsert("game_moves", gameMoves,
-                            "board_state_id, evaluation, from_x, from_y, to_x, to_y");
-                    }
+            updatedIDs.push_back(*serverId);
+            agentBoardStates.push_back(obj->TryGetValue<std::vector<OTN::OTNObject>>(i, "board_states"));
+            result.AddDataRow(*localID, *version);
+        }
+
+        if (statesOnly) {
+            std::vector<std::pair<int64_t, StoredBoardState>> changed;
+            for (size_t i = 0; i < updatedIDs.size(); ++i) {
+                if (!agentBoardStates[i])
+                    continue;
+                for (const auto& bs : *agentBoardStates[i]) {
+                    StoredBoardState state;
+                    if (ReadStoredBoardState(bs, state))
+                        changed.emplace_back(updatedIDs[i], std::move(state));
                 }
             }
 
-            result.AddDataRow(*localID, *version);
+            WriteBoardStateDelta(conn, std::move(changed));
         }
+        else {
+            //delete all old board states/game moves of the updated agents at once
+            DeleteBoardStates(conn, updatedIDs, m_config.storage);
+
+            // create the new board states
+            std::vector<BoardStateRow> states;
+            for (size_t i = 0; i < updatedIDs.size(); ++i) {
+                if (!agentBoardStates[i])
+                    continue;
+                for (auto& bs : *agentBoardStates[i])
+                    states.push_back({ updatedIDs[i], &bs });
+            }
+
+            InsertBoardStates(conn, states);
+        }
+
+        // a request without a real update is no change
+        if (!updatedIDs.empty())
+            StampChangeSequence(conn, updatedIDs);
 
         guard.commit();
     }
     catch (sql::SQLException& e) {
-        m_connection->rollback();
+        conn->connection->rollback();
         SentError(std::string("SQL Error: ") + e.what(), dstServer, actionName, requestID);
         return;
     }
 
-    OTN::OTNObject header = CreateRequestHeader(actionName, requestID);
-    OTN::OTNWriter writer;
-    writer.AppendObject(header);
-    writer.AppendObject(result);
+    SendReply(dstServer, actionName, requestID, std::move(result));
+}
 
-    std::string output;
-    writer.SaveToString(output);
+void SQLServerLogic::HandleReportGames(const std::string& dstServer, uint32_t requestID, ServerMessage& msg) {
+    const char* actionName = "ReportGamesResult";
 
-    NetServerManager::SendMessage(
-        m_server,
-        dstServer,
-        output
-    );
+    auto obj = msg.TryGetObject("body");
+    if (!obj) {
+        SentError("Failed to read the reported games", dstServer, actionName, requestID);
+        return;
+    }
+
+    int accepted = 0;
+    for (size_t i = 0; i < obj->GetRowCount(); ++i) {
+        if (m_reports.AddReport(*obj, i))
+            accepted++;
+    }
+
+    // acknowledged once buffered, a crash loses at most one flush interval of games
+    OTN::OTNObject result{ "Result" };
+    result.SetNames("accepted");
+    result.SetTypes("int");
+    result.AddDataRow(accepted);
+
+    SendReply(dstServer, actionName, requestID, std::move(result));
 }
 
-OTN::OTNObject SQLServerLogic::CreateRequestHeader(const std::string& action, uint32_t requestID, bool response) {
-    OTN::OTNObject headerObj{ "header" };
+void SQLServerLogic::FlushTraining() {
+    auto training = std::make_shared<std::unordered_map<int64_t, AgentTraining>>(m_reports.Take());
+    if (training->empty())
+        return;
+
+    std::vector<int64_t> agentIDs;
+    agentIDs.reserve(training->size());
+    for (const auto& [agentID, agentTraining] : *training)
+        agentIDs.push_back(agentID);
 
-    headerObj.SetNames("action", "request_id", "response");
-    headerObj.SetTypes("String", "int64", "bool");
-    headerObj.AddDataRow(action, requestID, response);
+    static LatencyHistogram& dbTime = ServerMetrics::GetHistogram("chesslite_db_seconds", ServerMetrics::Label("action", "FlushTraining"));
+    auto queuedAt = std::chrono::steady_clock::now();
+    SubmitOrdered([this, training, queuedAt]() {
+        m_workerQueueWait.Record(std::chrono::steady_clock::now() - queuedAt);
+        ScopedLatency timer(dbTime);
 
-    return headerObj;
+        SQLConnectionPool::Lease lease = m_connections.Acquire();
+        if (!lease) {
+            std::cerr << "SQLServerLogic: Dropped the training of " << training->size() << " agents, not connected to DB\n";
+            return;
+        }
+
+        try {
+            ApplyTraining(lease.Get(), *training);
+        }
+        catch (sql::SQLException& e) {
+            std::cerr << "SQLServerLogic: Failed to train " << training->size() << " agents: " << e.what() << '\n';
+        }
+    }, agentIDs);
 }
 
-void SQLServerLogic::SentError(
-    const std::string& errorMsg, 
-    const std::string dstServer, 
-    const std::string& action, 
-    uint32_t requestID) 
-{
-    OTN::OTNObject header = CreateRequestHeader(action, requestID, false);
-    
-    OTN::OTNObject body{ "body" };
-    body.SetNames("error");
-    body.SetTypes("String");
-    body.AddDataRow(errorMsg);
+std::vector<std::pair<int64_t, int64_t>> SQLServerLogic::ApplyTraining(SQLPooledConnection* conn, const std::unordered_map<int64_t, AgentTraining>& training) {
+    TransactionGuard guard(conn->connection.get());
+
+    // deleted agents are skipped, their board states would violate the foreign key
+    // the rows stay locked until the commit, so the read version + 1 is the trained version
+    std::vector<int64_t> agentIDs;
+    std::vector<std::pair<int64_t, int64_t>> trained;
+    agentIDs.reserve(training.size());
+    trained.reserve(training.size());
+    {
+        std::vector<int64_t> reported;
+        reported.reserve(training.size());
+        for (const auto& [agentID, agentTraining] : training)
+            reported.push_back(agentID);
+
+        for (size_t start = 0; start < reported.size(); start += MAX_ROWS_PER_STATEMENT) {
+            size_t count = std::min(MAX_ROWS_PER_STATEMENT, reported.size() - start);
+            std::vector<int64_t> chunk(reported.begin() + start, reported.begin() + start + count);
+            count = PadToBucket(chunk);
+
+            auto existing = FetchStatement(conn, "SELECT id, version FROM agents WHERE id IN (" + BuildPlaceholders(count) + ") FOR UPDATE;", chunk);
+            if (!existing)
+                throw sql::SQLException("ApplyTraining: Failed to read the trained agents");
+
+            for (size_t row = 0; row < existing->GetRowCount(); ++row) {
+                auto id = existing->TryGetValue<int64_t>(row, "id");
+                // agents.version is an INT column, ReadResultRow hands it out as int
+                auto version = existing->TryGetValue<int>(row, "version");
+                if (!id || !version)
+                    continue;
 
-    OTN::OTNWriter writer;
-    writer.AppendObject(header);
-    writer.AppendObject(body);
+                agentIDs.push_back(*id);
+                trained.emplace_back(*id, *version + 1);
+            }
+        }
+    }
 
-    std::string output;
-    writer.SaveToString(output);
+    if (agentIDs.empty())
+        return trained;
+
+    for (int64_t agentID : agentIDs) {
+        const AgentTraining& agentTraining = training.at(agentID);
+        ExecuteStatement(conn, R"""(
+            UPDATE agents
+            SET version = version + 1,
+                matches_played = matches_played + ?, matches_won = matches_won + ?,
+                matches_played_white = matches_played_white + ?, matches_won_white = matches_won_white + ?
+            WHERE id = ?;)""",
+            agentTraining.matchesPlayed, agentTraining.matchesWon,
+            agentTraining.matchesPlayedWhite, agentTraining.matchesWonWhite,
+            agentID
+        );
+    }
 
-    NetServerManager::SendMessage(
-        m_server,
-        dstServer,
-        output
-    );
+    if (m_config.storage == AgentStorage::BLOB) {
+        for (size_t start = 0; start < agentIDs.size(); start += BLOB_BATCH_ROWS) {
+            size_t count = std::min(BLOB_BATCH_ROWS, agentIDs.size() - start);
+            std::vector<int64_t> chunk(agentIDs.begin() + start, agentIDs.begin() + start + count);
+
+            std::unordered_map<int64_t, std::vector<StoredBoardState>> stored;
+            for (auto& [agentID, state] : LoadBoardStates(conn, chunk, AgentStorage::BLOB))
+                stored[agentID].push_back(std::move(state));
+
+            std::vector<std::pair<int64_t, StoredBoardState>> trainedStates;
+            for (int64_t agentID : chunk) {
+                auto& agentStates = stored[agentID];
+                training.at(agentID).ApplyTo(agentStates);
+                for (auto& state : agentStates)
+                    trainedStates.emplace_back(agentID, std::move(state));
+            }
+
+            DeleteBoardStates(conn, chunk, AgentStorage::BLOB);
+            WriteBoardStates(conn, trainedStates, AgentStorage::BLOB);
+        }
+    }
+    else {
+        // new states only fill in what is missing, the rewards are added to what is stored
+        std::vector<std::pair<int64_t, StoredBoardState>> newStates;
+        std::vector<std::pair<int64_t, StoredBoardState>> rewards;
+        for (int64_t agentID : agentIDs) {
+            const AgentTraining& agentTraining = training.at(agentID);
+            for (const auto& [boardState, moves] : agentTraining.newStates) {
+                StoredBoardState state{ boardState, moves };
+                for (auto& move : state.moves)
+                    move.eval = 0.0f;
+                newStates.emplace_back(agentID, std::move(state));
+            }
+            for (const auto& [boardState, moves] : agentTraining.rewards)
+                rewards.emplace_back(agentID, StoredBoardState{ boardState, moves });
+        }
+
+        UpsertBoardStateRows(conn, newStates, "evaluation = game_moves.evaluation");
+        UpsertBoardStateRows(conn, rewards, "evaluation = game_moves.evaluation + new.evaluation");
+    }
+
+    StampChangeSequence(conn, agentIDs);
+    guard.commit();
+    return trained;
 }
 
-void SQLServerLogic::Connect() {
-    m_connected = false;
+void SQLServerLogic::HandleSyncAgentDeltas(SQLPooledConnection* conn, const std::string& dstServer, uint32_t requestID, ServerMessage& msg) {
+    const char* actionName = "SyncAgentDeltasResult";
+
+    auto obj = msg.TryGetObject("body");
+    if (!obj) {
+        SentError("Failed to read the training deltas", dstServer, actionName, requestID);
+        return;
+    }
 
+    std::unordered_map<int64_t, AgentTraining> training;
+    for (size_t i = 0; i < obj->GetRowCount(); ++i)
+        ReadTrainingDelta(*obj, i, training);
+
+    std::vector<std::pair<int64_t, int64_t>> trained;
     try {
-       std::string hostString = "tcp://" + m_config.host + ":" + std::to_string(m_config.port);
-       std::cout << "Connecting to: " << hostString << std::endl;
+        if (!training.empty())
+            trained = ApplyTraining(conn, training);
+    }
+    catch (sql::SQLException& e) {
+        SentError(std::string("SQL Error: ") + e.what(), dstServer, actionName, requestID);
+        return;
+    }
+
+    OTN::OTNObject result{ "Result" };
+    result.SetNames("server_id", "version");
+    result.SetTypes("int64", "int64");
+    result.ReserveDataRows(trained.size());
+    for (const auto& [agentID, version] : trained)
+        result.AddDataRow(agentID, version);
+
+    SendReply(dstServer, actionName, requestID, std::move(result));
+}
+
+std::string SQLServerLogic::BuildPlaceholders(size_t count) {
+    std::string placeholders;
+    placeholders.reserve(count * 3);
+    for (size_t i = 0; i < count; ++i) {
+        placeholders += "?";
+        if (i + 1 < count)
+            placeholders += ", ";
+    }
+    return placeholders;
+}
+
+OTN::OTNRow SQLServerLogic::ReadResultRow(sql::ResultSet& res, const std::vector<int>& columnTypes) {
+    OTN::OTNRow rowValues;
+    rowValues.reserve(columnTypes.size());
+
+    for (uint32_t i = 0; i < columnTypes.size(); ++i) {
+        switch (columnTypes[i]) {
+        case sql::DataType::INTEGER:
+            rowValues.emplace_back(static_cast<int>(res.getInt(i + 1)));
+            break;
+        case sql::DataType::BIGINT:
+            rowValues.emplace_back(static_cast<int64_t>(res.getInt64(i + 1)));
+            break;
+        case sql::DataType::DOUBLE:
+            rowValues.emplace_back(static_cast<double>(res.getDouble(i + 1)));
+            break;
+        case sql::DataType::DECIMAL:
+        case sql::DataType::REAL:
+            rowValues.emplace_back(static_cast<float>(res.getDouble(i + 1)));
+            break;
+        case sql::DataType::BIT:
+            rowValues.emplace_back(res.getBoolean(i + 1));
+            break;
+        case sql::DataType::CHAR:
+        case sql::DataType::LONGVARCHAR:
+        case sql::DataType::VARCHAR:
+        // raw bytes, only decoded on the server and never written as OTN text
+        case sql::DataType::BINARY:
+        case sql::DataType::VARBINARY:
+        case sql::DataType::LONGVARBINARY:
+            rowValues.emplace_back(static_cast<std::string>(res.getString(i + 1)));
+            break;
+        default:
+            std::cerr << "SQL Invalid data type '" << columnTypes[i] << "'\n";
+            break;
+        }
+    }
+
+    return rowValues;
+}
+
+void SQLServerLogic::InsertBoardStates(SQLPooledConnection* conn, const std::vector<BoardStateRow>& states) {
+    std::vector<std::pair<int64_t, StoredBoardState>> stored;
+    stored.reserve(states.size());
+
+    for (const auto& state : states) {
+        StoredBoardState s;
+        if (ReadStoredBoardState(*state.boardState, s))
+            stored.emplace_back(state.agentID, std::move(s));
+    }
+
+    WriteBoardStates(conn, stored, m_config.storage);
+}
+
+void SQLServerLogic::WriteBoardStates(SQLPooledConnection* conn, const std::vector<std::pair<int64_t, StoredBoardState>>& states, AgentStorage layout) {
+    if (states.empty())
+        return;
+
+    if (layout == AgentStorage::BLOB) {
+        std::vector<std::tuple<int64_t, int, std::string>> blobRows;
+        std::vector<StoredBoardState> agentStates;
+
+        for (size_t i = 0; i < states.size(); ++i) {
+            agentStates.push_back(states[i].second);
+
+            bool agentEnd = (i + 1 == states.size() || states[i + 1].first != states[i].first);
+            if (!agentEnd)
+                continue;
+
+            blobRows.emplace_back(states[i].first, static_cast<int>(AgentBlobCodec::VERSION), AgentBlobCodec::Encode(agentStates));
+            agentStates.clear();
+
+            // blobs can be large, few of them per statement keep it below max_allowed_packet
+            if (blobRows.size() == BLOB_BATCH_ROWS) {
+                ExecuteBatchInsert(conn, "agent_blobs", blobRows, "agent_id, format_version, board_states");
+                blobRows.clear();
+            }
+        }
+
+        if (!blobRows.empty())
+            ExecuteBatchInsert(conn, "agent_blobs", blobRows, "agent_id, format_version, board_states");
+        return;
+    }
+
+    std::vector<std::tuple<int64_t, std::string>> stateRows;
+    stateRows.reserve(states.size());
+    for (const auto& [agentID, state] : states)
+        stateRows.emplace_back(agentID, state.boardState);
+
+    // the ids are read back by (agent_id, board_state), a multi-row insert has no id range to derive them from
+    ExecuteBatchInsert(conn, "board_states", stateRows, "agent_id, board_state");
+    auto stateIDs = FetchBoardStateIDs(conn, states);
+
+    // the moves of all states go into one batch
+    std::vector<std::tuple<int64_t, float, int, int, int, int>> gameMoves;
+    for (const auto& [agentID, state] : states) {
+        auto it = stateIDs.find({ agentID, state.boardState });
+        if (it == stateIDs.end())
+            throw sql::SQLException("WriteBoardStates: Failed to read the id of an inserted board state");
+
+        for (const auto& move : state.moves)
+            gameMoves.emplace_back(it->second, move.eval, move.fromX, move.fromY, move.toX, move.toY);
+    }
+
+    if (!gameMoves.empty()) {
+        ExecuteBatchInsert(conn, "game_moves", gameMoves,
+            "board_state_id, evaluation, from_x, from_y, to_x, to_y");
+    }
+}
 
-        sql::mysql::MySQL_Driver* driver = sql::mysql::get_mysql_driver_instance();
-        std::unique_ptr<sql::Connection> conn(
-            driver->connect(hostString, m_config.user, m_config.password)
+void SQLServerLogic::WriteBoardStateDelta(SQLPooledConnection* conn, std::vector<std::pair<int64_t, StoredBoardState>>&& states) {
+    if (states.empty())
+        return;
+
+    if (m_config.storage == AgentStorage::BLOB) {
+        std::vector<int64_t> agentIDs;
+        std::unordered_map<int64_t, std::vector<StoredBoardState>> changed;
+        for (auto& [agentID, state] : states) {
+            auto [it, inserted] = changed.try_emplace(agentID);
+            if (inserted)
+                agentIDs.push_back(agentID);
+            it->second.push_back(std::move(state));
+        }
+
+        // a blob is always written as a whole
+        std::vector<std::pair<int64_t, StoredBoardState>> merged;
+        for (size_t start = 0; start < agentIDs.size(); start += BLOB_BATCH_ROWS) {
+            size_t count = std::min(BLOB_BATCH_ROWS, agentIDs.size() - start);
+            std::vector<int64_t> chunk(agentIDs.begin() + start, agentIDs.begin() + start + count);
+
+            std::unordered_map<int64_t, std::vector<StoredBoardState>> stored;
+            for (auto& [agentID, state] : LoadBoardStates(conn, chunk, AgentStorage::BLOB))
+                stored[agentID].push_back(std::move(state));
+
+            for (int64_t agentID : chunk) {
+                auto& agentStates = stored[agentID];
+                MergeBoardStates(agentStates, std::move(changed[agentID]));
+                for (auto& state : agentStates)
+                    merged.emplace_back(agentID, std::move(state));
+            }
+        }
+
+        DeleteBoardStates(conn, agentIDs, AgentStorage::BLOB);
+        WriteBoardStates(conn, merged, AgentStorage::BLOB);
+        return;
+    }
+
+    UpsertBoardStateRows(conn, states, "evaluation = new.evaluation");
+}
+
+void SQLServerLogic::UpsertBoardStateRows(SQLPooledConnection* conn, const std::vector<std::pair<int64_t, StoredBoardState>>& states, const std::string& moveUpdate) {
+    if (states.empty())
+        return;
+
+    // existing states keep their id, so their moves can be upserted as well
+    std::vector<std::tuple<int64_t, std::string>> stateRows;
+    stateRows.reserve(states.size());
+    for (const auto& [agentID, state] : states)
+        stateRows.emplace_back(agentID, state.boardState);
+
+    ExecuteBatchInsert(conn, "board_states", stateRows, "agent_id, board_state",
+        "AS new ON DUPLICATE KEY UPDATE board_state = new.board_state");
+
+    // the ids of both new and existing states
+    auto stateIDs = FetchBoardStateIDs(conn, states);
+
+    std::vector<std::tuple<int64_t, float, int, int, int, int>> gameMoves;
+    for (const auto& [agentID, state] : states) {
+        auto it = stateIDs.find({ agentID, state.boardState });
+        if (it == stateIDs.end())
+            continue;
+
+        for (const auto& move : state.moves)
+            gameMoves.emplace_back(it->second, move.eval, move.fromX, move.fromY, move.toX, move.toY);
+    }
+
+    if (!gameMoves.empty()) {
+        ExecuteBatchInsert(conn, "game_moves", gameMoves,
+            "board_state_id, evaluation, from_x, from_y, to_x, to_y",
+            "AS new ON DUPLICATE KEY UPDATE " + moveUpdate);
+    }
+}
+
+std::map<std::pair<int64_t, std::string>, int64_t> SQLServerLogic::FetchBoardStateIDs(SQLPooledConnection* conn, const std::vector<std::pair<int64_t, StoredBoardState>>& states) {
+    std::map<std::pair<int64_t, std::string>, int64_t> stateIDs;
+    for (size_t start = 0; start < states.size(); start += MAX_ROWS_PER_STATEMENT) {
+        size_t count = std::min(MAX_ROWS_PER_STATEMENT, states.size() - start);
+
+        std::vector<int64_t> agentIDs;
+        std::vector<std::string> boardStates;
+        boardStates.reserve(count);
+        for (size_t i = start; i < start + count; ++i) {
+            agentIDs.push_back(states[i].first);
+            boardStates.push_back(states[i].second.boardState);
+        }
+
+        std::sort(agentIDs.begin(), agentIDs.end());
+        agentIDs.erase(std::unique(agentIDs.begin(), agentIDs.end()), agentIDs.end());
+        size_t agentCount = PadToBucket(agentIDs);
+
+        std::sort(boardStates.begin(), boardStates.end());
+        boardStates.erase(std::unique(boardStates.begin(), boardStates.end()), boardStates.end());
+        size_t stateCount = PadToBucket(boardStates);
+
+        auto rows = FetchStatement(conn,
+            "SELECT id, agent_id, board_state FROM board_states WHERE agent_id IN (" + BuildPlaceholders(agentCount) +
+            ") AND board_state IN (" + BuildPlaceholders(stateCount) + ");",
+            agentIDs, boardStates
+        );
+        if (!rows)
+            throw sql::SQLException("FetchBoardStateIDs: Failed to read the board state ids");
+
+        for (size_t row = 0; row < rows->GetRowCount(); ++row) {
+            auto id = rows->TryGetValue<int64_t>(row, "id");
+            auto agentID = rows->TryGetValue<int64_t>(row, "agent_id");
+            auto boardState = rows->TryGetValue<std::string>(row, "board_state");
+            if (id && agentID && boardState)
+                stateIDs[{ *agentID, *boardState }] = *id;
+        }
+    }
+    return stateIDs;
+}
+
+std::vector<std::pair<int64_t, StoredBoardState>> SQLServerLogic::LoadBoardStates(SQLPooledConnection* conn, std::vector<int64_t> agentIDs, AgentStorage layout) {
+    std::vector<std::pair<int64_t, StoredBoardState>> states;
+    size_t count = PadToBucket(agentIDs);
+    if (count == 0)
+        return states;
+
+    if (layout == AgentStorage::BLOB) {
+        auto blobs = FetchStatement(conn,
+            "SELECT agent_id, board_states FROM agent_blobs WHERE agent_id IN (" + BuildPlaceholders(count) + ");",
+            agentIDs
         );
+        if (!blobs)
+            throw sql::SQLException("LoadBoardStates: Failed to read agent_blobs");
+
+        for (size_t row = 0; row < blobs->GetRowCount(); ++row) {
+            auto agentID = blobs->TryGetValue<int64_t>(row, "agent_id");
+            auto blob = blobs->TryGetValue<std::string>(row, "board_states");
+            if (!agentID || !blob)
+                continue;
 
-        conn->setSchema(m_config.schema);
+            std::vector<StoredBoardState> decoded;
+            std::string error;
+            if (!AgentBlobCodec::Decode(*blob, decoded, error))
+                throw sql::SQLException("LoadBoardStates: Agent " + std::to_string(*agentID) + ": " + error);
 
-        m_connection = std::move(conn); 
-        std::cout << "Connected to MySQL successfully to schema '" << m_config.schema << "'!" << '\n';
-        m_connected = true;
+            for (auto& state : decoded)
+                states.emplace_back(*agentID, std::move(state));
+        }
+        return states;
+    }
+
+    // one row per move, states without moves have a move_id of 0
+    auto rows = FetchStatement(conn, R"""(
+        SELECT bs.agent_id, bs.id AS state_id, bs.board_state, COALESCE(gm.id, 0) AS move_id,
+            gm.evaluation, gm.from_x, gm.from_y, gm.to_x, gm.to_y
+        FROM board_states bs LEFT JOIN game_moves gm ON gm.board_state_id = bs.id
+        WHERE bs.agent_id IN ()""" + BuildPlaceholders(count) + R"""()
+        ORDER BY bs.agent_id, bs.id, gm.id;)""",
+        agentIDs
+    );
+    if (!rows)
+        throw sql::SQLException("LoadBoardStates: Failed to read board_states");
+
+    int64_t currentStateID = 0;
+    for (size_t row = 0; row < rows->GetRowCount(); ++row) {
+        auto agentID = rows->TryGetValue<int64_t>(row, "agent_id");
+        auto stateID = rows->TryGetValue<int64_t>(row, "state_id");
+        auto boardState = rows->TryGetValue<std::string>(row, "board_state");
+        if (!agentID || !stateID || !boardState)
+            continue;
+
+        if (states.empty() || *stateID != currentStateID) {
+            currentStateID = *stateID;
+            states.emplace_back(*agentID, StoredBoardState{ *boardState, {} });
+        }
+
+        if (rows->TryGetValue<int64_t>(row, "move_id").value_or(0) == 0)
+            continue;
+
+        StoredMove move;
+        move.eval = rows->TryGetValue<float>(row, "evaluation").value_or(0.0f);
+        move.fromX = static_cast<uint8_t>(rows->TryGetValue<int>(row, "from_x").value_or(0));
+        move.fromY = static_cast<uint8_t>(rows->TryGetValue<int>(row, "from_y").value_or(0));
+        move.toX = static_cast<uint8_t>(rows->TryGetValue<int>(row, "to_x").value_or(0));
+        move.toY = static_cast<uint8_t>(rows->TryGetValue<int>(row, "to_y").value_or(0));
+        states.back().second.moves.push_back(move);
+    }
+    return states;
+}
+
+void SQLServerLogic::DeleteBoardStates(SQLPooledConnection* conn, const std::vector<int64_t>& agentIDs, AgentStorage layout) {
+    // the moves are deleted by the foreign key
+    const char* query = (layout == AgentStorage::BLOB)
+        ? "DELETE FROM agent_blobs WHERE agent_id IN ("
+        : "DELETE FROM board_states WHERE agent_id IN (";
+
+    for (size_t start = 0; start < agentIDs.size(); start += MAX_ROWS_PER_STATEMENT) {
+        size_t count = std::min(MAX_ROWS_PER_STATEMENT, agentIDs.size() - start);
+        std::vector<int64_t> chunk(agentIDs.begin() + start, agentIDs.begin() + start + count);
+        count = PadToBucket(chunk);
+
+        ExecuteStatement(conn, query + BuildPlaceholders(count) + ");", chunk);
+    }
+}
+
+void SQLServerLogic::MigrateStorage(SQLPooledConnection* conn) {
+    AgentStorage target = m_config.storage;
+    AgentStorage source = (target == AgentStorage::BLOB) ? AgentStorage::ROWS : AgentStorage::BLOB;
+
+    std::string pendingQuery = (source == AgentStorage::ROWS)
+        ? "SELECT DISTINCT agent_id FROM board_states LIMIT " + std::to_string(BLOB_BATCH_ROWS) + ";"
+        : "SELECT agent_id FROM agent_blobs LIMIT " + std::to_string(BLOB_BATCH_ROWS) + ";";
+
+    size_t migrated = 0;
+    try {
+        while (true) {
+            auto pending = FetchStatement(conn, pendingQuery);
+            if (!pending || pending->GetRowCount() == 0)
+                break;
+
+            std::vector<int64_t> agentIDs;
+            agentIDs.reserve(pending->GetRowCount());
+            for (size_t i = 0; i < pending->GetRowCount(); ++i) {
+                if (auto id = pending->TryGetValue<int64_t>(i, "agent_id"))
+                    agentIDs.push_back(*id);
+            }
+
+            TransactionGuard guard(conn->connection.get());
+            auto states = LoadBoardStates(conn, agentIDs, source);
+            DeleteBoardStates(conn, agentIDs, source);
+            WriteBoardStates(conn, states, target);
+            guard.commit();
+
+            migrated += agentIDs.size();
+        }
     }
     catch (sql::SQLException& e) {
-        std::cerr << "Error connecting to MySQL: "
-            << e.what() << " (MySQL error code: "
-            << e.getErrorCode() << ")" << '\n';
+        std::cerr << "SQLServerLogic: Storage migration stopped after " << migrated << " agents: " << e.what() << '\n';
+        return;
     }
+
+    std::cout << "SQLServerLogic: Migrated " << migrated << " agents to "
+        << (target == AgentStorage::BLOB ? "blob" : "rows") << " storage" << '\n';
+}
+
+void SQLServerLogic::Connect() {
+    m_connected = false;
+
+    std::string hostString = "tcp://" + m_config.host + ":" + std::to_string(m_config.port);
+    std::cout << "Connecting to: " << hostString << std::endl;
+
+    if (!m_connections.Open(m_config))
+        return;
+
+    if (m_config.migrateStorage) {
+        // runs before the workers start, no action can see a half migrated agent
+        SQLConnectionPool::Lease lease = m_connections.Acquire();
+        if (lease)
+            MigrateStorage(lease.Get());
+    }
+
+    m_workers.Start(static_cast<uint32_t>(m_connections.GetSize()), 256);
+    std::cout << "Connected to MySQL successfully to schema '" << m_config.schema
+        << "' with " << m_connections.GetSize() << " connections!" << '\n';
+    m_connected = true;
+}
+
+int64_t SQLServerLogic::NextChangeSequence(SQLPooledConnection* conn) {
+    // LAST_INSERT_ID(expr) hands the new value to this connection only
+    ExecuteStatement(conn, "UPDATE change_sequence SET value = LAST_INSERT_ID(value + 1) WHERE id = 1;");
+
+    auto id = FetchLastInsertID(conn);
+    if (!id || *id <= 0)
+        throw sql::SQLException("NextChangeSequence: change_sequence is missing its row");
+    return *id;
+}
+
+void SQLServerLogic::StampChangeSequence(SQLPooledConnection* conn, std::vector<int64_t> agentIDs) {
+    int64_t sequence = NextChangeSequence(conn);
+
+    for (size_t start = 0; start < agentIDs.size(); start += MAX_ROWS_PER_STATEMENT) {
+        size_t count = std::min(MAX_ROWS_PER_STATEMENT, agentIDs.size() - start);
+        std::vector<int64_t> chunk(agentIDs.begin() + start, agentIDs.begin() + start + count);
+        count = PadToBucket(chunk);
+
+        ExecuteStatement(conn, "UPDATE agents SET change_seq = ? WHERE id IN (" + BuildPlaceholders(count) + ");", sequence, chunk);
+    }
+}
+
+int64_t SQLServerLogic::FetchChangeSequence(SQLPooledConnection* conn) {
+    auto result = FetchStatement(conn, "SELECT value FROM change_sequence WHERE id = 1;");
+    auto value = result ? result->TryGetValue<int64_t>(0, "value") : std::nullopt;
+    if (!value)
+        throw sql::SQLException("FetchChangeSequence: change_sequence is missing its row");
+    return *value;
 }
 
-std::optional<int64_t> SQLServerLogic::FetchLastInsertID() {
-    auto result = FetchStatement("SELECT LAST_INSERT_ID();");
+std::optional<int64_t> SQLServerLogic::FetchLastInsertID(SQLPooledConnection* conn) {
+    auto result = FetchStatement(conn, "SELECT LAST_INSERT_ID();");
     if (!result) 
         return std::nullopt;
 
@@ -566,9 +1266,9 @@ std::optional<int64_t> SQLServerLogic::FetchLastInsertID() {
     return result->TryGetValue<int64_t>(0, 0);
 }
 
-void SQLServerLogic::ExecuteStatement(const std::string& query) {
+void SQLServerLogic::ExecuteStatement(SQLPooledConnection* conn, const std::string& query) {
     try {
-        std::unique_ptr<sql::Statement> stmt(m_connection->createStatement());
+        std::unique_ptr<sql::Statement> stmt(conn->connection->createStatement());
         stmt->execute(query);
     }
     catch (sql::SQLException& e) {
@@ -0,0 +1,436 @@
+#include <iostream>
+#include <stdexcept>
+#include <unordered_set>
+#include <unordered_map>
+
+#include "LogAgentStore.h"
+#include "NetServerManager.h"
+#include "ServerLogic/StoreServerLogic.h"
+
+StoreServerLogic::StoreServerLogic(NetServer* server, const DBConfig& config)
+    : DBServerLogic(server, config) {
+    m_store = std::make_unique<LogAgentStore>(config.dataPath);
+}
+
+StoreServerLogic::~StoreServerLogic() {
+    // finishes the queued actions before the store is closed
+    if (m_opened)
+        FlushTraining();
+    m_workers.Stop();
+    m_store->Close();
+}
+
+void StoreServerLogic::OnRun() {
+    if (m_opened && m_reports.IsFlushDue())
+        FlushTraining();
+}
+
+void StoreServerLogic::OnServerMessage(ServerMessage& msg) {
+    if (!m_opened)
+        Open();
+
+    auto header = msg.TryGetObject("header");
+    if (!header)
+        return;
+
+    auto action = header->TryGetValue<std::string>(0, "action");
+    auto requestID = header->TryGetValue<int64_t>(0, "request_id");
+
+    if (!action || !requestID)
+        return;
+
+    uint32_t id = static_cast<uint32_t>(*requestID);
+    // only buffered here, the training is written by FlushTraining
+    if (*action == "ReportGames") {
+        if (m_opened)
+            HandleReportGames(msg.source, id, msg);
+        else
+            SentError("Agent store is not open", msg.source, "ReportGamesResult", id);
+        return;
+    }
+
+    // action name -> handler and the action of its result
+    static const std::unordered_map<std::string_view, std::pair<StoreAction, const char*>> actions = {
+        { "InsertAgents", { &StoreServerLogic::HandleInsertAgents, "InsertAgentsResult" } },
+        { "GetAgentIDs", { &StoreServerLogic::HandleGetAgentIDs, "GetAgentIDResult" } },
+        { "HandleGetMissinAgents", { &StoreServerLogic::HandleGetMissinAgents, "HandleGetMissinAgents" } },
+        { "GetAgentChanges", { &StoreServerLogic::HandleGetAgentChanges, "GetAgentChanges" } },
+        { "HandleDeleteAgents", { &StoreServerLogic::HandleDeleteAgents, "HandleDeleteAgentsResult" } },
+        { "HandleDirtyAgents", { &StoreServerLogic::HandleUpdateAgents, "HandleUpdateAgentsResult" } },
+        { "HandleDirtyAgentStates", { &StoreServerLogic::HandleUpdateAgentStates, "HandleUpdateAgentsResult" } },
+        { "SyncAgentDeltas", { &StoreServerLogic::HandleSyncAgentDeltas, "SyncAgentDeltasResult" } },
+    };
+
+    auto it = actions.find(*action);
+    if (it == actions.end()) {
+        std::cerr << "Unkown action store server '" << *action << "'\n";
+        return;
+    }
+
+    auto shared = std::make_shared<ServerMessage>(std::move(msg));
+    LatencyHistogram& dbTime = ServerMetrics::GetHistogram("chesslite_db_seconds", ServerMetrics::Label("action", *action));
+    SubmitAction(it->second.first, shared, id, it->second.second, dbTime);
+}
+
+void StoreServerLogic::Open() {
+    try {
+        m_store->Open();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "StoreServerLogic: Failed to open the store: " << e.what() << '\n';
+        return;
+    }
+
+    m_workers.Start(m_config.poolSize, 256);
+    std::cout << "Opened agent store '" << m_config.dataPath << "' with " << m_workers.GetWorkerCount() << " workers!" << '\n';
+    m_opened = true;
+}
+
+void StoreServerLogic::SubmitAction(
+    StoreAction action,
+    std::shared_ptr<ServerMessage> msg,
+    uint32_t requestID,
+    const char* resultAction,
+    LatencyHistogram& dbTime)
+{
+    if (!m_opened) {
+        SentError("Agent store is not open", msg->source, resultAction, requestID);
+        return;
+    }
+
+    auto queuedAt = std::chrono::steady_clock::now();
+    m_workers.Submit(m_nextKey++, [this, action, msg, requestID, resultAction, &dbTime, queuedAt]() {
+        m_workerQueueWait.Record(std::chrono::steady_clock::now() - queuedAt);
+        ScopedLatency timer(dbTime);
+
+        try {
+            (this->*action)(msg->source, requestID, *msg);
+        }
+        catch (const std::exception& e) {
+            SentError(std::string("Store Error: ") + e.what(), msg->source, resultAction, requestID);
+        }
+    });
+}
+
+StoredAgent StoreServerLogic::ReadAgent(const OTN::OTNObject& body, size_t row) {
+    StoredAgent agent;
+    agent.name = body.TryGetValue<std::string>(row, "name").value_or("");
+    agent.config = body.TryGetValue<std::string>(row, "config").value_or("");
+    agent.matchesPlayed = body.TryGetValue<int>(row, "matches_played").value_or(0);
+    agent.matchesWon = body.TryGetValue<int>(row, "matches_won").value_or(0);
+    agent.matchesPlayedWhite = body.TryGetValue<int>(row, "matches_played_white").value_or(0);
+    agent.matchesWonWhite = body.TryGetValue<int>(row, "matches_won_white").value_or(0);
+
+    if (auto states = body.TryGetValue<std::vector<OTN::OTNObject>>(row, "board_states")) {
+        agent.boardStates.reserve(states->size());
+        for (const auto& state : *states) {
+            StoredBoardState stored;
+            if (ReadStoredBoardState(state, stored))
+                agent.boardStates.push_back(std::move(stored));
+        }
+    }
+    return agent;
+}
+
+void StoreServerLogic::HandleInsertAgents(const std::string& dstServer, uint32_t requestID, ServerMessage& msg) {
+    const char* actionName = "InsertAgentsResult";
+
+    auto obj = msg.TryGetObject("body");
+    if (!obj) {
+        SentError("Failed to read the agents to insert", dstServer, actionName, requestID);
+        return;
+    }
+
+    std::vector<int64_t> localIDs;
+    std::vector<StoredAgent> agents;
+    localIDs.reserve(obj->GetRowCount());
+    agents.reserve(obj->GetRowCount());
+
+    for (size_t i = 0; i < obj->GetRowCount(); ++i) {
+        auto localID = obj->TryGetValue<int64_t>(i, "local_id");
+        if (!localID || !obj->TryGetValue<std::string>(i, "name") || !obj->TryGetValue<std::string>(i, "config"))
+            continue;
+
+        localIDs.push_back(*localID);
+        agents.push_back(ReadAgent(*obj, i));
+    }
+
+    std::vector<int64_t> serverIDs = m_store->InsertAgents(std::move(agents));
+
+    OTN::OTNObject result{ "ids" };
+    result.SetNames("localID", "serverID");
+    result.SetTypes("int64", "int64");
+    for (size_t i = 0; i < serverIDs.size(); ++i)
+        result.AddDataRow(localIDs[i], serverIDs[i]);
+
+    SendReply(dstServer, actionName, requestID, std::move(result));
+}
+
+void StoreServerLogic::HandleGetAgentIDs(const std::string& dstServer, uint32_t requestID, ServerMessage& /*msg*/) {
+    const char* actionName = "GetAgentIDResult";
+
+    OTN::OTNObject body{ "Result" };
+    body.SetNames("id");
+    body.SetTypes("int64");
+    for (int64_t id : m_store->GetAgentIDs())
+        body.AddDataRow(id);
+
+    SendReply(dstServer, actionName, requestID, std::move(body));
+}
+
+void StoreServerLogic::HandleGetMissinAgents(const std::string& dstServer, uint32_t requestID, ServerMessage& msg) {
+    const char* actionName = "HandleGetMissinAgents";
+
+    // the result is forwarded to the client segment by segment
+    if (!msg.stream) {
+        SentError("Missing agents can only be requested as a stream", dstServer, actionName, requestID);
+        return;
+    }
+
+    auto obj = msg.TryGetObject("body");
+    if (!obj) {
+        SentError("Failed to Get missing agents", dstServer, actionName, requestID);
+        return;
+    }
+
+    std::unordered_set<int64_t> known;
+    known.reserve(obj->GetRowCount());
+    for (size_t i = 0; i < obj->GetRowCount(); i++) {
+        if (auto id = obj->TryGetValue<int64_t>(i, "id"))
+            known.insert(*id);
+    }
+
+    // read first, changes durable while streaming are sent again by the next GetAgentChanges
+    int64_t sequence = m_store->GetChangeSequence();
+    StreamTarget target{ dstServer, actionName, requestID, msg.stream };
+
+    bool complete = StreamAgents(target, [&known](int64_t id, int64_t) {
+        return known.count(id) == 0;
+    });
+
+    // the client continues with GetAgentChanges from this sequence
+    complete = complete && SendChangeSequence(target, sequence, {});
+    FinishStream(target, complete);
+}
+
+void StoreServerLogic::HandleGetAgentChanges(const std::string& dstServer, uint32_t requestID, ServerMessage& msg) {
+    const char* actionName = "GetAgentChanges";
+
+    if (!msg.stream) {
+        SentError("Agent changes can only be requested as a stream", dstServer, actionName, requestID);
+        return;
+    }
+
+    auto obj = msg.TryGetObject("body");
+    auto since = obj ? obj->TryGetValue<int64_t>(0, "since") : std::nullopt;
+    if (!since) {
+        SentError("Failed to read the change sequence of the request", dstServer, actionName, requestID);
+        return;
+    }
+
+    // every change up to the sequence is durable, later ones are sent by the next request
+    int64_t until = m_store->GetChangeSequence();
+    StreamTarget target{ dstServer, actionName, requestID, msg.stream };
+
+    bool complete = true;
+    std::vector<int64_t> deleted;
+    if (until > *since) {
+        complete = StreamAgents(target, [since = *since, until](int64_t, int64_t sequence) {
+            return sequence > since && sequence <= until;
+        });
+        deleted = m_store->GetDeletedAgents(*since, until);
+    }
+
+    complete = complete && SendChangeSequence(target, until, deleted);
+    FinishStream(target, complete);
+}
+
+bool StoreServerLogic::StreamAgents(StreamTarget& target, const IAgentStore::AgentFilter& filter) {
+    // same tables as the rows layout of SQLServerLogic
+    return m_store->ForEachAgent(filter, STREAM_BATCH_AGENTS, [&](std::vector<StoredAgent>&& batch) {
+        OTN::OTNObject agents{ "agents" };
+        agents.SetNames("id", "version", "name", "config", "matches_played", "matches_won", "matches_played_white", "matches_won_white");
+        agents.SetTypes("int64", "int", "String", "String", "int", "int", "int", "int");
+
+        OTN::OTNObject states{ "board_states" };
+        states.SetNames("id", "agent_id", "board_state");
+        states.SetTypes("int64", "int64", "String");
+
+        OTN::OTNObject moves{ "game_moves" };
+        moves.SetNames("id", "board_state_id", "evaluation", "from_x", "from_y", "to_x", "to_y");
+        moves.SetTypes("int64", "int64", "float", "int", "int", "int", "int");
+
+        for (const auto& agent : batch) {
+            agents.AddDataRow(agent.id, static_cast<int>(agent.version), agent.name, agent.config,
+                agent.matchesPlayed, agent.matchesWon, agent.matchesPlayedWhite, agent.matchesWonWhite);
+
+            for (const auto& state : agent.boardStates) {
+                int64_t stateID = target.nextStateID++;
+                states.AddDataRow(stateID, agent.id, state.boardState);
+
+                for (const auto& move : state.moves) {
+                    moves.AddDataRow(target.nextMoveID++, stateID, move.eval,
+                        static_cast<int>(move.fromX), static_cast<int>(move.fromY),
+                        static_cast<int>(move.toX), static_cast<int>(move.toY));
+                }
+            }
+        }
+
+        OTN::OTNWriter writer;
+        writer.AppendObject(agents).AppendObject(states).AppendObject(moves);
+        return SendSegment(target, writer, "agents");
+    });
+}
+
+void StoreServerLogic::HandleReportGames(const std::string& dstServer, uint32_t requestID, ServerMessage& msg) {
+    const char* actionName = "ReportGamesResult";
+
+    auto obj = msg.TryGetObject("body");
+    if (!obj) {
+        SentError("Failed to read the reported games", dstServer, actionName, requestID);
+        return;
+    }
+
+    int accepted = 0;
+    for (size_t i = 0; i < obj->GetRowCount(); ++i) {
+        if (m_reports.AddReport(*obj, i))
+            accepted++;
+    }
+
+    // acknowledged once buffered, a crash loses at most one flush interval of games
+    OTN::OTNObject result{ "Result" };
+    result.SetNames("accepted");
+    result.SetTypes("int");
+    result.AddDataRow(accepted);
+
+    SendReply(dstServer, actionName, requestID, std::move(result));
+}
+
+void StoreServerLogic::FlushTraining() {
+    auto training = std::make_shared<std::unordered_map<int64_t, AgentTraining>>(m_reports.Take());
+    if (training->empty())
+        return;
+
+    static LatencyHistogram& dbTime = ServerMetrics::GetHistogram("chesslite_db_seconds", ServerMetrics::Label("action", "FlushTraining"));
+    auto queuedAt = std::chrono::steady_clock::now();
+    m_workers.Submit(m_nextKey++, [this, training, queuedAt]() {
+        m_workerQueueWait.Record(std::chrono::steady_clock::now() - queuedAt);
+        ScopedLatency timer(dbTime);
+
+        try {
+            m_store->ApplyTraining(*training);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "StoreServerLogic: Failed to train " << training->size() << " agents: " << e.what() << '\n';
+        }
+    });
+}
+
+void StoreServerLogic::HandleSyncAgentDeltas(const std::string& dstServer, uint32_t requestID, ServerMessage& msg) {
+    const char* actionName = "SyncAgentDeltasResult";
+
+    auto obj = msg.TryGetObject("body");
+    if (!obj) {
+        SentError("Failed to read the training deltas", dstServer, actionName, requestID);
+        return;
+    }
+
+    std::unordered_map<int64_t, AgentTraining> training;
+    for (size_t i = 0; i < obj->GetRowCount(); ++i)
+        ReadTrainingDelta(*obj, i, training);
+
+    std::vector<std::pair<int64_t, int64_t>> trained;
+    if (!training.empty())
+        trained = m_store->ApplyTraining(training);
+
+    OTN::OTNObject result{ "Result" };
+    result.SetNames("server_id", "version");
+    result.SetTypes("int64", "int64");
+    result.ReserveDataRows(trained.size());
+    for (const auto& [agentID, version] : trained)
+        result.AddDataRow(agentID, version);
+
+    SendReply(dstServer, actionName, requestID, std::move(result));
+}
+
+void StoreServerLogic::HandleDeleteAgents(const std::string& dstServer, uint32_t requestID, ServerMessage& msg) {
+    const char* actionName = "HandleDeleteAgentsResult";
+
+    auto obj = msg.TryGetObject("body");
+    if (!obj) {
+        SentError("Failed to delete agents", dstServer, actionName, requestID);
+        return;
+    }
+
+    std::vector<int64_t> ids;
+    ids.reserve(obj->GetRowCount());
+    for (size_t i = 0; i < obj->GetRowCount(); i++) {
+        if (auto id = obj->TryGetValue<int64_t>(i, "ids"))
+            ids.push_back(*id);
+    }
+
+    m_store->DeleteAgents(ids);
+
+    OTN::OTNObject body{ "Result" };
+    body.SetNames("empty");
+    body.SetTypes("int");
+
+    SendReply(dstServer, actionName, requestID, std::move(body));
+}
+
+void StoreServerLogic::HandleUpdateAgents(const std::string& dstServer, uint32_t requestID, ServerMessage& msg) {
+    UpdateAgents(dstServer, requestID, msg, false);
+}
+
+void StoreServerLogic::HandleUpdateAgentStates(const std::string& dstServer, uint32_t requestID, ServerMessage& msg) {
+    UpdateAgents(dstServer, requestID, msg, true);
+}
+
+void StoreServerLogic::UpdateAgents(const std::string& dstServer, uint32_t requestID, ServerMessage& msg, bool statesOnly) {
+    const char* actionName = "HandleUpdateAgentsResult";
+
+    auto obj = msg.TryGetObject("body");
+    if (!obj) {
+        SentError("Failed to read the agents to update", dstServer, actionName, requestID);
+        return;
+    }
+
+    std::vector<int64_t> localIDs;
+    std::vector<StoredAgent> agents;
+    localIDs.reserve(obj->GetRowCount());
+    agents.reserve(obj->GetRowCount());
+
+    for (size_t i = 0; i < obj->GetRowCount(); ++i) {
+        auto serverId = obj->TryGetValue<int64_t>(i, "server_id");
+        auto localID = obj->TryGetValue<int64_t>(i, "local_id");
+        auto version = obj->TryGetValue<int64_t>(i, "version");
+
+        if (!serverId || !version || !obj->TryGetValue<std::string>(i, "name") || !obj->TryGetValue<std::string>(i, "config"))
+            continue;
+
+        StoredAgent agent = ReadAgent(*obj, i);
+        agent.id = *serverId;
+        agent.version = *version;
+
+        localIDs.push_back(localID.value_or(0));
+        agents.push_back(std::move(agent));
+    }
+
+    std::vector<int64_t> versions;
+    versions.reserve(agents.size());
+    for (const auto& agent : agents)
+        versions.push_back(agent.version);
+
+    // unknown agents and agents that are already up to date are skipped by the store
+    std::vector<size_t> updated = statesOnly
+        ? m_store->UpdateAgentStates(std::move(agents))
+        : m_store->UpdateAgents(std::move(agents));
+
+    OTN::OTNObject result{ "Result" };
+    result.SetNames("localID", "version");
+    result.SetTypes("int64", "int64");
+    for (size_t i : updated)
+        result.AddDataRow(localIDs[i], versions[i]);
+
+    SendReply(dstServer, actionName, requestID, std::move(result));
+}
\ No newline at end of file
@@ -0,0 +1,103 @@
+#include "ServerMessage.h"
+
+#include <algorithm>
+
+ServerStream::ServerStream(size_t window)
+	: m_window(std::max<size_t>(1, window)) {
+}
+
+bool ServerStream::Reserve() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	bool ready = m_cv.wait_for(lock, STALL_TIMEOUT, [this]() {
+		return m_cancelled || m_inFlight < m_window;
+	});
+
+	if (!ready)
+		m_cancelled = true;
+	if (m_cancelled)
+		return false;
+
+	m_inFlight++;
+	return true;
+}
+
+void ServerStream::Release(size_t count) {
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_inFlight -= std::min(count, m_inFlight);
+	}
+	m_cv.notify_all();
+}
+
+void ServerStream::Cancel() {
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_cancelled = true;
+	}
+	m_cv.notify_all();
+}
+
+bool ServerStream::IsCancelled() const {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_cancelled;
+}
+
+void ServerMessage::AddObject(OTN::OTNObject&& obj) {
+	objects.push_back(std::move(obj));
+}
+
+void ServerMessage::AddObject(const OTN::OTNObject& obj) {
+	objects.push_back(obj);
+}
+
+OTN::OTNObject* ServerMessage::TryGetObject(const std::string& objName) {
+	for (auto& obj : objects) {
+		if (obj.GetObjectName() == objName)
+			return &obj;
+	}
+	return nullptr;
+}
+
+const OTN::OTNObject* ServerMessage::TryGetObject(const std::string& objName) const {
+	for (auto& obj : objects) {
+		if (obj.GetObjectName() == objName)
+			return &obj;
+	}
+	return nullptr;
+}
+
+void ServerMessageQueue::Push(ServerMessage&& msg) {
+	m_queue.Push(std::move(msg));
+	if (m_sleeping.load())
+		Wake();
+}
+
+bool ServerMessageQueue::WaitPop(ServerMessage& outMsg) {
+	if (m_queue.TryPop(outMsg))
+		return true;
+
+	std::unique_lock<std::mutex> lock(m_waitMutex);
+	m_sleeping.store(true);
+	m_waitCV.wait(lock, [this]() {
+		return !m_queue.IsEmpty() || m_closed.load();
+	});
+	m_sleeping.store(false);
+	lock.unlock();
+
+	return m_queue.TryPop(outMsg);
+}
+
+void ServerMessageQueue::Open() {
+	m_closed.store(false);
+}
+
+void ServerMessageQueue::Close() {
+	m_closed.store(true);
+	Wake();
+}
+
+void ServerMessageQueue::Wake() {
+	// taking the mutex orders the notify after the consumer started waiting
+	std::lock_guard<std::mutex> guard(m_waitMutex);
+	m_waitCV.notify_one();
+}
\ No newline at end of file
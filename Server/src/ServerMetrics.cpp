@@ -0,0 +1,314 @@
+#include "ServerMetrics.h"
+
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+	// histograms are exported with these cumulative buckets (16us to 33s), the exact buckets stay internal
+	constexpr uint32_t EXPORT_MIN_EXPONENT = 4;
+	constexpr uint32_t EXPORT_MAX_EXPONENT = 25;
+	constexpr std::array<double, 5> EXPORT_QUANTILES = { 0.5, 0.9, 0.99, 0.999, 1.0 };
+
+	std::string FormatNumber(double value) {
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+		return buffer;
+	}
+
+	std::string JoinLabels(const std::string& labels, const std::string& extra) {
+		if (labels.empty())
+			return "{" + extra + "}";
+		return "{" + labels + "," + extra + "}";
+	}
+
+	std::string WrapLabels(const std::string& labels) {
+		return labels.empty() ? std::string{} : "{" + labels + "}";
+	}
+
+	uint32_t FloorLog2(uint64_t value) {
+		uint32_t exponent = 0;
+		while (value >>= 1)
+			exponent++;
+		return exponent;
+	}
+
+}
+
+void LatencyHistogram::Record(std::chrono::nanoseconds duration) {
+	int64_t nanos = std::max<int64_t>(0, duration.count());
+	m_buckets[GetBucketIndex(static_cast<uint64_t>(nanos) / 1000)].fetch_add(1, std::memory_order_relaxed);
+	m_sumNanos.fetch_add(static_cast<uint64_t>(nanos), std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+	return m_count.load(std::memory_order_relaxed);
+}
+
+double LatencyHistogram::GetSumSeconds() const {
+	return static_cast<double>(m_sumNanos.load(std::memory_order_relaxed)) / 1e9;
+}
+
+uint64_t LatencyHistogram::CountBelowPowerOfTwo(uint32_t exponent) const {
+	// 2^exponent is the first value of its bucket, everything in front of that bucket is below it
+	size_t end = GetBucketIndex(uint64_t{ 1 } << std::min(exponent, MAX_EXPONENT));
+	uint64_t count = 0;
+	for (size_t i = 0; i < end; ++i)
+		count += m_buckets[i].load(std::memory_order_relaxed);
+	return count;
+}
+
+double LatencyHistogram::GetQuantileSeconds(double quantile) const {
+	// the buckets are read one by one while others record, the total is taken from them as well
+	std::array<uint64_t, BUCKET_COUNT> counts;
+	uint64_t total = 0;
+	for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+		counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+		total += counts[i];
+	}
+	if (total == 0)
+		return 0.0;
+
+	uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(total));
+	rank = std::max<uint64_t>(1, std::min(rank, total));
+
+	uint64_t seen = 0;
+	for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+		seen += counts[i];
+		if (seen >= rank)
+			return static_cast<double>(GetBucketUpperBound(i)) / 1e6;
+	}
+	return static_cast<double>(GetBucketUpperBound(BUCKET_COUNT - 1)) / 1e6;
+}
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t micros) {
+	if (micros < SUB_BUCKETS)
+		return static_cast<size_t>(micros);
+
+	uint32_t exponent = FloorLog2(micros);
+	if (exponent > MAX_EXPONENT)
+		return BUCKET_COUNT - 1;
+
+	// the SUB_BUCKET_BITS bits below the highest one pick the sub bucket
+	uint32_t shift = exponent - SUB_BUCKET_BITS;
+	size_t subBucket = static_cast<size_t>(micros >> shift) - SUB_BUCKETS;
+	return SUB_BUCKETS + static_cast<size_t>(shift) * SUB_BUCKETS + subBucket;
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t index) {
+	if (index < SUB_BUCKETS)
+		return index + 1;
+
+	size_t shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+	size_t subBucket = (index - SUB_BUCKETS) % SUB_BUCKETS;
+	return static_cast<uint64_t>(SUB_BUCKETS + subBucket + 1) << shift;
+}
+
+std::atomic<uint64_t>& ServerMetrics::GetCounter(const std::string& name, const Labels& labels) {
+	{
+		std::shared_lock lock(m_mutex);
+		auto family = m_families.find(name);
+		if (family != m_families.end()) {
+			auto it = family->second.counters.find(labels);
+			if (it != family->second.counters.end())
+				return *it->second;
+		}
+	}
+
+	std::unique_lock lock(m_mutex);
+	auto& counter = GetFamily(name, MetricType::COUNTER).counters[labels];
+	if (!counter)
+		counter = std::make_unique<std::atomic<uint64_t>>(0);
+	return *counter;
+}
+
+std::atomic<int64_t>& ServerMetrics::GetGauge(const std::string& name, const Labels& labels) {
+	{
+		std::shared_lock lock(m_mutex);
+		auto family = m_families.find(name);
+		if (family != m_families.end()) {
+			auto it = family->second.gauges.find(labels);
+			if (it != family->second.gauges.end())
+				return *it->second;
+		}
+	}
+
+	std::unique_lock lock(m_mutex);
+	auto& gauge = GetFamily(name, MetricType::GAUGE).gauges[labels];
+	if (!gauge)
+		gauge = std::make_unique<std::atomic<int64_t>>(0);
+	return *gauge;
+}
+
+LatencyHistogram& ServerMetrics::GetHistogram(const std::string& name, const Labels& labels) {
+	{
+		std::shared_lock lock(m_mutex);
+		auto family = m_families.find(name);
+		if (family != m_families.end()) {
+			auto it = family->second.histograms.find(labels);
+			if (it != family->second.histograms.end())
+				return *it->second;
+		}
+	}
+
+	std::unique_lock lock(m_mutex);
+	auto& histogram = GetFamily(name, MetricType::HISTOGRAM).histograms[labels];
+	if (!histogram)
+		histogram = std::make_unique<LatencyHistogram>();
+	return *histogram;
+}
+
+void ServerMetrics::AddCounter(const std::string& name, const Labels& labels, uint64_t value) {
+	GetCounter(name, labels).fetch_add(value, std::memory_order_relaxed);
+}
+
+void ServerMetrics::SetGauge(const std::string& name, const Labels& labels, int64_t value) {
+	GetGauge(name, labels).store(value, std::memory_order_relaxed);
+}
+
+void ServerMetrics::AddGauge(const std::string& name, const Labels& labels, int64_t delta) {
+	GetGauge(name, labels).fetch_add(delta, std::memory_order_relaxed);
+}
+
+void ServerMetrics::RecordLatency(const std::string& name, const Labels& labels, std::chrono::nanoseconds duration) {
+	GetHistogram(name, labels).Record(duration);
+}
+
+std::string ServerMetrics::WriteText() {
+	std::string out;
+	std::shared_lock lock(m_mutex);
+
+	for (const auto& [name, family] : m_families) {
+		switch (family.type) {
+		case MetricType::COUNTER:
+			out += "# TYPE " + name + " counter\n";
+			for (const auto& [labels, counter] : family.counters)
+				out += name + WrapLabels(labels) + " " + std::to_string(counter->load(std::memory_order_relaxed)) + "\n";
+			break;
+
+		case MetricType::GAUGE:
+			out += "# TYPE " + name + " gauge\n";
+			for (const auto& [labels, gauge] : family.gauges)
+				out += name + WrapLabels(labels) + " " + std::to_string(gauge->load(std::memory_order_relaxed)) + "\n";
+			break;
+
+		case MetricType::HISTOGRAM:
+			out += "# TYPE " + name + " histogram\n";
+			for (const auto& [labels, histogram] : family.histograms) {
+				uint64_t below = 0;
+				for (uint32_t exponent = EXPORT_MIN_EXPONENT; exponent <= EXPORT_MAX_EXPONENT; ++exponent) {
+					double le = static_cast<double>(uint64_t{ 1 } << exponent) / 1e6;
+					below = histogram->CountBelowPowerOfTwo(exponent);
+					out += name + "_bucket" + JoinLabels(labels, "le=\"" + FormatNumber(le) + "\"") + " " +
+						std::to_string(below) + "\n";
+				}
+
+				// values recorded while exporting can make a bucket larger than the count read before it
+				uint64_t count = std::max(histogram->GetCount(), below);
+				out += name + "_bucket" + JoinLabels(labels, "le=\"+Inf\"") + " " + std::to_string(count) + "\n";
+				out += name + "_sum" + WrapLabels(labels) + " " + FormatNumber(histogram->GetSumSeconds()) + "\n";
+				out += name + "_count" + WrapLabels(labels) + " " + std::to_string(count) + "\n";
+			}
+
+			// the quantiles of the exact buckets, for reading the dump without a query engine
+			out += "# TYPE " + name + "_quantile gauge\n";
+			for (const auto& [labels, histogram] : family.histograms) {
+				for (double quantile : EXPORT_QUANTILES) {
+					out += name + "_quantile" + JoinLabels(labels, "quantile=\"" + FormatNumber(quantile) + "\"") + " " +
+						FormatNumber(histogram->GetQuantileSeconds(quantile)) + "\n";
+				}
+			}
+			break;
+		}
+	}
+	return out;
+}
+
+bool ServerMetrics::WriteFile(const std::filesystem::path& path) {
+	std::string text = WriteText();
+
+	std::filesystem::path tmpPath = path;
+	tmpPath += ".tmp";
+	{
+		std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+		file.write(text.data(), static_cast<std::streamsize>(text.size()));
+		if (!file)
+			return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tmpPath, path, error);
+	return !error;
+}
+
+void ServerMetrics::StartDump(const MetricsConfig& config) {
+	if (config.dumpInterval.count() <= 0)
+		return;
+
+	StopDump();
+	{
+		std::lock_guard guard(m_dumpMutex);
+		m_dumpStop = false;
+	}
+	m_dumpThread = std::thread(&ServerMetrics::DumpLoop, config);
+}
+
+void ServerMetrics::StopDump() {
+	{
+		std::lock_guard guard(m_dumpMutex);
+		m_dumpStop = true;
+	}
+	m_dumpCV.notify_all();
+
+	if (m_dumpThread.joinable())
+		m_dumpThread.join();
+}
+
+std::string ServerMetrics::Label(const std::string& key, const std::string& value) {
+	std::string escaped;
+	escaped.reserve(value.size());
+	for (char c : value) {
+		if (c == '\\' || c == '"')
+			escaped += '\\';
+		if (c == '\n') {
+			escaped += "\\n";
+			continue;
+		}
+		escaped += c;
+	}
+	return key + "=\"" + escaped + "\"";
+}
+
+ServerMetrics::Family& ServerMetrics::GetFamily(const std::string& name, MetricType type) {
+	auto [it, inserted] = m_families.try_emplace(name);
+	if (inserted)
+		it->second.type = type;
+	else if (it->second.type != type)
+		throw std::logic_error("ServerMetrics: Metric '" + name + "' is used with two different types");
+	return it->second;
+}
+
+void ServerMetrics::DumpLoop(MetricsConfig config) {
+	bool reported = false;
+	std::unique_lock lock(m_dumpMutex);
+	while (!m_dumpCV.wait_for(lock, config.dumpInterval, []() { return m_dumpStop; })) {
+		lock.unlock();
+		bool written = WriteFile(config.dumpPath);
+		lock.lock();
+
+		// once per failure streak, a missing directory would otherwise flood the console
+		if (!written && !reported)
+			std::cerr << "ServerMetrics: Failed to write metrics to '" << config.dumpPath << "'\n";
+		reported = !written;
+	}
+
+	// the last state, e.g. after a load test ended
+	lock.unlock();
+	WriteFile(config.dumpPath);
+}
@@ -0,0 +1,28 @@
+project "ChessLiteLoadGen"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++17"
+
+    SetTargetAndObjDirs("%{prj.name}")
+
+    -- the networking of the game client is compiled in as is, without the rest of the game
+    files {
+        "src/**.cpp",
+        "src/**.h",
+        "%{wks.location}/Game/ChessLite/src/GameClient.cpp",
+        "%{wks.location}/Game/ChessLite/src/NetProtocol.cpp",
+        "%{wks.location}/Game/ChessLite/src/AI/GameMove.cpp"
+    }
+
+    includedirs {
+        "src",
+        "%{wks.location}/Game/ChessLite/include"
+    }
+
+    IncludeSDLCoreLib()
+    -- copys the SDL DLLs in to the build path of this project
+    CopySDLDLLs()
+
+    ApplyCommonConfigs()
+
+    filter {}
@@ -0,0 +1,877 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <SDL3/SDL.h>
+#include <SDL3_net/SDL_net.h>
+#include <CoreLib/OTNFile.h>
+#include <CoreLib/BinarySerializer.h>
+
+#include "GameClient.h"
+#include "NetProtocol.h"
+#include "AI/GameMove.h"
+
+/*
+* ChessLiteLoadGen
+*
+* Simulates concurrent ChessLite clients against a running game server. Every client runs
+* on its own thread with its own GameClient and sends the requests of AgentSyncService in a
+* closed loop: one action, a think time, the next action. The actions are full syncs, dirty
+* syncs of changed board states, deletes followed by the insert of a new agent and training
+* deltas that are read back from the change feed (train). Every client trains one agent after
+* its inserts, a delta that is answered but not stored fails the run.
+* Whether the server stores into MySQL or the embedded store is decided by its config.otn.
+*
+* usage: ChessLiteLoadGen [--host 127.0.0.1] [--port 5000] [--clients 8] [--duration 30]
+*	[--agents 4] [--states 64] [--moves 8] [--dirty-states 8] [--think 250]
+*	[--mix full:1,dirty:4,delete:1,train:0] [--protocol v1|v2] [--compression on|off] [--seed 1337]
+*/
+
+#pragma region Options
+
+struct Options {
+	std::string host = "127.0.0.1";
+	uint16_t port = 5000;
+	uint32_t clients = 8;
+	uint32_t durationS = 30;
+	uint32_t agents = 4;// < agents every client inserts at the start
+	uint32_t states = 64;// < board states per agent
+	uint32_t moves = 8;// < moves per board state
+	uint32_t dirtyStates = 8;// < board states changed by a dirty sync
+	uint32_t thinkMS = 250;// < mean of the exponential think time between two actions
+	uint32_t seed = 1337;
+	bool binary = true;
+	bool compression = true;
+	std::map<std::string, uint32_t> mix{ { "full", 1 }, { "dirty", 4 }, { "delete", 1 } };
+};
+
+static const char* USAGE =
+	"usage: ChessLiteLoadGen [--host 127.0.0.1] [--port 5000] [--clients 8] [--duration 30]\n"
+	"\t[--agents 4] [--states 64] [--moves 8] [--dirty-states 8] [--think 250]\n"
+	"\t[--mix full:1,dirty:4,delete:1,train:0] [--protocol v1|v2] [--compression on|off] [--seed 1337]\n";
+
+static std::map<std::string, uint32_t> ParseMix(const std::string& str) {
+	std::map<std::string, uint32_t> result;
+	size_t start = 0;
+	while (start < str.size()) {
+		size_t end = str.find(',', start);
+		if (end == std::string::npos)
+			end = str.size();
+
+		std::string entry = str.substr(start, end - start);
+		size_t colon = entry.find(':');
+		if (colon == std::string::npos)
+			throw std::invalid_argument("mix entry '" + entry + "' has no weight");
+
+		std::string action = entry.substr(0, colon);
+		if (action != "full" && action != "dirty" && action != "delete" && action != "train")
+			throw std::invalid_argument("unknown action '" + action + "' in mix");
+
+		result[action] = static_cast<uint32_t>(std::stoul(entry.substr(colon + 1)));
+		start = end + 1;
+	}
+	return result;
+}
+
+#pragma endregion
+
+#pragma region Statistics
+
+struct ActionStats {
+	std::vector<float> latenciesMS;
+	uint64_t errors = 0;
+	uint64_t bytesSent = 0;
+	uint64_t bytesReceived = 0;
+
+	void Merge(const ActionStats& other) {
+		latenciesMS.insert(latenciesMS.end(), other.latenciesMS.begin(), other.latenciesMS.end());
+		errors += other.errors;
+		bytesSent += other.bytesSent;
+		bytesReceived += other.bytesReceived;
+	}
+};
+
+using StatsMap = std::map<std::string, ActionStats>;
+
+// nearest rank, latencies has to be sorted
+static float Percentile(const std::vector<float>& latencies, double quantile) {
+	if (latencies.empty())
+		return 0.0f;
+	size_t rank = static_cast<size_t>(std::ceil(quantile * static_cast<double>(latencies.size())));
+	return latencies[std::clamp<size_t>(rank, 1, latencies.size()) - 1];
+}
+
+static void PrintReport(StatsMap& stats, double seconds) {
+	std::cout
+		<< std::left
+		<< std::setw(12) << "action"
+		<< std::right
+		<< std::setw(10) << "count"
+		<< std::setw(8) << "errors"
+		<< std::setw(10) << "req/s"
+		<< std::setw(10) << "p50 ms"
+		<< std::setw(10) << "p99 ms"
+		<< std::setw(10) << "p999 ms"
+		<< std::setw(10) << "max ms"
+		<< std::setw(10) << "MB out"
+		<< std::setw(10) << "MB in"
+		<< "\n";
+
+	for (auto& [action, s] : stats) {
+		std::sort(s.latenciesMS.begin(), s.latenciesMS.end());
+		double rate = seconds > 0.0 ? static_cast<double>(s.latenciesMS.size()) / seconds : 0.0;
+
+		std::cout
+			<< std::left
+			<< std::setw(12) << action
+			<< std::right << std::fixed << std::setprecision(2)
+			<< std::setw(10) << s.latenciesMS.size()
+			<< std::setw(8) << s.errors
+			<< std::setw(10) << rate
+			<< std::setw(10) << Percentile(s.latenciesMS, 0.5)
+			<< std::setw(10) << Percentile(s.latenciesMS, 0.99)
+			<< std::setw(10) << Percentile(s.latenciesMS, 0.999)
+			<< std::setw(10) << (s.latenciesMS.empty() ? 0.0f : s.latenciesMS.back())
+			<< std::setw(10) << (static_cast<double>(s.bytesSent) / (1024.0 * 1024.0))
+			<< std::setw(10) << (static_cast<double>(s.bytesReceived) / (1024.0 * 1024.0))
+			<< "\n";
+	}
+}
+
+#pragma endregion
+
+#pragma region Agent data
+
+struct SimBoardState {
+	std::string state;
+	std::vector<GameMove> moves;
+};
+
+struct SimAgent {
+	int64_t localID = 0;
+	int64_t serverID = 0;// < 0 until the insert was answered
+	int64_t version = 1;
+	int32_t games = 0;// < games added by training deltas, sent as all four match counters
+	std::string name;
+	std::vector<SimBoardState> states;
+	std::vector<size_t> dirty;// < indices of the states sent by the next dirty sync
+};
+
+static constexpr const char* CHESS_CONFIG = "5x5;kqppp/5/5/5/PPPQK";
+
+static std::string RandomBoardState(std::mt19937& rng) {
+	static const char pieces[] = "..pPkKqQ";
+	std::uniform_int_distribution<int> dist(0, sizeof(pieces) - 2);
+
+	std::string state(25, '.');
+	for (auto& c : state)
+		c = pieces[dist(rng)];
+	return state;
+}
+
+static GameMove RandomMove(std::mt19937& rng) {
+	std::uniform_int_distribution<int> posDist(0, 4);
+	std::uniform_int_distribution<int> evalDist(-8, 8);
+
+	GameMove move(posDist(rng), posDist(rng), posDist(rng), posDist(rng));
+	move.SetEvaluation(static_cast<float>(evalDist(rng)) * 0.125f);
+	return move;
+}
+
+#pragma endregion
+
+#pragma region Simulated client
+
+/*
+* One simulated client, all of its requests are sent and answered on its own thread.
+*/
+class SimClient {
+public:
+	SimClient(const Options& options, uint32_t index)
+		: m_options(options), m_index(index), m_rng(options.seed + index) {
+	}
+
+	/**
+	* @brief Connects, inserts the agents and runs actions until end.
+	* @return false if the client could not connect
+	*/
+	bool Run(std::chrono::steady_clock::time_point end) {
+		if (!Connect())
+			return false;
+
+		std::vector<size_t> all;
+		for (uint32_t i = 0; i < m_options.agents; ++i) {
+			m_agents.push_back(CreateAgent());
+			all.push_back(i);
+		}
+		InsertAgents(all);
+		Wait(end);
+		TrainAgent(end);
+
+		// spreads the clients out, they would otherwise act in lockstep
+		std::uniform_int_distribution<uint32_t> startDist(0, m_options.thinkMS);
+		std::this_thread::sleep_for(std::chrono::milliseconds(startDist(m_rng)));
+
+		while (std::chrono::steady_clock::now() < end && m_client.IsConnected()) {
+			const std::string& action = PickAction();
+			if (action == "full") {
+				FullSync();
+			}
+			else if (action == "dirty") {
+				DirtySync();
+			}
+			else if (action == "delete") {
+				size_t index = DeleteAgent();
+				Wait(end);
+				// keeps the amount of agents, the next dirty sync needs one
+				if (index < m_agents.size() && m_agents[index].serverID == 0)
+					InsertAgents({ index });
+			}
+			else if (action == "train") {
+				TrainAgent(end);
+			}
+			Wait(end);
+			Think(end);
+		}
+
+		m_client.Disconnect();
+		return true;
+	}
+
+	const StatsMap& GetStats() const {
+		return m_stats;
+	}
+
+	uint32_t GetCheckFailures() const {
+		return m_checkFailures;
+	}
+
+private:
+	/*< one action can be several requests, it ends with the last answer */
+	struct ActionTracker {
+		std::string name;
+		std::chrono::steady_clock::time_point start;
+		uint32_t remaining = 0;
+		bool failed = false;
+		uint64_t bytesSent = 0;
+		uint64_t bytesReceived = 0;
+	};
+	using OnAnswer = std::function<void(const std::string&)>;
+
+	const Options& m_options;
+	uint32_t m_index = 0;
+	std::mt19937 m_rng;
+	std::vector<SimAgent> m_agents;
+	int64_t m_nextLocalID = 1;
+	uint32_t m_inFlight = 0;
+	uint32_t m_checkFailures = 0;
+	StatsMap m_stats;
+	GameClient m_client;// < last, its pending callbacks use the members above
+
+	bool Connect() {
+		m_client.UseCompression(m_options.compression);
+		m_client.Connect(m_options.host, m_options.port, [this](bool result, const std::string& error) {
+			if (!result)
+				std::cerr << "Client " << m_index << ": " << error;
+		});
+
+		// the client gives up after its own connect timeout and reports it to the callback
+		while (m_client.IsConnecting()) {
+			m_client.WaitForInput(10);
+			m_client.ProcessReceiveQueue();
+		}
+		if (!m_client.IsConnected())
+			return false;
+
+		// the hello is sent on connect and answered before this request, the protocol is known afterwards
+		auto tracker = StartAction("handshake");
+		SendRequest(tracker, NetOpcode::NONE, WriteRequest("GetAgentIDList", OTN::OTNObject{ "body" }));
+		Wait(std::chrono::steady_clock::now() + std::chrono::seconds(5));
+		return m_client.IsConnected();
+	}
+
+	bool UseBinary() const {
+		return m_options.binary && m_client.UsesBinaryProtocol();
+	}
+
+	SimAgent CreateAgent() {
+		SimAgent agent;
+		agent.localID = m_nextLocalID++;
+		agent.name = "LoadGen_" + std::to_string(m_index) + "_" + std::to_string(agent.localID);
+		agent.states.resize(m_options.states);
+		for (auto& state : agent.states) {
+			state.state = RandomBoardState(m_rng);
+			state.moves.resize(m_options.moves);
+			for (auto& move : state.moves)
+				move = RandomMove(m_rng);
+		}
+		return agent;
+	}
+
+	const std::string& PickAction() {
+		uint32_t total = 0;
+		for (const auto& [action, weight] : m_options.mix)
+			total += weight;
+
+		uint32_t pick = std::uniform_int_distribution<uint32_t>(0, std::max(1u, total) - 1)(m_rng);
+		for (const auto& [action, weight] : m_options.mix) {
+			if (pick < weight)
+				return action;
+			pick -= weight;
+		}
+		return m_options.mix.begin()->first;
+	}
+
+	void Think(std::chrono::steady_clock::time_point end) {
+		if (m_options.thinkMS == 0)
+			return;
+
+		std::exponential_distribution<double> dist(1.0 / static_cast<double>(m_options.thinkMS));
+		auto wake = std::chrono::steady_clock::now() + std::chrono::microseconds(static_cast<int64_t>(dist(m_rng) * 1000.0));
+		std::this_thread::sleep_until(std::min(wake, end));
+	}
+
+#pragma region Requests
+
+	std::shared_ptr<ActionTracker> StartAction(const std::string& name) {
+		auto tracker = std::make_shared<ActionTracker>();
+		tracker->name = name;
+		tracker->start = std::chrono::steady_clock::now();
+		return tracker;
+	}
+
+	void SendRequest(const std::shared_ptr<ActionTracker>& tracker, NetOpcode opcode, const std::string& payload, OnAnswer&& onAnswer = {}) {
+		tracker->remaining++;
+		tracker->bytesSent += payload.size();
+		m_inFlight++;
+
+		m_client.Send(opcode, payload, [this, tracker, onAnswer = std::move(onAnswer)](bool result, const std::string& answer) {
+			m_inFlight--;
+			tracker->bytesReceived += answer.size();
+			if (!result)
+				tracker->failed = true;
+			else if (onAnswer)
+				onAnswer(answer);
+
+			if (--tracker->remaining > 0)
+				return;
+
+			ActionStats& stats = m_stats[tracker->name];
+			stats.bytesSent += tracker->bytesSent;
+			stats.bytesReceived += tracker->bytesReceived;
+			if (tracker->failed) {
+				stats.errors++;
+				return;
+			}
+			stats.latenciesMS.push_back(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - tracker->start).count());
+		});
+	}
+
+	/*< pumps the client until every request was answered or the deadline passed */
+	void Wait(std::chrono::steady_clock::time_point deadline) {
+		while (m_inFlight > 0 && m_client.IsConnected() && std::chrono::steady_clock::now() < deadline) {
+			m_client.ProcessSendQueue();
+			m_client.WaitForInput(5);
+			m_client.ProcessReceiveQueue();
+			m_client.ClearError();
+		}
+	}
+
+	std::string WriteRequest(const std::string& action, const OTN::OTNObject& body) {
+		OTN::OTNWriter writer;
+		writer.AppendObject(m_client.CreateHeaderBlock(action));
+		writer.AppendObject(body);
+
+		std::string msg;
+		if (!writer.SaveToString(msg))
+			std::cerr << "Client " << m_index << ": Failed to write " << action << ": " << writer.GetError() << "\n";
+		return msg;
+	}
+
+	static OTN::OTNObject BuildIDBody(const std::string& column, const std::vector<int64_t>& ids) {
+		OTN::OTNObject body{ "body" };
+		body.SetNames(column);
+		body.SetTypes("int64");
+		body.ReserveDataRows(ids.size());
+		for (int64_t id : ids)
+			body.AddDataRow(id);
+		return body;
+	}
+
+	/*< the agent rows of AgentManager::BuildOTNObjectFromIDs / BuildBinaryFromIDs with the local id */
+	std::string BuildAgents(const std::string& action, const std::vector<size_t>& indices, bool dirtyOnly) {
+		auto statesOf = [&](const SimAgent& agent) {
+			std::vector<const SimBoardState*> states;
+			if (dirtyOnly) {
+				for (size_t i : agent.dirty)
+					states.push_back(&agent.states[i]);
+			}
+			else {
+				for (const auto& state : agent.states)
+					states.push_back(&state);
+			}
+			return states;
+		};
+
+		if (UseBinary()) {
+			BinarySerializer ser;
+			ser.AddField(static_cast<uint32_t>(indices.size()));
+			for (size_t index : indices) {
+				const SimAgent& agent = m_agents[index];
+				ser.AddFields(agent.serverID, agent.version, agent.localID);
+				ser.AddField(agent.name);
+				ser.AddField(std::string(CHESS_CONFIG));
+				ser.AddFields(agent.games, agent.games, agent.games, agent.games);
+
+				auto states = statesOf(agent);
+				ser.AddField(static_cast<uint32_t>(states.size()));
+				for (const SimBoardState* state : states)
+					NetProtocol::AddState(ser, state->state, state->moves);
+			}
+			return NetProtocol::ToPayload(ser);
+		}
+
+		OTN::OTNObject body{ "body" };
+		body.SetNames("server_id", "version", "local_id", "name", "board_states", "config",
+			"matches_played", "matches_won", "matches_played_white", "matches_won_white");
+		body.SetTypes("int64", "int64", "int64", "String", "-", "String", "int", "int", "int", "int");
+		body.ReserveDataRows(indices.size());
+
+		for (size_t index : indices) {
+			const SimAgent& agent = m_agents[index];
+			OTN::OTNObject boardStates{ "BoardState" };
+			boardStates.SetNames("board_state", "moves");
+			boardStates.SetTypes("String", "GameMove[]");
+			for (const SimBoardState* state : statesOf(agent))
+				boardStates.AddDataRow(state->state, state->moves);
+
+			body.AddDataRow(agent.serverID, agent.version, agent.localID, agent.name, boardStates,
+				std::string(CHESS_CONFIG), agent.games, agent.games, agent.games, agent.games);
+		}
+		return WriteRequest(action, body);
+	}
+
+	/*< one game and one new board state for the agent, the body of AgentSyncService::SyncTrainingDeltas */
+	std::string BuildTrainingDelta(const SimAgent& agent, const SimBoardState& state) {
+		if (UseBinary()) {
+			BinarySerializer ser;
+			ser.AddField(uint32_t{ 1 });
+			ser.AddField(agent.serverID);
+			ser.AddFields(int32_t{ 1 }, int32_t{ 1 }, int32_t{ 1 }, int32_t{ 1 });
+			ser.AddField(uint32_t{ 1 });
+			NetProtocol::AddState(ser, state.state, state.moves);
+			return NetProtocol::ToPayload(ser);
+		}
+
+		OTN::OTNObject states{ "BoardState" };
+		states.SetNames("board_state", "moves");
+		states.SetTypes("String", "GameMove[]");
+		states.AddDataRow(state.state, state.moves);
+
+		OTN::OTNObject body{ "body" };
+		body.SetNames("server_id", "matches_played", "matches_won", "matches_played_white", "matches_won_white", "states");
+		body.SetTypes("int64", "int", "int", "int", "int", "-");
+		body.AddDataRow(agent.serverID, 1, 1, 1, 1, states);
+		return WriteRequest("SyncAgentDeltas", body);
+	}
+
+	/*< the changes after since, the answer is the streamed agents, board states, moves and the new sequence */
+	void RequestChanges(int64_t since, OnAnswer&& onAnswer) {
+		auto tracker = StartAction("changes");
+		if (UseBinary()) {
+			SendRequest(tracker, NetOpcode::REQUEST_AGENT_CHANGES, NetProtocol::EncodeSequence(since), std::move(onAnswer));
+			return;
+		}
+
+		OTN::OTNObject body{ "body" };
+		body.SetNames("since");
+		body.SetTypes("int64");
+		body.AddDataRow(since);
+		SendRequest(tracker, NetOpcode::NONE, WriteRequest("RequestAgentChanges", body), std::move(onAnswer));
+	}
+
+	void CheckFailed(const std::string& error) {
+		m_checkFailures++;
+		std::cerr << "Client " << m_index << ": Training check failed: " << error << "\n";
+	}
+
+#pragma endregion
+
+#pragma region Actions
+
+	void InsertAgents(const std::vector<size_t>& indices) {
+		auto tracker = StartAction("insert");
+		bool binary = UseBinary();
+		std::string msg = BuildAgents("SyncMissingData", indices, false);
+
+		SendRequest(tracker, binary ? NetOpcode::SYNC_MISSING_DATA : NetOpcode::NONE, msg, [this](const std::string& answer) {
+			OTN::OTNReader reader;
+			if (!reader.ReadString(answer))
+				return;
+			auto ids = reader.TryGetObject("ids");
+			if (!ids)
+				return;
+
+			for (size_t row = 0; row < ids->GetRowCount(); ++row) {
+				auto localID = ids->TryGetValue<int64_t>(row, "localID");
+				auto serverID = ids->TryGetValue<int64_t>(row, "serverID");
+				if (!localID || !serverID)
+					continue;
+				for (auto& agent : m_agents) {
+					if (agent.localID == *localID)
+						agent.serverID = *serverID;
+				}
+			}
+		});
+	}
+
+	/*< the first sync of AgentSyncService::FullSync, all agents the client does not have and the server id list */
+	void FullSync() {
+		auto tracker = StartAction("full");
+		bool binary = UseBinary();
+		// one frame like the game, a server without batches gets the requests one by one
+		m_client.BeginBatch();
+
+		std::vector<int64_t> known;
+		for (const auto& agent : m_agents) {
+			if (agent.serverID != 0)
+				known.push_back(agent.serverID);
+		}
+
+		if (binary) {
+			SendRequest(tracker, NetOpcode::REQUEST_MISSING_AGENTS, NetProtocol::EncodeIDList(known));
+			SendRequest(tracker, NetOpcode::GET_AGENT_ID_LIST, std::string{});
+		}
+		else {
+			SendRequest(tracker, NetOpcode::NONE, WriteRequest("RequestMissingAgents", BuildIDBody("id", known)));
+			SendRequest(tracker, NetOpcode::NONE, WriteRequest("GetAgentIDList", OTN::OTNObject{ "body" }));
+		}
+		m_client.EndBatch();
+	}
+
+	/*< changes the evaluations of a few board states of one agent and sends only those */
+	void DirtySync() {
+		std::vector<size_t> registered;
+		for (size_t i = 0; i < m_agents.size(); ++i) {
+			if (m_agents[i].serverID != 0)
+				registered.push_back(i);
+		}
+		if (registered.empty())
+			return;
+
+		size_t index = registered[std::uniform_int_distribution<size_t>(0, registered.size() - 1)(m_rng)];
+		SimAgent& agent = m_agents[index];
+		agent.dirty.clear();
+		if (!agent.states.empty()) {
+			std::uniform_int_distribution<size_t> stateDist(0, agent.states.size() - 1);
+			for (uint32_t i = 0; i < m_options.dirtyStates; ++i) {
+				size_t state = stateDist(m_rng);
+				for (auto& move : agent.states[state].moves)
+					move.AddEvaluation(0.125f);
+				if (std::find(agent.dirty.begin(), agent.dirty.end(), state) == agent.dirty.end())
+					agent.dirty.push_back(state);
+			}
+		}
+		// the server only takes newer versions
+		agent.version++;
+
+		auto tracker = StartAction("dirty");
+		bool binary = UseBinary();
+		SendRequest(tracker, binary ? NetOpcode::SYNC_DIRTY_STATES : NetOpcode::NONE, BuildAgents("SyncDirtyStates", { index }, true));
+	}
+
+	/**
+	* @brief Deletes one registered agent, a successful delete replaces it locally with a new one.
+	* @return index of the agent, the caller inserts it if it was replaced once the delete was answered
+	*/
+	size_t DeleteAgent() {
+		std::vector<size_t> registered;
+		for (size_t i = 0; i < m_agents.size(); ++i) {
+			if (m_agents[i].serverID != 0)
+				registered.push_back(i);
+		}
+		if (registered.empty())
+			return m_agents.size();
+
+		size_t index = registered[std::uniform_int_distribution<size_t>(0, registered.size() - 1)(m_rng)];
+		std::vector<int64_t> ids{ m_agents[index].serverID };
+
+		// a failed or unanswered delete keeps the agent, the server still has it
+		auto onDeleted = [this, index, serverID = ids[0]](const std::string&) {
+			if (index < m_agents.size() && m_agents[index].serverID == serverID)
+				m_agents[index] = CreateAgent();
+		};
+
+		auto tracker = StartAction("delete");
+		if (UseBinary())
+			SendRequest(tracker, NetOpcode::SYNC_DELETE_DATA, NetProtocol::EncodeIDList(ids), std::move(onDeleted));
+		else
+			SendRequest(tracker, NetOpcode::NONE, WriteRequest("SyncDeleteData", BuildIDBody("ids", ids)), std::move(onDeleted));
+		return index;
+	}
+
+	/**
+	* @brief Adds a training delta to one agent and reads the agent back from the change feed.
+	*
+	* The delta adds one game and a board state the agent does not have yet. The reply has to
+	* carry the new version and the agent row, state and move of the feed have to match it.
+	*/
+	void TrainAgent(std::chrono::steady_clock::time_point end) {
+		std::vector<size_t> registered;
+		for (size_t i = 0; i < m_agents.size(); ++i) {
+			if (m_agents[i].serverID != 0)
+				registered.push_back(i);
+		}
+		if (registered.empty())
+			return;
+
+		size_t index = registered[std::uniform_int_distribution<size_t>(0, registered.size() - 1)(m_rng)];
+		int64_t serverID = m_agents[index].serverID;
+
+		// the callbacks can outlive this call if the deadline passes, they only touch the shared result
+		struct TrainResult {
+			std::optional<int64_t> since;
+			std::optional<int64_t> version;
+			bool answered = false;
+			std::string error;
+		};
+		auto result = std::make_shared<TrainResult>();
+
+		// a sequence no change has yet only answers with the current sequence
+		RequestChanges(std::numeric_limits<int64_t>::max(), [result](const std::string& answer) {
+			OTN::OTNReader reader;
+			if (!reader.ReadSegmentsString(answer))
+				return;
+			for (const auto& segment : reader.GetSegments()) {
+				auto changes = segment.find("changes");
+				if (changes != segment.end())
+					result->since = changes->second.TryGetValue<int64_t>(0, "sequence");
+			}
+		});
+		Wait(end);
+		if (!result->since)
+			return;
+
+		SimBoardState state{ RandomBoardState(m_rng), { RandomMove(m_rng) } };
+		state.moves[0].SetEvaluation(0.5f);
+
+		auto tracker = StartAction("train");
+		SendRequest(tracker, UseBinary() ? NetOpcode::SYNC_AGENT_DELTAS : NetOpcode::NONE, BuildTrainingDelta(m_agents[index], state),
+			[result, serverID](const std::string& answer) {
+				OTN::OTNReader reader;
+				auto versions = reader.ReadString(answer) ? reader.TryGetObject("Result") : std::nullopt;
+				if (!versions)
+					return;
+				for (size_t row = 0; row < versions->GetRowCount(); ++row) {
+					if (versions->TryGetValue<int64_t>(row, "server_id") == serverID)
+						result->version = versions->TryGetValue<int64_t>(row, "version");
+				}
+			});
+		Wait(end);
+		if (tracker->remaining > 0 || tracker->failed)
+			return;
+		if (!result->version) {
+			CheckFailed("the delta of agent " + std::to_string(serverID) + " was answered without its version");
+			return;
+		}
+
+		// the later syncs of the agent have to include the training
+		SimAgent& agent = m_agents[index];
+		agent.version = *result->version;
+		agent.games++;
+		agent.states.push_back(state);
+		int32_t games = agent.games;
+
+		RequestChanges(*result->since, [result, serverID, state, games](const std::string& answer) {
+			result->answered = true;
+			OTN::OTNReader reader;
+			if (!reader.ReadSegmentsString(answer)) {
+				result->error = "the changes could not be read: " + reader.GetError();
+				return;
+			}
+
+			std::optional<int> version;
+			std::optional<int> played;
+			std::optional<int64_t> stateID;
+			std::optional<float> eval;
+			for (const auto& segment : reader.GetSegments()) {
+				if (auto it = segment.find("agents"); it != segment.end()) {
+					for (size_t row = 0; row < it->second.GetRowCount(); ++row) {
+						if (it->second.TryGetValue<int64_t>(row, "id") != serverID)
+							continue;
+						version = it->second.TryGetValue<int>(row, "version");
+						played = it->second.TryGetValue<int>(row, "matches_played");
+					}
+				}
+				if (auto it = segment.find("board_states"); it != segment.end()) {
+					for (size_t row = 0; row < it->second.GetRowCount(); ++row) {
+						if (it->second.TryGetValue<int64_t>(row, "agent_id") == serverID
+							&& it->second.TryGetValue<std::string>(row, "board_state") == state.state)
+							stateID = it->second.TryGetValue<int64_t>(row, "id");
+					}
+				}
+			}
+			// the moves can be in a later segment than their state
+			for (const auto& segment : reader.GetSegments()) {
+				auto it = segment.find("game_moves");
+				if (it == segment.end() || !stateID)
+					continue;
+				const GameMove& move = state.moves[0];
+				for (size_t row = 0; row < it->second.GetRowCount(); ++row) {
+					if (it->second.TryGetValue<int64_t>(row, "board_state_id") == stateID
+						&& it->second.TryGetValue<int>(row, "from_x") == static_cast<int>(move.GetFrom().x)
+						&& it->second.TryGetValue<int>(row, "from_y") == static_cast<int>(move.GetFrom().y)
+						&& it->second.TryGetValue<int>(row, "to_x") == static_cast<int>(move.GetTo().x)
+						&& it->second.TryGetValue<int>(row, "to_y") == static_cast<int>(move.GetTo().y))
+						eval = it->second.TryGetValue<float>(row, "evaluation");
+				}
+			}
+
+			if (!version || *version != *result->version)
+				result->error = "agent " + std::to_string(serverID) + " has version " + (version ? std::to_string(*version) : "none") + ", the delta answered " + std::to_string(*result->version);
+			else if (!played || *played != games)
+				result->error = "agent " + std::to_string(serverID) + " played " + (played ? std::to_string(*played) : "none") + " games, expected " + std::to_string(games);
+			else if (!eval || std::abs(*eval - state.moves[0].GetEvaluation()) > 1e-4f)
+				result->error = "the trained move of agent " + std::to_string(serverID) + " was not stored";
+		});
+		Wait(end);
+		if (result->answered && !result->error.empty())
+			CheckFailed(result->error);
+	}
+
+#pragma endregion
+};
+
+#pragma endregion
+
+int main(int argc, char** argv) {
+	Options options;
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			bool hasValue = (i + 1 < argc);
+
+			if (arg == "--host" && hasValue) {
+				options.host = argv[++i];
+			}
+			else if (arg == "--port" && hasValue) {
+				options.port = static_cast<uint16_t>(std::stoul(argv[++i]));
+			}
+			else if (arg == "--clients" && hasValue) {
+				options.clients = std::max(1u, static_cast<uint32_t>(std::stoul(argv[++i])));
+			}
+			else if (arg == "--duration" && hasValue) {
+				options.durationS = std::max(1u, static_cast<uint32_t>(std::stoul(argv[++i])));
+			}
+			else if (arg == "--agents" && hasValue) {
+				options.agents = std::max(1u, static_cast<uint32_t>(std::stoul(argv[++i])));
+			}
+			else if (arg == "--states" && hasValue) {
+				options.states = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (arg == "--moves" && hasValue) {
+				options.moves = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (arg == "--dirty-states" && hasValue) {
+				options.dirtyStates = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (arg == "--think" && hasValue) {
+				options.thinkMS = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (arg == "--mix" && hasValue) {
+				options.mix = ParseMix(argv[++i]);
+			}
+			else if (arg == "--protocol" && hasValue) {
+				std::string protocol = argv[++i];
+				if (protocol != "v1" && protocol != "v2")
+					throw std::invalid_argument("protocol has to be v1 or v2");
+				options.binary = (protocol == "v2");
+			}
+			else if (arg == "--compression" && hasValue) {
+				options.compression = (std::string(argv[++i]) != "off");
+			}
+			else if (arg == "--seed" && hasValue) {
+				options.seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else {
+				std::cout << USAGE;
+				return (arg == "--help") ? 0 : 1;
+			}
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Invalid argument: " << e.what() << "\n";
+		return 1;
+	}
+
+	if (options.mix.empty()) {
+		std::cerr << "Invalid argument: the mix has no action\n";
+		return 1;
+	}
+
+	if (!SDL_Init(SDL_INIT_EVENTS)) {
+		std::cerr << "SDL init failed: " << SDL_GetError() << "\n";
+		return 1;
+	}
+	if (!NET_Init()) {
+		std::cerr << "SDL_Net init failed: " << SDL_GetError() << "\n";
+		SDL_Quit();
+		return 1;
+	}
+
+	std::cout << "Running " << options.clients << " clients against " << options.host << ":" << options.port
+		<< " for " << options.durationS << "s (" << options.agents << " agents of " << options.states << "x"
+		<< options.moves << " moves each, protocol " << (options.binary ? "v2" : "v1") << ")\n";
+
+	std::vector<std::unique_ptr<SimClient>> clients;
+	std::vector<std::thread> threads;
+	std::vector<char> connected(options.clients, 0);
+	clients.reserve(options.clients);
+	threads.reserve(options.clients);
+
+	auto start = std::chrono::steady_clock::now();
+	auto end = start + std::chrono::seconds(options.durationS);
+	for (uint32_t i = 0; i < options.clients; ++i) {
+		clients.push_back(std::make_unique<SimClient>(options, i));
+		threads.emplace_back([&, i]() {
+			connected[i] = clients[i]->Run(end) ? 1 : 0;
+		});
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	StatsMap total;
+	size_t connectedCount = 0;
+	uint32_t checkFailures = 0;
+	for (uint32_t i = 0; i < options.clients; ++i) {
+		if (!connected[i])
+			continue;
+		connectedCount++;
+		checkFailures += clients[i]->GetCheckFailures();
+		for (const auto& [action, stats] : clients[i]->GetStats())
+			total[action].Merge(stats);
+	}
+
+	std::cout << connectedCount << "/" << options.clients << " clients connected, ran " << std::fixed << std::setprecision(1) << seconds << "s\n";
+	PrintReport(total, seconds);
+	if (checkFailures > 0)
+		std::cout << checkFailures << " training checks failed\n";
+
+	NET_Quit();
+	SDL_Quit();
+	return (connectedCount == options.clients && checkFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,27 @@
+project "OTNBench"
+    kind "ConsoleApp"
+    language "C++"
+    cppdialect "C++17"
+
+    SetTargetAndObjDirs("%{prj.name}")
+
+    files {
+        "src/**.cpp",
+        "src/**.h"
+    }
+
+    includedirs {
+        "src",
+        "%{wks.location}/Game/CoreLib/include"
+    }
+
+    links {
+        "CoreLib"
+    }
+
+    ApplyCommonConfigs()
+
+    filter "system:windows"
+        links { "psapi" }
+
+    filter {}
@@ -0,0 +1,591 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <CoreLib/OTNFile.h>
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+/*
+* OTNBench
+*
+* Generates synthetic data sets shaped like the real OTN traffic and measures
+* every phase of the reader and writer.
+*
+* usage: OTNBench [--rows 1000,10000,100000] [--iterations 3] [--dataset all|agents|sql]
+*
+* Fails if a check of the results fails, see the Checks region.
+*/
+
+#pragma region Allocation tracking
+
+static std::atomic<size_t> g_allocCount{ 0 };
+static std::atomic<size_t> g_allocBytes{ 0 };
+
+void* operator new(size_t size) {
+	g_allocCount.fetch_add(1, std::memory_order_relaxed);
+	g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+	if (void* ptr = std::malloc(size ? size : 1))
+		return ptr;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+	std::free(ptr);
+}
+
+static size_t GetPeakRSS() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS info{};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &info, sizeof(info)))
+		return 0;
+	return static_cast<size_t>(info.PeakWorkingSetSize);
+#else
+	rusage usage{};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+	#ifdef __APPLE__
+	return static_cast<size_t>(usage.ru_maxrss);
+	#else
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;
+	#endif
+#endif
+}
+
+#pragma endregion
+
+#pragma region Data sets
+
+// same layout as the GameMove of ChessLite, without pulling in the game
+struct BenchMove {
+	float eval = 0.0f;
+	float fromX = 0.0f;
+	float fromY = 0.0f;
+	float toX = 0.0f;
+	float toY = 0.0f;
+};
+
+template<>
+inline void OTN::ToOTNDataType<BenchMove>(OTN::OTNObjectBuilder& obj, BenchMove& move) {
+	obj.SetObjectName("GameMove");
+	obj.AddNames("eval", "from_x", "from_y", "to_x", "to_y");
+	obj.AddData(move.eval, move.fromX, move.fromY, move.toX, move.toY);
+}
+
+static constexpr size_t MOVES_PER_STATE = 8;
+static constexpr size_t STATES_PER_AGENT = 64;
+
+static std::string RandomBoardState(std::mt19937& rng) {
+	static const char pieces[] = "..pPkKqQ";
+	std::uniform_int_distribution<int> dist(0, sizeof(pieces) - 2);
+
+	std::string state(25, '.');
+	for (auto& c : state)
+		c = pieces[dist(rng)];
+	return state;
+}
+
+static BenchMove RandomMove(std::mt19937& rng) {
+	// few distinct values, so row deduplication has something to find
+	std::uniform_int_distribution<int> posDist(0, 4);
+	std::uniform_int_distribution<int> evalDist(-4, 4);
+
+	BenchMove move;
+	move.eval = static_cast<float>(evalDist(rng)) * 0.25f;
+	move.fromX = static_cast<float>(posDist(rng));
+	move.fromY = static_cast<float>(posDist(rng));
+	move.toX = static_cast<float>(posDist(rng));
+	move.toY = static_cast<float>(posDist(rng));
+	return move;
+}
+
+/*
+* Agent file layout: Agent rows -> BoardState objects -> GameMove[] lists
+* rows = total amount of game moves
+*/
+static OTN::OTNObject CreateAgentDataSet(size_t rows) {
+	using namespace OTN;
+	std::mt19937 rng{ 1337 };
+
+	size_t agentCount = std::max<size_t>(1, rows / (MOVES_PER_STATE * STATES_PER_AGENT));
+	size_t statesPerAgent = std::max<size_t>(1, rows / (agentCount * MOVES_PER_STATE));
+
+	OTNObject agentObj{ "Agent" };
+	agentObj.SetNames("server_id", "version", "name", "board_states", "config",
+		"matches_played", "matches_won", "matches_played_white", "matches_won_white");
+	agentObj.SetTypes("int64", "int64", "String", "-", "String", "int", "int", "int", "int");
+	agentObj.ReserveDataRows(agentCount);
+
+	for (size_t a = 0; a < agentCount; a++) {
+		OTNObject boardStateObj{ "BoardState" };
+		boardStateObj.SetNames("board_state", "moves");
+		boardStateObj.SetTypes("String", "GameMove[]");
+		boardStateObj.ReserveDataRows(statesPerAgent);
+
+		for (size_t s = 0; s < statesPerAgent; s++) {
+			std::vector<BenchMove> moves(MOVES_PER_STATE);
+			for (auto& move : moves)
+				move = RandomMove(rng);
+			boardStateObj.AddDataRow(RandomBoardState(rng), moves);
+		}
+
+		agentObj.AddDataRow(
+			static_cast<int64_t>(a + 1),
+			static_cast<int64_t>(a % 7),
+			"Agent_" + std::to_string(a),
+			boardStateObj,
+			std::string("5x5;kqppp/5/5/5/PPPQK"),
+			static_cast<int>(a % 100),
+			static_cast<int>(a % 50),
+			static_cast<int>(a % 60),
+			static_cast<int>(a % 30)
+		);
+	}
+
+	return agentObj;
+}
+
+/*
+* SQL result layout, like the game_moves table returned by the sql server
+*/
+static OTN::OTNObject CreateSQLDataSet(size_t rows) {
+	using namespace OTN;
+	std::mt19937 rng{ 1337 };
+
+	OTNObject result{ "Result" };
+	result.SetNames("id", "board_state_id", "evaluation", "from_x", "from_y", "to_x", "to_y");
+	result.SetTypes("int64", "int64", "float", "int", "int", "int", "int");
+	result.ReserveDataRows(rows);
+
+	for (size_t i = 0; i < rows; i++) {
+		BenchMove move = RandomMove(rng);
+		result.AddDataRow(
+			static_cast<int64_t>(i + 1),
+			static_cast<int64_t>(i / MOVES_PER_STATE + 1),
+			move.eval,
+			static_cast<int>(move.fromX),
+			static_cast<int>(move.fromY),
+			static_cast<int>(move.toX),
+			static_cast<int>(move.toY)
+		);
+	}
+
+	return result;
+}
+
+#pragma endregion
+
+#pragma region Measurement
+
+struct Measurement {
+	double ms = 0.0;
+	size_t allocCount = 0;
+	size_t allocBytes = 0;
+};
+
+// runs func iterations times, keeps the fastest run
+template<typename Func>
+static Measurement Measure(int iterations, Func&& func) {
+	Measurement best;
+	best.ms = -1.0;
+
+	for (int i = 0; i < iterations; i++) {
+		size_t allocCount = g_allocCount.load();
+		size_t allocBytes = g_allocBytes.load();
+		auto start = std::chrono::steady_clock::now();
+
+		func();
+
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (best.ms < 0.0 || ms < best.ms) {
+			best.ms = ms;
+			best.allocCount = g_allocCount.load() - allocCount;
+			best.allocBytes = g_allocBytes.load() - allocBytes;
+		}
+	}
+
+	return best;
+}
+
+static double ToMBs(size_t bytes, double ms) {
+	if (ms <= 0.0)
+		return 0.0;
+	return (static_cast<double>(bytes) / (1024.0 * 1024.0)) / (ms / 1000.0);
+}
+
+static void PrintHeader() {
+	std::cout
+		<< std::left
+		<< std::setw(8) << "dataset"
+		<< std::setw(10) << "rows"
+		<< std::setw(12) << "phase"
+		<< std::setw(7) << "dedup"
+		<< std::right
+		<< std::setw(12) << "ms"
+		<< std::setw(12) << "MB/s"
+		<< std::setw(14) << "allocs"
+		<< std::setw(12) << "alloc MB"
+		<< std::setw(12) << "peak MB"
+		<< "\n";
+}
+
+static void PrintRow(const std::string& dataSet, size_t rows, const std::string& phase,
+	const std::string& dedup, double ms, double mbs, const Measurement* m) {
+	std::cout
+		<< std::left
+		<< std::setw(8) << dataSet
+		<< std::setw(10) << rows
+		<< std::setw(12) << phase
+		<< std::setw(7) << dedup
+		<< std::right << std::fixed << std::setprecision(2)
+		<< std::setw(12) << ms
+		<< std::setw(12) << mbs;
+
+	if (m) {
+		std::cout
+			<< std::setw(14) << m->allocCount
+			<< std::setw(12) << (static_cast<double>(m->allocBytes) / (1024.0 * 1024.0));
+	}
+	else {
+		std::cout << std::setw(14) << "-" << std::setw(12) << "-";
+	}
+
+	std::cout << std::setw(12) << (static_cast<double>(GetPeakRSS()) / (1024.0 * 1024.0)) << "\n";
+}
+
+static size_t AccessRows(const OTN::OTNObject& obj, bool agents) {
+	size_t touched = 0;
+
+	for (size_t i = 0; i < obj.GetRowCount(); i++) {
+		if (agents) {
+			auto name = obj.TryGetValue<std::string>(i, "name");
+			auto boardStates = obj.TryGetValue<std::vector<OTN::OTNObject>>(i, "board_states");
+			if (name)
+				touched++;
+			if (!boardStates)
+				continue;
+
+			for (const auto& state : *boardStates) {
+				auto moves = state.TryGetValue<std::vector<BenchMove>>(0, "moves");
+				if (moves)
+					touched += moves->size();
+			}
+		}
+		else {
+			auto id = obj.TryGetValue<int64_t>(i, "id");
+			auto eval = obj.TryGetValue<float>(i, "evaluation");
+			if (id && eval)
+				touched++;
+		}
+	}
+
+	return touched;
+}
+
+/*
+* Reads dedupText and writes the object name again without dedup, it has to be byte equal to text.
+* Only the root object is written, the reader also lists the referenced objects on their own.
+*/
+static bool CheckSameDocument(const std::string& name, const std::string& text, const std::string& dedupText) {
+	OTN::OTNReader reader;
+	if (!reader.ReadString(dedupText)) {
+		std::cerr << "Read failed: " << reader.GetError() << "\n";
+		return false;
+	}
+
+	auto it = reader.GetObjects().find(name);
+	if (it == reader.GetObjects().end())
+		return false;
+
+	OTN::OTNWriter writer;
+	writer.AppendObject(it->second);
+	writer.UseDeduplicateRows(false);
+
+	std::string rewritten;
+	if (!writer.SaveToString(rewritten)) {
+		std::cerr << "Write failed: " << writer.GetError() << "\n";
+		return false;
+	}
+
+	return rewritten == text;
+}
+
+static bool RunDataSet(const std::string& dataSet, size_t rows, int iterations) {
+	bool agents = (dataSet == "agents");
+	OTN::OTNObject obj = agents ? CreateAgentDataSet(rows) : CreateSQLDataSet(rows);
+
+	if (!obj.IsValid()) {
+		std::cerr << "Failed to create data set '" << dataSet << "': " << obj.GetError() << "\n";
+		return false;
+	}
+
+	std::string text;
+	std::string dedupText;
+	for (bool dedup : { false, true }) {
+		const std::string dedupStr = dedup ? "on" : "off";
+		std::string serialOut;
+
+		for (bool parallel : { false, true }) {
+			std::string out;
+			bool valid = true;
+			Measurement m = Measure(iterations, [&]() {
+				OTN::OTNWriter writer;
+				writer.AppendObject(obj);
+				writer.UseDeduplicateRows(dedup);
+				writer.UseParallelWrite(parallel);
+				valid = writer.SaveToString(out);
+				if (!valid)
+					std::cerr << "Write failed: " << writer.GetError() << "\n";
+			});
+
+			if (!valid)
+				return false;
+
+			PrintRow(dataSet, rows, parallel ? "write-par" : "write", dedupStr, m.ms, ToMBs(out.size(), m.ms), &m);
+
+			// a faster write is worthless if the output changed
+			if (!parallel) {
+				serialOut = std::move(out);
+			}
+			else if (out != serialOut) {
+				std::cerr << "Parallel write (dedup " << dedupStr << ") differs from the serial write\n";
+				return false;
+			}
+		}
+
+		if (dedup)
+			dedupText = std::move(serialOut);
+		else
+			text = std::move(serialOut);
+	}
+
+	if (!CheckSameDocument(obj.GetObjectName(), text, dedupText)) {
+		std::cerr << "Write with dedup does not read back to the data of the write without it\n";
+		return false;
+	}
+
+	OTN::OTNReader::ReadStats stats;
+	std::optional<OTN::OTNObject> readObj;
+	bool valid = true;
+	Measurement readM = Measure(iterations, [&]() {
+		OTN::OTNReader reader;
+		valid = reader.ReadString(text);
+		if (!valid) {
+			std::cerr << "Read failed: " << reader.GetError() << "\n";
+			return;
+		}
+		stats = reader.GetReadStats();
+		readObj = reader.GetObjects().begin()->second;
+	});
+
+	if (!valid)
+		return false;
+
+	PrintRow(dataSet, rows, "read", "-", readM.ms, ToMBs(text.size(), readM.ms), &readM);
+	PrintRow(dataSet, rows, " tokenize", "-", stats.tokenizeMs, ToMBs(text.size(), stats.tokenizeMs), nullptr);
+	PrintRow(dataSet, rows, " parse", "-", stats.parseMs, ToMBs(text.size(), stats.parseMs), nullptr);
+	PrintRow(dataSet, rows, " resolve", "-", stats.resolveMs, ToMBs(text.size(), stats.resolveMs), nullptr);
+
+	size_t touched = 0;
+	Measurement accessM = Measure(iterations, [&]() {
+		touched = AccessRows(*readObj, agents);
+	});
+	PrintRow(dataSet, rows, "access", "-", accessM.ms, ToMBs(text.size(), accessM.ms), &accessM);
+
+	if (touched == 0) {
+		std::cerr << "Row access did not find any data\n";
+		return false;
+	}
+
+	return true;
+}
+
+#pragma endregion
+
+#pragma region Checks
+
+/*
+* A torn last segment, like a crash in the middle of an agent journal append.
+* It has to be dropped and cut off, so the next append is still read back.
+*/
+static bool CheckTornSegmentReplay() {
+	namespace fs = std::filesystem;
+	fs::path path = fs::temp_directory_path() / "OTNBench_journal.otn";
+	std::error_code ec;
+	fs::remove(path, ec);
+
+	auto createEntry = [](int64_t value) {
+		OTN::OTNObject obj{ "Entry" };
+		obj.SetNames("value");
+		obj.SetTypes("int64");
+		obj.AddDataRow(value);
+		return obj;
+	};
+
+	auto appendEntry = [&](int64_t value) {
+		OTN::OTNWriter writer;
+		writer.AppendObject(createEntry(value));
+		return writer.AppendToFile(path);
+	};
+
+	auto readValues = [&](std::vector<int64_t>& outValues, size_t& outValidSize) {
+		OTN::OTNReader reader;
+		if (!reader.ReadSegments(path)) {
+			std::cerr << "Torn segment check: read failed: " << reader.GetError() << "\n";
+			return false;
+		}
+
+		outValues.clear();
+		for (const auto& segment : reader.GetSegments()) {
+			auto it = segment.find("Entry");
+			if (it == segment.end())
+				continue;
+			if (auto value = it->second.TryGetValue<int64_t>(0, "value"))
+				outValues.push_back(*value);
+		}
+		outValidSize = reader.GetSegmentsValidSize();
+		return true;
+	};
+
+	bool ok = appendEntry(1) && appendEntry(2);
+
+	OTN::OTNWriter tornWriter;
+	tornWriter.AppendObject(createEntry(3));
+	std::string torn;
+	ok = ok && tornWriter.SaveToString(torn);
+	if (ok) {
+		std::ofstream file(path, std::ios::binary | std::ios::app);
+		file.write(torn.data(), static_cast<std::streamsize>(torn.size() / 2));
+		ok = file.good();
+	}
+	if (!ok) {
+		std::cerr << "Torn segment check: failed to write the journal\n";
+		return false;
+	}
+
+	std::vector<int64_t> values;
+	size_t validSize = 0;
+	if (!readValues(values, validSize))
+		return false;
+
+	uintmax_t fileSize = fs::file_size(path, ec);
+	if (values != std::vector<int64_t>{ 1, 2 } || ec || validSize >= fileSize) {
+		std::cerr << "Torn segment check: the torn segment was not detected\n";
+		return false;
+	}
+
+	fs::resize_file(path, validSize, ec);
+	if (ec || !appendEntry(4) || !readValues(values, validSize)) {
+		std::cerr << "Torn segment check: failed to append after truncating\n";
+		return false;
+	}
+
+	fileSize = fs::file_size(path, ec);
+	fs::remove(path, ec);
+	if (values != std::vector<int64_t>{ 1, 2, 4 } || validSize != fileSize) {
+		std::cerr << "Torn segment check: the segment appended after the torn one was lost\n";
+		return false;
+	}
+
+	return true;
+}
+
+#pragma endregion
+
+static std::vector<size_t> ParseRowList(const std::string& str) {
+	std::vector<size_t> result;
+	size_t start = 0;
+	while (start < str.size()) {
+		size_t end = str.find(',', start);
+		if (end == std::string::npos)
+			end = str.size();
+
+		size_t value = static_cast<size_t>(std::stoull(str.substr(start, end - start)));
+		if (value > 0)
+			result.push_back(value);
+		start = end + 1;
+	}
+	return result;
+}
+
+int main(int argc, char** argv) {
+	std::vector<size_t> rowCounts{ 1000, 10000, 100000 };
+	int iterations = 3;
+	std::string dataSet = "all";
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			bool hasValue = (i + 1 < argc);
+
+			if (arg == "--rows" && hasValue) {
+				rowCounts = ParseRowList(argv[++i]);
+			}
+			else if (arg == "--iterations" && hasValue) {
+				iterations = std::max(1, std::stoi(argv[++i]));
+			}
+			else if (arg == "--dataset" && hasValue) {
+				dataSet = argv[++i];
+			}
+			else {
+				std::cout << "usage: OTNBench [--rows 1000,10000,100000] [--iterations 3] [--dataset all|agents|sql]\n";
+				return (arg == "--help") ? 0 : 1;
+			}
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Invalid argument: " << e.what() << "\n";
+		return 1;
+	}
+
+	std::vector<std::string> dataSets;
+	if (dataSet == "all" || dataSet == "agents")
+		dataSets.push_back("agents");
+	if (dataSet == "all" || dataSet == "sql")
+		dataSets.push_back("sql");
+
+	bool success = CheckTornSegmentReplay();
+
+	PrintHeader();
+	for (const auto& set : dataSets) {
+		for (size_t rows : rowCounts) {
+			if (!RunDataSet(set, rows, iterations))
+				success = false;
+		}
+	}
+
+	return success ? 0 : 1;
+}
@@ -13,6 +13,7 @@ IF "%~1" == "db-stop" GOTO DbStop
 IF "%~1" == "db-stop-containers" GOTO DbStopContainers
 IF "%~1" == "db-status" GOTO DbStatus
 IF "%~1" == "db-tables" GOTO DbTables
+IF "%~1" == "db-migrate" GOTO DbMigrate
 
 vendor\premake5\premake5.exe %1
 GOTO Done
@@ -31,6 +32,7 @@ echo   db-stop             Stops the MySQL DB and DELETES its volume
 echo   db-stop-containers  Stops the MySQL DB and KEEPS the volume
 echo   db-status           Returns the status of the DB
 echo   db-tables           Lists all tables in the game database
+echo   db-migrate          Updates the tables of an existing DB to Database\migrate.sql
 GOTO Done
 
 :Compile
@@ -125,4 +127,9 @@ echo Showing tables in database %DB_NAME%...
 docker exec -it game-db mysql -u %DB_USER% -p%DB_PASS% -e "USE %DB_NAME%; SHOW TABLES;"
 GOTO Done
 
+:DbMigrate
+echo Migrating database %DB_NAME%...
+docker exec -i game-db mysql -u %DB_USER% -p%DB_PASS% < Database\migrate.sql
+GOTO Done
+
 :Done
\ No newline at end of file
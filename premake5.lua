@@ -73,6 +73,13 @@ group ""
 ------------------------------------
 include "Game/ChessLite"
 include "Server"
+------------------------------------
+-- Tools Includes
+------------------------------------
+group "Tools"
+    include "Tools/OTNBench"
+    include "Tools/ChessLiteLoadGen"
+group ""
 
 --------------------------------------------------------
 -- Custom clean action